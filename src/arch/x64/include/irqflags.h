@@ -5,6 +5,7 @@
 extern "C" {
 #endif
 
+#include <xconfigs.h>
 #include <types.h>
 
 #if !defined(__SANDBOX__)
@@ -24,6 +25,31 @@ static inline irq_flags_t arch_local_irq_save(void)
 static inline void arch_local_irq_restore(irq_flags_t flags)
 {
 }
+#elif defined(CONFIG_MAX_SMP_CPUS) && (CONFIG_MAX_SMP_CPUS > 1)
+extern void sandbox_irq_enable(void);
+extern void sandbox_irq_disable(void);
+extern int sandbox_irq_save(void);
+extern void sandbox_irq_restore(int flags);
+
+static inline void arch_local_irq_enable(void)
+{
+	sandbox_irq_enable();
+}
+
+static inline void arch_local_irq_disable(void)
+{
+	sandbox_irq_disable();
+}
+
+static inline irq_flags_t arch_local_irq_save(void)
+{
+	return sandbox_irq_save();
+}
+
+static inline void arch_local_irq_restore(irq_flags_t flags)
+{
+	sandbox_irq_restore(flags);
+}
 #else
 static inline void arch_local_irq_enable(void)
 {
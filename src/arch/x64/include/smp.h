@@ -12,6 +12,13 @@ static inline int smp_processor_id(void)
 {
 	return 0;
 }
+#elif defined(CONFIG_MAX_SMP_CPUS) && (CONFIG_MAX_SMP_CPUS > 1) && defined(__SANDBOX__)
+extern int sandbox_smp_processor_id(void);
+
+static inline int smp_processor_id(void)
+{
+	return sandbox_smp_processor_id();
+}
 #else
 static inline int smp_processor_id(void)
 {
@@ -12,30 +12,29 @@ extern "C" {
 #if defined(CONFIG_MAX_SMP_CPUS) && (CONFIG_MAX_SMP_CPUS > 1)
 static inline int arch_spin_trylock(spinlock_t * lock)
 {
-	int flag = 0;
+	int tmp = 1;
 
-	mb();
-	if(lock->lock == 0)
-	{
-		lock->lock = 1;
-		flag = 1;
-	}
-	mb();
-	return flag;
+	__asm__ __volatile__ (
+		"xchgl %0, %1\n"
+		:"+r"(tmp), "+m"(lock->lock)
+		:
+		:"memory");
+	return (tmp == 0);
 }
 
 static inline void arch_spin_lock(spinlock_t * lock)
 {
-	mb();
-	while(lock->lock != 0);
-	mb();
+	while(!arch_spin_trylock(lock))
+	{
+		while(lock->lock != 0)
+			__asm__ __volatile__ ("pause\n" ::: "memory");
+	}
 }
 
 static inline void arch_spin_unlock(spinlock_t * lock)
 {
-	mb();
+	__asm__ __volatile__ ("" ::: "memory");
 	lock->lock = 0;
-	mb();
 }
 #else
 static inline int arch_spin_trylock(spinlock_t * lock)
@@ -0,0 +1,318 @@
+/*
+ * arch/x64/lib/crypto.c
+ */
+
+#include <types.h>
+#include <string.h>
+#include <crc32.h>
+#include <sha256.h>
+#include <aes128.h>
+#include <aes256.h>
+#include <immintrin.h>
+#include <xboot/initcall.h>
+#include <xboot/module.h>
+
+/*
+ * The sse4.2 crc32 instruction only does crc32c, so the ieee polynomial is folded with pclmulqdq instead
+ */
+static __attribute__((target("pclmul,sse4.1"))) uint32_t crc32_sum_pclmul(uint32_t crc, const uint8_t * buf, int len)
+{
+	const __m128i k1k2 = _mm_set_epi64x(0x00000001c6e41596ULL, 0x0000000154442bd4ULL);
+	const __m128i k3k4 = _mm_set_epi64x(0x00000000ccaa009eULL, 0x00000001751997d0ULL);
+	const __m128i k5 = _mm_set_epi64x(0, 0x0000000163cd6124ULL);
+	const __m128i poly = _mm_set_epi64x(0x00000001f7011641ULL, 0x00000001db710641ULL);
+	const __m128i mask32 = _mm_set_epi32(0, 0, 0, ~0);
+	__m128i x0, x1, x2, x3, y0, y1, y2, y3;
+	int n;
+
+	if(len < 64)
+		return crc32_sum_generic(crc, buf, len);
+
+	x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)buf), _mm_cvtsi32_si128(~crc));
+	x1 = _mm_loadu_si128((const __m128i *)(buf + 16));
+	x2 = _mm_loadu_si128((const __m128i *)(buf + 32));
+	x3 = _mm_loadu_si128((const __m128i *)(buf + 48));
+	buf += 64;
+	n = len - 64;
+
+	while(n >= 64)
+	{
+		y0 = _mm_clmulepi64_si128(x0, k1k2, 0x11);
+		y1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		y2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		y3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x0 = _mm_xor_si128(_mm_clmulepi64_si128(x0, k1k2, 0x00), y0);
+		x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x00), y1);
+		x2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x00), y2);
+		x3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x00), y3);
+		x0 = _mm_xor_si128(x0, _mm_loadu_si128((const __m128i *)buf));
+		x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)(buf + 16)));
+		x2 = _mm_xor_si128(x2, _mm_loadu_si128((const __m128i *)(buf + 32)));
+		x3 = _mm_xor_si128(x3, _mm_loadu_si128((const __m128i *)(buf + 48)));
+		buf += 64;
+		n -= 64;
+	}
+
+	/*
+	 * Fold the four lanes into one, then the remaining whole 16 bytes blocks
+	 */
+	y0 = _mm_clmulepi64_si128(x0, k3k4, 0x11);
+	x0 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x0, k3k4, 0x00), y0), x1);
+	y0 = _mm_clmulepi64_si128(x0, k3k4, 0x11);
+	x0 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x0, k3k4, 0x00), y0), x2);
+	y0 = _mm_clmulepi64_si128(x0, k3k4, 0x11);
+	x0 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x0, k3k4, 0x00), y0), x3);
+	while(n >= 16)
+	{
+		y0 = _mm_clmulepi64_si128(x0, k3k4, 0x11);
+		x0 = _mm_xor_si128(_mm_clmulepi64_si128(x0, k3k4, 0x00), y0);
+		x0 = _mm_xor_si128(x0, _mm_loadu_si128((const __m128i *)buf));
+		buf += 16;
+		n -= 16;
+	}
+
+	/*
+	 * Reduce 128 to 64 bits, then barrett reduction down to 32 bits
+	 */
+	x1 = _mm_clmulepi64_si128(k3k4, x0, 0x01);
+	x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), x1);
+	x1 = _mm_srli_si128(x0, 4);
+	x0 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x0, mask32), k5, 0x00), x1);
+	x1 = x0;
+	x0 = _mm_and_si128(_mm_clmulepi64_si128(_mm_and_si128(x0, mask32), poly, 0x10), mask32);
+	x0 = _mm_xor_si128(_mm_clmulepi64_si128(x0, poly, 0x00), x1);
+	crc = ~(uint32_t)_mm_extract_epi32(x0, 1);
+
+	return crc32_sum_generic(crc, buf, n);
+}
+
+static const uint32_t sha256_k[64] __attribute__((aligned(16))) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/*
+ * Four rounds, the schedule for the group four steps ahead is produced in place of m0
+ */
+#define SHANI_ROUNDS(i, m0, m1, m2, m3) \
+	do { \
+		wk = _mm_add_epi32(m0, _mm_load_si128((const __m128i *)&sha256_k[(i) << 2])); \
+		s1 = _mm_sha256rnds2_epu32(s1, s0, wk); \
+		if((i) < 12) \
+			m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), _mm_alignr_epi8(m3, m2, 4)), m3); \
+		s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(wk, 0x0e)); \
+	} while(0)
+
+static __attribute__((target("sha,sse4.1"))) void sha256_blocks_shani(uint32_t * state, const uint8_t * data, int blks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i s0, s1, t, abef, cdgh, wk;
+	__m128i m0, m1, m2, m3;
+
+	/*
+	 * The instructions want the state as abef and cdgh
+	 */
+	t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+	s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+	s0 = _mm_alignr_epi8(t, s1, 8);
+	s1 = _mm_blend_epi16(s1, t, 0xf0);
+
+	for(; blks > 0; blks--, data += 64)
+	{
+		abef = s0;
+		cdgh = s1;
+		m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), bswap);
+		m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), bswap);
+		m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), bswap);
+		m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), bswap);
+		SHANI_ROUNDS(0, m0, m1, m2, m3);
+		SHANI_ROUNDS(1, m1, m2, m3, m0);
+		SHANI_ROUNDS(2, m2, m3, m0, m1);
+		SHANI_ROUNDS(3, m3, m0, m1, m2);
+		SHANI_ROUNDS(4, m0, m1, m2, m3);
+		SHANI_ROUNDS(5, m1, m2, m3, m0);
+		SHANI_ROUNDS(6, m2, m3, m0, m1);
+		SHANI_ROUNDS(7, m3, m0, m1, m2);
+		SHANI_ROUNDS(8, m0, m1, m2, m3);
+		SHANI_ROUNDS(9, m1, m2, m3, m0);
+		SHANI_ROUNDS(10, m2, m3, m0, m1);
+		SHANI_ROUNDS(11, m3, m0, m1, m2);
+		SHANI_ROUNDS(12, m0, m1, m2, m3);
+		SHANI_ROUNDS(13, m1, m2, m3, m0);
+		SHANI_ROUNDS(14, m2, m3, m0, m1);
+		SHANI_ROUNDS(15, m3, m0, m1, m2);
+		s0 = _mm_add_epi32(s0, abef);
+		s1 = _mm_add_epi32(s1, cdgh);
+	}
+
+	t = _mm_shuffle_epi32(s0, 0x1b);
+	s1 = _mm_shuffle_epi32(s1, 0xb1);
+	_mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(t, s1, 0xf0));
+	_mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(s1, t, 8));
+}
+
+/*
+ * The expanded keys of the portable code are already in the layout aes-ni expects
+ */
+static __attribute__((target("aes"))) void aesni_encrypt(const uint8_t * xkey, int rounds, const uint8_t * in, uint8_t * out, int blks)
+{
+	__m128i k[15];
+	__m128i b0, b1, b2, b3;
+	int i;
+
+	for(i = 0; i <= rounds; i++)
+		k[i] = _mm_loadu_si128((const __m128i *)(xkey + (i << 4)));
+	for(; blks >= 4; blks -= 4, in += 64, out += 64)
+	{
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 0)), k[0]);
+		b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16)), k[0]);
+		b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 32)), k[0]);
+		b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 48)), k[0]);
+		for(i = 1; i < rounds; i++)
+		{
+			b0 = _mm_aesenc_si128(b0, k[i]);
+			b1 = _mm_aesenc_si128(b1, k[i]);
+			b2 = _mm_aesenc_si128(b2, k[i]);
+			b3 = _mm_aesenc_si128(b3, k[i]);
+		}
+		_mm_storeu_si128((__m128i *)(out + 0), _mm_aesenclast_si128(b0, k[rounds]));
+		_mm_storeu_si128((__m128i *)(out + 16), _mm_aesenclast_si128(b1, k[rounds]));
+		_mm_storeu_si128((__m128i *)(out + 32), _mm_aesenclast_si128(b2, k[rounds]));
+		_mm_storeu_si128((__m128i *)(out + 48), _mm_aesenclast_si128(b3, k[rounds]));
+	}
+	for(; blks > 0; blks--, in += 16, out += 16)
+	{
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), k[0]);
+		for(i = 1; i < rounds; i++)
+			b0 = _mm_aesenc_si128(b0, k[i]);
+		_mm_storeu_si128((__m128i *)out, _mm_aesenclast_si128(b0, k[rounds]));
+	}
+}
+
+static __attribute__((target("aes"))) void aesni_decrypt(const uint8_t * xkey, int rounds, const uint8_t * in, uint8_t * out, int blks)
+{
+	__m128i k[15];
+	__m128i b0, b1, b2, b3;
+	int i;
+
+	/*
+	 * Equivalent inverse cipher, the round keys run backwards through inverse mix columns
+	 */
+	k[0] = _mm_loadu_si128((const __m128i *)(xkey + (rounds << 4)));
+	for(i = 1; i < rounds; i++)
+		k[i] = _mm_aesimc_si128(_mm_loadu_si128((const __m128i *)(xkey + ((rounds - i) << 4))));
+	k[rounds] = _mm_loadu_si128((const __m128i *)xkey);
+	for(; blks >= 4; blks -= 4, in += 64, out += 64)
+	{
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 0)), k[0]);
+		b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16)), k[0]);
+		b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 32)), k[0]);
+		b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 48)), k[0]);
+		for(i = 1; i < rounds; i++)
+		{
+			b0 = _mm_aesdec_si128(b0, k[i]);
+			b1 = _mm_aesdec_si128(b1, k[i]);
+			b2 = _mm_aesdec_si128(b2, k[i]);
+			b3 = _mm_aesdec_si128(b3, k[i]);
+		}
+		_mm_storeu_si128((__m128i *)(out + 0), _mm_aesdeclast_si128(b0, k[rounds]));
+		_mm_storeu_si128((__m128i *)(out + 16), _mm_aesdeclast_si128(b1, k[rounds]));
+		_mm_storeu_si128((__m128i *)(out + 32), _mm_aesdeclast_si128(b2, k[rounds]));
+		_mm_storeu_si128((__m128i *)(out + 48), _mm_aesdeclast_si128(b3, k[rounds]));
+	}
+	for(; blks > 0; blks--, in += 16, out += 16)
+	{
+		b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), k[0]);
+		for(i = 1; i < rounds; i++)
+			b0 = _mm_aesdec_si128(b0, k[i]);
+		_mm_storeu_si128((__m128i *)out, _mm_aesdeclast_si128(b0, k[rounds]));
+	}
+}
+
+static int __aesni = 0;
+static uint32_t (*__crc32_sum)(uint32_t, const uint8_t *, int) = crc32_sum_generic;
+static void (*__sha256_blocks)(uint32_t *, const uint8_t *, int) = sha256_blocks_generic;
+
+uint32_t crc32_sum(uint32_t crc, const uint8_t * buf, int len)
+{
+	return __crc32_sum(crc, buf, len);
+}
+
+void sha256_blocks(uint32_t * state, const uint8_t * data, int blks)
+{
+	__sha256_blocks(state, data, blks);
+}
+
+void aes128_ecb_encrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
+{
+	if(__aesni)
+		aesni_encrypt(ctx->xkey, 10, in, out, blks);
+	else
+		aes128_ecb_encrypt_generic(ctx, in, out, blks);
+}
+
+void aes128_ecb_decrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
+{
+	if(__aesni)
+		aesni_decrypt(ctx->xkey, 10, in, out, blks);
+	else
+		aes128_ecb_decrypt_generic(ctx, in, out, blks);
+}
+
+void aes256_ecb_encrypt(struct aes256_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
+{
+	if(__aesni)
+		aesni_encrypt(ctx->xkey, 14, in, out, blks);
+	else
+		aes256_ecb_encrypt_generic(ctx, in, out, blks);
+}
+
+void aes256_ecb_decrypt(struct aes256_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
+{
+	if(__aesni)
+		aesni_decrypt(ctx->xkey, 14, in, out, blks);
+	else
+		aes256_ecb_decrypt_generic(ctx, in, out, blks);
+}
+
+static inline void cpuid(u32_t leaf, u32_t sub, u32_t * r)
+{
+	__asm__ __volatile__("cpuid" : "=a"(r[0]), "=b"(r[1]), "=c"(r[2]), "=d"(r[3]) : "a"(leaf), "c"(sub));
+}
+
+static __init void crypto_pure_init(void)
+{
+	u32_t r[4];
+	u32_t ecx;
+	int max;
+
+	cpuid(0, 0, r);
+	max = r[0];
+	cpuid(1, 0, r);
+	ecx = r[2];
+	if((ecx & (1 << 1)) && (ecx & (1 << 19)))
+		__crc32_sum = crc32_sum_pclmul;
+	if(ecx & (1 << 25))
+		__aesni = 1;
+	if(max >= 7)
+	{
+		cpuid(7, 0, r);
+		if((r[1] & (1 << 29)) && (ecx & (1 << 19)))
+			__sha256_blocks = sha256_blocks_shani;
+	}
+}
+pure_initcall(crypto_pure_init);
@@ -0,0 +1,482 @@
+/*
+ * arch/x64/lib/string.c
+ */
+
+#include <types.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <xboot/initcall.h>
+#include <xboot/module.h>
+
+/*
+ * SSE2 is part of the x86-64 baseline, AVX2 variants are switched in at boot when the cpu and os support them
+ */
+typedef u64_t __attribute__((__may_alias__, __aligned__(1))) u64u_t;
+typedef u32_t __attribute__((__may_alias__, __aligned__(1))) u32u_t;
+typedef u16_t __attribute__((__may_alias__, __aligned__(1))) u16u_t;
+
+#define ERMS_THRESHOLD		(2048)
+
+static int __erms = 0;
+
+static inline void copy_small(char * d, const char * s, size_t n)
+{
+	if(n >= 8)
+	{
+		u64_t a = *(const u64u_t *)s, b = *(const u64u_t *)(s + n - 8);
+		*(u64u_t *)d = a;
+		*(u64u_t *)(d + n - 8) = b;
+	}
+	else if(n >= 4)
+	{
+		u32_t a = *(const u32u_t *)s, b = *(const u32u_t *)(s + n - 4);
+		*(u32u_t *)d = a;
+		*(u32u_t *)(d + n - 4) = b;
+	}
+	else if(n >= 2)
+	{
+		u16_t a = *(const u16u_t *)s, b = *(const u16u_t *)(s + n - 2);
+		*(u16u_t *)d = a;
+		*(u16u_t *)(d + n - 2) = b;
+	}
+	else if(n)
+	{
+		*d = *s;
+	}
+}
+
+static inline void copy_rep(char * d, const char * s, size_t n)
+{
+	__asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+}
+
+/*
+ * Copies up to 64 bytes, every load is issued before the first store so overlap is harmless
+ */
+static inline void copy_upto64_sse2(char * d, const char * s, size_t n)
+{
+	if(n <= 16)
+	{
+		copy_small(d, s, n);
+	}
+	else if(n <= 32)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)s);
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + n - 16));
+		_mm_storeu_si128((__m128i *)d, a);
+		_mm_storeu_si128((__m128i *)(d + n - 16), b);
+	}
+	else
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)s);
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *)(s + n - 32));
+		__m128i e = _mm_loadu_si128((const __m128i *)(s + n - 16));
+		_mm_storeu_si128((__m128i *)d, a);
+		_mm_storeu_si128((__m128i *)(d + 16), b);
+		_mm_storeu_si128((__m128i *)(d + n - 32), c);
+		_mm_storeu_si128((__m128i *)(d + n - 16), e);
+	}
+}
+
+static void * memcpy_sse2(void * dest, const void * src, size_t n)
+{
+	char * d = dest;
+	const char * s = src;
+	__m128i head, tail;
+	size_t k;
+
+	if(n <= 64)
+	{
+		copy_upto64_sse2(d, s, n);
+		return dest;
+	}
+	if(__erms && (n >= ERMS_THRESHOLD))
+	{
+		copy_rep(d, s, n);
+		return dest;
+	}
+	head = _mm_loadu_si128((const __m128i *)s);
+	tail = _mm_loadu_si128((const __m128i *)(s + n - 16));
+	k = 16 - ((unsigned long)d & 15);
+	_mm_storeu_si128((__m128i *)(d + n - 16), tail);
+	_mm_storeu_si128((__m128i *)d, head);
+	d += k;
+	s += k;
+	n -= k;
+	for(; n > 64; n -= 64, d += 64, s += 64)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)s);
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+		_mm_store_si128((__m128i *)d, a);
+		_mm_store_si128((__m128i *)(d + 16), b);
+		_mm_store_si128((__m128i *)(d + 32), c);
+		_mm_store_si128((__m128i *)(d + 48), e);
+	}
+	for(; n > 16; n -= 16, d += 16, s += 16)
+		_mm_store_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+	return dest;
+}
+
+static __attribute__((target("avx2"))) void * memcpy_avx2(void * dest, const void * src, size_t n)
+{
+	char * d = dest;
+	const char * s = src;
+	__m256i head, tail;
+	size_t k;
+
+	if(n <= 64)
+	{
+		if(n <= 32)
+		{
+			copy_upto64_sse2(d, s, n);
+		}
+		else
+		{
+			__m256i a = _mm256_loadu_si256((const __m256i *)s);
+			__m256i b = _mm256_loadu_si256((const __m256i *)(s + n - 32));
+			_mm256_storeu_si256((__m256i *)d, a);
+			_mm256_storeu_si256((__m256i *)(d + n - 32), b);
+		}
+		return dest;
+	}
+	if(__erms && (n >= ERMS_THRESHOLD))
+	{
+		copy_rep(d, s, n);
+		return dest;
+	}
+	head = _mm256_loadu_si256((const __m256i *)s);
+	tail = _mm256_loadu_si256((const __m256i *)(s + n - 32));
+	k = 32 - ((unsigned long)d & 31);
+	_mm256_storeu_si256((__m256i *)(d + n - 32), tail);
+	_mm256_storeu_si256((__m256i *)d, head);
+	d += k;
+	s += k;
+	n -= k;
+	for(; n > 128; n -= 128, d += 128, s += 128)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *)s);
+		__m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i *)(s + 64));
+		__m256i e = _mm256_loadu_si256((const __m256i *)(s + 96));
+		_mm256_store_si256((__m256i *)d, a);
+		_mm256_store_si256((__m256i *)(d + 32), b);
+		_mm256_store_si256((__m256i *)(d + 64), c);
+		_mm256_store_si256((__m256i *)(d + 96), e);
+	}
+	for(; n > 32; n -= 32, d += 32, s += 32)
+		_mm256_store_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+	return dest;
+}
+
+static void * (*__memcpy)(void *, const void *, size_t) = memcpy_sse2;
+
+/*
+ * Forward and backward loops keep the chunk at the far end in a register, the bulk loop may overwrite it
+ */
+static void * memmove_sse2(void * dest, const void * src, size_t n)
+{
+	char * d = dest;
+	const char * s = src;
+	__m128i head, tail;
+
+	if(n <= 64)
+	{
+		copy_upto64_sse2(d, s, n);
+		return dest;
+	}
+	if(((size_t)(d - s) >= n) && ((size_t)(s - d) >= n))
+		return __memcpy(dest, src, n);
+	if(d < s)
+	{
+		tail = _mm_loadu_si128((const __m128i *)(s + n - 16));
+		for(; n > 16; n -= 16, d += 16, s += 16)
+			_mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+		_mm_storeu_si128((__m128i *)(d + n - 16), tail);
+		return dest;
+	}
+	head = _mm_loadu_si128((const __m128i *)s);
+	for(d += n, s += n; n > 16; n -= 16)
+	{
+		d -= 16;
+		s -= 16;
+		_mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+	}
+	_mm_storeu_si128((__m128i *)dest, head);
+	return dest;
+}
+
+static inline void set_small(char * d, u64_t w, size_t n)
+{
+	if(n >= 8)
+	{
+		*(u64u_t *)d = w;
+		*(u64u_t *)(d + n - 8) = w;
+	}
+	else if(n >= 4)
+	{
+		*(u32u_t *)d = (u32_t)w;
+		*(u32u_t *)(d + n - 4) = (u32_t)w;
+	}
+	else if(n >= 2)
+	{
+		*(u16u_t *)d = (u16_t)w;
+		*(u16u_t *)(d + n - 2) = (u16_t)w;
+	}
+	else if(n)
+	{
+		*d = (char)w;
+	}
+}
+
+static void * memset_sse2(void * s, int c, size_t n)
+{
+	char * d = s;
+	__m128i v;
+	size_t k;
+
+	if(n <= 16)
+	{
+		set_small(d, 0x0101010101010101ULL * (unsigned char)c, n);
+		return s;
+	}
+	v = _mm_set1_epi8((char)c);
+	_mm_storeu_si128((__m128i *)d, v);
+	_mm_storeu_si128((__m128i *)(d + n - 16), v);
+	if(n <= 32)
+		return s;
+	k = 16 - ((unsigned long)d & 15);
+	d += k;
+	n -= k;
+	for(; n > 64; n -= 64, d += 64)
+	{
+		_mm_store_si128((__m128i *)d, v);
+		_mm_store_si128((__m128i *)(d + 16), v);
+		_mm_store_si128((__m128i *)(d + 32), v);
+		_mm_store_si128((__m128i *)(d + 48), v);
+	}
+	for(; n > 16; n -= 16, d += 16)
+		_mm_store_si128((__m128i *)d, v);
+	return s;
+}
+
+static __attribute__((target("avx2"))) void * memset_avx2(void * s, int c, size_t n)
+{
+	char * d = s;
+	__m256i v;
+	size_t k;
+
+	if(n <= 32)
+		return memset_sse2(s, c, n);
+	v = _mm256_set1_epi8((char)c);
+	_mm256_storeu_si256((__m256i *)d, v);
+	_mm256_storeu_si256((__m256i *)(d + n - 32), v);
+	if(n <= 64)
+		return s;
+	k = 32 - ((unsigned long)d & 31);
+	d += k;
+	n -= k;
+	for(; n > 128; n -= 128, d += 128)
+	{
+		_mm256_store_si256((__m256i *)d, v);
+		_mm256_store_si256((__m256i *)(d + 32), v);
+		_mm256_store_si256((__m256i *)(d + 64), v);
+		_mm256_store_si256((__m256i *)(d + 96), v);
+	}
+	for(; n > 32; n -= 32, d += 32)
+		_mm256_store_si256((__m256i *)d, v);
+	return s;
+}
+
+static int memcmp_sse2(const void * s1, const void * s2, size_t n)
+{
+	const unsigned char * a = s1;
+	const unsigned char * b = s2;
+	unsigned int m;
+	size_t i;
+
+	for(; n >= 16; n -= 16, a += 16, b += 16)
+	{
+		m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b))) ^ 0xffff;
+		if(m)
+		{
+			i = __builtin_ctz(m);
+			return a[i] - b[i];
+		}
+	}
+	for(; n > 0; n--, a++, b++)
+	{
+		if(*a != *b)
+			return *a - *b;
+	}
+	return 0;
+}
+
+static __attribute__((target("avx2"))) int memcmp_avx2(const void * s1, const void * s2, size_t n)
+{
+	const unsigned char * a = s1;
+	const unsigned char * b = s2;
+	unsigned int m;
+	size_t i;
+
+	for(; n >= 32; n -= 32, a += 32, b += 32)
+	{
+		m = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)a), _mm256_loadu_si256((const __m256i *)b)));
+		if(m)
+		{
+			i = __builtin_ctz(m);
+			return a[i] - b[i];
+		}
+	}
+	return memcmp_sse2(a, b, n);
+}
+
+/*
+ * Aligned loads never cross a page, so reading past the terminator is safe
+ */
+static size_t strlen_sse2(const char * s)
+{
+	const __m128i z = _mm_setzero_si128();
+	const char * p = (const char *)((unsigned long)s & ~15UL);
+	unsigned int m;
+
+	m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), z)) >> ((unsigned long)s & 15);
+	if(m)
+		return __builtin_ctz(m);
+	for(;;)
+	{
+		p += 16;
+		m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), z));
+		if(m)
+			return p + __builtin_ctz(m) - s;
+	}
+}
+
+static __attribute__((target("avx2"))) size_t strlen_avx2(const char * s)
+{
+	const __m256i z = _mm256_setzero_si256();
+	const char * p = (const char *)((unsigned long)s & ~31UL);
+	unsigned int m;
+
+	m = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), z)) >> ((unsigned long)s & 31);
+	if(m)
+		return __builtin_ctz(m);
+	for(;;)
+	{
+		p += 32;
+		m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), z));
+		if(m)
+			return p + __builtin_ctz(m) - s;
+	}
+}
+
+static void * memchr_sse2(const void * s, int c, size_t n)
+{
+	const unsigned char * p = s;
+	__m128i v = _mm_set1_epi8((char)c);
+	unsigned int m;
+
+	for(; n >= 16; n -= 16, p += 16)
+	{
+		m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), v));
+		if(m)
+			return (void *)(p + __builtin_ctz(m));
+	}
+	for(; n > 0; n--, p++)
+	{
+		if(*p == (unsigned char)c)
+			return (void *)p;
+	}
+	return NULL;
+}
+
+static __attribute__((target("avx2"))) void * memchr_avx2(const void * s, int c, size_t n)
+{
+	const unsigned char * p = s;
+	__m256i v = _mm256_set1_epi8((char)c);
+	unsigned int m;
+
+	for(; n >= 32; n -= 32, p += 32)
+	{
+		m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), v));
+		if(m)
+			return (void *)(p + __builtin_ctz(m));
+	}
+	return memchr_sse2(p, c, n);
+}
+
+static void * (*__memset)(void *, int, size_t) = memset_sse2;
+static int (*__memcmp)(const void *, const void *, size_t) = memcmp_sse2;
+static size_t (*__strlen)(const char *) = strlen_sse2;
+static void * (*__memchr)(const void *, int, size_t) = memchr_sse2;
+
+void * memcpy(void * dest, const void * src, size_t n)
+{
+	return __memcpy(dest, src, n);
+}
+EXPORT_SYMBOL(memcpy);
+
+void * memmove(void * dest, const void * src, size_t n)
+{
+	return memmove_sse2(dest, src, n);
+}
+EXPORT_SYMBOL(memmove);
+
+void * memset(void * s, int c, size_t n)
+{
+	return __memset(s, c, n);
+}
+EXPORT_SYMBOL(memset);
+
+int memcmp(const void * s1, const void * s2, size_t n)
+{
+	return __memcmp(s1, s2, n);
+}
+EXPORT_SYMBOL(memcmp);
+
+size_t strlen(const char * s)
+{
+	return __strlen(s);
+}
+EXPORT_SYMBOL(strlen);
+
+void * memchr(const void * s, int c, size_t n)
+{
+	return __memchr(s, c, n);
+}
+EXPORT_SYMBOL(memchr);
+
+static inline void cpuid(u32_t leaf, u32_t sub, u32_t * r)
+{
+	__asm__ __volatile__("cpuid" : "=a"(r[0]), "=b"(r[1]), "=c"(r[2]), "=d"(r[3]) : "a"(leaf), "c"(sub));
+}
+
+static __init void string_pure_init(void)
+{
+	u32_t r[4], lo, hi;
+	int avx2 = 0;
+
+	cpuid(0, 0, r);
+	if(r[0] < 7)
+		return;
+	cpuid(7, 0, r);
+	__erms = (r[1] >> 9) & 0x1;
+	avx2 = (r[1] >> 5) & 0x1;
+	cpuid(1, 0, r);
+	if(avx2 && ((r[2] & (0x3 << 27)) == (0x3 << 27)))
+	{
+		__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		if((lo & 0x6) == 0x6)
+		{
+			__memcpy = memcpy_avx2;
+			__memset = memset_avx2;
+			__memcmp = memcmp_avx2;
+			__strlen = strlen_avx2;
+			__memchr = memchr_avx2;
+		}
+	}
+}
+pure_initcall(string_pure_init);
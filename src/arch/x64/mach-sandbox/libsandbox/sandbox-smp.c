@@ -0,0 +1,131 @@
+#include <x.h>
+#include <sandbox.h>
+
+struct sandbox_smp_context_t {
+	pthread_t thread;
+	void (*func)(void);
+	int cpu;
+};
+
+static volatile int __kick[64];
+static __thread int __cpuid = 0;
+static __thread volatile int __irq_disabled = 0;
+static __thread void (* volatile __irq_pending)(void) = NULL;
+
+static void * sandbox_smp_thread(void * arg)
+{
+	struct sandbox_smp_context_t * ctx = (struct sandbox_smp_context_t *)arg;
+	sigset_t mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+	__cpuid = ctx->cpu;
+	ctx->func();
+	pthread_exit(NULL);
+}
+
+void sandbox_smpboot(int ncpu, void (*func)(void))
+{
+	struct sandbox_smp_context_t * ctx;
+	pthread_attr_t attr;
+	int i;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if(ncpu > (int)(sizeof(__kick) / sizeof(__kick[0])))
+		ncpu = sizeof(__kick) / sizeof(__kick[0]);
+	for(i = 1; i < ncpu; i++)
+	{
+		ctx = malloc(sizeof(struct sandbox_smp_context_t));
+		if(!ctx)
+			break;
+		ctx->func = func;
+		ctx->cpu = i;
+		if(pthread_create(&ctx->thread, &attr, sandbox_smp_thread, ctx) != 0)
+		{
+			free(ctx);
+			break;
+		}
+	}
+	pthread_attr_destroy(&attr);
+}
+
+int sandbox_smp_processor_id(void)
+{
+	return __cpuid;
+}
+
+void sandbox_idle(void)
+{
+	volatile int * kick = &__kick[__cpuid];
+
+	if(__sync_lock_test_and_set(kick, 0) == 0)
+	{
+		syscall(SYS_futex, kick, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+		__sync_lock_test_and_set(kick, 0);
+	}
+}
+
+void sandbox_kick(int cpu)
+{
+	volatile int * kick = &__kick[cpu];
+
+	if(__sync_lock_test_and_set(kick, 1) == 0)
+		syscall(SYS_futex, kick, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void sandbox_irq_enable(void)
+{
+	void (*handler)(void);
+
+	__irq_disabled = 0;
+	__asm__ __volatile__ ("" ::: "memory");
+	while(__irq_pending)
+	{
+		__irq_disabled = 1;
+		__asm__ __volatile__ ("" ::: "memory");
+		handler = __irq_pending;
+		__irq_pending = NULL;
+		if(handler)
+			handler();
+		__irq_disabled = 0;
+		__asm__ __volatile__ ("" ::: "memory");
+	}
+}
+
+void sandbox_irq_disable(void)
+{
+	__irq_disabled = 1;
+	__asm__ __volatile__ ("" ::: "memory");
+}
+
+int sandbox_irq_save(void)
+{
+	int flags = __irq_disabled;
+
+	__irq_disabled = 1;
+	__asm__ __volatile__ ("" ::: "memory");
+	return flags;
+}
+
+void sandbox_irq_restore(int flags)
+{
+	if(!flags)
+		sandbox_irq_enable();
+}
+
+void sandbox_irq_dispatch(void (*handler)(void))
+{
+	if(__irq_disabled)
+	{
+		__irq_pending = handler;
+	}
+	else
+	{
+		__irq_disabled = 1;
+		handler();
+		__irq_disabled = 0;
+	}
+	__kick[__cpuid] = 1;
+}
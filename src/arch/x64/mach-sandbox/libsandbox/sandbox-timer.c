@@ -1,6 +1,10 @@
 #include <x.h>
 #include <sandbox.h>
 
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id	_sigev_un._tid
+#endif
+
 struct sandbox_timer_context_t {
 	struct {
 		void (*cb)(void *);
@@ -12,7 +16,7 @@ struct sandbox_timer_context_t {
 };
 static struct sandbox_timer_context_t tctx;
 
-static void signal_timer_handler(int signum)
+static void sandbox_timer_handler(void)
 {
 	tctx.its.it_value.tv_sec = 0;
 	tctx.its.it_value.tv_nsec = 0;
@@ -21,9 +25,15 @@ static void signal_timer_handler(int signum)
 		tctx.tcd.cb(tctx.tcd.data);
 }
 
+static void signal_timer_handler(int signum)
+{
+	sandbox_irq_dispatch(sandbox_timer_handler);
+}
+
 void sandbox_timer_init(void)
 {
-	tctx.sev.sigev_notify = SIGEV_SIGNAL;
+	tctx.sev.sigev_notify = SIGEV_THREAD_ID;
+	tctx.sev.sigev_notify_thread_id = syscall(SYS_gettid);
 	tctx.sev.sigev_signo = SIGUSR1;
 	tctx.sev.sigev_value.sival_ptr = &tctx.tid;
 	signal(SIGUSR1, signal_timer_handler);
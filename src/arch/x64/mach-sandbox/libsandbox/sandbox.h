@@ -309,6 +309,19 @@ void sandbox_pm_sleep(void);
  */
 void sandbox_shell(const char * cmd, char * msg, int sz, int async);
 
+/*
+ * Smp interface
+ */
+void sandbox_smpboot(int ncpu, void (*func)(void));
+int sandbox_smp_processor_id(void);
+void sandbox_idle(void);
+void sandbox_kick(int cpu);
+void sandbox_irq_enable(void);
+void sandbox_irq_disable(void);
+int sandbox_irq_save(void);
+void sandbox_irq_restore(int flags);
+void sandbox_irq_dispatch(void (*handler)(void));
+
 /*
  * Socket interface
  */
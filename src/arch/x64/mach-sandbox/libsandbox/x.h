@@ -22,6 +22,7 @@ extern "C" {
 #include <termios.h>
 #include <pthread.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/types.h>
@@ -37,6 +38,7 @@ extern "C" {
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <linux/fb.h>
+#include <linux/futex.h>
 #include <linux/input.h>
 #include <linux/videodev2.h>
 #include <xf86drm.h>
@@ -26,30 +26,46 @@
  *
  */
 
+#include <mprof.h>
 #include <sandbox.h>
 
 void * malloc(size_t size)
 {
-	return sandbox_malloc(size);
+	void * m = sandbox_malloc(size);
+
+	mprof_alloc(m, size, __builtin_return_address(0));
+	return m;
 }
 
 void * memalign(size_t align, size_t size)
 {
-	return sandbox_memalign(align, size);
+	void * m = sandbox_memalign(align, size);
+
+	mprof_alloc(m, size, __builtin_return_address(0));
+	return m;
 }
 
 void * realloc(void * ptr, size_t size)
 {
-	return sandbox_realloc(ptr, size);
+	void * m = sandbox_realloc(ptr, size);
+
+	if(m || (size == 0))
+		mprof_free(ptr);
+	mprof_alloc(m, size, __builtin_return_address(0));
+	return m;
 }
 
 void * calloc(size_t nmemb, size_t size)
 {
-	return sandbox_calloc(nmemb, size);
+	void * m = sandbox_calloc(nmemb, size);
+
+	mprof_alloc(m, nmemb * size, __builtin_return_address(0));
+	return m;
 }
 
 void free(void * ptr)
 {
+	mprof_free(ptr);
 	sandbox_free(ptr);
 }
 
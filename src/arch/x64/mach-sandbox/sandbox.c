@@ -40,6 +40,17 @@ static void mach_smpinit(struct machine_t * mach)
 
 static void mach_smpboot(struct machine_t * mach, void (*func)(void))
 {
+	sandbox_smpboot(CONFIG_MAX_SMP_CPUS, func);
+}
+
+static void mach_idle(struct machine_t * mach)
+{
+	sandbox_idle();
+}
+
+static void mach_kick(struct machine_t * mach, int cpu)
+{
+	sandbox_kick(cpu);
 }
 
 static void mach_shutdown(struct machine_t * mach)
@@ -87,6 +98,8 @@ static struct machine_t sandbox = {
 	.detect 	= mach_detect,
 	.smpinit	= mach_smpinit,
 	.smpboot	= mach_smpboot,
+	.idle		= mach_idle,
+	.kick		= mach_kick,
 	.shutdown	= mach_shutdown,
 	.reboot		= mach_reboot,
 	.sleep		= mach_sleep,
@@ -169,13 +169,12 @@ static int audio_playback_callback(void * data, void * buf, int count)
 	int bytes = 0;
 	int sample;
 	int length;
-	int empty;
 	int i;
 
-	spin_lock_irqsave(&audio->soundpool.lock, flags);
-	empty = list_empty_careful(&audio->soundpool.list);
-	spin_unlock_irqrestore(&audio->soundpool.lock, flags);
-	if(!empty)
+	/*
+	 * The mixer is the only remover, so it walks the pool without the lock
+	 */
+	if(!list_empty(&audio->soundpool.list))
 	{
 		while(count > 0)
 		{
@@ -183,8 +182,7 @@ static int audio_playback_callback(void * data, void * buf, int count)
 			length = sample << 2;
 			memset(left, 0, length);
 			memset(right, 0, length);
-			spin_lock_irqsave(&audio->soundpool.lock, flags);
-			list_for_each_entry_safe(pos, n, &audio->soundpool.list, list)
+			list_for_each_entry_rcu(pos, &audio->soundpool.list, list)
 			{
 				if(pos->loop != 0)
 				{
@@ -212,7 +210,6 @@ static int audio_playback_callback(void * data, void * buf, int count)
 					}
 				}
 			}
-			spin_unlock_irqrestore(&audio->soundpool.lock, flags);
 			p = (int16_t *)result;
 			for(i = 0; i < sample; i++)
 			{
@@ -241,14 +238,14 @@ static int audio_playback_callback(void * data, void * buf, int count)
 
 void audio_playback(struct audio_t * audio, struct sound_t * snd)
 {
-	struct sound_t * pos, * n;
+	struct sound_t * pos;
 	irq_flags_t flags;
 	int found = 0;
 
 	if(audio && snd)
 	{
 		spin_lock_irqsave(&audio->soundpool.lock, flags);
-		list_for_each_entry_safe(pos, n, &audio->soundpool.list, list)
+		list_for_each_entry(pos, &audio->soundpool.list, list)
 		{
 			if(pos == snd)
 			{
@@ -256,12 +253,11 @@ void audio_playback(struct audio_t * audio, struct sound_t * snd)
 				break;
 			}
 		}
+		if(!found)
+			list_add_tail_rcu(&snd->list, &audio->soundpool.list);
 		spin_unlock_irqrestore(&audio->soundpool.lock, flags);
 		if(!found)
 		{
-			spin_lock_irqsave(&audio->soundpool.lock, flags);
-			list_add_tail(&snd->list, &audio->soundpool.list);
-			spin_unlock_irqrestore(&audio->soundpool.lock, flags);
 			audio_playback_start(audio, AUDIO_RATE_48000, AUDIO_FORMAT_S16, 2, audio_playback_callback, audio);
 		}
 	}
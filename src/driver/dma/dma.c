@@ -41,6 +41,23 @@ static ssize_t dmachip_read_ndma(struct kobj_t * kobj, void * buf, size_t size)
 	return sprintf(buf, "%d", chip->ndma);
 }
 
+static void dma_channel_half(void * data)
+{
+	struct dma_channel_t * ch = (struct dma_channel_t *)data;
+
+	if(ch->__half)
+		ch->__half(ch->__data);
+}
+
+static void dma_channel_finish(void * data)
+{
+	struct dma_channel_t * ch = (struct dma_channel_t *)data;
+
+	if(ch->__finish)
+		ch->__finish(ch->__data);
+	waitqueue_wakeup_all(&ch->__wq);
+}
+
 struct dmachip_t * search_dmachip(int dma)
 {
 	struct device_t * pos, * n;
@@ -74,6 +91,7 @@ struct device_t * register_dmachip(struct dmachip_t * chip, struct driver_t * dr
 	for(i = 0; i < chip->ndma; i++)
 	{
 		spin_lock_init(&chip->channel[i].lock);
+		waitqueue_init(&chip->channel[i].__wq);
 		spin_lock_irqsave(&chip->channel[i].lock, flags);
 		if(chip->stop)
 			chip->stop(chip, i);
@@ -85,6 +103,9 @@ struct device_t * register_dmachip(struct dmachip_t * chip, struct driver_t * dr
 		chip->channel[i].data = NULL;
 		chip->channel[i].half = NULL;
 		chip->channel[i].finish = NULL;
+		chip->channel[i].__data = NULL;
+		chip->channel[i].__half = NULL;
+		chip->channel[i].__finish = NULL;
 		spin_unlock_irqrestore(&chip->channel[i].lock, flags);
 	}
 	dev->name = strdup(chip->name);
@@ -129,6 +150,9 @@ void unregister_dmachip(struct dmachip_t * chip)
 				chip->channel[i].data = NULL;
 				chip->channel[i].half = NULL;
 				chip->channel[i].finish = NULL;
+				chip->channel[i].__data = NULL;
+				chip->channel[i].__half = NULL;
+				chip->channel[i].__finish = NULL;
 				spin_unlock_irqrestore(&chip->channel[i].lock, flags);
 			}
 			kobj_remove_self(dev->kobj);
@@ -158,9 +182,12 @@ void dma_start(int dma, void * src, void * dst, int size, int flag, void (*half)
 		chip->channel[offset].size = size;
 		chip->channel[offset].flag = flag;
 		chip->channel[offset].len = 0;
-		chip->channel[offset].data = data;
-		chip->channel[offset].half = half;
-		chip->channel[offset].finish = finish;
+		chip->channel[offset].data = &chip->channel[offset];
+		chip->channel[offset].half = half ? dma_channel_half : NULL;
+		chip->channel[offset].finish = dma_channel_finish;
+		chip->channel[offset].__data = data;
+		chip->channel[offset].__half = half;
+		chip->channel[offset].__finish = finish;
 		if(chip->start)
 			chip->start(chip, offset);
 		spin_unlock_irqrestore(&chip->channel[offset].lock, flags);
@@ -187,7 +214,11 @@ void dma_stop(int dma)
 		chip->channel[offset].data = NULL;
 		chip->channel[offset].half = NULL;
 		chip->channel[offset].finish = NULL;
+		chip->channel[offset].__data = NULL;
+		chip->channel[offset].__half = NULL;
+		chip->channel[offset].__finish = NULL;
 		spin_unlock_irqrestore(&chip->channel[offset].lock, flags);
+		waitqueue_wakeup_all(&chip->channel[offset].__wq);
 	}
 }
 
@@ -200,6 +231,6 @@ void dma_wait(int dma)
 	{
 		offset = dma - chip->base;
 		while(chip->busying(chip, offset))
-			task_yield();
+			waitqueue_wait_event_timeout(&chip->channel[offset].__wq, !chip->busying(chip, offset), ms_to_ktime(1));
 	}
 }
@@ -144,6 +144,7 @@ static struct device_t * key_adc_probe(struct driver_t * drv, struct dtnode_t *
 	}
 
 	timer_init(&pdat->timer, key_adc_timer_function, input);
+	timer_set_slack(&pdat->timer, ms_to_ktime(4));
 	pdat->adc = adc;
 	pdat->keys = keys;
 	pdat->nkeys = nkeys;
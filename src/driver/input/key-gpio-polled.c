@@ -126,6 +126,7 @@ static struct device_t * key_gpio_polled_probe(struct driver_t * drv, struct dtn
 	}
 
 	timer_init(&pdat->timer, key_gpio_polled_timer_function, input);
+	timer_set_slack(&pdat->timer, ms_to_ktime(4));
 	pdat->keys = keys;
 	pdat->nkeys = nkeys;
 	pdat->interval = dt_read_int(n, "poll-interval-ms", 100);
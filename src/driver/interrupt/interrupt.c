@@ -240,6 +240,10 @@ void interrupt_handle_exception(void * regs)
 	{
 		chip = (struct irqchip_t *)(pos->priv);
 		if(chip->dispatch)
+		{
+			trace_event(TRACE_TYPE_IRQ_ENTER, chip->name, chip->base);
 			chip->dispatch(chip);
+			trace_event(TRACE_TYPE_IRQ_EXIT, chip->name, chip->base);
+		}
 	}
 }
@@ -90,6 +90,7 @@ static struct device_t * ledtrigger_breathing_probe(struct driver_t * drv, struc
 	}
 
 	timer_init(&pdat->timer, ledtrigger_breathing_timer_function, trigger);
+	timer_set_slack(&pdat->timer, ms_to_ktime(2));
 	pdat->led = led;
 	pdat->interval = dt_read_int(n, "interval-ms", 20);
 	pdat->period = dt_read_int(n, "period-ms", 3000);
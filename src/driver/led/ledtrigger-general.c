@@ -86,6 +86,7 @@ static struct device_t * ledtrigger_general_probe(struct driver_t * drv, struct
 	}
 
 	timer_init(&pdat->timer, ledtrigger_general_timer_function, trigger);
+	timer_set_slack(&pdat->timer, ms_to_ktime(4));
 	pdat->led = led;
 	pdat->activity = 0;
 	pdat->last_activity = 0;
@@ -105,6 +105,7 @@ static struct device_t * ledtrigger_heartbeat_probe(struct driver_t * drv, struc
 	}
 
 	timer_init(&pdat->timer, ledtrigger_heartbeat_timer_function, trigger);
+	timer_set_slack(&pdat->timer, ms_to_ktime(4));
 	pdat->led = led;
 	pdat->period = dt_read_int(n, "period-ms", 1260);
 	pdat->phase = 0;
@@ -69,53 +69,103 @@ struct nvmem_t * search_first_nvmem(void)
 	return (struct nvmem_t *)dev->priv;
 }
 
-static int kvdb_timer_function(struct timer_t * timer, void * data)
+static int kvdb_pair_compare(const void * a, const void * b)
+{
+	return strcmp(((char * const *)a)[0], ((char * const *)b)[0]);
+}
+
+/*
+ * Only the string copy runs under the lock, the pairs are sorted and formatted with
+ * interrupts enabled. A map that outgrew the snapshot buffer meanwhile takes another round
+ */
+static void kvdb_work_function(struct work_t * work, void * data)
 {
 	struct nvmem_t * m = (struct nvmem_t *)data;
 	struct hmap_entry_t * e;
 	irq_flags_t flags;
 	uint32_t c = 0;
-	char h[8], * s;
-	int size, l = 0;
+	char h[8], ** kv = NULL, * p, * s = NULL;
+	int size, i, n, need, cap = 0, l = 0;
+
+	size = nvmem_capacity(m);
+	if(size > 0)
+		s = malloc(size);
 
-	if(m->kvdb.dirty)
+	while(1)
 	{
 		spin_lock_irqsave(&m->kvdb.lock, flags);
-		hmap_sort(m->kvdb.map);
-
-		size = nvmem_capacity(m);
-		if(size > 0)
+		if(!m->kvdb.dirty)
+		{
+			spin_unlock_irqrestore(&m->kvdb.lock, flags);
+			free(kv);
+			free(s);
+			return;
+		}
+		if(!s)
+		{
+			m->kvdb.dirty = 0;
+			spin_unlock_irqrestore(&m->kvdb.lock, flags);
+			free(kv);
+			return;
+		}
+		n = m->kvdb.map->n;
+		need = n * 2 * sizeof(char *);
+		hmap_for_each_entry(e, m->kvdb.map)
+		{
+			need += strlen(e->key) + strlen(e->value) + 2;
+		}
+		if(kv && (need <= cap))
 		{
-			s = malloc(size);
-			if(s)
+			p = (char *)(kv + n * 2);
+			i = 0;
+			hmap_for_each_entry(e, m->kvdb.map)
 			{
-				memset(s, 0, size);
-				hmap_for_each_entry(e, m->kvdb.map)
-				{
-					if(l + strlen(e->key) + strlen(e->value) + 3 > size)
-						break;
-					l += sprintf((char *)(s + l), "%s=%s;", e->key, e->value);
-				}
-				l += 1;
-				h[4] = (l >>  0) & 0xff;
-				h[5] = (l >>  8) & 0xff;
-				h[6] = (l >> 16) & 0xff;
-				h[7] = (l >> 24) & 0xff;
-				c = crc32_sum(c, (const uint8_t *)(&h[4]), 4);
-				c = crc32_sum(c, (const uint8_t *)s, l);
-				h[0] = (c >>  0) & 0xff;
-				h[1] = (c >>  8) & 0xff;
-				h[2] = (c >> 16) & 0xff;
-				h[3] = (c >> 24) & 0xff;
-				nvmem_write(m, h, 0, 8);
-				nvmem_write(m, s, 8, l);
-				free(s);
+				l = strlen(e->key) + 1;
+				kv[i++] = memcpy(p, e->key, l);
+				p += l;
+				l = strlen(e->value) + 1;
+				kv[i++] = memcpy(p, e->value, l);
+				p += l;
 			}
+			m->kvdb.dirty = 0;
+			spin_unlock_irqrestore(&m->kvdb.lock, flags);
+			break;
 		}
-		m->kvdb.dirty = 0;
 		spin_unlock_irqrestore(&m->kvdb.lock, flags);
+		free(kv);
+		cap = need + 64;
+		kv = malloc(cap);
+		if(!kv)
+		{
+			free(s);
+			return;
+		}
 	}
-	return 0;
+
+	qsort(kv, n, sizeof(char *) * 2, kvdb_pair_compare);
+	memset(s, 0, size);
+	for(i = 0, l = 0; i < n; i++)
+	{
+		if(l + strlen(kv[i * 2]) + strlen(kv[i * 2 + 1]) + 3 > size)
+			break;
+		l += sprintf((char *)(s + l), "%s=%s;", kv[i * 2], kv[i * 2 + 1]);
+	}
+	l += 1;
+	free(kv);
+
+	h[4] = (l >>  0) & 0xff;
+	h[5] = (l >>  8) & 0xff;
+	h[6] = (l >> 16) & 0xff;
+	h[7] = (l >> 24) & 0xff;
+	c = crc32_sum(c, (const uint8_t *)(&h[4]), 4);
+	c = crc32_sum(c, (const uint8_t *)s, l);
+	h[0] = (c >>  0) & 0xff;
+	h[1] = (c >>  8) & 0xff;
+	h[2] = (c >> 16) & 0xff;
+	h[3] = (c >> 24) & 0xff;
+	nvmem_write(m, h, 0, 8);
+	nvmem_write(m, s, 8, l);
+	free(s);
 }
 
 static void hmap_entry_callback(struct hmap_t * m, struct hmap_entry_t * e)
@@ -135,7 +185,8 @@ static void nvmem_init_kvdb(struct nvmem_t * m)
 
 	if(m)
 	{
-		timer_init(&m->kvdb.timer, kvdb_timer_function, m);
+		work_init(&m->kvdb.work, kvdb_work_function, m);
+		timer_set_slack(&m->kvdb.work.timer, ms_to_ktime(500));
 		m->kvdb.map = hmap_alloc(0, hmap_entry_callback);
 		spin_lock_init(&m->kvdb.lock);
 		m->kvdb.dirty = 0;
@@ -202,7 +253,7 @@ struct device_t * register_nvmem(struct nvmem_t * m, struct driver_t * drv)
 
 	if(!register_device(dev))
 	{
-		timer_cancel(&m->kvdb.timer);
+		work_cancel(&m->kvdb.work);
 		hmap_free(m->kvdb.map);
 		kobj_remove_self(dev->kobj);
 		free(dev->name);
@@ -221,7 +272,7 @@ void unregister_nvmem(struct nvmem_t * m)
 		dev = search_device(m->name, DEVICE_TYPE_NVMEM);
 		if(dev && unregister_device(dev))
 		{
-			timer_cancel(&m->kvdb.timer);
+			work_cancel(&m->kvdb.work);
 			hmap_free(m->kvdb.map);
 			kobj_remove_self(dev->kobj);
 			free(dev->name);
@@ -298,7 +349,7 @@ void nvmem_set(struct nvmem_t * m, const char * key, const char * value)
 			hmap_add(m->kvdb.map, key, strdup(value));
 		}
 		if(m->kvdb.dirty)
-			timer_start(&m->kvdb.timer, ms_to_ktime(5000));
+			work_mod_delayed(&m->kvdb.work, ms_to_ktime(5000));
 		spin_unlock_irqrestore(&m->kvdb.lock, flags);
 	}
 }
@@ -326,15 +377,13 @@ void nvmem_clear(struct nvmem_t * m)
 		spin_lock_irqsave(&m->kvdb.lock, flags);
 		hmap_clear(m->kvdb.map);
 		m->kvdb.dirty = 1;
-		timer_start(&m->kvdb.timer, ms_to_ktime(5000));
+		work_mod_delayed(&m->kvdb.work, ms_to_ktime(5000));
 		spin_unlock_irqrestore(&m->kvdb.lock, flags);
 	}
 }
 
 void nvmem_sync(struct nvmem_t * m)
 {
-	while(m && m->kvdb.dirty)
-	{
-		task_yield();
-	}
+	if(m)
+		work_flush(&m->kvdb.work);
 }
@@ -52,7 +52,7 @@ struct sdcard_pdata_t
 {
 	struct block_t blk;
 	struct sdcard_t card;
-	struct timer_t timer;
+	struct work_t work;
 	struct sdhci_t * hci;
 	u8_t buf[512];
 	bool_t online;
@@ -857,12 +857,11 @@ static void sdcard_scan(struct sdcard_pdata_t * pdat)
 	}
 }
 
-static int sdcard_timer_function(struct timer_t * timer, void * data)
+static void sdcard_work_function(struct work_t * work, void * data)
 {
 	struct sdcard_pdata_t * pdat = (struct sdcard_pdata_t *)(data);
 	sdcard_scan(pdat);
-	timer_forward(timer, ms_to_ktime(2000));
-	return 1;
+	work_queue_delayed(work, ms_to_ktime(2000));
 }
 
 void * sdcard_probe(struct sdhci_t * hci)
@@ -879,8 +878,9 @@ void * sdcard_probe(struct sdhci_t * hci)
 	sdcard_scan(pdat);
 	if(pdat->hci->removable)
 	{
-		timer_init(&pdat->timer, sdcard_timer_function, pdat);
-		timer_start(&pdat->timer, ms_to_ktime(2000));
+		work_init(&pdat->work, sdcard_work_function, pdat);
+		timer_set_slack(&pdat->work.timer, ms_to_ktime(250));
+		work_queue_delayed(&pdat->work, ms_to_ktime(2000));
 	}
 	return pdat;
 }
@@ -892,7 +892,7 @@ void sdcard_remove(void * card)
 	if(pdat)
 	{
 		if(pdat->hci->removable)
-			timer_cancel(&pdat->timer);
+			work_cancel(&pdat->work);
 		if(pdat->online && search_block(pdat->blk.name))
 		{
 			unregister_sub_block(&pdat->blk);
@@ -1117,6 +1117,7 @@ static int m_render(lua_State * L)
 		window_region_list_clear(w);
 		window_region_list_fill(w, o);
 		window_present(w, o, (void (*)(struct window_t *, void *))display_draw);
+		frame_reset();
 	}
 	return 0;
 }
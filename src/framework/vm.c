@@ -368,17 +368,66 @@ static int pmain(lua_State * L)
 	return 0;
 }
 
+/*
+ * Small blocks, display objects and the other userdata included, come from slab caches
+ * in 16 bytes classes. Lua passes the old size of every block it resizes or frees, so the
+ * class of a block is always known without a header
+ */
+#define L_ALLOC_CACHE_SHIFT		(4)
+#define L_ALLOC_CACHE_MAX		(256)
+
+static struct kmem_cache_t l_alloc_cache[L_ALLOC_CACHE_MAX >> L_ALLOC_CACHE_SHIFT] = {
+	KMEM_CACHE_INIT("lua-16", 16, 0, NULL),
+	KMEM_CACHE_INIT("lua-32", 32, 0, NULL),
+	KMEM_CACHE_INIT("lua-48", 48, 0, NULL),
+	KMEM_CACHE_INIT("lua-64", 64, 0, NULL),
+	KMEM_CACHE_INIT("lua-80", 80, 0, NULL),
+	KMEM_CACHE_INIT("lua-96", 96, 0, NULL),
+	KMEM_CACHE_INIT("lua-112", 112, 0, NULL),
+	KMEM_CACHE_INIT("lua-128", 128, 0, NULL),
+	KMEM_CACHE_INIT("lua-144", 144, 0, NULL),
+	KMEM_CACHE_INIT("lua-160", 160, 0, NULL),
+	KMEM_CACHE_INIT("lua-176", 176, 0, NULL),
+	KMEM_CACHE_INIT("lua-192", 192, 0, NULL),
+	KMEM_CACHE_INIT("lua-208", 208, 0, NULL),
+	KMEM_CACHE_INIT("lua-224", 224, 0, NULL),
+	KMEM_CACHE_INIT("lua-240", 240, 0, NULL),
+	KMEM_CACHE_INIT("lua-256", 256, 0, NULL),
+};
+
+static inline struct kmem_cache_t * l_alloc_class(size_t size)
+{
+	if((size == 0) || (size > L_ALLOC_CACHE_MAX))
+		return NULL;
+	return &l_alloc_cache[(size - 1) >> L_ALLOC_CACHE_SHIFT];
+}
+
 static void * l_alloc(void * ud, void * ptr, size_t osize, size_t nsize)
 {
+	struct kmem_cache_t * oc = ptr ? l_alloc_class(osize) : NULL;
+	struct kmem_cache_t * nc = l_alloc_class(nsize);
+	void * p;
+
 	if(nsize == 0)
 	{
-		free(ptr);
+		if(oc)
+			kmem_cache_free(oc, ptr);
+		else
+			free(ptr);
 		return NULL;
 	}
-	else
+	if(ptr && (oc == nc))
+		return nc ? ptr : realloc(ptr, nsize);
+	p = nc ? kmem_cache_alloc(nc) : malloc(nsize);
+	if(p && ptr)
 	{
-		return realloc(ptr, nsize);
+		memcpy(p, ptr, (osize < nsize) ? osize : nsize);
+		if(oc)
+			kmem_cache_free(oc, ptr);
+		else
+			free(ptr);
 	}
+	return p;
 }
 
 static int l_panic(lua_State *L)
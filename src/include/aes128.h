@@ -15,6 +15,8 @@ struct aes128_ctx_t {
 };
 
 void aes128_set_key(struct aes128_ctx_t * ctx, uint8_t * key);
+void aes128_ecb_encrypt_generic(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
+void aes128_ecb_decrypt_generic(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
 void aes128_ecb_encrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
 void aes128_ecb_decrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
 void aes128_cbc_encrypt(struct aes128_ctx_t * ctx, uint8_t * iv, uint8_t * in, uint8_t * out, int blks);
@@ -15,6 +15,8 @@ struct aes256_ctx_t {
 };
 
 void aes256_set_key(struct aes256_ctx_t * ctx, uint8_t * key);
+void aes256_ecb_encrypt_generic(struct aes256_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
+void aes256_ecb_decrypt_generic(struct aes256_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
 void aes256_ecb_encrypt(struct aes256_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
 void aes256_ecb_decrypt(struct aes256_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks);
 void aes256_cbc_encrypt(struct aes256_ctx_t * ctx, uint8_t * iv, uint8_t * in, uint8_t * out, int blks);
@@ -7,6 +7,7 @@ extern "C" {
 
 #include <stdint.h>
 
+uint32_t crc32_sum_generic(uint32_t crc, const uint8_t * buf, int len);
 uint32_t crc32_sum(uint32_t crc, const uint8_t * buf, int len);
 
 #ifdef __cplusplus
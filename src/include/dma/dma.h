@@ -77,6 +77,11 @@ struct dma_channel_t
 	void * data;
 	void (*half)(void * data);
 	void (*finish)(void * data);
+
+	void * __data;
+	void (*__half)(void * data);
+	void (*__finish)(void * data);
+	struct waitqueue_t __wq;
 };
 
 struct dmachip_t
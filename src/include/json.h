@@ -59,9 +59,89 @@ struct json_object_entry_t {
 	struct json_value_t * value;
 };
 
+enum json_token_type_t {
+	JSON_TOKEN_ERROR		= -1,
+	JSON_TOKEN_EOF			= 0,
+	JSON_TOKEN_OBJECT_BEGIN	= 1,
+	JSON_TOKEN_OBJECT_END	= 2,
+	JSON_TOKEN_ARRAY_BEGIN	= 3,
+	JSON_TOKEN_ARRAY_END	= 4,
+	JSON_TOKEN_KEY			= 5,
+	JSON_TOKEN_STRING		= 6,
+	JSON_TOKEN_INTEGER		= 7,
+	JSON_TOKEN_DOUBLE		= 8,
+	JSON_TOKEN_BOOLEAN		= 9,
+	JSON_TOKEN_NULL			= 10,
+};
+
+struct json_token_t {
+	enum json_token_type_t type;
+
+	/*
+	 * Keys and strings are raw slices of the source without the quotes,
+	 * use json_string_unescape() when escaped is set
+	 */
+	const char * ptr;
+	unsigned int length;
+	int escaped;
+
+	union {
+		int boolean;
+		int64_t integer;
+		double dbl;
+	} u;
+};
+
+#define JSON_READER_DEPTH		(64)
+
+struct json_reader_t {
+	const char * ptr;
+	const char * end;
+	const char * bol;
+	const char * error;
+	unsigned int line;
+	int state;
+	int depth;
+	char stack[JSON_READER_DEPTH];
+};
+
+#define JSON_WRITER_DEPTH		(64)
+
+struct json_writer_t {
+	char * buf;
+	size_t size;
+	size_t len;
+	void (*flush)(struct json_writer_t * w, const char * buf, size_t len);
+	void * priv;
+	int depth;
+	int overflow;
+	uint64_t comma;
+	int key;
+};
+
 struct json_value_t * json_parse(const char * json, size_t length, char * errbuf);
+struct json_value_t * json_parse_insitu(char * json, size_t length, char * errbuf);
 void json_free(struct json_value_t * value);
 
+void json_reader_init(struct json_reader_t * r, const char * json, size_t length);
+enum json_token_type_t json_reader_next(struct json_reader_t * r, struct json_token_t * t);
+int json_reader_skip(struct json_reader_t * r);
+unsigned int json_string_unescape(char * dst, const char * src, unsigned int length);
+
+void json_writer_init(struct json_writer_t * w, char * buf, size_t size, void (*flush)(struct json_writer_t *, const char *, size_t), void * priv);
+void json_writer_flush(struct json_writer_t * w);
+void json_writer_object_begin(struct json_writer_t * w);
+void json_writer_object_end(struct json_writer_t * w);
+void json_writer_array_begin(struct json_writer_t * w);
+void json_writer_array_end(struct json_writer_t * w);
+void json_writer_key(struct json_writer_t * w, const char * key);
+void json_writer_string(struct json_writer_t * w, const char * s);
+void json_writer_integer(struct json_writer_t * w, int64_t v);
+void json_writer_double(struct json_writer_t * w, double v);
+void json_writer_boolean(struct json_writer_t * w, int v);
+void json_writer_null(struct json_writer_t * w);
+void json_writer_raw(struct json_writer_t * w, const char * s, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
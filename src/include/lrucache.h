@@ -0,0 +1,82 @@
+#ifndef __LRUCACHE_H__
+#define __LRUCACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <stdint.h>
+#include <list.h>
+#include <spinlock.h>
+
+#define LRUCACHE_INLINE_KEY		(48)
+
+enum lrucache_policy_t {
+	LRUCACHE_POLICY_LRU		= 0,
+	LRUCACHE_POLICY_2Q		= 1,
+};
+
+struct lrucache_node_t {
+	struct list_head entry;
+	struct lrucache_node_t * hnext;
+	uint32_t hash;
+	int nkey;
+	int hot;
+	char * key;
+	void * value;
+	size_t size;
+	char ikey[LRUCACHE_INLINE_KEY];
+};
+
+struct lrucache_shard_t {
+	spinlock_t lock;
+	struct lrucache_node_t ** table;
+	unsigned int mask;
+	unsigned int count;
+	struct list_head cold;
+	struct list_head hot;
+	size_t budget;
+	size_t bytes;
+	size_t cbytes;
+	unsigned long hit;
+	unsigned long miss;
+	unsigned long insert;
+	unsigned long evict;
+};
+
+struct lrucache_stat_t {
+	size_t budget;
+	size_t bytes;
+	unsigned long count;
+	unsigned long hit;
+	unsigned long miss;
+	unsigned long insert;
+	unsigned long evict;
+};
+
+struct lrucache_t {
+	struct lrucache_shard_t * shard;
+	unsigned int nshard;
+	int policy;
+	void (*callback)(struct lrucache_t * c, const char * key, int nkey, void * value, size_t size);
+};
+
+/*
+ * Byte budgeted cache of caller values, split into independently locked shards.
+ * With the 2Q policy new entries wait in a cold queue and only a second hit
+ * promotes them, so one pass over many keys can't flush the hot set.
+ */
+struct lrucache_t * lrucache_alloc(size_t budget, int nshard, int policy, void (*cb)(struct lrucache_t *, const char *, int, void *, size_t));
+void lrucache_free(struct lrucache_t * c);
+void lrucache_clear(struct lrucache_t * c);
+void * lrucache_get(struct lrucache_t * c, const char * key, int nkey);
+int lrucache_set(struct lrucache_t * c, const char * key, int nkey, void * value, size_t size);
+int lrucache_remove(struct lrucache_t * c, const char * key, int nkey);
+void lrucache_stat(struct lrucache_t * c, struct lrucache_stat_t * st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LRUCACHE_H__ */
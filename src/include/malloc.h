@@ -24,6 +24,7 @@ void * realloc(void * ptr, size_t size);
 void * calloc(size_t nmemb, size_t size);
 void free(void * ptr);
 void meminfo(size_t * mused, size_t * mfree);
+int memwalk(void (*cb)(void * ptr, size_t size, int used, void * data), void * data);
 
 void do_init_mem(void);
 
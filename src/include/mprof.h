@@ -0,0 +1,46 @@
+#ifndef __MPROF_H__
+#define __MPROF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <stddef.h>
+
+struct mprof_site_t {
+	void * caller;
+	unsigned long count;
+	unsigned long total;
+	size_t bytes;
+	size_t peak;
+};
+
+extern volatile int __mprof_enabled;
+
+void __mprof_alloc(void * ptr, size_t size, void * caller);
+void __mprof_free(void * ptr);
+
+static inline void mprof_alloc(void * ptr, size_t size, void * caller)
+{
+	if(unlikely(__mprof_enabled) && ptr)
+		__mprof_alloc(ptr, size, caller);
+}
+
+static inline void mprof_free(void * ptr)
+{
+	if(unlikely(__mprof_enabled) && ptr)
+		__mprof_free(ptr);
+}
+
+int mprof_start(void);
+void mprof_stop(void);
+void mprof_clear(void);
+int mprof_snapshot(struct mprof_site_t * site, int n);
+void mprof_summary(unsigned long * blocks, size_t * bytes, unsigned long * dropped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPROF_H__ */
@@ -11,7 +11,7 @@ struct nvmem_t
 {
 	char * name;
 	struct {
-		struct timer_t timer;
+		struct work_t work;
 		struct hmap_t * map;
 		spinlock_t lock;
 		int dirty;
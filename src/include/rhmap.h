@@ -0,0 +1,45 @@
+#ifndef __RHMAP_H__
+#define __RHMAP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <stdint.h>
+
+/*
+ * Open addressing hash map with robin hood probing. Keys are owned by the
+ * caller and must stay valid while they are in the map. Growing is done
+ * incrementally, a few slots per add or remove. Not thread safe.
+ */
+struct rhmap_slot_t {
+	const char * key;
+	void * value;
+	uint32_t hash;
+	uint32_t dist;
+};
+
+struct rhmap_t {
+	struct rhmap_slot_t * slot;
+	unsigned int size;
+	unsigned int n;
+
+	struct rhmap_slot_t * old;
+	unsigned int osize;
+	unsigned int ocursor;
+};
+
+struct rhmap_t * rhmap_alloc(int size);
+void rhmap_free(struct rhmap_t * m);
+void rhmap_clear(struct rhmap_t * m);
+int rhmap_add(struct rhmap_t * m, const char * key, void * value);
+void rhmap_remove(struct rhmap_t * m, const char * key);
+void * rhmap_search(struct rhmap_t * m, const char * key);
+void rhmap_walk(struct rhmap_t * m, void (*cb)(const char * key, void * value, void * data), void * data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RHMAP_H__ */
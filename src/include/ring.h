@@ -0,0 +1,74 @@
+#ifndef __RING_H__
+#define __RING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <atomic.h>
+
+#define RING_CACHE_LINE		(64)
+
+/*
+ * Single producer, single consumer ring of fixed size elements. Neither side
+ * takes a lock, the producer only writes head and the consumer only writes tail
+ */
+struct ring_t {
+	unsigned int head;
+	unsigned int ctail;
+	char __pad0[RING_CACHE_LINE - 2 * sizeof(unsigned int)];
+	unsigned int tail;
+	unsigned int chead;
+	char __pad1[RING_CACHE_LINE - 2 * sizeof(unsigned int)];
+	unsigned int mask;
+	unsigned int esize;
+	unsigned char * buffer;
+};
+
+/*
+ * Bounded multi producer, multi consumer ring, each cell carries a sequence
+ * number telling whether it is free, being filled, full or being drained
+ */
+struct mpmc_cell_t {
+	atomic_t seq;
+	unsigned int ticket;
+};
+
+struct mpmc_ring_t {
+	atomic_t head;
+	char __pad0[RING_CACHE_LINE - sizeof(atomic_t)];
+	atomic_t tail;
+	char __pad1[RING_CACHE_LINE - sizeof(atomic_t)];
+	unsigned int mask;
+	unsigned int esize;
+	unsigned int stride;
+	unsigned char * buffer;
+};
+
+struct ring_t * ring_alloc(unsigned int esize, unsigned int count);
+void ring_free(struct ring_t * r);
+void ring_reset(struct ring_t * r);
+unsigned int ring_count(struct ring_t * r);
+void * ring_reserve(struct ring_t * r, unsigned int * n);
+void ring_commit(struct ring_t * r, unsigned int n);
+void * ring_peek(struct ring_t * r, unsigned int * n);
+void ring_release(struct ring_t * r, unsigned int n);
+int ring_enqueue(struct ring_t * r, const void * e);
+unsigned int ring_dequeue(struct ring_t * r, void * buf, unsigned int n);
+
+struct mpmc_ring_t * mpmc_ring_alloc(unsigned int esize, unsigned int count);
+void mpmc_ring_free(struct mpmc_ring_t * r);
+unsigned int mpmc_ring_count(struct mpmc_ring_t * r);
+void * mpmc_ring_reserve(struct mpmc_ring_t * r);
+void mpmc_ring_commit(struct mpmc_ring_t * r, void * e);
+void * mpmc_ring_peek(struct mpmc_ring_t * r);
+void mpmc_ring_release(struct mpmc_ring_t * r, void * e);
+int mpmc_ring_enqueue(struct mpmc_ring_t * r, const void * e);
+unsigned int mpmc_ring_dequeue(struct mpmc_ring_t * r, void * buf, unsigned int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RING_H__ */
@@ -15,6 +15,8 @@ struct sha256_ctx_t {
 	uint32_t state[8];
 };
 
+void sha256_blocks_generic(uint32_t * state, const uint8_t * data, int blks);
+void sha256_blocks(uint32_t * state, const uint8_t * data, int blks);
 void sha256_init(struct sha256_ctx_t * ctx);
 void sha256_update(struct sha256_ctx_t * ctx, const void * data, int len);
 const uint8_t * sha256_final(struct sha256_ctx_t * ctx);
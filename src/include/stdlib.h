@@ -37,15 +37,27 @@ long long strtoll(const char * nptr, char ** endptr, int base);
 unsigned long strtoul(const char * nptr, char ** endptr, int base);
 unsigned long long strtoull(const char * nptr, char ** endptr, int base);
 double strtod(const char * nptr, char ** endptr);
+int dtoa(double v, char * buf);
 
 intmax_t strtoimax(const char * nptr, char ** endptr, int base);
 uintmax_t strtoumax(const char * nptr, char ** endptr, int base);
 intmax_t strntoimax(const char * nptr, char ** endptr, int base, size_t n);
 uintmax_t strntoumax(const char * nptr, char ** endptr, int base, size_t n);
 
+int __dtoa(double v, int mode, int ndigits, char * digits, int * decpt);
+int __bigdec(u64_t m, int e, char * digits, int * decpt);
+u64_t __cached_pow10(int * k, int * e);
+
 void * bsearch(const void * key, const void * base, size_t nmemb, size_t size,
 		int (*compar)(const void *, const void *));
 void qsort(void * aa, size_t n, size_t es, int (*cmp)(const void *, const void *));
+void qsort_stable(void * base, size_t n, size_t es, int (*cmp)(const void *, const void *));
+void radixsort_u32(u32_t * a, size_t n);
+void radixsort_s32(s32_t * a, size_t n);
+void radixsort_u64(u64_t * a, size_t n);
+void radixsort_s64(s64_t * a, size_t n);
+void radixsort_float(float * a, size_t n);
+void radixsort_double(double * a, size_t n);
 
 #ifdef __cplusplus
 }
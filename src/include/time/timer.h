@@ -5,6 +5,7 @@
 extern "C" {
 #endif
 
+#include <list.h>
 #include <rbtree_augmented.h>
 #include <clockevent/clockevent.h>
 #include <xboot/ktime.h>
@@ -12,6 +13,12 @@ extern "C" {
 struct timer_base_t;
 struct timer_t;
 
+#define TIMER_WHEEL_BITS		(6)
+#define TIMER_WHEEL_SIZE		(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_SHIFT		(3)
+#define TIMER_WHEEL_LEVELS		(6)
+#define TIMER_WHEEL_TICK		(1000000ULL)
+
 enum timer_state_t {
 	TIMER_STATE_INACTIVE = 0,
 	TIMER_STATE_ENQUEUED = 1,
@@ -21,20 +28,29 @@ enum timer_state_t {
 struct timer_base_t {
 	struct rb_root head;
 	struct timer_t * next;
-	struct clockevent_t * ce;
+	struct hlist_head wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+	struct hlist_head expired;
+	uint64_t pending[TIMER_WHEEL_LEVELS];
+	uint64_t clk;
+	struct timer_t * running;
+	int running_cpu;
 	spinlock_t lock;
 };
 
 struct timer_t {
 	struct rb_node node;
+	struct hlist_node entry;
 	struct timer_base_t * base;
 	enum timer_state_t state;
 	ktime_t expires;
+	ktime_t slack;
+	int index;
 	void * data;
 	int (*function)(struct timer_t *, void *);
 };
 
 void timer_init(struct timer_t * timer, int (*function)(struct timer_t *, void *), void * data);
+void timer_set_slack(struct timer_t * timer, ktime_t slack);
 void timer_start(struct timer_t * timer, ktime_t interval);
 void timer_forward(struct timer_t * timer, ktime_t interval);
 void timer_cancel(struct timer_t * timer);
@@ -45,8 +45,11 @@ extern "C" {
 #include <lsort.h>
 #include <slist.h>
 #include <lru.h>
+#include <lrucache.h>
 #include <hmap.h>
+#include <rhmap.h>
 #include <fifo.h>
+#include <ring.h>
 #include <queue.h>
 #include <ssize.h>
 #include <spring.h>
@@ -56,10 +59,15 @@ extern "C" {
 #include <charset.h>
 #include <version.h>
 #include <xboot/kobj.h>
+#include <xboot/slab.h>
+#include <xboot/arena.h>
 #include <xboot/ktime.h>
 #include <xboot/seqlock.h>
+#include <xboot/rwlock.h>
+#include <xboot/rcu.h>
 #include <xboot/event.h>
 #include <xboot/profiler.h>
+#include <xboot/trace.h>
 #include <xboot/notifier.h>
 #include <xboot/initcall.h>
 #include <xboot/machine.h>
@@ -67,9 +75,11 @@ extern "C" {
 #include <xboot/device.h>
 #include <xboot/driver.h>
 #include <xboot/task.h>
+#include <xboot/waitqueue.h>
 #include <xboot/mutex.h>
 #include <xboot/waiter.h>
 #include <xboot/channel.h>
+#include <xboot/workqueue.h>
 #include <xboot/window.h>
 #include <xboot/module.h>
 #include <xboot/setting.h>
@@ -0,0 +1,44 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <xconfigs.h>
+#include <types.h>
+#include <stddef.h>
+#include <list.h>
+
+struct task_t;
+
+struct frame_arena_t {
+	struct list_head entry;
+	struct list_head overflow;
+	struct task_t * task;
+	char * base;
+	size_t size;
+	size_t used;
+	size_t last;
+	size_t ovused;
+	size_t frame;
+	size_t peak;
+	unsigned long nframe;
+	unsigned long noverflow;
+};
+
+/*
+ * Scratch memory owned by the calling task, reclaimed in one go by frame_reset()
+ * at the end of each frame. Must be released by the task that allocated it. Without
+ * a calling task it comes straight from malloc and has to be given back by frame_free().
+ */
+void * frame_alloc(size_t size);
+void frame_free(void * ptr);
+void frame_reset(void);
+void frame_arena_free(struct frame_arena_t * a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ARENA_H__ */
@@ -8,6 +8,7 @@ extern "C" {
 #include <types.h>
 #include <list.h>
 #include <spinlock.h>
+#include <xboot/waitqueue.h>
 
 struct channel_t {
 	unsigned char * buffer;
@@ -15,6 +16,8 @@ struct channel_t {
 	unsigned int in;
 	unsigned int out;
 	spinlock_t lock;
+	struct waitqueue_t rwq;
+	struct waitqueue_t wwq;
 };
 
 struct channel_t * channel_alloc(unsigned int size);
@@ -11,6 +11,7 @@ extern "C" {
 #include <atomic.h>
 #include <irqflags.h>
 #include <spinlock.h>
+#include <xboot/rwlock.h>
 
 enum kobj_type_t {
 	KOBJ_TYPE_DIR,
@@ -34,8 +35,8 @@ struct kobj_t
 	/* kobj's children */
 	struct list_head children;
 
-	/* kobj lock */
-	spinlock_t lock;
+	/* kobj lock, children are walked under the read side */
+	rwlock_t lock;
 
 	/* kobj read */
 	ssize_t (*read)(struct kobj_t * kobj, void * buf, size_t size);
@@ -37,6 +37,8 @@ struct machine_t {
 	int (*detect)(struct machine_t * mach);
 	void (*smpinit)(struct machine_t * mach);
 	void (*smpboot)(struct machine_t * mach, void (*func)(void));
+	void (*idle)(struct machine_t * mach);
+	void (*kick)(struct machine_t * mach, int cpu);
 	void (*shutdown)(struct machine_t * mach);
 	void (*reboot)(struct machine_t * mach);
 	void (*sleep)(struct machine_t * mach);
@@ -53,6 +55,8 @@ bool_t machine_mmap(struct machine_t * mach, const char * name, virtual_addr_t v
 struct machine_t * get_machine(void);
 void machine_smpinit(void);
 void machine_smpboot(void (*func)(void));
+void machine_idle(void);
+void machine_kick(int cpu);
 void machine_shutdown(void);
 void machine_reboot(void);
 void machine_sleep(void);
@@ -0,0 +1,82 @@
+#ifndef __RCU_H__
+#define __RCU_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <list.h>
+#include <barrier.h>
+
+/*
+ * Epoch based read-copy-update, readers never block and writers wait for a grace period
+ */
+#define rcu_assign_pointer(p, v)	do { smp_wmb(); (p) = (v); } while(0)
+#define rcu_dereference(p)			({ typeof(p) __p = *(volatile typeof(p) *)&(p); smp_rmb(); __p; })
+
+int rcu_read_lock(void);
+void rcu_read_unlock(int idx);
+void synchronize_rcu(void);
+
+static inline void list_add_rcu(struct list_head * new, struct list_head * head)
+{
+	struct list_head * next = head->next;
+
+	new->next = next;
+	new->prev = head;
+	rcu_assign_pointer(head->next, new);
+	next->prev = new;
+}
+
+static inline void list_add_tail_rcu(struct list_head * new, struct list_head * head)
+{
+	struct list_head * prev = head->prev;
+
+	new->next = head;
+	new->prev = prev;
+	rcu_assign_pointer(prev->next, new);
+	head->prev = new;
+}
+
+/*
+ * The entry keeps its next pointer so that readers standing on it can move on
+ */
+static inline void list_del_rcu(struct list_head * entry)
+{
+	__list_del(entry->prev, entry->next);
+	entry->prev = 0;
+}
+
+static inline void hlist_add_head_rcu(struct hlist_node * n, struct hlist_head * h)
+{
+	struct hlist_node * first = h->first;
+
+	n->next = first;
+	n->pprev = &h->first;
+	rcu_assign_pointer(h->first, n);
+	if(first)
+		first->pprev = &n->next;
+}
+
+static inline void hlist_del_rcu(struct hlist_node * n)
+{
+	__hlist_del(n);
+	n->pprev = 0;
+}
+
+#define list_for_each_entry_rcu(pos, head, member) \
+	for(pos = list_entry(rcu_dereference((head)->next), typeof(*pos), member); \
+		&pos->member != (head); \
+		pos = list_entry(rcu_dereference(pos->member.next), typeof(*pos), member))
+
+#define hlist_for_each_entry_rcu(pos, head, member) \
+	for(pos = hlist_entry_safe(rcu_dereference((head)->first), typeof(*(pos)), member); \
+		pos; \
+		pos = hlist_entry_safe(rcu_dereference((pos)->member.next), typeof(*(pos)), member))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RCU_H__ */
@@ -0,0 +1,90 @@
+#ifndef __RWLOCK_H__
+#define __RWLOCK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <barrier.h>
+#include <atomic.h>
+#include <irqflags.h>
+
+/*
+ * Writer preferring reader-writer spinlock, the low bits count active readers
+ */
+#define RWLOCK_WRITER		(1 << 30)
+
+typedef struct {
+	atomic_t value;
+} rwlock_t;
+
+#define RW_LOCK_INIT()		{ .value = { 0 } }
+
+static inline void rwlock_init(rwlock_t * rw)
+{
+	atomic_set(&rw->value, 0);
+}
+
+static inline int read_trylock(rwlock_t * rw)
+{
+	int v = atomic_get(&rw->value);
+
+	if(!(v & RWLOCK_WRITER) && (atomic_cmpxchg(&rw->value, v, v + 1) == v))
+	{
+		smp_mb();
+		return 1;
+	}
+	return 0;
+}
+
+static inline void read_lock(rwlock_t * rw)
+{
+	while(!read_trylock(rw));
+}
+
+static inline void read_unlock(rwlock_t * rw)
+{
+	smp_mb();
+	atomic_dec(&rw->value);
+}
+
+static inline int write_trylock(rwlock_t * rw)
+{
+	if(atomic_cmpxchg(&rw->value, 0, RWLOCK_WRITER) == 0)
+	{
+		smp_mb();
+		return 1;
+	}
+	return 0;
+}
+
+static inline void write_lock(rwlock_t * rw)
+{
+	int v;
+
+	for(;;)
+	{
+		v = atomic_get(&rw->value);
+		if(!(v & RWLOCK_WRITER) && (atomic_cmpxchg(&rw->value, v, v | RWLOCK_WRITER) == v))
+			break;
+	}
+	while(atomic_get(&rw->value) != RWLOCK_WRITER);
+	smp_mb();
+}
+
+static inline void write_unlock(rwlock_t * rw)
+{
+	smp_mb();
+	atomic_set(&rw->value, 0);
+}
+
+#define read_lock_irqsave(lock, flags)			do { local_irq_save(flags); read_lock(lock); } while(0)
+#define read_unlock_irqrestore(lock, flags)		do { read_unlock(lock); local_irq_restore(flags); } while(0)
+#define write_lock_irqsave(lock, flags)			do { local_irq_save(flags); write_lock(lock); } while(0)
+#define write_unlock_irqrestore(lock, flags)	do { write_unlock(lock); local_irq_restore(flags); } while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RWLOCK_H__ */
@@ -0,0 +1,59 @@
+#ifndef __SLAB_H__
+#define __SLAB_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <xconfigs.h>
+#include <types.h>
+#include <stddef.h>
+#include <list.h>
+#include <spinlock.h>
+
+struct kmem_cache_cpu_t {
+	void * obj[CONFIG_KMEM_CACHE_CPU_SIZE];
+	int count;
+	unsigned long hit;
+	unsigned long miss;
+};
+
+struct kmem_cache_t {
+	struct list_head list;
+	const char * name;
+	size_t size;
+	size_t align;
+	void (*ctor)(void * obj);
+
+	size_t stride;
+	size_t offset;
+	size_t slabsz;
+	unsigned int nobj;
+	struct list_head partial;
+	struct list_head full;
+	unsigned long nslab;
+	unsigned long nempty;
+	unsigned long active;
+	int dynamic;
+	int ready;
+	spinlock_t lock;
+
+	struct kmem_cache_cpu_t cpu[CONFIG_MAX_SMP_CPUS];
+};
+
+/*
+ * Static caches are set up on their first allocation, so they may be used before any initcall
+ */
+#define KMEM_CACHE_INIT(n, s, a, c)	{ .name = (n), .size = (s), .align = (a), .ctor = (c) }
+
+struct kmem_cache_t * kmem_cache_create(const char * name, size_t size, size_t align, void (*ctor)(void *));
+void kmem_cache_destroy(struct kmem_cache_t * cache);
+void * kmem_cache_alloc(struct kmem_cache_t * cache);
+void * kmem_cache_zalloc(struct kmem_cache_t * cache);
+void kmem_cache_free(struct kmem_cache_t * cache, void * obj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SLAB_H__ */
@@ -13,17 +13,47 @@ extern "C" {
 #include <spinlock.h>
 #include <smp.h>
 #include <rbtree_augmented.h>
+#include <xboot/ktime.h>
+#include <xboot/trace.h>
 #include <console/console.h>
 
 struct task_t;
 struct scheduler_t;
+struct waiter_t;
 typedef void (*task_func_t)(struct task_t * task, void * data);
 
+#define TASK_RT_PRIO_MAX	(32)
+
+enum task_policy_t {
+	TASK_POLICY_NORMAL	= 0,
+	TASK_POLICY_FIFO	= 1,
+	TASK_POLICY_RR		= 2,
+};
+
+enum task_state_t {
+	TASK_STATE_RUNNING	= 0,
+	TASK_STATE_READY	= 1,
+	TASK_STATE_BLOCKED	= 2,
+	TASK_STATE_EXITED	= 3,
+};
+
 struct task_t {
 	struct rb_node node;
+	struct list_head list;
+	struct list_head wlist;
+	struct list_head rlist;
 	struct scheduler_t * sched;
+	enum task_state_t state;
+	enum task_policy_t policy;
+	int prio;
+	uint64_t timeslice;
+	int oncpu;
+	int nomigrate;
 	uint64_t start;
 	uint64_t vtime;
+	uint64_t runtime;
+	uint64_t nswitch;
+	uint64_t nyield;
 	char * name;
 	char * fb;
 	char * input;
@@ -39,14 +69,36 @@ struct task_t {
 	void * __stdin;
 	void * __stdout;
 	void * __stderr;
+	void * __arena;
+	struct waiter_t * __release;
+	atomic_t __ref;
 	int __errno;
+	int __stkext;
+	int __stkovf;
+	char __strbuf[64];
 };
 
 struct scheduler_t {
 	struct rb_root_cached ready;
+	struct list_head rt[TASK_RT_PRIO_MAX];
+	uint32_t rtmap;
+	uint64_t rt_period;
+	uint64_t rt_time;
+	int rt_throttled;
+	struct list_head head;
 	struct task_t * running;
+	struct task_t * idle;
 	uint64_t min_vtime;
 	uint64_t weight;
+	uint64_t balance;
+	uint64_t migrate_in;
+	uint64_t migrate_out;
+	uint64_t busy_time;
+	uint64_t idle_time;
+	uint64_t nswitch;
+	int nready;
+	int idling;
+	int kicked;
 	spinlock_t lock;
 };
 
@@ -62,32 +114,68 @@ static inline struct task_t * task_self(void)
 	return __sched[smp_processor_id()].running;
 }
 
+static inline char task_state_char(struct task_t * task)
+{
+	switch(task->state)
+	{
+	case TASK_STATE_RUNNING:
+		return 'R';
+	case TASK_STATE_READY:
+		return 'S';
+	case TASK_STATE_BLOCKED:
+		return 'B';
+	default:
+		break;
+	}
+	return '?';
+}
+
 static inline void task_dynice_increase(struct task_t * task)
 {
 	if(task->dynice < 39)
+	{
 		task->dynice++;
+		trace_event(TRACE_TYPE_DYNICE, task, task->dynice - 20);
+	}
 }
 
 static inline void task_dynice_decrease(struct task_t * task)
 {
 	if(task->dynice > 0)
+	{
 		task->dynice--;
+		trace_event(TRACE_TYPE_DYNICE, task, task->dynice - 20);
+	}
 }
 
 static inline void task_dynice_restore(struct task_t * task)
 {
 	if(task->dynice != task->nice)
+	{
 		task->dynice = task->nice;
+		trace_event(TRACE_TYPE_DYNICE, task, task->dynice - 20);
+	}
 }
 
 struct task_t * task_create(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, size_t stksz, int nice);
+struct task_t * task_create_with_stack(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, void * stack, size_t stksz, int nice, struct waiter_t * release);
+struct task_t * task_create_bound(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, size_t stksz, int nice);
+struct task_t * task_create_with_policy(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, size_t stksz, int nice, enum task_policy_t policy, int prio);
+int task_stack_check(struct task_t * task);
+size_t task_stack_used(struct task_t * task);
 void task_console(struct task_t * task, struct console_t * con);
 void task_nice(struct task_t * task, int nice);
+void task_policy(struct task_t * task, enum task_policy_t policy, int prio);
 void task_yield(void);
+void task_block(void);
+void task_block_timeout(ktime_t timeout);
+void task_wakeup(struct task_t * task);
+void task_unpin(struct task_t * task);
 
 void do_idle_task(void);
 void do_init_sched(void);
 void scheduler_loop(void);
+int scheduler_pin_tasks(struct scheduler_t * sched, struct task_t ** tasks, int max);
 
 #ifdef __cplusplus
 }
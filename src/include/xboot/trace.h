@@ -0,0 +1,69 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic.h>
+
+enum trace_type_t {
+	TRACE_TYPE_SWITCH		= 0,
+	TRACE_TYPE_YIELD		= 1,
+	TRACE_TYPE_BLOCK		= 2,
+	TRACE_TYPE_WAKEUP		= 3,
+	TRACE_TYPE_CREATE		= 4,
+	TRACE_TYPE_EXIT			= 5,
+	TRACE_TYPE_DYNICE		= 6,
+	TRACE_TYPE_TIMER_ENTER	= 7,
+	TRACE_TYPE_TIMER_EXIT	= 8,
+	TRACE_TYPE_IRQ_ENTER	= 9,
+	TRACE_TYPE_IRQ_EXIT		= 10,
+};
+
+struct trace_event_t {
+	uint64_t time;
+	const void * ptr;
+	union {
+		int arg;
+		char name[16];
+	};
+	int type;
+};
+
+struct trace_buffer_t {
+	struct trace_event_t * event;
+	atomic_t head;
+};
+
+extern volatile int __trace_enabled;
+
+void __trace_event(int type, const void * ptr, int arg);
+void __trace_event_name(int type, const void * ptr, const char * name);
+
+static inline void trace_event(int type, const void * ptr, int arg)
+{
+	if(unlikely(__trace_enabled))
+		__trace_event(type, ptr, arg);
+}
+
+static inline void trace_event_name(int type, const void * ptr, const char * name)
+{
+	if(unlikely(__trace_enabled))
+		__trace_event_name(type, ptr, name);
+}
+
+int trace_start(void);
+void trace_stop(void);
+void trace_clear(void);
+int trace_count(int cpu);
+int trace_dump(const char * path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_H__ */
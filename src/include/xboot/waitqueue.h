@@ -0,0 +1,51 @@
+#ifndef __WAITQUEUE_H__
+#define __WAITQUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <list.h>
+#include <spinlock.h>
+#include <xboot/ktime.h>
+
+struct waitqueue_t {
+	struct list_head head;
+	spinlock_t lock;
+};
+
+void waitqueue_init(struct waitqueue_t * wq);
+void waitqueue_prepare(struct waitqueue_t * wq);
+void waitqueue_finish(struct waitqueue_t * wq);
+void waitqueue_wakeup(struct waitqueue_t * wq);
+void waitqueue_wakeup_all(struct waitqueue_t * wq);
+
+#define waitqueue_wait_event(wq, cond) \
+	do { \
+		while(!(cond)) \
+		{ \
+			waitqueue_prepare(wq); \
+			if(!(cond)) \
+				task_block(); \
+			waitqueue_finish(wq); \
+		} \
+	} while(0)
+
+#define waitqueue_wait_event_timeout(wq, cond, timeout) \
+	do { \
+		ktime_t __expires = ktime_add_safe(ktime_get(), timeout); \
+		while(!(cond) && ktime_before(ktime_get(), __expires)) \
+		{ \
+			waitqueue_prepare(wq); \
+			if(!(cond)) \
+				task_block_timeout(ktime_sub(__expires, ktime_get())); \
+			waitqueue_finish(wq); \
+		} \
+	} while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WAITQUEUE_H__ */
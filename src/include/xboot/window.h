@@ -8,14 +8,18 @@ extern "C" {
 #include <types.h>
 #include <stdint.h>
 #include <list.h>
-#include <fifo.h>
+#include <ring.h>
 #include <irqflags.h>
 #include <spinlock.h>
+#include <xboot/mutex.h>
+#include <xboot/workqueue.h>
 #include <xboot/event.h>
 #include <framebuffer/framebuffer.h>
 
 struct window_manager_t {
 	spinlock_t lock;
+	struct mutex_t mutex;
+	struct work_t home;
 	struct list_head list;
 	struct list_head window;
 	struct framebuffer_t * fb;
@@ -40,7 +44,7 @@ struct window_t {
 	struct window_manager_t * wm;
 	struct surface_t * s;
 	struct region_list_t * rl;
-	struct fifo_t * event;
+	struct mpmc_ring_t * event;
 	struct hmap_t * map;
 	int launcher;
 };
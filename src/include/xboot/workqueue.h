@@ -0,0 +1,65 @@
+#ifndef __WORKQUEUE_H__
+#define __WORKQUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <types.h>
+#include <list.h>
+#include <atomic.h>
+#include <spinlock.h>
+#include <time/timer.h>
+#include <xboot/task.h>
+#include <xboot/waitqueue.h>
+
+struct work_t;
+struct worker_t;
+typedef void (*work_func_t)(struct work_t * work, void * data);
+
+enum work_state_t {
+	WORK_STATE_IDLE		= 0,
+	WORK_STATE_DELAYED	= 1,
+	WORK_STATE_QUEUED	= 2,
+};
+
+struct work_t {
+	struct list_head entry;
+	struct timer_t timer;
+	struct worker_t * worker;
+	atomic_t state;
+	int cpu;
+	work_func_t func;
+	void * data;
+};
+
+struct worker_t {
+	struct list_head head;
+	struct task_t * task;
+	struct work_t * current;
+	struct waitqueue_t wq;
+	struct waitqueue_t done;
+	uint64_t count;
+	spinlock_t lock;
+};
+
+static inline int work_pending(struct work_t * work)
+{
+	return (atomic_get(&work->state) != WORK_STATE_IDLE) ? 1 : 0;
+}
+
+void work_init(struct work_t * work, work_func_t func, void * data);
+int work_queue(struct work_t * work);
+int work_queue_on(int cpu, struct work_t * work);
+int work_queue_delayed(struct work_t * work, ktime_t delay);
+int work_mod_delayed(struct work_t * work, ktime_t delay);
+int work_cancel(struct work_t * work);
+void work_flush(struct work_t * work);
+
+void do_init_workqueue(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WORKQUEUE_H__ */
@@ -19,6 +19,66 @@ extern "C" {
 #define CONFIG_TASK_STACK_SIZE				(512 * 1024)
 #endif
 
+#if !defined(CONFIG_TASK_STACK_POOL_SIZE)
+#define CONFIG_TASK_STACK_POOL_SIZE			(2)
+#endif
+
+#if !defined(CONFIG_TASK_STACK_PAINT)
+#define CONFIG_TASK_STACK_PAINT				(1)
+#endif
+
+#if !defined(CONFIG_TASK_BALANCE_INTERVAL)
+#define CONFIG_TASK_BALANCE_INTERVAL		(10)
+#endif
+
+#if !defined(CONFIG_TASK_RT_PERIOD)
+#define CONFIG_TASK_RT_PERIOD				(1000)
+#endif
+
+#if !defined(CONFIG_TASK_RT_RUNTIME)
+#define CONFIG_TASK_RT_RUNTIME				(950)
+#endif
+
+#if !defined(CONFIG_TASK_RT_TIMESLICE)
+#define CONFIG_TASK_RT_TIMESLICE			(10)
+#endif
+
+#if !defined(CONFIG_WORKQUEUE_STACK_SIZE)
+#define CONFIG_WORKQUEUE_STACK_SIZE			(64 * 1024)
+#endif
+
+#if !defined(CONFIG_TRACE_EVENTS)
+#define CONFIG_TRACE_EVENTS					(4096)
+#endif
+
+#if !defined(CONFIG_MALLOC_MAGAZINE_SIZE)
+#define CONFIG_MALLOC_MAGAZINE_SIZE			(32)
+#endif
+
+#if !defined(CONFIG_KMEM_CACHE_CPU_SIZE)
+#define CONFIG_KMEM_CACHE_CPU_SIZE			(16)
+#endif
+
+#if !defined(CONFIG_MPROF_BLOCKS)
+#define CONFIG_MPROF_BLOCKS					(32768)
+#endif
+
+#if !defined(CONFIG_MPROF_SITES)
+#define CONFIG_MPROF_SITES					(1024)
+#endif
+
+#if !defined(CONFIG_FRAME_ARENA_SIZE)
+#define CONFIG_FRAME_ARENA_SIZE				(64 * 1024)
+#endif
+
+#if !defined(CONFIG_FRAME_ARENA_MAX)
+#define CONFIG_FRAME_ARENA_MAX				(4 * 1024 * 1024)
+#endif
+
+#if !defined(CONFIG_XUI_SURFACE_CACHE_SIZE)
+#define CONFIG_XUI_SURFACE_CACHE_SIZE		(16 * 1024 * 1024)
+#endif
+
 #if !defined(CONFIG_DRIVER_HASH_SIZE)
 #define CONFIG_DRIVER_HASH_SIZE				(521)
 #endif
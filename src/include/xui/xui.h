@@ -506,7 +506,8 @@ struct xui_context_t {
 	struct window_t * w;
 	struct font_context_t * f;
 	struct hmap_t * lang;
-	struct lru_t * surface;
+	struct lrucache_t * surface;
+	struct hmap_t * uncached;
 	struct region_t screen;
 	unsigned int cpshift;
 	unsigned int cpsize;
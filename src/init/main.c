@@ -67,6 +67,9 @@ void xboot_main(void)
 	/* Do initial scheduler */
 	do_init_sched();
 
+	/* Do initial workqueue */
+	do_init_workqueue();
+
 	/* Create init task */
 	task_create(scheduler_self(), "init", NULL, NULL, init_task, NULL, 0, 0);
 
@@ -0,0 +1,203 @@
+/*
+ * kernel/command/cmd-heap.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <xboot.h>
+#include <mprof.h>
+#include <command/command.h>
+
+struct heap_frag_t {
+	unsigned long count[24];
+	size_t bytes[24];
+	unsigned long nused;
+	unsigned long nfree;
+	size_t used;
+	size_t free;
+	size_t largest;
+};
+
+static void usage(void)
+{
+	printf("usage:\r\n");
+	printf("    heap [start|stop|clear]\r\n");
+	printf("    heap top [count]\r\n");
+	printf("    heap frag\r\n");
+}
+
+static int heap_compare(const void * a, const void * b)
+{
+	const struct mprof_site_t * sa = a;
+	const struct mprof_site_t * sb = b;
+
+	if(sa->bytes != sb->bytes)
+		return (sa->bytes < sb->bytes) ? 1 : -1;
+	if(sa->peak != sb->peak)
+		return (sa->peak < sb->peak) ? 1 : -1;
+	return 0;
+}
+
+static void heap_top(int n)
+{
+	struct mprof_site_t * site;
+	unsigned long blocks, dropped;
+	size_t bytes;
+	int len, i;
+
+	site = malloc(sizeof(struct mprof_site_t) * CONFIG_MPROF_SITES);
+	if(!site)
+		return;
+	len = mprof_snapshot(site, CONFIG_MPROF_SITES);
+	qsort(site, len, sizeof(struct mprof_site_t), heap_compare);
+	mprof_summary(&blocks, &bytes, &dropped);
+	printf("%ld live blocks, %ld live bytes, %d callsites, %ld dropped\r\n", blocks, (long)bytes, len, dropped);
+	printf(" %-18s %12s %8s %12s %10s\r\n", "CALLER", "BYTES", "BLOCKS", "PEAK", "ALLOCS");
+	for(i = 0; (i < len) && (i < n); i++)
+		printf(" %-18p %12ld %8ld %12ld %10ld\r\n", site[i].caller, (long)site[i].bytes, site[i].count, (long)site[i].peak, site[i].total);
+	free(site);
+}
+
+static void heap_frag_walk(void * ptr, size_t size, int used, void * data)
+{
+	struct heap_frag_t * f = (struct heap_frag_t *)data;
+	int i;
+
+	if(used)
+	{
+		f->nused++;
+		f->used += size;
+	}
+	else
+	{
+		i = (size > 16) ? fls(size - 1) - 4 : 0;
+		if(i >= ARRAY_SIZE(f->count))
+			i = ARRAY_SIZE(f->count) - 1;
+		f->count[i]++;
+		f->bytes[i] += size;
+		f->nfree++;
+		f->free += size;
+		if(size > f->largest)
+			f->largest = size;
+	}
+}
+
+static void heap_frag(void)
+{
+	struct heap_frag_t f;
+	char buf[32];
+	int i;
+
+	memset(&f, 0, sizeof(struct heap_frag_t));
+	if(!memwalk(heap_frag_walk, &f))
+	{
+		meminfo(&f.used, &f.free);
+		printf("used: %ld bytes\r\n", (long)f.used);
+		printf("free: %ld bytes\r\n", (long)f.free);
+		printf("heap: no block map on a host allocator, fragmentation needs the tlsf heap\r\n");
+		return;
+	}
+	printf("used: %ld blocks, %ld bytes\r\n", f.nused, (long)f.used);
+	printf("free: %ld blocks, %ld bytes, largest %ld bytes\r\n", f.nfree, (long)f.free, (long)f.largest);
+	printf("fragmentation: %d%%\r\n", f.free ? (int)(100 - (uint64_t)f.largest * 100 / f.free) : 0);
+	printf(" %-12s %8s %12s\r\n", "FREE <=", "BLOCKS", "BYTES");
+	for(i = 0; i < ARRAY_SIZE(f.count); i++)
+	{
+		if(f.count[i])
+		{
+			if(i == ARRAY_SIZE(f.count) - 1)
+				snprintf(buf, sizeof(buf), "inf");
+			else
+				ssize(buf, (double)(1ULL << (i + 4)));
+			printf(" %-12s %8ld %12ld\r\n", buf, f.count[i], (long)f.bytes[i]);
+		}
+	}
+}
+
+static int do_heap(int argc, char ** argv)
+{
+	unsigned long blocks, dropped;
+	size_t mused = 0, mfree = 0;
+	size_t bytes;
+
+	if(argc == 1)
+	{
+		meminfo(&mused, &mfree);
+		mprof_summary(&blocks, &bytes, &dropped);
+		printf("heap used: %ld, free: %ld\r\n", (long)mused, (long)mfree);
+		printf("profiling: %s, %ld live blocks, %ld live bytes, %ld dropped\r\n", __mprof_enabled ? "on" : "off", blocks, (long)bytes, dropped);
+		return 0;
+	}
+	if(!strcmp(argv[1], "start"))
+	{
+		if(!mprof_start())
+		{
+			printf("heap: no memory for profiler tables\r\n");
+			return -1;
+		}
+	}
+	else if(!strcmp(argv[1], "stop"))
+	{
+		mprof_stop();
+	}
+	else if(!strcmp(argv[1], "clear"))
+	{
+		mprof_clear();
+	}
+	else if(!strcmp(argv[1], "top"))
+	{
+		heap_top((argc > 2) ? strtol(argv[2], NULL, 0) : 20);
+	}
+	else if(!strcmp(argv[1], "frag"))
+	{
+		heap_frag();
+	}
+	else
+	{
+		usage();
+		return -1;
+	}
+	return 0;
+}
+
+static struct command_t cmd_heap = {
+	.name	= "heap",
+	.desc	= "heap allocation profiler and fragmentation map",
+	.usage	= usage,
+	.exec	= do_heap,
+};
+
+static __init void heap_cmd_init(void)
+{
+	register_command(&cmd_heap);
+}
+
+static __exit void heap_cmd_exit(void)
+{
+	unregister_command(&cmd_heap);
+}
+
+command_initcall(heap_cmd_init);
+command_exitcall(heap_cmd_exit);
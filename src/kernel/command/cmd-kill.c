@@ -31,22 +31,25 @@
 
 static void usage(void)
 {
-	struct window_manager_t * pos, * n;
-	struct window_t * wpos, * wn;
+	struct window_manager_t * pos;
+	struct window_t * wpos;
 	struct slist_t * sl, * e;
+	int idx;
 
 	printf("usage:\r\n");
 	printf("    kill <name>\r\n");
 
 	printf("task:\r\n");
 	sl = slist_alloc();
-	list_for_each_entry_safe(pos, n, &__window_manager_list, list)
+	idx = rcu_read_lock();
+	list_for_each_entry_rcu(pos, &__window_manager_list, list)
 	{
-		list_for_each_entry_safe(wpos, wn, &pos->window, list)
+		list_for_each_entry_rcu(wpos, &pos->window, list)
 		{
 			slist_add(sl, wpos, "%s", wpos->task->name);
 		}
 	}
+	rcu_read_unlock(idx);
 	slist_sort(sl);
 	slist_for_each_entry(e, sl)
 	{
@@ -57,9 +60,10 @@ static void usage(void)
 
 static int do_kill(int argc, char ** argv)
 {
-	struct window_manager_t * pos, * n;
-	struct window_t * wpos, * wn;
+	struct window_manager_t * pos;
+	struct window_t * wpos;
 	int find = 0;
+	int idx;
 
 	if(argc < 2)
 	{
@@ -67,9 +71,10 @@ static int do_kill(int argc, char ** argv)
 		return -1;
 	}
 
-	list_for_each_entry_safe(pos, n, &__window_manager_list, list)
+	idx = rcu_read_lock();
+	list_for_each_entry_rcu(pos, &__window_manager_list, list)
 	{
-		list_for_each_entry_safe(wpos, wn, &pos->window, list)
+		list_for_each_entry_rcu(wpos, &pos->window, list)
 		{
 			if(strcmp(argv[1], wpos->task->name) == 0)
 			{
@@ -78,6 +83,7 @@ static int do_kill(int argc, char ** argv)
 			}
 		}
 	}
+	rcu_read_unlock(idx);
 	if(!find)
 		printf("No such window task '%s'\r\n", argv[1]);
 	return 0;
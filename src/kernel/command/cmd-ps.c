@@ -35,34 +35,56 @@ static void usage(void)
 	printf("    ps\r\n");
 }
 
+static inline char task_policy_char(struct task_t * task)
+{
+	switch(task->policy)
+	{
+	case TASK_POLICY_FIFO:
+		return 'F';
+	case TASK_POLICY_RR:
+		return 'R';
+	default:
+		break;
+	}
+	return 'N';
+}
+
+/*
+ * Tasks are pinned rather than walked under the scheduler lock, so the list
+ * is built and printed with interrupts on and none of them can go away.
+ */
 static int do_ps(int argc, char ** argv)
 {
 	struct scheduler_t * sched;
-	struct task_t * pos, * n;
+	struct task_t ** tasks;
+	struct task_t * pos;
 	struct slist_t * sl, * e;
-	int i;
+	int i, j, n;
 
 	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
 	{
-		sl = slist_alloc();
 		sched = &__sched[i];
+		n = scheduler_pin_tasks(sched, NULL, 0) + 8;
+		tasks = malloc(n * sizeof(struct task_t *));
+		if(!tasks)
+			continue;
+		n = min(scheduler_pin_tasks(sched, tasks, n), n);
 
-		pos = sched->running;
-		if(pos)
-			slist_add(sl, pos, "%s", pos->name ? pos->name : "");
-		rbtree_postorder_for_each_entry_safe(pos, n, &sched->ready.rb_root, node)
-		{
-			slist_add(sl, pos, "%s", pos->name ? pos->name : "");
-		}
+		sl = slist_alloc();
+		for(j = 0; j < n; j++)
+			slist_add(sl, tasks[j], "%s", tasks[j]->name ? tasks[j]->name : "");
 		slist_sort(sl);
 
 		printf("CPU%d:\r\n", i);
 		slist_for_each_entry(e, sl)
 		{
 			pos = (struct task_t *)e->priv;
-			printf(" %p %3d %3d %-12s %-12s %s\r\n", pos->func, pos->nice - 20, pos->dynice - 20, pos->fb ? pos->fb : "none", pos->input ? pos->input : "none", e->key);
+			printf(" %p %c %c%-2d %3d %3d %4ld/%4ldK %-12s %-12s %s\r\n", pos->func, task_state_char(pos), task_policy_char(pos), pos->prio, pos->nice - 20, pos->dynice - 20, (long)((task_stack_used(pos) + 1023) >> 10), (long)(pos->stksz >> 10), pos->fb ? pos->fb : "none", pos->input ? pos->input : "none", e->key);
 		}
 		slist_free(sl);
+		for(j = 0; j < n; j++)
+			task_unpin(tasks[j]);
+		free(tasks);
 	}
 	return 0;
 }
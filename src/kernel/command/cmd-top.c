@@ -0,0 +1,265 @@
+/*
+ * kernel/command/cmd-top.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <xboot.h>
+#include <shell/ctrlc.h>
+#include <command/command.h>
+
+#define TOP_MAX_TASKS	(256)
+
+struct top_task_t {
+	struct task_t * task;
+	task_func_t func;
+	uint64_t runtime;
+	uint64_t nswitch;
+	uint64_t nyield;
+	uint64_t drun;
+	uint64_t dswitch;
+	uint64_t dyield;
+	int cpu;
+	int nice;
+	int dynice;
+	char state;
+	char name[32];
+};
+
+struct top_snapshot_t {
+	struct top_task_t task[TOP_MAX_TASKS];
+	int ntask;
+	uint64_t busy[CONFIG_MAX_SMP_CPUS];
+	uint64_t idle[CONFIG_MAX_SMP_CPUS];
+	uint64_t nswitch[CONFIG_MAX_SMP_CPUS];
+	uint64_t time;
+};
+
+static void usage(void)
+{
+	printf("usage:\r\n");
+	printf("    top [-d delay] [-n count]\r\n");
+}
+
+static void top_snapshot(struct top_snapshot_t * s)
+{
+	struct scheduler_t * sched;
+	struct task_t * pos;
+	struct top_task_t * t;
+	irq_flags_t flags;
+	uint64_t now, delta;
+	int i;
+
+	s->ntask = 0;
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		sched = &__sched[i];
+		spin_lock_irqsave(&sched->lock, flags);
+		now = ktime_to_ns(ktime_get());
+		s->busy[i] = sched->busy_time;
+		s->idle[i] = sched->idle_time;
+		s->nswitch[i] = sched->nswitch;
+		list_for_each_entry(pos, &sched->head, list)
+		{
+			delta = 0;
+			if((pos->state == TASK_STATE_RUNNING) && (now > pos->start))
+			{
+				delta = now - pos->start;
+				if(pos == sched->idle)
+					s->idle[i] += delta;
+				else
+					s->busy[i] += delta;
+			}
+			if(s->ntask < TOP_MAX_TASKS)
+			{
+				t = &s->task[s->ntask++];
+				t->task = pos;
+				t->func = pos->func;
+				t->runtime = pos->runtime + delta;
+				t->nswitch = pos->nswitch;
+				t->nyield = pos->nyield;
+				t->cpu = i;
+				t->nice = pos->nice - 20;
+				t->dynice = pos->dynice - 20;
+				t->state = task_state_char(pos);
+				strlcpy(t->name, pos->name ? pos->name : "", sizeof(t->name));
+			}
+		}
+		spin_unlock_irqrestore(&sched->lock, flags);
+	}
+	s->time = ktime_to_ns(ktime_get());
+}
+
+static void top_delta(struct top_snapshot_t * prev, struct top_snapshot_t * cur)
+{
+	struct top_task_t * t, * o;
+	int i, j;
+
+	for(i = 0; i < cur->ntask; i++)
+	{
+		t = &cur->task[i];
+		t->drun = t->runtime;
+		t->dswitch = t->nswitch;
+		t->dyield = t->nyield;
+		for(j = 0; j < prev->ntask; j++)
+		{
+			o = &prev->task[j];
+			if((o->task == t->task) && (o->func == t->func) && (t->runtime >= o->runtime))
+			{
+				t->drun = t->runtime - o->runtime;
+				t->dswitch = t->nswitch - o->nswitch;
+				t->dyield = t->nyield - o->nyield;
+				break;
+			}
+		}
+	}
+}
+
+static int top_compare(const void * a, const void * b)
+{
+	const struct top_task_t * ta = (const struct top_task_t *)a;
+	const struct top_task_t * tb = (const struct top_task_t *)b;
+
+	if(ta->drun > tb->drun)
+		return -1;
+	if(ta->drun < tb->drun)
+		return 1;
+	return strcmp(ta->name, tb->name);
+}
+
+static void top_show(struct top_snapshot_t * prev, struct top_snapshot_t * cur)
+{
+	struct top_task_t * t;
+	uint64_t elapsed = cur->time - prev->time;
+	uint64_t busy, idle;
+	int i;
+
+	if(elapsed == 0)
+		elapsed = 1;
+	top_delta(prev, cur);
+	qsort(cur->task, cur->ntask, sizeof(struct top_task_t), top_compare);
+
+	printf("\033[2J\033[H");
+	printf("top - %d cpus, %d tasks, %.1fs interval\r\n", CONFIG_MAX_SMP_CPUS, cur->ntask, (double)elapsed / 1000000000.0);
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		busy = cur->busy[i] - prev->busy[i];
+		idle = cur->idle[i] - prev->idle[i];
+		printf("CPU%d: %5.1f%% busy %5.1f%% idle %8llu sw/s\r\n", i,
+			(double)busy * 100.0 / (double)elapsed, (double)idle * 100.0 / (double)elapsed,
+			(unsigned long long)((cur->nswitch[i] - prev->nswitch[i]) * 1000000000ULL / elapsed));
+	}
+	printf("\r\n CPU S NICE DYNICE  %%CPU     SW/S  YIELD/S     TIME NAME\r\n");
+	for(i = 0; i < cur->ntask; i++)
+	{
+		t = &cur->task[i];
+		printf(" %3d %c %4d %6d %5.1f %8llu %8llu %8.2f %s\r\n", t->cpu, t->state, t->nice, t->dynice,
+			(double)t->drun * 100.0 / (double)elapsed,
+			(unsigned long long)(t->dswitch * 1000000000ULL / elapsed),
+			(unsigned long long)(t->dyield * 1000000000ULL / elapsed),
+			(double)t->runtime / 1000000000.0, t->name);
+	}
+}
+
+static int do_top(int argc, char ** argv)
+{
+	struct top_snapshot_t * s[2];
+	ktime_t timeout;
+	int delay = 1000, count = -1;
+	int i, idx = 0;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-d") && (argc > i + 1))
+		{
+			delay = strtol(argv[i + 1], NULL, 0);
+			i++;
+		}
+		else if(!strcmp(argv[i], "-n") && (argc > i + 1))
+		{
+			count = strtol(argv[i + 1], NULL, 0);
+			i++;
+		}
+		else
+		{
+			usage();
+			return -1;
+		}
+	}
+	if(delay < 100)
+		delay = 100;
+
+	s[0] = malloc(sizeof(struct top_snapshot_t));
+	s[1] = malloc(sizeof(struct top_snapshot_t));
+	if(!s[0] || !s[1])
+	{
+		free(s[0]);
+		free(s[1]);
+		return -1;
+	}
+
+	top_snapshot(s[idx]);
+	while(count != 0)
+	{
+		timeout = ktime_add_ms(ktime_get(), delay);
+		while(ktime_before(ktime_get(), timeout))
+		{
+			if(ctrlc())
+			{
+				count = 1;
+				break;
+			}
+			msleep(10);
+		}
+		top_snapshot(s[idx ^ 1]);
+		top_show(s[idx], s[idx ^ 1]);
+		idx ^= 1;
+		if(count > 0)
+			count--;
+	}
+	free(s[0]);
+	free(s[1]);
+	return 0;
+}
+
+static struct command_t cmd_top = {
+	.name	= "top",
+	.desc	= "display cpu usage of tasks",
+	.usage	= usage,
+	.exec	= do_top,
+};
+
+static __init void top_cmd_init(void)
+{
+	register_command(&cmd_top);
+}
+
+static __exit void top_cmd_exit(void)
+{
+	unregister_command(&cmd_top);
+}
+
+command_initcall(top_cmd_init);
+command_exitcall(top_cmd_exit);
@@ -0,0 +1,106 @@
+/*
+ * kernel/command/cmd-trace.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <xboot.h>
+#include <command/command.h>
+
+static void usage(void)
+{
+	printf("usage:\r\n");
+	printf("    trace [start|stop|clear]\r\n");
+	printf("    trace dump <file>\r\n");
+}
+
+static int do_trace(int argc, char ** argv)
+{
+	char fpath[VFS_MAX_PATH];
+	int i;
+
+	if(argc == 1)
+	{
+		printf("tracing: %s\r\n", __trace_enabled ? "on" : "off");
+		for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+			printf(" CPU%d: %d events\r\n", i, trace_count(i));
+		return 0;
+	}
+	if(!strcmp(argv[1], "start"))
+	{
+		if(!trace_start())
+		{
+			printf("trace: no memory for trace buffer\r\n");
+			return -1;
+		}
+	}
+	else if(!strcmp(argv[1], "stop"))
+	{
+		trace_stop();
+	}
+	else if(!strcmp(argv[1], "clear"))
+	{
+		trace_clear();
+	}
+	else if(!strcmp(argv[1], "dump") && (argc == 3))
+	{
+		if(shell_realpath(argv[2], fpath) < 0)
+		{
+			printf("trace: %s: Can not convert to realpath\r\n", argv[2]);
+			return -1;
+		}
+		if(!trace_dump(fpath))
+		{
+			printf("trace: can not dump to '%s'\r\n", fpath);
+			return -1;
+		}
+	}
+	else
+	{
+		usage();
+		return -1;
+	}
+	return 0;
+}
+
+static struct command_t cmd_trace = {
+	.name	= "trace",
+	.desc	= "record scheduler events and dump as chrome trace",
+	.usage	= usage,
+	.exec	= do_trace,
+};
+
+static __init void trace_cmd_init(void)
+{
+	register_command(&cmd_trace);
+}
+
+static __exit void trace_cmd_exit(void)
+{
+	unregister_command(&cmd_trace);
+}
+
+command_initcall(trace_cmd_init);
+command_exitcall(trace_cmd_exit);
@@ -0,0 +1,229 @@
+/*
+ * kernel/core/arena.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <xboot.h>
+#include <xboot/arena.h>
+
+#define FRAME_ALIGN			(16)
+#define FRAME_ROUND(x)		(((x) + FRAME_ALIGN - 1) & ~((size_t)FRAME_ALIGN - 1))
+#define FRAME_HEADER_SIZE	FRAME_ROUND(sizeof(struct frame_block_t))
+
+/*
+ * Header of a block that did not fit the arena, blocks taken without a task have no arena
+ */
+struct frame_block_t {
+	struct list_head entry;
+	struct frame_arena_t * arena;
+	size_t size;
+};
+
+static struct list_head __frame_arena_list = { &__frame_arena_list, &__frame_arena_list };
+static spinlock_t __frame_arena_lock = SPIN_LOCK_INIT();
+
+static struct frame_arena_t * frame_arena_self(void)
+{
+	struct task_t * task = task_self();
+	struct frame_arena_t * a;
+	irq_flags_t flags;
+
+	if(!task)
+		return NULL;
+	a = task->__arena;
+	if(!a)
+	{
+		a = malloc(sizeof(struct frame_arena_t));
+		if(!a)
+			return NULL;
+		init_list_head(&a->overflow);
+		a->task = task;
+		a->base = malloc(CONFIG_FRAME_ARENA_SIZE);
+		a->size = a->base ? CONFIG_FRAME_ARENA_SIZE : 0;
+		a->used = 0;
+		a->last = 0;
+		a->ovused = 0;
+		a->frame = 0;
+		a->peak = 0;
+		a->nframe = 0;
+		a->noverflow = 0;
+		spin_lock_irqsave(&__frame_arena_lock, flags);
+		list_add_tail(&a->entry, &__frame_arena_list);
+		spin_unlock_irqrestore(&__frame_arena_lock, flags);
+		task->__arena = a;
+	}
+	return a;
+}
+
+/*
+ * The frame size is the high water mark of what is live at once, memory given back
+ * by frame_free() in between is not counted twice when the arena is resized
+ */
+static inline void frame_arena_mark(struct frame_arena_t * a)
+{
+	if(a->used + a->ovused > a->frame)
+		a->frame = a->used + a->ovused;
+}
+
+void * frame_alloc(size_t size)
+{
+	struct frame_arena_t * a = frame_arena_self();
+	struct frame_block_t * h;
+	size_t sz = FRAME_ROUND(size);
+	void * p;
+
+	if(a && (a->size - a->used >= sz))
+	{
+		p = a->base + a->used;
+		a->last = a->used;
+		a->used += sz;
+		frame_arena_mark(a);
+		return p;
+	}
+	h = malloc(FRAME_HEADER_SIZE + size);
+	if(!h)
+		return NULL;
+	h->arena = a;
+	h->size = sz;
+	if(a)
+	{
+		list_add(&h->entry, &a->overflow);
+		a->ovused += sz;
+		a->noverflow++;
+		frame_arena_mark(a);
+	}
+	return (char *)h + FRAME_HEADER_SIZE;
+}
+EXPORT_SYMBOL(frame_alloc);
+
+void frame_free(void * ptr)
+{
+	struct task_t * task = task_self();
+	struct frame_arena_t * a = task ? task->__arena : NULL;
+	struct frame_block_t * h;
+
+	if(!ptr)
+		return;
+	if(a && ((char *)ptr >= a->base) && ((char *)ptr < a->base + a->size))
+	{
+		if((char *)ptr == a->base + a->last)
+			a->used = a->last;
+		return;
+	}
+	h = (struct frame_block_t *)((char *)ptr - FRAME_HEADER_SIZE);
+	if(h->arena)
+	{
+		list_del(&h->entry);
+		h->arena->ovused -= h->size;
+	}
+	free(h);
+}
+EXPORT_SYMBOL(frame_free);
+
+void frame_reset(void)
+{
+	struct task_t * task = task_self();
+	struct frame_arena_t * a = task ? task->__arena : NULL;
+	struct list_head * pos, * n;
+	size_t size;
+	char * base;
+
+	if(!a)
+		return;
+	list_for_each_safe(pos, n, &a->overflow)
+	{
+		list_del(pos);
+		free(pos);
+	}
+	if(a->frame > a->peak)
+		a->peak = a->frame;
+	if((a->frame > a->size) && (a->size < CONFIG_FRAME_ARENA_MAX))
+	{
+		size = roundup_pow_of_two(a->frame);
+		if(size > CONFIG_FRAME_ARENA_MAX)
+			size = CONFIG_FRAME_ARENA_MAX;
+		base = malloc(size);
+		if(base)
+		{
+			free(a->base);
+			a->base = base;
+			a->size = size;
+		}
+	}
+	a->used = 0;
+	a->last = 0;
+	a->ovused = 0;
+	a->frame = 0;
+	a->nframe++;
+}
+EXPORT_SYMBOL(frame_reset);
+
+void frame_arena_free(struct frame_arena_t * a)
+{
+	struct list_head * pos, * n;
+	irq_flags_t flags;
+
+	if(a)
+	{
+		spin_lock_irqsave(&__frame_arena_lock, flags);
+		list_del(&a->entry);
+		spin_unlock_irqrestore(&__frame_arena_lock, flags);
+		list_for_each_safe(pos, n, &a->overflow)
+		{
+			list_del(pos);
+			free(pos);
+		}
+		if(a->base)
+			free(a->base);
+		free(a);
+	}
+}
+
+static ssize_t memory_read_arena(struct kobj_t * kobj, void * buf, size_t size)
+{
+	struct frame_arena_t * pos;
+	irq_flags_t flags;
+	char * p = buf;
+	int len = 0;
+
+	len += sprintf((char *)(p + len), " %-16s %10s %10s %10s %10s\r\n", "task", "size", "peak", "frames", "overflows");
+	spin_lock_irqsave(&__frame_arena_lock, flags);
+	list_for_each_entry(pos, &__frame_arena_list, entry)
+	{
+		if(len + 128 > size)
+			break;
+		len += sprintf((char *)(p + len), " %-16.16s %10ld %10ld %10lu %10lu\r\n", pos->task->name ? pos->task->name : "", (long)pos->size, (long)pos->peak, pos->nframe, pos->noverflow);
+	}
+	spin_unlock_irqrestore(&__frame_arena_lock, flags);
+	return len;
+}
+
+static __init void arena_pure_init(void)
+{
+	struct kobj_t * kclass = kobj_search_directory_with_create(kobj_get_root(), "class");
+	kobj_add_regular(kobj_search_directory_with_create(kclass, "memory"), "arena", memory_read_arena, NULL, NULL);
+}
+pure_initcall(arena_pure_init);
@@ -52,6 +52,8 @@ struct channel_t * channel_alloc(unsigned int size)
 	c->in = 0;
 	c->out = 0;
 	spin_lock_init(&c->lock);
+	waitqueue_init(&c->rwq);
+	waitqueue_init(&c->wwq);
 
 	return c;
 }
@@ -107,42 +109,26 @@ static inline unsigned int __channel_get(struct channel_t * c, unsigned char * b
 
 static inline unsigned int channel_put(struct channel_t * c, unsigned char * buf, unsigned int len)
 {
-	struct task_t * self = task_self();
 	unsigned int l;
 
 	spin_lock(&c->lock);
-	if(channel_isfull(c))
-	{
-		l = 0;
-		task_dynice_increase(self);
-	}
-	else
-	{
-		l = __channel_put(c, buf, len);
-		task_dynice_restore(self);
-	}
+	l = __channel_put(c, buf, len);
 	spin_unlock(&c->lock);
+	if(l > 0)
+		waitqueue_wakeup_all(&c->rwq);
 
 	return l;
 }
 
 static inline unsigned int channel_get(struct channel_t * c, unsigned char * buf, unsigned int len)
 {
-	struct task_t * self = task_self();
 	unsigned int l;
 
 	spin_lock(&c->lock);
-	if(channel_isempty(c))
-	{
-		l = 0;
-		task_dynice_increase(self);
-	}
-	else
-	{
-		l = __channel_get(c, buf, len);
-		task_dynice_restore(self);
-	}
+	l = __channel_get(c, buf, len);
 	spin_unlock(&c->lock);
+	if(l > 0)
+		waitqueue_wakeup_all(&c->wwq);
 
 	return l;
 }
@@ -158,7 +144,8 @@ void channel_send(struct channel_t * c, unsigned char * buf, unsigned int len)
 			l = channel_put(c, buf, len);
 			buf += l;
 			len -= l;
-			task_yield();
+			if(len > 0)
+				waitqueue_wait_event(&c->wwq, !channel_isfull(c));
 		}
 	}
 }
@@ -174,7 +161,8 @@ void channel_recv(struct channel_t * c, unsigned char * buf, unsigned int len)
 			l = channel_get(c, buf, len);
 			buf += l;
 			len -= l;
-			task_yield();
+			if(len > 0)
+				waitqueue_wait_event(&c->rwq, !channel_isempty(c));
 		}
 	}
 }
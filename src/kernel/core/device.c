@@ -214,14 +214,20 @@ static ssize_t device_write_resume(struct kobj_t * kobj, void * buf, size_t size
 static bool_t device_exist(const char * name)
 {
 	struct device_t * pos;
-	struct hlist_node * n;
+	bool_t ret = FALSE;
+	int idx;
 
-	hlist_for_each_entry_safe(pos, n, device_hash(name), node)
+	idx = rcu_read_lock();
+	hlist_for_each_entry_rcu(pos, device_hash(name), node)
 	{
 		if(strcmp(pos->name, name) == 0)
-			return TRUE;
+		{
+			ret = TRUE;
+			break;
+		}
 	}
-	return FALSE;
+	rcu_read_unlock(idx);
+	return ret;
 }
 
 char * alloc_device_name(const char * name, int id)
@@ -246,17 +252,23 @@ void free_device_name(char * name)
 struct device_t * search_device(const char * name, enum device_type_t type)
 {
 	struct device_t * pos;
-	struct hlist_node * n;
+	struct device_t * dev = NULL;
+	int idx;
 
 	if(!name)
 		return NULL;
 
-	hlist_for_each_entry_safe(pos, n, device_hash(name), node)
+	idx = rcu_read_lock();
+	hlist_for_each_entry_rcu(pos, device_hash(name), node)
 	{
 		if((pos->type == type) && (strcmp(pos->name, name) == 0))
-			return pos;
+		{
+			dev = pos;
+			break;
+		}
 	}
-	return NULL;
+	rcu_read_unlock(idx);
+	return dev;
 }
 
 struct device_t * search_first_device(enum device_type_t type)
@@ -285,11 +297,11 @@ bool_t register_device(struct device_t * dev)
 
 	spin_lock_irqsave(&__device_lock, flags);
 	init_list_head(&dev->list);
-	list_add_tail(&dev->list, &__device_list);
+	list_add_tail_rcu(&dev->list, &__device_list);
 	init_list_head(&dev->head);
-	list_add_tail(&dev->head, &__device_head[dev->type]);
+	list_add_tail_rcu(&dev->head, &__device_head[dev->type]);
 	init_hlist_node(&dev->node);
-	hlist_add_head(&dev->node, device_hash(dev->name));
+	hlist_add_head_rcu(&dev->node, device_hash(dev->name));
 	spin_unlock_irqrestore(&__device_lock, flags);
 	notifier_chain_call(&__device_nc, "notifier-device-add", dev);
 
@@ -311,11 +323,12 @@ bool_t unregister_device(struct device_t * dev)
 
 	notifier_chain_call(&__device_nc, "notifier-device-remove", dev);
 	spin_lock_irqsave(&__device_lock, flags);
-	list_del(&dev->list);
-	list_del(&dev->head);
-	hlist_del(&dev->node);
+	list_del_rcu(&dev->list);
+	list_del_rcu(&dev->head);
+	hlist_del_rcu(&dev->node);
 	spin_unlock_irqrestore(&__device_lock, flags);
 	kobj_remove(search_device_kobj(dev), dev->kobj);
+	synchronize_rcu();
 
 	return TRUE;
 }
@@ -141,12 +141,16 @@ void probe_device(const char * json, int length, const char * tips)
 	struct dtnode_t n;
 	struct json_value_t * v;
 	char errbuf[256];
-	char * p;
+	char * buf, * p;
 	int i;
 
 	if(json && (length > 0))
 	{
-		v = json_parse(json, length, errbuf);
+		buf = malloc(length);
+		if(!buf)
+			return;
+		memcpy(buf, json, length);
+		v = json_parse_insitu(buf, length, errbuf);
 		if(v && (v->type == JSON_OBJECT))
 		{
 			for(i = 0; i < v->u.object.length; i++)
@@ -171,6 +175,7 @@ void probe_device(const char * json, int length, const char * tips)
 			LOG("[%s]-%s\r\n", tips ? tips : "Json", errbuf);
 		}
 		json_free(v);
+		free(buf);
 	}
 }
 
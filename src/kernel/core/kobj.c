@@ -47,7 +47,7 @@ static struct kobj_t * __kobj_alloc(const char * name, enum kobj_type_t type, ko
 	kobj->parent = kobj;
 	init_list_head(&kobj->entry);
 	init_list_head(&kobj->children);
-	spin_lock_init(&kobj->lock);
+	rwlock_init(&kobj->lock);
 	kobj->read = read;
 	kobj->write = write;
 	kobj->priv = priv;
@@ -64,7 +64,9 @@ struct kobj_t * kobj_get_root(void)
 
 struct kobj_t * kobj_search(struct kobj_t * parent, const char * name)
 {
-	struct kobj_t * pos, * n;
+	struct kobj_t * pos;
+	struct kobj_t * kobj = NULL;
+	irq_flags_t flags;
 
 	if(!parent)
 		return NULL;
@@ -75,13 +77,18 @@ struct kobj_t * kobj_search(struct kobj_t * parent, const char * name)
 	if(!name)
 		return NULL;
 
-	list_for_each_entry_safe(pos, n, &(parent->children), entry)
+	read_lock_irqsave(&parent->lock, flags);
+	list_for_each_entry(pos, &(parent->children), entry)
 	{
 		if(strcmp(pos->name, name) == 0)
-			return pos;
+		{
+			kobj = pos;
+			break;
+		}
 	}
+	read_unlock_irqrestore(&parent->lock, flags);
 
-	return NULL;
+	return kobj;
 }
 
 struct kobj_t * kobj_search_directory_with_create(struct kobj_t * parent, const char * name)
@@ -140,6 +147,7 @@ bool_t kobj_free(struct kobj_t * kobj)
 
 bool_t kobj_add(struct kobj_t * parent, struct kobj_t * kobj)
 {
+	struct kobj_t * pos;
 	irq_flags_t pflags, flags;
 
 	if(!parent)
@@ -151,24 +159,29 @@ bool_t kobj_add(struct kobj_t * parent, struct kobj_t * kobj)
 	if(!kobj)
 		return FALSE;
 
-	if(kobj_search(parent, kobj->name))
-		return FALSE;
-
-	spin_lock_irqsave(&parent->lock, pflags);
-	spin_lock_irqsave(&kobj->lock, flags);
+	write_lock_irqsave(&parent->lock, pflags);
+	list_for_each_entry(pos, &(parent->children), entry)
+	{
+		if(strcmp(pos->name, kobj->name) == 0)
+		{
+			write_unlock_irqrestore(&parent->lock, pflags);
+			return FALSE;
+		}
+	}
+	write_lock_irqsave(&kobj->lock, flags);
 
 	kobj->parent = parent;
 	list_add_tail(&kobj->entry, &parent->children);
 
-	spin_unlock_irqrestore(&kobj->lock, flags);
-	spin_unlock_irqrestore(&parent->lock, pflags);
+	write_unlock_irqrestore(&kobj->lock, flags);
+	write_unlock_irqrestore(&parent->lock, pflags);
 
 	return TRUE;
 }
 
 bool_t kobj_remove(struct kobj_t * parent, struct kobj_t * kobj)
 {
-	struct kobj_t * pos, * n;
+	struct kobj_t * pos;
 	irq_flags_t pflags, flags;
 
 	if(!parent)
@@ -180,22 +193,23 @@ bool_t kobj_remove(struct kobj_t * parent, struct kobj_t * kobj)
 	if(!kobj)
 		return FALSE;
 
-	list_for_each_entry_safe(pos, n, &(parent->children), entry)
+	write_lock_irqsave(&parent->lock, pflags);
+	list_for_each_entry(pos, &(parent->children), entry)
 	{
 		if(pos == kobj)
 		{
-			spin_lock_irqsave(&parent->lock, pflags);
-			spin_lock_irqsave(&kobj->lock, flags);
+			write_lock_irqsave(&kobj->lock, flags);
 
 			pos->parent = pos;
 			list_del(&(pos->entry));
 
-			spin_unlock_irqrestore(&kobj->lock, flags);
-			spin_unlock_irqrestore(&parent->lock, pflags);
+			write_unlock_irqrestore(&kobj->lock, flags);
+			write_unlock_irqrestore(&parent->lock, pflags);
 
 			return TRUE;
 		}
 	}
+	write_unlock_irqrestore(&parent->lock, pflags);
 
 	return FALSE;
 }
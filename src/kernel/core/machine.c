@@ -216,6 +216,22 @@ void machine_smpboot(void (*func)(void))
 		mach->smpboot(mach, func);
 }
 
+void machine_idle(void)
+{
+	struct machine_t * mach = get_machine();
+
+	if(mach && mach->idle)
+		mach->idle(mach);
+}
+
+void machine_kick(int cpu)
+{
+	struct machine_t * mach = get_machine();
+
+	if(mach && mach->kick)
+		mach->kick(mach, cpu);
+}
+
 void machine_shutdown(void)
 {
 	struct machine_t * mach = get_machine();
@@ -32,24 +32,17 @@
 void mutex_init(struct mutex_t * m)
 {
 	atomic_set(&m->atomic, 1);
+	waitqueue_init(&m->wq);
 }
 
 void mutex_lock(struct mutex_t * m)
 {
-	struct task_t * self = task_self();
-
 	while(atomic_cmpxchg(&m->atomic, 1, 0) != 1)
-	{
-		task_dynice_increase(self);
-		task_yield();
-	}
-	task_dynice_restore(self);
+		waitqueue_wait_event(&m->wq, atomic_get(&m->atomic) == 1);
 }
 
 void mutex_unlock(struct mutex_t * m)
 {
 	if(atomic_cmpxchg(&m->atomic, 0, 1) == 0)
-	{
-		task_yield();
-	}
+		waitqueue_wakeup(&m->wq);
 }
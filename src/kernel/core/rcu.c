@@ -0,0 +1,106 @@
+/*
+ * kernel/core/rcu.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <xboot.h>
+#include <xboot/rcu.h>
+
+struct rcu_cpu_t {
+	atomic_t ctr[2];
+	char __pad[64 - 2 * sizeof(atomic_t)];
+};
+
+static struct rcu_cpu_t __rcu_cpu[CONFIG_MAX_SMP_CPUS] __attribute__((aligned(64)));
+static atomic_t __rcu_epoch = { 0 };
+static atomic_t __rcu_writer = { 0 };
+
+/*
+ * Readers may nest from irq context, the counter update is done with interrupts masked as
+ * atomic_inc is only a read modify write on parts without exclusive loads and stores
+ */
+int rcu_read_lock(void)
+{
+	irq_flags_t flags;
+	int idx;
+
+	local_irq_save(flags);
+	idx = atomic_get(&__rcu_epoch) & 0x1;
+	atomic_inc(&__rcu_cpu[smp_processor_id()].ctr[idx]);
+	local_irq_restore(flags);
+	smp_mb();
+	return idx;
+}
+EXPORT_SYMBOL(rcu_read_lock);
+
+void rcu_read_unlock(int idx)
+{
+	irq_flags_t flags;
+
+	smp_mb();
+	local_irq_save(flags);
+	atomic_dec(&__rcu_cpu[smp_processor_id()].ctr[idx & 0x1]);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(rcu_read_unlock);
+
+static inline int rcu_readers(int idx)
+{
+	int sum = 0;
+	int i;
+
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+		sum += atomic_get(&__rcu_cpu[i].ctr[idx]);
+	return sum;
+}
+
+static inline void rcu_relax(void)
+{
+	if(task_self())
+		task_yield();
+}
+
+/*
+ * Drain the stale epoch first, so readers that sampled it late can not starve us after the flip
+ */
+void synchronize_rcu(void)
+{
+	int idx;
+
+	smp_mb();
+	while(atomic_cmpxchg(&__rcu_writer, 0, 1) != 0)
+		rcu_relax();
+	idx = atomic_get(&__rcu_epoch) & 0x1;
+	while(rcu_readers(idx ^ 0x1) != 0)
+		rcu_relax();
+	atomic_inc(&__rcu_epoch);
+	smp_mb();
+	while(rcu_readers(idx) != 0)
+		rcu_relax();
+	smp_mb();
+	atomic_set(&__rcu_writer, 0);
+}
+EXPORT_SYMBOL(synchronize_rcu);
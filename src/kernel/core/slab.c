@@ -0,0 +1,296 @@
+/*
+ * kernel/core/slab.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <xboot.h>
+#include <xboot/slab.h>
+
+struct kmem_slab_t {
+	struct list_head list;
+	void * free;
+	unsigned int inuse;
+};
+
+#define KMEM_SLAB_SIZE_MIN		(4096)
+#define KMEM_SLAB_OBJS_MIN		(8)
+#define KMEM_OBJ_NEXT(c, o)		(*((void **)((char *)(o) + (c)->offset)))
+
+static struct list_head __kmem_cache_list = { &__kmem_cache_list, &__kmem_cache_list };
+static spinlock_t __kmem_cache_lock = SPIN_LOCK_INIT();
+
+static void kmem_cache_setup(struct kmem_cache_t * cache)
+{
+	size_t align, header;
+
+	spin_lock(&__kmem_cache_lock);
+	if(!cache->ready)
+	{
+		align = (cache->align > sizeof(void *)) ? cache->align : sizeof(void *);
+		if(cache->ctor)
+		{
+			cache->offset = (cache->size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+			cache->stride = (cache->offset + sizeof(void *) + align - 1) & ~(align - 1);
+		}
+		else
+		{
+			cache->offset = 0;
+			cache->stride = (((cache->size > sizeof(void *)) ? cache->size : sizeof(void *)) + align - 1) & ~(align - 1);
+		}
+		header = (sizeof(struct kmem_slab_t) + align - 1) & ~(align - 1);
+		cache->slabsz = KMEM_SLAB_SIZE_MIN;
+		while(cache->slabsz - header < cache->stride * KMEM_SLAB_OBJS_MIN)
+			cache->slabsz <<= 1;
+		cache->nobj = (cache->slabsz - header) / cache->stride;
+		init_list_head(&cache->partial);
+		init_list_head(&cache->full);
+		cache->nslab = 0;
+		cache->nempty = 0;
+		cache->active = 0;
+		spin_lock_init(&cache->lock);
+		list_add_tail(&cache->list, &__kmem_cache_list);
+		smp_wmb();
+		cache->ready = 1;
+	}
+	spin_unlock(&__kmem_cache_lock);
+}
+
+static struct kmem_slab_t * kmem_slab_grow(struct kmem_cache_t * cache)
+{
+	struct kmem_slab_t * slab;
+	char * obj;
+	unsigned int i;
+
+	slab = memalign(cache->slabsz, cache->slabsz);
+	if(!slab)
+		return NULL;
+	slab->free = NULL;
+	slab->inuse = 0;
+	obj = (char *)slab + cache->slabsz - cache->nobj * cache->stride;
+	for(i = 0; i < cache->nobj; i++, obj += cache->stride)
+	{
+		if(cache->ctor)
+			cache->ctor(obj);
+		KMEM_OBJ_NEXT(cache, obj) = slab->free;
+		slab->free = obj;
+	}
+	list_add(&slab->list, &cache->partial);
+	cache->nslab++;
+	cache->nempty++;
+	return slab;
+}
+
+static void * kmem_slab_take(struct kmem_cache_t * cache)
+{
+	struct kmem_slab_t * slab;
+	void * obj;
+
+	if(list_empty(&cache->partial))
+	{
+		if(!kmem_slab_grow(cache))
+			return NULL;
+	}
+	slab = list_first_entry(&cache->partial, struct kmem_slab_t, list);
+	obj = slab->free;
+	slab->free = KMEM_OBJ_NEXT(cache, obj);
+	if(slab->inuse++ == 0)
+		cache->nempty--;
+	if(slab->inuse == cache->nobj)
+		list_move(&slab->list, &cache->full);
+	cache->active++;
+	return obj;
+}
+
+static void kmem_slab_put(struct kmem_cache_t * cache, void * obj)
+{
+	struct kmem_slab_t * slab = (struct kmem_slab_t *)((virtual_addr_t)obj & ~((virtual_addr_t)cache->slabsz - 1));
+
+	KMEM_OBJ_NEXT(cache, obj) = slab->free;
+	slab->free = obj;
+	if(slab->inuse-- == cache->nobj)
+		list_move(&slab->list, &cache->partial);
+	if(slab->inuse == 0)
+	{
+		if(cache->nempty > 0)
+		{
+			list_del(&slab->list);
+			free(slab);
+			cache->nslab--;
+		}
+		else
+		{
+			list_move_tail(&slab->list, &cache->partial);
+			cache->nempty++;
+		}
+	}
+	cache->active--;
+}
+
+struct kmem_cache_t * kmem_cache_create(const char * name, size_t size, size_t align, void (*ctor)(void *))
+{
+	struct kmem_cache_t * cache;
+
+	if(!name || (size == 0) || (align & (align - 1)))
+		return NULL;
+	cache = malloc(sizeof(struct kmem_cache_t));
+	if(!cache)
+		return NULL;
+	memset(cache, 0, sizeof(struct kmem_cache_t));
+	cache->name = strdup(name);
+	cache->size = size;
+	cache->align = align;
+	cache->ctor = ctor;
+	cache->dynamic = 1;
+	kmem_cache_setup(cache);
+	return cache;
+}
+
+void kmem_cache_destroy(struct kmem_cache_t * cache)
+{
+	struct kmem_slab_t * pos, * n;
+	irq_flags_t flags;
+	int i;
+
+	if(!cache || !cache->dynamic)
+		return;
+	spin_lock(&__kmem_cache_lock);
+	list_del(&cache->list);
+	spin_unlock(&__kmem_cache_lock);
+	spin_lock_irqsave(&cache->lock, flags);
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		while(cache->cpu[i].count > 0)
+			kmem_slab_put(cache, cache->cpu[i].obj[--cache->cpu[i].count]);
+	}
+	list_for_each_entry_safe(pos, n, &cache->partial, list)
+	{
+		list_del(&pos->list);
+		free(pos);
+	}
+	list_for_each_entry_safe(pos, n, &cache->full, list)
+	{
+		list_del(&pos->list);
+		free(pos);
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+	free((void *)cache->name);
+	free(cache);
+}
+
+void * kmem_cache_alloc(struct kmem_cache_t * cache)
+{
+	struct kmem_cache_cpu_t * cc;
+	irq_flags_t flags;
+	void * obj;
+
+	local_irq_save(flags);
+	cc = &cache->cpu[smp_processor_id()];
+	if(cc->count > 0)
+	{
+		obj = cc->obj[--cc->count];
+		cc->hit++;
+	}
+	else
+	{
+		cc->miss++;
+		if(unlikely(!cache->ready))
+			kmem_cache_setup(cache);
+		spin_lock(&cache->lock);
+		obj = kmem_slab_take(cache);
+		while(obj && (cc->count < CONFIG_KMEM_CACHE_CPU_SIZE / 2))
+		{
+			void * o = kmem_slab_take(cache);
+			if(!o)
+				break;
+			cc->obj[cc->count++] = o;
+		}
+		spin_unlock(&cache->lock);
+	}
+	local_irq_restore(flags);
+	return obj;
+}
+
+void * kmem_cache_zalloc(struct kmem_cache_t * cache)
+{
+	void * obj = kmem_cache_alloc(cache);
+
+	if(obj)
+		memset(obj, 0, cache->size);
+	return obj;
+}
+
+void kmem_cache_free(struct kmem_cache_t * cache, void * obj)
+{
+	struct kmem_cache_cpu_t * cc;
+	irq_flags_t flags;
+
+	if(!obj)
+		return;
+	local_irq_save(flags);
+	cc = &cache->cpu[smp_processor_id()];
+	if(cc->count >= CONFIG_KMEM_CACHE_CPU_SIZE)
+	{
+		spin_lock(&cache->lock);
+		while(cc->count > CONFIG_KMEM_CACHE_CPU_SIZE / 2)
+			kmem_slab_put(cache, cc->obj[--cc->count]);
+		spin_unlock(&cache->lock);
+	}
+	cc->obj[cc->count++] = obj;
+	local_irq_restore(flags);
+}
+
+static ssize_t memory_read_slabinfo(struct kobj_t * kobj, void * buf, size_t size)
+{
+	struct kmem_cache_t * pos;
+	unsigned long hit, miss, cached;
+	char * p = buf;
+	int len = 0;
+	int i;
+
+	len += sprintf((char *)(p + len), " %-16s %8s %8s %8s %6s %10s %10s\r\n", "name", "objsize", "active", "total", "slabs", "hit", "miss");
+	spin_lock(&__kmem_cache_lock);
+	list_for_each_entry(pos, &__kmem_cache_list, list)
+	{
+		if(len + 128 > size)
+			break;
+		for(i = 0, hit = 0, miss = 0, cached = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+		{
+			hit += pos->cpu[i].hit;
+			miss += pos->cpu[i].miss;
+			cached += pos->cpu[i].count;
+		}
+		len += sprintf((char *)(p + len), " %-16.16s %8ld %8ld %8ld %6ld %10lu %10lu\r\n", pos->name, (long)pos->size, (long)(pos->active - cached), (long)(pos->nslab * pos->nobj), (long)pos->nslab, hit, miss);
+	}
+	spin_unlock(&__kmem_cache_lock);
+	return len;
+}
+
+static __init void slab_pure_init(void)
+{
+	struct kobj_t * kclass = kobj_search_directory_with_create(kobj_get_root(), "class");
+	kobj_add_regular(kobj_search_directory_with_create(kclass, "memory"), "slabinfo", memory_read_slabinfo, NULL, NULL);
+}
+pure_initcall(slab_pure_init);
@@ -38,8 +38,22 @@ struct transfer_t
 extern void * make_fcontext(void * stack, size_t size, void (*func)(struct transfer_t));
 extern struct transfer_t jump_fcontext(void * fctx, void * priv);
 
+#define TASK_STACK_CANARY		(0x5a17c0deUL)
+#define TASK_STACK_PAINT		(0xa5)
+#define TASK_STACK_PAINT_WORD	(0xa5a5a5a5UL)
+
+struct task_pool_t {
+	struct {
+		void * head;
+		size_t size;
+		int count;
+	} stack[4];
+};
+
 struct scheduler_t __sched[CONFIG_MAX_SMP_CPUS];
 EXPORT_SYMBOL(__sched);
+static struct task_pool_t __task_pool[CONFIG_MAX_SMP_CPUS];
+static struct kmem_cache_t __task_cache = KMEM_CACHE_INIT("task", sizeof(struct task_t), 0, NULL);
 
 static const uint32_t nice_to_weight[40] = {
  /* -20 */     88761,     71755,     56483,     46273,     36291,
@@ -112,7 +126,36 @@ static inline uint64_t calc_delta_fair(struct task_t * task, uint64_t delta)
 	return delta;
 }
 
-static inline struct task_t * scheduler_next_ready_task(struct scheduler_t * sched)
+static inline void task_account(struct scheduler_t * sched, struct task_t * task, uint64_t now)
+{
+	uint64_t delta = now - task->start;
+
+	task->runtime += delta;
+	if(task == sched->idle)
+		sched->idle_time += delta;
+	else
+		sched->busy_time += delta;
+
+	if(now - sched->rt_period >= CONFIG_TASK_RT_PERIOD * 1000000ULL)
+	{
+		sched->rt_period = now;
+		sched->rt_time = 0;
+		sched->rt_throttled = 0;
+	}
+	if(task->policy == TASK_POLICY_NORMAL)
+	{
+		task->vtime += calc_delta_fair(task, delta);
+	}
+	else
+	{
+		task->timeslice += delta;
+		sched->rt_time += delta;
+		if(sched->rt_time >= CONFIG_TASK_RT_RUNTIME * 1000000ULL)
+			sched->rt_throttled = 1;
+	}
+}
+
+static inline struct task_t * scheduler_next_fair_task(struct scheduler_t * sched)
 {
 	struct rb_node * leftmost = rb_first_cached(&sched->ready);
 
@@ -121,6 +164,31 @@ static inline struct task_t * scheduler_next_ready_task(struct scheduler_t * sch
 	return rb_entry(leftmost, struct task_t, node);
 }
 
+static inline struct task_t * scheduler_next_ready_task(struct scheduler_t * sched)
+{
+	if(sched->rtmap && !sched->rt_throttled)
+		return list_first_entry(&sched->rt[fls(sched->rtmap) - 1], struct task_t, rlist);
+	return scheduler_next_fair_task(sched);
+}
+
+static inline void scheduler_enqueue_rt_task(struct scheduler_t * sched, struct task_t * task, int head)
+{
+	if(head)
+		list_add(&task->rlist, &sched->rt[task->prio]);
+	else
+		list_add_tail(&task->rlist, &sched->rt[task->prio]);
+	sched->rtmap |= (1 << task->prio);
+	sched->nready++;
+}
+
+static inline void scheduler_dequeue_rt_task(struct scheduler_t * sched, struct task_t * task)
+{
+	list_del_init(&task->rlist);
+	if(list_empty(&sched->rt[task->prio]))
+		sched->rtmap &= ~(1 << task->prio);
+	sched->nready--;
+}
+
 static inline void scheduler_enqueue_task(struct scheduler_t * sched, struct task_t * task)
 {
 	struct rb_node ** link = &sched->ready.rb_root.rb_node;
@@ -128,6 +196,11 @@ static inline void scheduler_enqueue_task(struct scheduler_t * sched, struct tas
 	struct task_t * next, * entry;
 	int leftmost = 1;
 
+	if(task->policy != TASK_POLICY_NORMAL)
+	{
+		scheduler_enqueue_rt_task(sched, task, 0);
+		return;
+	}
 	while(*link)
 	{
 		parent = *link;
@@ -145,7 +218,8 @@ static inline void scheduler_enqueue_task(struct scheduler_t * sched, struct tas
 
 	rb_link_node(&task->node, parent, link);
 	rb_insert_color_cached(&task->node, &sched->ready, leftmost);
-	next = scheduler_next_ready_task(sched);
+	sched->nready++;
+	next = scheduler_next_fair_task(sched);
 	if(likely(next))
 		sched->min_vtime = next->vtime;
 	else if(sched->running)
@@ -158,8 +232,14 @@ static inline void scheduler_dequeue_task(struct scheduler_t * sched, struct tas
 {
 	struct task_t * next;
 
+	if(task->policy != TASK_POLICY_NORMAL)
+	{
+		scheduler_dequeue_rt_task(sched, task);
+		return;
+	}
 	rb_erase_cached(&task->node, &sched->ready);
-	next = scheduler_next_ready_task(sched);
+	sched->nready--;
+	next = scheduler_next_fair_task(sched);
 	if(likely(next))
 		sched->min_vtime = next->vtime;
 	else if(sched->running)
@@ -168,13 +248,192 @@ static inline void scheduler_dequeue_task(struct scheduler_t * sched, struct tas
 		sched->min_vtime = 0;
 }
 
-static inline void scheduler_switch_task(struct scheduler_t * sched, struct task_t * task)
+#if (CONFIG_TASK_STACK_PAINT > 0)
+/*
+ * Lowest word of a painted stack that no longer holds the paint, the first word is left out
+ * as it carries the canary
+ */
+static inline uint32_t * task_stack_mark(void * stack, size_t stksz)
+{
+	uint32_t * p = (uint32_t *)stack + 1;
+	uint32_t * e = (uint32_t *)(stack + stksz);
+
+	while((p < e) && (*p == (uint32_t)TASK_STACK_PAINT_WORD))
+		p++;
+	return p;
+}
+#endif
+
+static struct task_t * task_pool_alloc(size_t stksz, void ** stack)
+{
+	struct task_pool_t * pool;
+	struct task_t * task;
+	irq_flags_t flags;
+	void * stk = NULL;
+	int i;
+
+	local_irq_save(flags);
+	pool = &__task_pool[smp_processor_id()];
+	if(stack)
+	{
+		for(i = 0; i < ARRAY_SIZE(pool->stack); i++)
+		{
+			if((pool->stack[i].size == stksz) && pool->stack[i].head)
+			{
+				stk = pool->stack[i].head;
+				pool->stack[i].head = *((void **)stk);
+				pool->stack[i].count--;
+#if (CONFIG_TASK_STACK_PAINT > 0)
+				memset(stk, TASK_STACK_PAINT, sizeof(void *));
+#endif
+				break;
+			}
+		}
+	}
+	local_irq_restore(flags);
+#if (CONFIG_TASK_STACK_PAINT > 0)
+	if(stk)
+	{
+		uint32_t * m = task_stack_mark(stk, stksz);
+		memset(m, TASK_STACK_PAINT, (char *)stk + stksz - (char *)m);
+	}
+#endif
+
+	task = kmem_cache_alloc(&__task_cache);
+	if(!task)
+	{
+		if(stk)
+			free(stk);
+		return NULL;
+	}
+	if(stack)
+	{
+		if(!stk)
+		{
+			stk = malloc(stksz);
+			if(!stk)
+			{
+				kmem_cache_free(&__task_cache, task);
+				return NULL;
+			}
+#if (CONFIG_TASK_STACK_PAINT > 0)
+			memset(stk, TASK_STACK_PAINT, stksz);
+#endif
+		}
+		*stack = stk;
+	}
+	return task;
+}
+
+static void task_pool_free(struct task_t * task)
+{
+	struct task_pool_t * pool;
+	irq_flags_t flags;
+	void * stk = task->__stkext ? NULL : task->stack;
+	size_t stksz = task->stksz;
+	int i;
+
+	local_irq_save(flags);
+	pool = &__task_pool[smp_processor_id()];
+	if(stk)
+	{
+		for(i = 0; i < ARRAY_SIZE(pool->stack); i++)
+		{
+			if((pool->stack[i].size == stksz) || (pool->stack[i].count == 0))
+			{
+				if(pool->stack[i].count < CONFIG_TASK_STACK_POOL_SIZE)
+				{
+					pool->stack[i].size = stksz;
+					*((void **)stk) = pool->stack[i].head;
+					pool->stack[i].head = stk;
+					pool->stack[i].count++;
+					stk = NULL;
+				}
+				break;
+			}
+		}
+	}
+	local_irq_restore(flags);
+
+	if(stk)
+		free(stk);
+	kmem_cache_free(&__task_cache, task);
+}
+
+static char * task_strdup(struct task_t * task, const char * s, size_t * off)
+{
+	size_t len;
+	char * p;
+
+	if(!s)
+		return NULL;
+	len = strlen(s) + 1;
+	if(*off + len <= sizeof(task->__strbuf))
+	{
+		p = &task->__strbuf[*off];
+		memcpy(p, s, len);
+		*off += len;
+		return p;
+	}
+	return strdup(s);
+}
+
+static void task_strfree(struct task_t * task, char * s)
+{
+	if(s && ((s < task->__strbuf) || (s >= task->__strbuf + sizeof(task->__strbuf))))
+		free(s);
+}
+
+/*
+ * Called once nothing runs on the task any more and nobody has it pinned, the owner
+ * of a caller owned stack is told through its waiter that the stack may be reused.
+ */
+static void task_release(struct task_t * task)
+{
+	struct waiter_t * release = task->__release;
+
+	task_strfree(task, task->name);
+	task_strfree(task, task->fb);
+	task_strfree(task, task->input);
+	task_pool_free(task);
+	if(release)
+		waiter_sub(release, 1);
+}
+
+static inline void scheduler_finish_switch(struct transfer_t from)
 {
-	struct task_t * running = sched->running;
-	sched->running = task;
-	struct transfer_t from = jump_fcontext(task->fctx, running);
 	struct task_t * t = (struct task_t *)from.priv;
-	t->fctx = from.fctx;
+
+	if(t)
+	{
+		if(unlikely(t->state == TASK_STATE_EXITED))
+			task_unpin(t);
+		else
+		{
+			t->fctx = from.fctx;
+			smp_wmb();
+			t->oncpu = 0;
+		}
+	}
+}
+
+static void task_stack_overflow(struct task_t * task)
+{
+	if(!task->__stkovf)
+	{
+		task->__stkovf = 1;
+		LOG("Task '%s' overflowed its %ld bytes stack", task->name ? task->name : "", (long)task->stksz);
+	}
+}
+
+static inline void scheduler_switch_task(struct task_t * prev, struct task_t * next)
+{
+	if(prev && (prev->state != TASK_STATE_EXITED) && unlikely(*((uint32_t *)prev->stack) != TASK_STACK_CANARY))
+		task_stack_overflow(prev);
+	next->nswitch++;
+	next->sched->nswitch++;
+	trace_event(TRACE_TYPE_SWITCH, next, 0);
+	scheduler_finish_switch(jump_fcontext(next->fctx, prev));
 }
 
 static inline struct scheduler_t * scheduler_load_balance_choice(void)
@@ -194,52 +453,195 @@ static inline struct scheduler_t * scheduler_load_balance_choice(void)
 	return sched;
 }
 
+static inline int scheduler_load(struct scheduler_t * sched)
+{
+	struct task_t * idle = sched->idle;
+	int load = sched->nready;
+
+	if(idle && (idle->state == TASK_STATE_READY))
+		load--;
+	if(sched->running && (sched->running != idle))
+		load++;
+	return load;
+}
+
+/*
+ * An idling scheduler is kicked even from its own interrupt, the task may have
+ * been queued after the idle check and before the machine went to sleep
+ */
+static inline void scheduler_kick(struct scheduler_t * sched)
+{
+#if (CONFIG_MAX_SMP_CPUS > 1)
+	int i;
+#endif
+
+	smp_mb();
+	if(sched->idling)
+	{
+		machine_kick(sched - &__sched[0]);
+	}
+#if (CONFIG_MAX_SMP_CPUS > 1)
+	else if(scheduler_load(sched) > 1)
+	{
+		for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+		{
+			if(__sched[i].idling && (&__sched[i] != scheduler_self()))
+			{
+				__sched[i].kicked = 1;
+				machine_kick(i);
+				break;
+			}
+		}
+	}
+#endif
+}
+
+static inline void scheduler_idle(struct scheduler_t * sched)
+{
+	sched->idling = 1;
+	smp_mb();
+	if(sched->nready == 0)
+		machine_idle();
+	sched->idling = 0;
+}
+
+#if (CONFIG_MAX_SMP_CPUS > 1)
+
+static struct task_t * scheduler_steal_task(struct scheduler_t * dst, struct scheduler_t * src)
+{
+	struct rb_node * rb;
+	struct task_t * task;
+	uint64_t lag;
+
+	for(rb = rb_first_cached(&src->ready); rb; rb = rb_next(rb))
+	{
+		task = rb_entry(rb, struct task_t, node);
+		if(!task->nomigrate && !task->oncpu)
+		{
+			lag = task->vtime - src->min_vtime;
+			scheduler_dequeue_task(src, task);
+			src->weight -= nice_to_weight[task->nice];
+			src->migrate_out++;
+			list_del(&task->list);
+			task->sched = dst;
+			task->vtime = dst->min_vtime + lag;
+			dst->weight += nice_to_weight[task->nice];
+			dst->migrate_in++;
+			list_add_tail(&task->list, &dst->head);
+			scheduler_enqueue_task(dst, task);
+			return task;
+		}
+	}
+	return NULL;
+}
+
+static int scheduler_balance(struct scheduler_t * dst)
+{
+	struct scheduler_t * src = NULL;
+	struct task_t * task = NULL;
+	irq_flags_t flags;
+	int load, max = scheduler_load(dst) + 1;
+	int i;
+
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		if(&__sched[i] != dst)
+		{
+			load = scheduler_load(&__sched[i]);
+			if(load > max)
+			{
+				src = &__sched[i];
+				max = load;
+			}
+		}
+	}
+	if(src)
+	{
+		local_irq_save(flags);
+		if(src < dst)
+		{
+			spin_lock(&src->lock);
+			spin_lock(&dst->lock);
+		}
+		else
+		{
+			spin_lock(&dst->lock);
+			spin_lock(&src->lock);
+		}
+		if(scheduler_load(src) > scheduler_load(dst) + 1)
+			task = scheduler_steal_task(dst, src);
+		spin_unlock(&src->lock);
+		spin_unlock(&dst->lock);
+		local_irq_restore(flags);
+	}
+	return task ? 1 : 0;
+}
+#endif
+
+static inline struct scheduler_t * task_sched_lock(struct task_t * task, irq_flags_t * flags)
+{
+	struct scheduler_t * sched;
+
+	while(1)
+	{
+		sched = task->sched;
+		spin_lock_irqsave(&sched->lock, *flags);
+		if(likely(sched == task->sched))
+			return sched;
+		spin_unlock_irqrestore(&sched->lock, *flags);
+	}
+}
+
 static void fcontext_entry(struct transfer_t from)
 {
-	struct task_t * t = (struct task_t *)from.priv;
-	struct scheduler_t * sched = t->sched;
-	struct task_t * task = sched->running;
+	struct task_t * task = task_self();
+	struct scheduler_t * sched;
+	irq_flags_t flags;
 
-	t->fctx = from.fctx;
+	scheduler_finish_switch(from);
 	task->func(task, task->data);
-	uint32_t weight = nice_to_weight[task->nice];
+	trace_event(TRACE_TYPE_EXIT, task, 0);
+	if(!task_stack_check(task))
+		task_stack_overflow(task);
 	if(task->__stdin)
 		__file_free(task->__stdin);
 	if(task->__stdout)
 		__file_free(task->__stdout);
 	if(task->__stderr)
 		__file_free(task->__stderr);
-	if(task->name)
-		free(task->name);
-	if(task->fb)
-		free(task->fb);
-	if(task->input)
-		free(task->input);
-	if(task->stack)
-		free(task->stack);
-	free(task);
-
-	spin_lock(&sched->lock);
-	sched->weight -= weight;
+	if(task->__arena)
+		frame_arena_free(task->__arena);
+
+	sched = scheduler_self();
+	task_account(sched, task, ktime_to_ns(ktime_get()));
+	spin_lock_irqsave(&sched->lock, flags);
+	sched->weight -= nice_to_weight[task->nice];
+	list_del(&task->list);
+	task->state = TASK_STATE_EXITED;
 	struct task_t * next = scheduler_next_ready_task(sched);
 	if(likely(next))
 	{
 		scheduler_dequeue_task(sched, next);
+		next->state = TASK_STATE_RUNNING;
+		next->oncpu = 1;
 		next->start = ktime_to_ns(ktime_get());
-		spin_unlock(&sched->lock);
-		scheduler_switch_task(sched, next);
+		sched->running = next;
+		spin_unlock_irqrestore(&sched->lock, flags);
+		scheduler_switch_task(task, next);
 	}
 	else
 	{
-		spin_unlock(&sched->lock);
+		spin_unlock_irqrestore(&sched->lock, flags);
 	}
 }
 
-struct task_t * task_create(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, size_t stksz, int nice)
+static struct task_t * __task_create(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, void * stack, size_t stksz, int nice, enum task_policy_t policy, int prio, struct waiter_t * release, int nomigrate)
 {
 	struct task_t * self = task_self();
 	struct task_t * task;
-	void * stack;
+	irq_flags_t flags;
+	int ext = stack ? 1 : 0;
+	size_t off = 0;
 
 	if(!func)
 		return NULL;
@@ -249,6 +651,8 @@ struct task_t * task_create(struct scheduler_t * sched, const char * name, const
 
 	if(stksz <= 0)
 		stksz = CONFIG_TASK_STACK_SIZE;
+	else if(!stack)
+		stksz = (stksz + 15) & ~((size_t)15);
 
 	if(nice < -20)
 		nice = 0;
@@ -257,31 +661,41 @@ struct task_t * task_create(struct scheduler_t * sched, const char * name, const
 	else
 		nice += 20;
 
-	task = malloc(sizeof(struct task_t));
+	task = task_pool_alloc(stksz, stack ? NULL : &stack);
 	if(!task)
 		return NULL;
 
-	stack = malloc(stksz);
-	if(!stack)
-	{
-		free(task);
-		return NULL;
-	}
-
 	RB_CLEAR_NODE(&task->node);
-	task->name = strdup(name);
-	task->fb = strdup(fb);
-	task->input = strdup(input);
+	init_list_head(&task->list);
+	init_list_head(&task->wlist);
+	init_list_head(&task->rlist);
+	task->state = TASK_STATE_READY;
+	task->policy = policy;
+	task->prio = prio;
+	task->timeslice = 0;
+	task->oncpu = 0;
+	task->nomigrate = nomigrate;
+	task->name = task_strdup(task, name, &off);
+	task->fb = task_strdup(task, fb, &off);
+	task->input = task_strdup(task, input, &off);
 	task->start = ktime_to_ns(ktime_get());
 	task->vtime = 0;
+	task->runtime = 0;
+	task->nswitch = 0;
+	task->nyield = 0;
 	task->sched = sched;
 	task->stack = stack;
 	task->stksz = stksz;
 	task->nice = nice;
 	task->dynice = nice;
+#if (CONFIG_TASK_STACK_PAINT > 0)
+	if(ext)
+		memset(task->stack, TASK_STACK_PAINT, task->stksz);
+#endif
 	task->fctx = make_fcontext(task->stack + stksz, task->stksz, fcontext_entry);
 	task->func = func;
 	task->data = data;
+	*((uint32_t *)task->stack) = TASK_STACK_CANARY;
 
 	if(self)
 		task->__con = self->__con;
@@ -290,17 +704,96 @@ struct task_t * task_create(struct scheduler_t * sched, const char * name, const
 	task->__stdin = NULL;
 	task->__stdout = NULL;
 	task->__stderr = NULL;
+	task->__arena = NULL;
+	task->__release = release;
+	atomic_set(&task->__ref, 1);
 	task->__errno = 0;
+	task->__stkext = ext;
+	task->__stkovf = 0;
 
-	spin_lock(&sched->lock);
+	spin_lock_irqsave(&sched->lock, flags);
 	task->vtime = sched->min_vtime;
 	sched->weight += nice_to_weight[nice];
+	list_add_tail(&task->list, &sched->head);
 	scheduler_enqueue_task(sched, task);
-	spin_unlock(&sched->lock);
+	spin_unlock_irqrestore(&sched->lock, flags);
+	trace_event_name(TRACE_TYPE_CREATE, task, name);
+	scheduler_kick(sched);
+
+	return task;
+}
+
+struct task_t * task_create(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, size_t stksz, int nice)
+{
+	return __task_create(sched, name, fb, input, func, data, NULL, stksz, nice, TASK_POLICY_NORMAL, 0, NULL, 0);
+}
 
+/*
+ * The stack stays owned by the caller. When release is given it is added to here and
+ * subtracted once the task has exited and switched away, only then may the stack be reused.
+ */
+struct task_t * task_create_with_stack(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, void * stack, size_t stksz, int nice, struct waiter_t * release)
+{
+	struct task_t * task;
+
+	if(!stack || (stksz <= 0))
+		return NULL;
+	if(release)
+		waiter_add(release, 1);
+	task = __task_create(sched, name, fb, input, func, data, stack, stksz, nice, TASK_POLICY_NORMAL, 0, release, 0);
+	if(!task && release)
+		waiter_sub(release, 1);
 	return task;
 }
 
+/*
+ * The task stays on the given scheduler for its whole life, load balancing never steals it
+ */
+struct task_t * task_create_bound(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, size_t stksz, int nice)
+{
+	if(!sched)
+		return NULL;
+	return __task_create(sched, name, fb, input, func, data, NULL, stksz, nice, TASK_POLICY_NORMAL, 0, NULL, 1);
+}
+
+struct task_t * task_create_with_policy(struct scheduler_t * sched, const char * name, const char * fb, const char * input, task_func_t func, void * data, size_t stksz, int nice, enum task_policy_t policy, int prio)
+{
+	if((policy != TASK_POLICY_FIFO) && (policy != TASK_POLICY_RR))
+		policy = TASK_POLICY_NORMAL;
+	if(prio < 0)
+		prio = 0;
+	else if(prio > TASK_RT_PRIO_MAX - 1)
+		prio = TASK_RT_PRIO_MAX - 1;
+	return __task_create(sched, name, fb, input, func, data, NULL, stksz, nice, policy, (policy == TASK_POLICY_NORMAL) ? 0 : prio, NULL, 0);
+}
+
+int task_stack_check(struct task_t * task)
+{
+	if(task && (*((uint32_t *)task->stack) != TASK_STACK_CANARY))
+		return 0;
+	return 1;
+}
+
+/*
+ * High-water mark of a painted stack, the deepest word that no longer holds the paint. A pooled
+ * stack is repainted down to the mark of its previous owner when reused, so the mark is this task's.
+ */
+size_t task_stack_used(struct task_t * task)
+{
+#if (CONFIG_TASK_STACK_PAINT > 0)
+	uint32_t * p;
+
+	if(!task)
+		return 0;
+	p = task_stack_mark(task->stack, task->stksz);
+	if(!task_stack_check(task))
+		return task->stksz;
+	return (size_t)((char *)(task->stack + task->stksz) - (char *)p);
+#else
+	return task ? task->stksz : 0;
+#endif
+}
+
 void task_console(struct task_t * task, struct console_t * con)
 {
 	if(task)
@@ -326,6 +819,9 @@ void task_console(struct task_t * task, struct console_t * con)
 
 void task_nice(struct task_t * task, int nice)
 {
+	struct scheduler_t * sched;
+	irq_flags_t flags;
+
 	if(task)
 	{
 		if(nice < -20)
@@ -337,13 +833,69 @@ void task_nice(struct task_t * task, int nice)
 
 		if(task->nice != nice)
 		{
-			spin_lock(&task->sched->lock);
-			task->sched->weight -= nice_to_weight[task->nice];
-			task->sched->weight += nice_to_weight[nice];
+			sched = task_sched_lock(task, &flags);
+			sched->weight -= nice_to_weight[task->nice];
+			sched->weight += nice_to_weight[nice];
 			task->nice = nice;
 			task->dynice = nice;
-			spin_unlock(&task->sched->lock);
+			spin_unlock_irqrestore(&sched->lock, flags);
+			trace_event(TRACE_TYPE_DYNICE, task, nice - 20);
+		}
+	}
+}
+
+static inline int scheduler_need_resched(struct scheduler_t * sched, struct task_t * self)
+{
+	int prio;
+
+	if(sched->rtmap && !sched->rt_throttled)
+	{
+		if(self->policy == TASK_POLICY_NORMAL)
+			return 1;
+		prio = fls(sched->rtmap) - 1;
+		if(prio > self->prio)
+			return 1;
+		if((prio == self->prio) && (self->policy == TASK_POLICY_RR))
+			return (self->timeslice >= CONFIG_TASK_RT_TIMESLICE * 1000000ULL) ? 1 : 0;
+		return 0;
+	}
+	if(self->policy != TASK_POLICY_NORMAL)
+		return sched->rt_throttled;
+	return ((int64_t)(self->vtime - sched->min_vtime) < 0) ? 0 : 1;
+}
+
+void task_policy(struct task_t * task, enum task_policy_t policy, int prio)
+{
+	struct scheduler_t * sched;
+	irq_flags_t flags;
+	int queued;
+
+	if(task)
+	{
+		if((policy != TASK_POLICY_FIFO) && (policy != TASK_POLICY_RR))
+			policy = TASK_POLICY_NORMAL;
+		if(policy == TASK_POLICY_NORMAL)
+			prio = 0;
+		else if(prio < 0)
+			prio = 0;
+		else if(prio > TASK_RT_PRIO_MAX - 1)
+			prio = TASK_RT_PRIO_MAX - 1;
+
+		sched = task_sched_lock(task, &flags);
+		if((task->policy != policy) || (task->prio != prio))
+		{
+			queued = (task->state == TASK_STATE_READY) && (task != sched->running);
+			if(queued)
+				scheduler_dequeue_task(sched, task);
+			if((task->policy != TASK_POLICY_NORMAL) && (policy == TASK_POLICY_NORMAL))
+				task->vtime = sched->min_vtime;
+			task->policy = policy;
+			task->prio = prio;
+			task->timeslice = 0;
+			if(queued)
+				scheduler_enqueue_task(sched, task);
 		}
+		spin_unlock_irqrestore(&sched->lock, flags);
 	}
 }
 
@@ -352,108 +904,339 @@ void task_yield(void)
 	struct scheduler_t * sched = scheduler_self();
 	struct task_t * self = task_self();
 	uint64_t now = ktime_to_ns(ktime_get());
+	irq_flags_t flags;
 
-	self->vtime += calc_delta_fair(self, now - self->start);
-	if((int64_t)(self->vtime - sched->min_vtime) < 0)
+#if (CONFIG_MAX_SMP_CPUS > 1)
+	if(now - sched->balance >= CONFIG_TASK_BALANCE_INTERVAL * 1000000ULL)
+	{
+		sched->balance = now;
+		scheduler_balance(sched);
+	}
+#endif
+	task_account(sched, self, now);
+	self->nyield++;
+	trace_event(TRACE_TYPE_YIELD, self, 0);
+	if(!scheduler_need_resched(sched, self))
 	{
 		self->start = now;
 	}
 	else
 	{
-		spin_lock(&sched->lock);
-		scheduler_enqueue_task(sched, self);
+		spin_lock_irqsave(&sched->lock, flags);
+		self->state = TASK_STATE_READY;
+		if((self->policy == TASK_POLICY_FIFO) || ((self->policy == TASK_POLICY_RR) && (self->timeslice < CONFIG_TASK_RT_TIMESLICE * 1000000ULL)))
+		{
+			scheduler_enqueue_rt_task(sched, self, 1);
+		}
+		else
+		{
+			self->timeslice = 0;
+			scheduler_enqueue_task(sched, self);
+		}
+		struct task_t * next = scheduler_next_ready_task(sched);
+		scheduler_dequeue_task(sched, next);
+		next->state = TASK_STATE_RUNNING;
+		next->oncpu = 1;
+		next->start = now;
+		sched->running = next;
+		spin_unlock_irqrestore(&sched->lock, flags);
+		if(likely(next != self))
+			scheduler_switch_task(self, next);
+	}
+}
+
+void task_block(void)
+{
+	struct scheduler_t * sched = scheduler_self();
+	struct task_t * self = task_self();
+	uint64_t now = ktime_to_ns(ktime_get());
+	irq_flags_t flags;
+
+	trace_event(TRACE_TYPE_BLOCK, self, 0);
+	spin_lock_irqsave(&sched->lock, flags);
+	if(self->state == TASK_STATE_BLOCKED)
+	{
+		task_account(sched, self, now);
 		struct task_t * next = scheduler_next_ready_task(sched);
 		if(likely(next))
 		{
 			scheduler_dequeue_task(sched, next);
+			next->state = TASK_STATE_RUNNING;
+			next->oncpu = 1;
 			next->start = now;
-			spin_unlock(&sched->lock);
-			if(likely(next != self))
-				scheduler_switch_task(sched, next);
+			sched->running = next;
+			spin_unlock_irqrestore(&sched->lock, flags);
+			scheduler_switch_task(self, next);
+			return;
 		}
-		else
+	}
+	spin_unlock_irqrestore(&sched->lock, flags);
+
+	while(self->state == TASK_STATE_BLOCKED)
+		smp_mb();
+	self->start = ktime_to_ns(ktime_get());
+}
+
+static int task_timeout_function(struct timer_t * timer, void * data)
+{
+	task_wakeup((struct task_t *)data);
+	return 0;
+}
+
+void task_block_timeout(ktime_t timeout)
+{
+	struct timer_t timer;
+
+	timer_init(&timer, task_timeout_function, task_self());
+	timer_start(&timer, timeout);
+	task_block();
+	timer_cancel(&timer);
+}
+
+void task_wakeup(struct task_t * task)
+{
+	struct scheduler_t * sched;
+	irq_flags_t flags;
+
+	if(task)
+	{
+		sched = task_sched_lock(task, &flags);
+		if(task->state == TASK_STATE_BLOCKED)
 		{
-			spin_unlock(&sched->lock);
+			trace_event(TRACE_TYPE_WAKEUP, task, 0);
+			if(task == sched->running)
+			{
+				task->state = TASK_STATE_RUNNING;
+			}
+			else
+			{
+				if((int64_t)(task->vtime - sched->min_vtime) < 0)
+					task->vtime = sched->min_vtime;
+				task->state = TASK_STATE_READY;
+				scheduler_enqueue_task(sched, task);
+			}
 		}
+		spin_unlock_irqrestore(&sched->lock, flags);
+		scheduler_kick(sched);
 	}
 }
 
-static void secondary_idle_task(struct task_t * task, void * data)
+/*
+ * Drops a pin taken by scheduler_pin_tasks(), the last one gives an exited task back
+ */
+void task_unpin(struct task_t * task)
 {
+	if(task && atomic_dec_and_test(&task->__ref))
+		task_release(task);
+}
+
+/*
+ * An idle cpu balances at once when another one kicked it for work, otherwise it backs
+ * off from 100us up to the balance interval for as long as there is nothing to steal
+ */
+static void scheduler_idle_loop(struct scheduler_t * sched)
+{
+#if (CONFIG_MAX_SMP_CPUS > 1)
+	uint64_t next = 0, wait = 0, now;
+#endif
+
 	while(1)
 	{
+#if (CONFIG_MAX_SMP_CPUS > 1)
+		now = ktime_to_ns(ktime_get());
+		if(sched->kicked || (now >= next))
+		{
+			sched->kicked = 0;
+			if(scheduler_balance(sched))
+				wait = 0;
+			else if(wait < CONFIG_TASK_BALANCE_INTERVAL * 1000000ULL)
+				wait = wait ? (wait << 1) : 100000ULL;
+			next = now + wait;
+		}
+#endif
+		scheduler_idle(sched);
 		task_yield();
 	}
 }
 
+static void secondary_idle_task(struct task_t * task, void * data)
+{
+	scheduler_idle_loop(task->sched);
+}
+
 static void smpboot_entry(void)
 {
 	machine_smpinit();
 
 	struct scheduler_t * sched = scheduler_self();
-	task_create(sched, "idle", NULL, NULL, secondary_idle_task, (int[]){smp_processor_id()}, SZ_8K, 19);
+	irq_flags_t flags;
+
+	sched->idle = task_create_bound(sched, "idle", NULL, NULL, secondary_idle_task, (int[]){smp_processor_id()}, SZ_8K, 19);
 
-	spin_lock(&sched->lock);
+	spin_lock_irqsave(&sched->lock, flags);
 	struct task_t * next = scheduler_next_ready_task(sched);
 	if(likely(next))
 	{
 		sched->running = next;
 		scheduler_dequeue_task(sched, next);
+		next->state = TASK_STATE_RUNNING;
+		next->oncpu = 1;
 		next->start = ktime_to_ns(ktime_get());
-		spin_unlock(&sched->lock);
-		scheduler_switch_task(sched, next);
+		spin_unlock_irqrestore(&sched->lock, flags);
+		scheduler_switch_task(NULL, next);
 	}
 	else
 	{
-		spin_unlock(&sched->lock);
+		spin_unlock_irqrestore(&sched->lock, flags);
 	}
 }
 
 static void primary_idle_task(struct task_t * task, void * data)
 {
 	machine_smpboot(smpboot_entry);
-	while(1)
-	{
-		task_yield();
-	}
+	scheduler_idle_loop(task->sched);
 }
 
 void do_idle_task(void)
 {
 	struct scheduler_t * sched = scheduler_self();
-	task_create(sched, "idle", NULL, NULL, primary_idle_task, (int[]){smp_processor_id()}, SZ_8K, 19);
+	sched->idle = task_create_bound(sched, "idle", NULL, NULL, primary_idle_task, (int[]){smp_processor_id()}, SZ_8K, 19);
+}
+
+static struct kobj_t * search_class_scheduler_kobj(void)
+{
+	struct kobj_t * kclass = kobj_search_directory_with_create(kobj_get_root(), "class");
+	return kobj_search_directory_with_create(kclass, "scheduler");
+}
+
+static ssize_t scheduler_read_migration(struct kobj_t * kobj, void * buf, size_t size)
+{
+	struct scheduler_t * sched = (struct scheduler_t *)kobj->priv;
+	char * p = buf;
+	int len = 0;
+
+	len += sprintf((char *)(p + len), " migrate in: %llu\r\n", (unsigned long long)sched->migrate_in);
+	len += sprintf((char *)(p + len), " migrate out: %llu\r\n", (unsigned long long)sched->migrate_out);
+	return len;
+}
+
+static ssize_t scheduler_read_stat(struct kobj_t * kobj, void * buf, size_t size)
+{
+	struct scheduler_t * sched = (struct scheduler_t *)kobj->priv;
+	char * p = buf;
+	int len = 0;
+
+	len += sprintf((char *)(p + len), " busy: %llu ns\r\n", (unsigned long long)sched->busy_time);
+	len += sprintf((char *)(p + len), " idle: %llu ns\r\n", (unsigned long long)sched->idle_time);
+	len += sprintf((char *)(p + len), " switch: %llu\r\n", (unsigned long long)sched->nswitch);
+	return len;
+}
+
+/*
+ * Pins up to max tasks of the scheduler and returns how many it has, a pinned
+ * task stays valid after it exits until task_unpin() is called on it.
+ */
+int scheduler_pin_tasks(struct scheduler_t * sched, struct task_t ** tasks, int max)
+{
+	struct task_t * pos;
+	irq_flags_t flags;
+	int n = 0;
+
+	spin_lock_irqsave(&sched->lock, flags);
+	list_for_each_entry(pos, &sched->head, list)
+	{
+		if(n < max)
+		{
+			atomic_inc(&pos->__ref);
+			tasks[n] = pos;
+		}
+		n++;
+	}
+	spin_unlock_irqrestore(&sched->lock, flags);
+	return n;
+}
+
+static ssize_t scheduler_read_tasks(struct kobj_t * kobj, void * buf, size_t size)
+{
+	struct scheduler_t * sched = (struct scheduler_t *)kobj->priv;
+	struct task_t ** tasks;
+	struct task_t * pos;
+	char * p = buf;
+	int len = 0;
+	int max = size / 160;
+	int n, i;
+
+	tasks = malloc(max * sizeof(struct task_t *));
+	if(!tasks)
+		return 0;
+	n = min(scheduler_pin_tasks(sched, tasks, max), max);
+	for(i = 0; i < n; i++)
+	{
+		pos = tasks[i];
+		len += sprintf((char *)(p + len), " %-16.64s %12llu %8llu %8llu %8ld/%ld\r\n", pos->name ? pos->name : "", (unsigned long long)pos->runtime, (unsigned long long)pos->nswitch, (unsigned long long)pos->nyield, (long)task_stack_used(pos), (long)pos->stksz);
+		task_unpin(pos);
+	}
+	free(tasks);
+	return len;
 }
 
 void do_init_sched(void)
 {
+	char name[16];
+
 	for(int i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
 	{
 		struct scheduler_t * sched = &__sched[i];
 		spin_lock_init(&sched->lock);
 		spin_lock(&sched->lock);
 		sched->ready = RB_ROOT_CACHED;
+		for(int j = 0; j < TASK_RT_PRIO_MAX; j++)
+			init_list_head(&sched->rt[j]);
+		sched->rtmap = 0;
+		sched->rt_period = 0;
+		sched->rt_time = 0;
+		sched->rt_throttled = 0;
+		init_list_head(&sched->head);
 		sched->running = NULL;
+		sched->idle = NULL;
 		sched->min_vtime = 0;
 		sched->weight = 0;
+		sched->balance = 0;
+		sched->migrate_in = 0;
+		sched->migrate_out = 0;
+		sched->busy_time = 0;
+		sched->idle_time = 0;
+		sched->nswitch = 0;
+		sched->nready = 0;
+		sched->idling = 0;
+		sched->kicked = 0;
 		spin_unlock(&sched->lock);
+		sprintf(name, "cpu%d", i);
+		kobj_add_regular(kobj_search_directory_with_create(search_class_scheduler_kobj(), name), "migration", scheduler_read_migration, NULL, sched);
+		kobj_add_regular(kobj_search_directory_with_create(search_class_scheduler_kobj(), name), "stat", scheduler_read_stat, NULL, sched);
+		kobj_add_regular(kobj_search_directory_with_create(search_class_scheduler_kobj(), name), "tasks", scheduler_read_tasks, NULL, sched);
 	}
 }
 
 void scheduler_loop(void)
 {
 	struct scheduler_t * sched = scheduler_self();
-	spin_lock(&sched->lock);
+	irq_flags_t flags;
+
+	spin_lock_irqsave(&sched->lock, flags);
 	struct task_t * next = scheduler_next_ready_task(sched);
 	if(likely(next))
 	{
 		sched->running = next;
 		scheduler_dequeue_task(sched, next);
+		next->state = TASK_STATE_RUNNING;
+		next->oncpu = 1;
 		next->start = ktime_to_ns(ktime_get());
-		spin_unlock(&sched->lock);
-		scheduler_switch_task(sched, next);
+		spin_unlock_irqrestore(&sched->lock, flags);
+		scheduler_switch_task(NULL, next);
 	}
 	else
 	{
-		spin_unlock(&sched->lock);
+		spin_unlock_irqrestore(&sched->lock, flags);
 	}
 }
@@ -0,0 +1,385 @@
+/*
+ * kernel/core/trace.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <xboot.h>
+#include <xboot/trace.h>
+
+volatile int __trace_enabled = 0;
+EXPORT_SYMBOL(__trace_enabled);
+static struct trace_buffer_t __trace_buffer[CONFIG_MAX_SMP_CPUS];
+
+/*
+ * Interrupt hooks trace into the same per-cpu buffer as task context, and atomic_add_return is
+ * a plain read modify write on ARMv5 and csky, so the slot is reserved with interrupts masked
+ */
+static inline struct trace_event_t * trace_reserve(int type, const void * ptr)
+{
+	struct trace_buffer_t * b;
+	struct trace_event_t * e;
+	irq_flags_t flags;
+	int idx;
+
+	local_irq_save(flags);
+	b = &__trace_buffer[smp_processor_id()];
+	if(!b->event)
+	{
+		local_irq_restore(flags);
+		return NULL;
+	}
+	idx = atomic_add_return(&b->head, 1) - 1;
+	e = &b->event[idx & (CONFIG_TRACE_EVENTS - 1)];
+	e->time = ktime_to_ns(ktime_get());
+	e->ptr = ptr;
+	e->type = type;
+	local_irq_restore(flags);
+	return e;
+}
+
+void __trace_event(int type, const void * ptr, int arg)
+{
+	struct trace_event_t * e = trace_reserve(type, ptr);
+
+	if(e)
+		e->arg = arg;
+}
+EXPORT_SYMBOL(__trace_event);
+
+void __trace_event_name(int type, const void * ptr, const char * name)
+{
+	struct trace_event_t * e = trace_reserve(type, ptr);
+
+	if(e)
+		strlcpy(e->name, name ? name : "", sizeof(e->name));
+}
+EXPORT_SYMBOL(__trace_event_name);
+
+int trace_start(void)
+{
+	struct trace_buffer_t * b;
+	int i;
+
+	if(__trace_enabled)
+		return 1;
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		b = &__trace_buffer[i];
+		if(!b->event)
+		{
+			b->event = malloc(sizeof(struct trace_event_t) * CONFIG_TRACE_EVENTS);
+			if(!b->event)
+				return 0;
+			atomic_set(&b->head, 0);
+		}
+	}
+	smp_wmb();
+	__trace_enabled = 1;
+	return 1;
+}
+
+void trace_stop(void)
+{
+	__trace_enabled = 0;
+	smp_mb();
+}
+
+void trace_clear(void)
+{
+	int i;
+
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+		atomic_set(&__trace_buffer[i].head, 0);
+}
+
+int trace_count(int cpu)
+{
+	if((cpu < 0) || (cpu >= CONFIG_MAX_SMP_CPUS) || !__trace_buffer[cpu].event)
+		return 0;
+	return atomic_get(&__trace_buffer[cpu].head);
+}
+
+struct trace_writer_t {
+	struct json_writer_t json;
+	int fd;
+	char buf[4096];
+};
+
+static void trace_flush(struct json_writer_t * w, const char * buf, size_t len)
+{
+	vfs_write(((struct trace_writer_t *)w->priv)->fd, (void *)buf, len);
+}
+
+static void trace_name_set(struct hmap_t * m, const void * ptr, const char * name)
+{
+	char key[32];
+	char * v;
+
+	sprintf(key, "%p", ptr);
+	v = hmap_search(m, key);
+	if(v)
+	{
+		if(strcmp(v, name) == 0)
+			return;
+		hmap_remove(m, key);
+		free(v);
+	}
+	hmap_add(m, key, strdup(name));
+}
+
+static const char * trace_name_get(struct hmap_t * m, const void * ptr, char * buf)
+{
+	char * v;
+
+	sprintf(buf, "%p", ptr);
+	v = hmap_search(m, buf);
+	if(v)
+		return v;
+	sprintf(buf, "task-%p", ptr);
+	return buf;
+}
+
+static void trace_hmap_callback(struct hmap_t * m, struct hmap_entry_t * e)
+{
+	if(e)
+		free(e->value);
+}
+
+static const char * trace_task_event[] = {
+	[TRACE_TYPE_YIELD]	= "yield",
+	[TRACE_TYPE_BLOCK]	= "block",
+	[TRACE_TYPE_WAKEUP]	= "wakeup",
+	[TRACE_TYPE_CREATE]	= "create",
+	[TRACE_TYPE_EXIT]	= "exit",
+};
+
+static void trace_json_time(struct json_writer_t * w, const char * key, uint64_t ns)
+{
+	char tmp[32];
+	int len;
+
+	len = sprintf(tmp, "%llu.%03llu", (unsigned long long)(ns / 1000), (unsigned long long)(ns % 1000));
+	json_writer_key(w, key);
+	json_writer_raw(w, tmp, len);
+}
+
+/*
+ * Opens the event object, the caller adds its own fields and closes it
+ */
+static void trace_json_event(struct json_writer_t * w, const char * name, const char * ph, const char * cat, int cpu, uint64_t ts)
+{
+	json_writer_object_begin(w);
+	json_writer_key(w, "name");
+	json_writer_string(w, name);
+	json_writer_key(w, "ph");
+	json_writer_string(w, ph);
+	if(cat)
+	{
+		json_writer_key(w, "cat");
+		json_writer_string(w, cat);
+	}
+	json_writer_key(w, "pid");
+	json_writer_integer(w, 0);
+	json_writer_key(w, "tid");
+	json_writer_integer(w, cpu);
+	trace_json_time(w, "ts", ts);
+}
+
+/*
+ * Instant event with an open args object holding the task name
+ */
+static void trace_json_task(struct json_writer_t * w, const char * name, int cpu, uint64_t ts, const char * task)
+{
+	trace_json_event(w, name, "i", "sched", cpu, ts);
+	json_writer_key(w, "s");
+	json_writer_string(w, "t");
+	json_writer_key(w, "args");
+	json_writer_object_begin(w);
+	json_writer_key(w, "task");
+	json_writer_string(w, task);
+}
+
+static void trace_json_slice(struct json_writer_t * w, const char * name, int cpu, uint64_t start, uint64_t end)
+{
+	trace_json_event(w, name, "X", "sched", cpu, start);
+	trace_json_time(w, "dur", end - start);
+	json_writer_object_end(w);
+}
+
+static void trace_dump_cpu(struct json_writer_t * w, struct hmap_t * m, int cpu)
+{
+	struct trace_buffer_t * b = &__trace_buffer[cpu];
+	struct trace_event_t * e;
+	const void * cur = NULL;
+	uint64_t start = 0, last = 0;
+	char tmp[2][32];
+	int head = atomic_get(&b->head);
+	int i = (head > CONFIG_TRACE_EVENTS) ? head - CONFIG_TRACE_EVENTS : 0;
+
+	for(; i < head; i++)
+	{
+		e = &b->event[i & (CONFIG_TRACE_EVENTS - 1)];
+		last = e->time;
+		switch(e->type)
+		{
+		case TRACE_TYPE_SWITCH:
+			if(cur && (e->time >= start))
+				trace_json_slice(w, trace_name_get(m, cur, tmp[0]), cpu, start, e->time);
+			cur = e->ptr;
+			start = e->time;
+			break;
+		case TRACE_TYPE_YIELD:
+		case TRACE_TYPE_BLOCK:
+		case TRACE_TYPE_WAKEUP:
+		case TRACE_TYPE_CREATE:
+		case TRACE_TYPE_EXIT:
+			trace_json_task(w, trace_task_event[e->type], cpu, e->time, trace_name_get(m, e->ptr, tmp[0]));
+			json_writer_object_end(w);
+			json_writer_object_end(w);
+			break;
+		case TRACE_TYPE_DYNICE:
+			trace_json_task(w, "dynice", cpu, e->time, trace_name_get(m, e->ptr, tmp[0]));
+			json_writer_key(w, "dynice");
+			json_writer_integer(w, e->arg);
+			json_writer_object_end(w);
+			json_writer_object_end(w);
+			break;
+		case TRACE_TYPE_TIMER_ENTER:
+		case TRACE_TYPE_TIMER_EXIT:
+			sprintf(tmp[1], "timer %p", e->ptr);
+			trace_json_event(w, tmp[1], (e->type == TRACE_TYPE_TIMER_ENTER) ? "B" : "E", "timer", cpu, e->time);
+			json_writer_object_end(w);
+			break;
+		case TRACE_TYPE_IRQ_ENTER:
+			trace_json_event(w, e->ptr ? (const char *)e->ptr : "irq", "B", "irq", cpu, e->time);
+			json_writer_key(w, "args");
+			json_writer_object_begin(w);
+			json_writer_key(w, "base");
+			json_writer_integer(w, e->arg);
+			json_writer_object_end(w);
+			json_writer_object_end(w);
+			break;
+		case TRACE_TYPE_IRQ_EXIT:
+			trace_json_event(w, e->ptr ? (const char *)e->ptr : "irq", "E", "irq", cpu, e->time);
+			json_writer_object_end(w);
+			break;
+		default:
+			break;
+		}
+	}
+	if(cur && (last >= start))
+		trace_json_slice(w, trace_name_get(m, cur, tmp[0]), cpu, start, last);
+}
+
+int trace_dump(const char * path)
+{
+	struct trace_writer_t * w;
+	struct trace_buffer_t * b;
+	struct trace_event_t * e;
+	struct scheduler_t * sched;
+	struct task_t * pos;
+	struct hmap_t * m;
+	irq_flags_t flags;
+	char name[16];
+	int enabled = __trace_enabled;
+	int head, cpu, i;
+
+	w = malloc(sizeof(struct trace_writer_t));
+	if(!w)
+		return 0;
+	m = hmap_alloc(0, trace_hmap_callback);
+	if(!m)
+	{
+		free(w);
+		return 0;
+	}
+	w->fd = vfs_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(w->fd < 0)
+	{
+		hmap_free(m);
+		free(w);
+		return 0;
+	}
+	json_writer_init(&w->json, w->buf, sizeof(w->buf), trace_flush, w);
+
+	trace_stop();
+	for(cpu = 0; cpu < CONFIG_MAX_SMP_CPUS; cpu++)
+	{
+		b = &__trace_buffer[cpu];
+		if(!b->event)
+			continue;
+		head = atomic_get(&b->head);
+		for(i = (head > CONFIG_TRACE_EVENTS) ? head - CONFIG_TRACE_EVENTS : 0; i < head; i++)
+		{
+			e = &b->event[i & (CONFIG_TRACE_EVENTS - 1)];
+			if(e->type == TRACE_TYPE_CREATE)
+			{
+				strlcpy(name, e->name, sizeof(name));
+				trace_name_set(m, e->ptr, name);
+			}
+		}
+	}
+	for(cpu = 0; cpu < CONFIG_MAX_SMP_CPUS; cpu++)
+	{
+		sched = &__sched[cpu];
+		spin_lock_irqsave(&sched->lock, flags);
+		list_for_each_entry(pos, &sched->head, list)
+		{
+			strlcpy(name, pos->name ? pos->name : "", sizeof(name));
+			trace_name_set(m, pos, name);
+		}
+		spin_unlock_irqrestore(&sched->lock, flags);
+	}
+
+	json_writer_object_begin(&w->json);
+	json_writer_key(&w->json, "displayTimeUnit");
+	json_writer_string(&w->json, "ns");
+	json_writer_key(&w->json, "traceEvents");
+	json_writer_array_begin(&w->json);
+	for(cpu = 0; cpu < CONFIG_MAX_SMP_CPUS; cpu++)
+	{
+		sprintf(name, "CPU%d", cpu);
+		trace_json_event(&w->json, "thread_name", "M", NULL, cpu, 0);
+		json_writer_key(&w->json, "args");
+		json_writer_object_begin(&w->json);
+		json_writer_key(&w->json, "name");
+		json_writer_string(&w->json, name);
+		json_writer_object_end(&w->json);
+		json_writer_object_end(&w->json);
+		if(__trace_buffer[cpu].event)
+			trace_dump_cpu(&w->json, m, cpu);
+	}
+	json_writer_array_end(&w->json);
+	json_writer_object_end(&w->json);
+	json_writer_flush(&w->json);
+	vfs_close(w->fd);
+	hmap_free(m);
+	free(w);
+	if(enabled)
+		trace_start();
+	return 1;
+}
@@ -0,0 +1,98 @@
+/*
+ * kernel/core/waitqueue.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <xboot.h>
+#include <xboot/waitqueue.h>
+
+void waitqueue_init(struct waitqueue_t * wq)
+{
+	if(wq)
+	{
+		init_list_head(&wq->head);
+		spin_lock_init(&wq->lock);
+	}
+}
+
+void waitqueue_prepare(struct waitqueue_t * wq)
+{
+	struct task_t * self = task_self();
+	irq_flags_t flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	if(list_empty(&self->wlist))
+		list_add_tail(&self->wlist, &wq->head);
+	self->state = TASK_STATE_BLOCKED;
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void waitqueue_finish(struct waitqueue_t * wq)
+{
+	struct task_t * self = task_self();
+	irq_flags_t flags;
+
+	spin_lock_irqsave(&wq->lock, flags);
+	if(!list_empty(&self->wlist))
+		list_del_init(&self->wlist);
+	spin_unlock_irqrestore(&wq->lock, flags);
+	task_wakeup(self);
+}
+
+void waitqueue_wakeup(struct waitqueue_t * wq)
+{
+	struct task_t * task;
+	irq_flags_t flags;
+
+	if(wq)
+	{
+		spin_lock_irqsave(&wq->lock, flags);
+		if(!list_empty(&wq->head))
+		{
+			task = list_first_entry(&wq->head, struct task_t, wlist);
+			list_del_init(&task->wlist);
+			task_wakeup(task);
+		}
+		spin_unlock_irqrestore(&wq->lock, flags);
+	}
+}
+
+void waitqueue_wakeup_all(struct waitqueue_t * wq)
+{
+	struct task_t * pos, * n;
+	irq_flags_t flags;
+
+	if(wq)
+	{
+		spin_lock_irqsave(&wq->lock, flags);
+		list_for_each_entry_safe(pos, n, &wq->head, wlist)
+		{
+			list_del_init(&pos->wlist);
+			task_wakeup(pos);
+		}
+		spin_unlock_irqrestore(&wq->lock, flags);
+	}
+}
@@ -76,17 +76,24 @@ static spinlock_t __window_manager_lock = SPIN_LOCK_INIT();
 
 static inline struct window_manager_t * window_manager_search(struct framebuffer_t * fb)
 {
-	struct window_manager_t * pos, * n;
+	struct window_manager_t * pos;
+	struct window_manager_t * wm = NULL;
+	int idx;
 
 	if(fb)
 	{
-		list_for_each_entry_safe(pos, n, &__window_manager_list, list)
+		idx = rcu_read_lock();
+		list_for_each_entry_rcu(pos, &__window_manager_list, list)
 		{
 			if(pos->fb == fb)
-				return pos;
+			{
+				wm = pos;
+				break;
+			}
 		}
+		rcu_read_unlock(idx);
 	}
-	return NULL;
+	return wm;
 }
 
 static const unsigned char watermark_png[] = {
@@ -915,6 +922,45 @@ static const unsigned char cursor_png[] = {
 	0x44, 0xae, 0x42, 0x60, 0x82,
 };
 
+/*
+ * Moving a window deletes and inserts the same entry, the grace period in between keeps readers
+ * standing on it from being carried to the other end. Callers hold the manager mutex, which also
+ * keeps window_free away, so this is never done from irq context or inside a read section
+ */
+static void window_reorder(struct window_manager_t * wm, struct window_t * w, int front)
+{
+	if(front ? list_is_first(&w->list, &wm->window) : list_is_last(&w->list, &wm->window))
+		return;
+	spin_lock(&wm->lock);
+	list_del_rcu(&w->list);
+	spin_unlock(&wm->lock);
+	synchronize_rcu();
+	spin_lock(&wm->lock);
+	if(front)
+		list_add_rcu(&w->list, &wm->window);
+	else
+		list_add_tail_rcu(&w->list, &wm->window);
+	wm->refresh = 1;
+	spin_unlock(&wm->lock);
+}
+
+static void window_manager_home(struct work_t * work, void * data)
+{
+	struct window_manager_t * wm = (struct window_manager_t *)data;
+	struct window_t * pos;
+
+	mutex_lock(&wm->mutex);
+	list_for_each_entry(pos, &wm->window, list)
+	{
+		if(pos->launcher)
+		{
+			window_reorder(wm, pos, 1);
+			break;
+		}
+	}
+	mutex_unlock(&wm->mutex);
+}
+
 static struct window_manager_t * window_manager_alloc(const char * fb)
 {
 	struct window_manager_t * wm;
@@ -947,10 +993,12 @@ static struct window_manager_t * window_manager_alloc(const char * fb)
 	region_init(&wm->cursor.ro, 0, 0, 0, 0);
 	region_init(&wm->cursor.rn, 0, 0, 0, 0);
 	spin_lock_init(&wm->lock);
+	mutex_init(&wm->mutex);
+	work_init(&wm->home, window_manager_home, wm);
 	init_list_head(&wm->list);
 	init_list_head(&wm->window);
 	spin_lock_irqsave(&__window_manager_lock, flags);
-	list_add_tail(&wm->list, &__window_manager_list);
+	list_add_tail_rcu(&wm->list, &__window_manager_list);
 	spin_unlock_irqrestore(&__window_manager_lock, flags);
 
 	if(!machine_verify())
@@ -973,13 +1021,16 @@ static void window_manager_free(struct window_manager_t * wm)
 		if(pos == wm)
 		{
 			spin_lock_irqsave(&__window_manager_lock, flags);
-			list_del(&pos->list);
+			list_del_rcu(&pos->list);
 			spin_unlock_irqrestore(&__window_manager_lock, flags);
+			synchronize_rcu();
+			work_cancel(&pos->home);
 			if(pos->watermark.s)
 				surface_free(pos->watermark.s);
 			if(pos->cursor.s)
 				surface_free(pos->cursor.s);
 			free(pos);
+			break;
 		}
 	}
 }
@@ -1004,7 +1055,7 @@ struct window_t * window_alloc(const char * fb, const char * input)
 	w->wm = wm;
 	w->s = framebuffer_create_surface(w->wm->fb);
 	w->rl = region_list_alloc(0);
-	w->event = fifo_alloc(sizeof(struct event_t) * CONFIG_EVENT_FIFO_SIZE);
+	w->event = mpmc_ring_alloc(sizeof(struct event_t), CONFIG_EVENT_FIFO_SIZE);
 	w->launcher = 0;
 	if(p && (*p != '\0'))
 	{
@@ -1038,7 +1089,7 @@ struct window_t * window_alloc(const char * fb, const char * input)
 		}
 	}
 	spin_lock(&wm->lock);
-	list_add(&w->list, &wm->window);
+	list_add_rcu(&w->list, &wm->window);
 	wm->wcount++;
 	wm->refresh = 1;
 	spin_unlock(&wm->lock);
@@ -1048,42 +1099,46 @@ struct window_t * window_alloc(const char * fb, const char * input)
 
 void window_free(struct window_t * w)
 {
+	struct window_manager_t * wm;
+
 	if(!w || !w->wm)
 		return;
 
-	spin_lock(&w->wm->lock);
-	list_del(&w->list);
-	w->wm->wcount--;
-	w->wm->refresh = 1;
-	spin_unlock(&w->wm->lock);
-	if(w->wm->wcount <= 0)
-		window_manager_free(w->wm);
-	fifo_free(w->event);
+	wm = w->wm;
+	mutex_lock(&wm->mutex);
+	spin_lock(&wm->lock);
+	list_del_rcu(&w->list);
+	wm->wcount--;
+	wm->refresh = 1;
+	spin_unlock(&wm->lock);
+	mutex_unlock(&wm->mutex);
+	synchronize_rcu();
+	mpmc_ring_free(w->event);
 	hmap_free(w->map);
-	framebuffer_destroy_surface(w->wm->fb, w->s);
+	framebuffer_destroy_surface(wm->fb, w->s);
 	region_list_free(w->rl);
 	free(w);
+	if(wm->wcount <= 0)
+		window_manager_free(wm);
 }
 
 void window_to_front(struct window_t * w)
 {
-	if(w && w->wm && !list_is_first(&w->list, &w->wm->window))
+	if(w && w->wm)
 	{
-		spin_lock(&w->wm->lock);
-		list_move(&w->list, &w->wm->window);
-		w->wm->refresh = 1;
-		spin_unlock(&w->wm->lock);
+		mutex_lock(&w->wm->mutex);
+		window_reorder(w->wm, w, 1);
+		mutex_unlock(&w->wm->mutex);
 	}
 }
 
 void window_to_back(struct window_t * w)
 {
-	if(w && w->wm && !list_is_last(&w->list, &w->wm->window))
+	if(w && w->wm)
 	{
-		spin_lock(&w->wm->lock);
-		list_move_tail(&w->list, &w->wm->window);
-		w->wm->refresh = 1;
-		spin_unlock(&w->wm->lock);
+		mutex_lock(&w->wm->mutex);
+		window_reorder(w->wm, w, 0);
+		mutex_unlock(&w->wm->mutex);
 	}
 }
 
@@ -1185,46 +1240,41 @@ void window_exit(struct window_t * w)
 		e.device = &(struct input_t){ "system", NULL, NULL };
 		e.type = EVENT_TYPE_SYSTEM_EXIT;
 		e.timestamp = ktime_get();
-		fifo_put(w->event, (unsigned char *)&e, sizeof(struct event_t));
+		mpmc_ring_enqueue(w->event, &e);
 	}
 }
 
 int window_pump_event(struct window_t * w, struct event_t * e)
 {
-	if(w && (fifo_get(w->event, (unsigned char *)e, sizeof(struct event_t)) == sizeof(struct event_t)))
+	if(w && (mpmc_ring_dequeue(w->event, e, 1) == 1))
 		return 1;
 	return 0;
 }
 
 void push_event(struct event_t * e)
 {
-	struct window_manager_t * pos, * n;
+	struct window_manager_t * pos;
 	struct window_t * w;
+	int idx;
 
 	if(e)
 	{
 		e->timestamp = ktime_get();
-		list_for_each_entry_safe(pos, n, &__window_manager_list, list)
+		idx = rcu_read_lock();
+		list_for_each_entry_rcu(pos, &__window_manager_list, list)
 		{
 			w = (struct window_t *)list_first_entry_or_null(&pos->window, struct window_t, list);
 			if(w && (!w->map || hmap_search(w->map, ((struct input_t *)e->device)->name)))
 			{
-				fifo_put(w->event, (unsigned char *)e, sizeof(struct event_t));
+				mpmc_ring_enqueue(w->event, e);
 				switch(e->type)
 				{
 				case EVENT_TYPE_KEY_DOWN:
+					/*
+					 * Raising the launcher waits for a grace period, so it is left to the worker
+					 */
 					if(e->e.key_down.key == KEY_HOME)
-					{
-						struct window_t * wpos, * wn;
-						list_for_each_entry_safe(wpos, wn, &pos->window, list)
-						{
-							if(wpos->launcher)
-							{
-								window_to_front(wpos);
-								break;
-							}
-						}
-					}
+						work_queue(&pos->home);
 					break;
 				case EVENT_TYPE_KEY_UP:
 					break;
@@ -1275,5 +1325,6 @@ void push_event(struct event_t * e)
 				}
 			}
 		}
+		rcu_read_unlock(idx);
 	}
 }
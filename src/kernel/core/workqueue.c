@@ -0,0 +1,273 @@
+/*
+ * kernel/core/workqueue.c
+ *
+ * Copyright(c) 2007-2022 Jianjun Jiang <8192542@qq.com>
+ * Official site: http://xboot.org
+ * Mobile phone: +86-18665388956
+ * QQ: 8192542
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <xboot.h>
+#include <xboot/workqueue.h>
+
+static struct worker_t __worker[CONFIG_MAX_SMP_CPUS];
+
+static void worker_insert(struct worker_t * w, struct work_t * work)
+{
+	struct worker_t * last = work->worker;
+	irq_flags_t flags;
+
+	/*
+	 * Keep a work that is still running on its last worker,
+	 * so that it never runs concurrently with itself.
+	 */
+	if(last && (last != w))
+	{
+		spin_lock_irqsave(&last->lock, flags);
+		if(last->current == work)
+			w = last;
+		spin_unlock_irqrestore(&last->lock, flags);
+	}
+	spin_lock_irqsave(&w->lock, flags);
+	work->worker = w;
+	list_add_tail(&work->entry, &w->head);
+	spin_unlock_irqrestore(&w->lock, flags);
+	waitqueue_wakeup(&w->wq);
+}
+
+static int work_timer_function(struct timer_t * timer, void * data)
+{
+	struct work_t * work = (struct work_t *)data;
+
+	if(atomic_cmpxchg(&work->state, WORK_STATE_DELAYED, WORK_STATE_QUEUED) == WORK_STATE_DELAYED)
+		worker_insert(&__worker[work->cpu], work);
+	return 0;
+}
+
+void work_init(struct work_t * work, work_func_t func, void * data)
+{
+	if(work)
+	{
+		init_list_head(&work->entry);
+		timer_init(&work->timer, work_timer_function, work);
+		work->worker = NULL;
+		atomic_set(&work->state, WORK_STATE_IDLE);
+		work->cpu = 0;
+		work->func = func;
+		work->data = data;
+	}
+}
+
+int work_queue_on(int cpu, struct work_t * work)
+{
+	if(!work || !work->func || (cpu < 0) || (cpu >= CONFIG_MAX_SMP_CPUS))
+		return 0;
+	if(atomic_cmpxchg(&work->state, WORK_STATE_IDLE, WORK_STATE_QUEUED) != WORK_STATE_IDLE)
+		return 0;
+	work->cpu = cpu;
+	worker_insert(&__worker[cpu], work);
+	return 1;
+}
+
+int work_queue(struct work_t * work)
+{
+	return work_queue_on(smp_processor_id(), work);
+}
+
+int work_queue_delayed(struct work_t * work, ktime_t delay)
+{
+	if(!work || !work->func)
+		return 0;
+	if(ktime_to_ns(delay) <= 0)
+		return work_queue(work);
+	if(atomic_cmpxchg(&work->state, WORK_STATE_IDLE, WORK_STATE_DELAYED) != WORK_STATE_IDLE)
+		return 0;
+	work->cpu = smp_processor_id();
+	timer_start(&work->timer, delay);
+	return 1;
+}
+
+/*
+ * Like work_queue_delayed(), but a work still waiting for its timer is pushed out
+ * to the new deadline, so a burst of requests runs it once after the last one
+ */
+int work_mod_delayed(struct work_t * work, ktime_t delay)
+{
+	if(!work || !work->func)
+		return 0;
+	if(atomic_cmpxchg(&work->state, WORK_STATE_DELAYED, WORK_STATE_IDLE) == WORK_STATE_DELAYED)
+		timer_cancel(&work->timer);
+	return work_queue_delayed(work, delay);
+}
+
+static void work_wait(struct work_t * work)
+{
+	struct worker_t * w;
+	int i;
+
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		w = &__worker[i];
+		if(w->task != task_self())
+			waitqueue_wait_event(&w->done, w->current != work);
+	}
+}
+
+static int work_dequeue(struct work_t * work)
+{
+	struct worker_t * w;
+	irq_flags_t flags;
+	int ret;
+
+	while(1)
+	{
+		switch(atomic_get(&work->state))
+		{
+		case WORK_STATE_DELAYED:
+			if(atomic_cmpxchg(&work->state, WORK_STATE_DELAYED, WORK_STATE_IDLE) == WORK_STATE_DELAYED)
+			{
+				timer_cancel(&work->timer);
+				return 1;
+			}
+			break;
+		case WORK_STATE_QUEUED:
+			if((w = work->worker) != NULL)
+			{
+				ret = 0;
+				spin_lock_irqsave(&w->lock, flags);
+				if((work->worker == w) && !list_empty(&work->entry))
+				{
+					list_del_init(&work->entry);
+					atomic_set(&work->state, WORK_STATE_IDLE);
+					ret = 1;
+				}
+				spin_unlock_irqrestore(&w->lock, flags);
+				if(ret)
+					return 1;
+			}
+			task_yield();
+			break;
+		default:
+			return 0;
+		}
+	}
+}
+
+int work_cancel(struct work_t * work)
+{
+	int ret = 0;
+
+	if(work)
+	{
+		do {
+			ret |= work_dequeue(work);
+			work_wait(work);
+		} while(work_pending(work));
+	}
+	return ret;
+}
+
+void work_flush(struct work_t * work)
+{
+	struct worker_t * w;
+
+	if(!work)
+		return;
+	if(atomic_cmpxchg(&work->state, WORK_STATE_DELAYED, WORK_STATE_QUEUED) == WORK_STATE_DELAYED)
+	{
+		timer_cancel(&work->timer);
+		worker_insert(&__worker[work->cpu], work);
+	}
+	while(atomic_get(&work->state) == WORK_STATE_QUEUED)
+	{
+		w = work->worker;
+		if(!w || (w->task == task_self()))
+			return;
+		waitqueue_wait_event(&w->done, (atomic_get(&work->state) != WORK_STATE_QUEUED) || (work->worker != w));
+	}
+	work_wait(work);
+}
+
+static void worker_task(struct task_t * task, void * data)
+{
+	struct worker_t * w = (struct worker_t *)data;
+	struct work_t * work;
+	irq_flags_t flags;
+
+	while(1)
+	{
+		waitqueue_wait_event(&w->wq, !list_empty(&w->head));
+		spin_lock_irqsave(&w->lock, flags);
+		work = list_first_entry_or_null(&w->head, struct work_t, entry);
+		if(work)
+		{
+			list_del_init(&work->entry);
+			atomic_set(&work->state, WORK_STATE_IDLE);
+			w->current = work;
+		}
+		spin_unlock_irqrestore(&w->lock, flags);
+		if(work)
+		{
+			work->func(work, work->data);
+			spin_lock_irqsave(&w->lock, flags);
+			w->current = NULL;
+			w->count++;
+			spin_unlock_irqrestore(&w->lock, flags);
+			waitqueue_wakeup_all(&w->done);
+		}
+	}
+}
+
+static struct kobj_t * search_class_workqueue_kobj(void)
+{
+	struct kobj_t * kclass = kobj_search_directory_with_create(kobj_get_root(), "class");
+	return kobj_search_directory_with_create(kclass, "workqueue");
+}
+
+static ssize_t worker_read_count(struct kobj_t * kobj, void * buf, size_t size)
+{
+	struct worker_t * w = (struct worker_t *)kobj->priv;
+	return sprintf(buf, "%llu", (unsigned long long)w->count);
+}
+
+void do_init_workqueue(void)
+{
+	struct worker_t * w;
+	char name[16];
+	int i;
+
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		w = &__worker[i];
+		init_list_head(&w->head);
+		w->current = NULL;
+		waitqueue_init(&w->wq);
+		waitqueue_init(&w->done);
+		w->count = 0;
+		spin_lock_init(&w->lock);
+		sprintf(name, "kworker/%d", i);
+		w->task = task_create_bound(&__sched[i], name, NULL, NULL, worker_task, w, CONFIG_WORKQUEUE_STACK_SIZE, 0);
+		sprintf(name, "cpu%d", i);
+		kobj_add_regular(kobj_search_directory_with_create(search_class_workqueue_kobj(), name), "count", worker_read_count, NULL, w);
+	}
+}
@@ -102,7 +102,7 @@ void surface_effect_shadow(struct surface_t * s, struct region_t * clip, int x,
 		int tw = w + r4;
 		int th = h + r4;
 		int pixlen = th * (tw << 2);
-		void * pixels = malloc(pixlen);
+		void * pixels = frame_alloc(pixlen);
 		if(pixels)
 		{
 			memset(pixels, 0, pixlen);
@@ -127,7 +127,7 @@ void surface_effect_shadow(struct surface_t * s, struct region_t * clip, int x,
 					blend(p + i, q + i);
 				}
 			}
-			free(pixels);
+			frame_free(pixels);
 		}
 	}
 }
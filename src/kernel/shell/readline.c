@@ -869,7 +869,7 @@ char * readline(const char * prompt)
 		}
 		else
 		{
-			task_yield();
+			msleep(10);
 		}
 	}
 
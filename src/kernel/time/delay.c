@@ -53,41 +53,35 @@ void mdelay(u32_t ms)
 }
 EXPORT_SYMBOL(mdelay);
 
-void nsleep(u32_t ns)
+static void sleep_until(ktime_t timeout)
 {
 	struct task_t * self = task_self();
-	ktime_t timeout = ktime_add_ns(ktime_get(), ns);
-	while(ktime_before(ktime_get(), timeout))
+	ktime_t now;
+
+	while(ktime_before((now = ktime_get()), timeout))
 	{
-		task_dynice_increase(self);
-		task_yield();
+		if(self)
+		{
+			self->state = TASK_STATE_BLOCKED;
+			task_block_timeout(ktime_sub(timeout, now));
+		}
 	}
-	task_dynice_restore(self);
+}
+
+void nsleep(u32_t ns)
+{
+	sleep_until(ktime_add_ns(ktime_get(), ns));
 }
 EXPORT_SYMBOL(nsleep);
 
 void usleep(u32_t us)
 {
-	struct task_t * self = task_self();
-	ktime_t timeout = ktime_add_us(ktime_get(), us);
-	while(ktime_before(ktime_get(), timeout))
-	{
-		task_dynice_increase(self);
-		task_yield();
-	}
-	task_dynice_restore(self);
+	sleep_until(ktime_add_us(ktime_get(), us));
 }
 EXPORT_SYMBOL(usleep);
 
 void msleep(u32_t ms)
 {
-	struct task_t * self = task_self();
-	ktime_t timeout = ktime_add_ms(ktime_get(), ms);
-	while(ktime_before(ktime_get(), timeout))
-	{
-		task_dynice_increase(self);
-		task_yield();
-	}
-	task_dynice_restore(self);
+	sleep_until(ktime_add_ms(ktime_get(), ms));
 }
 EXPORT_SYMBOL(msleep);
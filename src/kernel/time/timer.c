@@ -26,66 +26,201 @@
  *
  */
 
+#include <smp.h>
 #include <clockevent/clockevent.h>
 #include <clocksource/clocksource.h>
 #include <time/timer.h>
+#include <xboot/trace.h>
 
-static struct timer_base_t __timer_base = {
-	.head = { NULL },
-	.next = NULL,
-	.ce = NULL,
-	.lock = SPIN_LOCK_INIT(),
-};
+static struct timer_base_t __timer_base[CONFIG_MAX_SMP_CPUS];
+static struct clockevent_t * __timer_ce = NULL;
+static ktime_t __timer_ce_next = { .tv64 = KTIME_MAX };
+static spinlock_t __timer_ce_lock = SPIN_LOCK_INIT();
 
-static inline struct timer_t * next_timer(struct timer_base_t * base)
+static inline uint64_t wheel_granularity(int lvl)
 {
-	return base->next;
+	return 1ULL << (lvl * TIMER_WHEEL_SHIFT);
 }
 
-static inline int add_timer(struct timer_base_t * base, struct timer_t * timer)
+static inline uint64_t wheel_tick(ktime_t t)
+{
+	return (uint64_t)ktime_to_ns(t) / TIMER_WHEEL_TICK;
+}
+
+static inline ktime_t timer_hard_expires(struct timer_t * timer)
+{
+	return ktime_add_safe(timer->expires, timer->slack);
+}
+
+static uint64_t wheel_next_tick(struct timer_base_t * base)
+{
+	uint64_t next = ~0ULL;
+	uint64_t bits, slot;
+	int lvl, k;
+
+	for(lvl = 0; lvl < TIMER_WHEEL_LEVELS; lvl++)
+	{
+		if(base->pending[lvl])
+		{
+			slot = (base->clk + wheel_granularity(lvl) - 1) >> (lvl * TIMER_WHEEL_SHIFT);
+			k = slot & (TIMER_WHEEL_SIZE - 1);
+			bits = k ? ((base->pending[lvl] >> k) | (base->pending[lvl] << (TIMER_WHEEL_SIZE - k))) : base->pending[lvl];
+			slot = (slot + __builtin_ctzll(bits)) << (lvl * TIMER_WHEEL_SHIFT);
+			if(slot < next)
+				next = slot;
+		}
+	}
+	return next;
+}
+
+static ktime_t base_next_expires(struct timer_base_t * base)
+{
+	ktime_t next = { .tv64 = KTIME_MAX };
+	uint64_t tick;
+
+	if(base->next)
+		next = timer_hard_expires(base->next);
+	if(!hlist_empty(&base->expired))
+		next = ktime_get();
+	tick = wheel_next_tick(base);
+	if((tick != ~0ULL) && ((s64_t)(tick * TIMER_WHEEL_TICK) < next.tv64))
+		next = ns_to_ktime(tick * TIMER_WHEEL_TICK);
+	return next;
+}
+
+static void timer_program(ktime_t expires)
+{
+	irq_flags_t flags;
+	ktime_t now;
+
+	if(expires.tv64 == KTIME_MAX)
+		return;
+	spin_lock_irqsave(&__timer_ce_lock, flags);
+	if(expires.tv64 < __timer_ce_next.tv64)
+	{
+		__timer_ce_next = expires;
+		now = ktime_get();
+		if(ktime_before(expires, now))
+			expires = now;
+		clockevent_set_event_next(__timer_ce, now, expires);
+	}
+	spin_unlock_irqrestore(&__timer_ce_lock, flags);
+}
+
+static inline int add_timer_tree(struct timer_base_t * base, struct timer_t * timer)
 {
 	struct rb_node ** p = &base->head.rb_node;
 	struct rb_node * parent = NULL;
 	struct timer_t * ptr;
+	ktime_t hard = timer_hard_expires(timer);
+
+	while(*p)
+	{
+		parent = *p;
+		ptr = rb_entry(parent, struct timer_t, node);
+		if(hard.tv64 < timer_hard_expires(ptr).tv64)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&timer->node, parent, p);
+	rb_insert_color(&timer->node, &base->head);
+	if(!base->next || (hard.tv64 < timer_hard_expires(base->next).tv64))
+		base->next = timer;
+	timer->index = -1;
+	return 1;
+}
 
-	if(timer->state == TIMER_STATE_INACTIVE)
+static inline int add_timer_wheel(struct timer_base_t * base, struct timer_t * timer)
+{
+	uint64_t expires = (ktime_to_ns(timer->expires) + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK;
+	uint64_t now = wheel_tick(ktime_get());
+	uint64_t next, gran, slot;
+	int lvl;
+
+	next = wheel_next_tick(base);
+	if(now < next)
+		next = now;
+	if(base->clk < next)
+		base->clk = next;
+	if(expires < base->clk)
+		expires = base->clk;
+
+	for(lvl = 0; lvl < TIMER_WHEEL_LEVELS; lvl++)
 	{
-		while(*p)
+		gran = wheel_granularity(lvl);
+		if((s64_t)(gran * TIMER_WHEEL_TICK) > timer->slack.tv64)
+			break;
+		slot = (expires + gran - 1) >> (lvl * TIMER_WHEEL_SHIFT);
+		if(slot - ((base->clk + gran - 1) >> (lvl * TIMER_WHEEL_SHIFT)) < TIMER_WHEEL_SIZE)
 		{
-			parent = *p;
-			ptr = rb_entry(parent, struct timer_t, node);
-			if(timer->expires.tv64 < ptr->expires.tv64)
-				p = &(*p)->rb_left;
-			else
-				p = &(*p)->rb_right;
+			timer->index = lvl * TIMER_WHEEL_SIZE + (slot & (TIMER_WHEEL_SIZE - 1));
+			hlist_add_head(&timer->entry, &base->wheel[lvl][slot & (TIMER_WHEEL_SIZE - 1)]);
+			base->pending[lvl] |= 1ULL << (slot & (TIMER_WHEEL_SIZE - 1));
+			return 1;
 		}
-		rb_link_node(&timer->node, parent, p);
-		rb_insert_color(&timer->node, &base->head);
-		if(!base->next || (timer->expires.tv64 < base->next->expires.tv64))
-			base->next = timer;
-		timer->state = TIMER_STATE_ENQUEUED;
-		return (timer == base->next);
 	}
 	return 0;
 }
 
-static inline int del_timer(struct timer_base_t * base, struct timer_t * timer)
+static inline void add_timer(struct timer_base_t * base, struct timer_t * timer)
 {
-	int ret = 0;
+	if(timer->state != TIMER_STATE_ENQUEUED)
+	{
+		if((timer->slack.tv64 < TIMER_WHEEL_TICK) || !add_timer_wheel(base, timer))
+			add_timer_tree(base, timer);
+		timer->state = TIMER_STATE_ENQUEUED;
+	}
+}
+
+static inline void del_timer(struct timer_base_t * base, struct timer_t * timer)
+{
+	struct hlist_head * head;
+	int lvl;
 
 	if(timer->state == TIMER_STATE_ENQUEUED)
 	{
-		if(base->next == timer)
+		if(timer->index < 0)
 		{
-			struct rb_node * rbn = rb_next(&timer->node);
-			base->next = rbn ? rb_entry(rbn, struct timer_t, node) : NULL;
-			ret = 1;
+			if(base->next == timer)
+			{
+				struct rb_node * rbn = rb_next(&timer->node);
+				base->next = rbn ? rb_entry(rbn, struct timer_t, node) : NULL;
+			}
+			rb_erase(&timer->node, &base->head);
+			RB_CLEAR_NODE(&timer->node);
+		}
+		else
+		{
+			hlist_del_init(&timer->entry);
+			if(timer->index < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE)
+			{
+				lvl = timer->index / TIMER_WHEEL_SIZE;
+				head = &base->wheel[lvl][timer->index % TIMER_WHEEL_SIZE];
+				if(hlist_empty(head))
+					base->pending[lvl] &= ~(1ULL << (timer->index % TIMER_WHEEL_SIZE));
+			}
+			timer->index = -1;
 		}
-		rb_erase(&timer->node, &base->head);
-		RB_CLEAR_NODE(&timer->node);
 		timer->state = TIMER_STATE_INACTIVE;
 	}
-	return ret;
+}
+
+static struct timer_base_t * lock_timer_base(struct timer_t * timer, irq_flags_t * flags)
+{
+	struct timer_base_t * base;
+
+	while(1)
+	{
+		base = timer->base;
+		if(base)
+		{
+			spin_lock_irqsave(&base->lock, *flags);
+			if(likely(base == timer->base))
+				return base;
+			spin_unlock_irqrestore(&base->lock, *flags);
+		}
+	}
 }
 
 void timer_init(struct timer_t * timer, int (*function)(struct timer_t *, void *), void * data)
@@ -94,33 +229,46 @@ void timer_init(struct timer_t * timer, int (*function)(struct timer_t *, void *
 	{
 		memset(timer, 0, sizeof(struct timer_t));
 		RB_CLEAR_NODE(&timer->node);
-		timer->base = &__timer_base;
+		init_hlist_node(&timer->entry);
+		timer->base = &__timer_base[smp_processor_id()];
 		timer->state = TIMER_STATE_INACTIVE;
+		timer->slack = ns_to_ktime(0);
+		timer->index = -1;
 		timer->data = data;
 		timer->function = function;
 	}
 }
 
+void timer_set_slack(struct timer_t * timer, ktime_t slack)
+{
+	if(timer)
+		timer->slack = (slack.tv64 > 0) ? slack : ns_to_ktime(0);
+}
+
 void timer_start(struct timer_t * timer, ktime_t interval)
 {
-	struct timer_base_t * base;
+	struct timer_base_t * base, * self;
 	irq_flags_t flags;
+	ktime_t expires;
 
 	if(timer)
 	{
-		ktime_t now = ktime_get();
-		base = timer->base;
-		spin_lock_irqsave(&base->lock, flags);
-		if(del_timer(base, timer))
+		base = lock_timer_base(timer, &flags);
+		del_timer(base, timer);
+		self = &__timer_base[smp_processor_id()];
+		if((base != self) && (timer->state == TIMER_STATE_INACTIVE))
 		{
-			struct timer_t * next = next_timer(base);
-			if(next)
-				clockevent_set_event_next(base->ce, now, next->expires);
+			timer->base = NULL;
+			spin_unlock_irqrestore(&base->lock, flags);
+			base = self;
+			spin_lock_irqsave(&base->lock, flags);
+			timer->base = base;
 		}
-		timer->expires = ktime_add_safe(now, interval);
-		if(add_timer(base, timer))
-			clockevent_set_event_next(base->ce, now, timer->expires);
+		timer->expires = ktime_add_safe(ktime_get(), interval);
+		add_timer(base, timer);
+		expires = timer->index < 0 ? timer_hard_expires(timer) : base_next_expires(base);
 		spin_unlock_irqrestore(&base->lock, flags);
+		timer_program(expires);
 	}
 }
 
@@ -130,6 +278,10 @@ void timer_forward(struct timer_t * timer, ktime_t interval)
 		timer->expires = ktime_add_safe(ktime_get(), interval);
 }
 
+/*
+ * Callbacks run with the base unlocked, so a timer whose callback runs on another cpu is waited
+ * for. The timer may live on the stack of a task the callback wakes up, which can exit at once.
+ */
 void timer_cancel(struct timer_t * timer)
 {
 	struct timer_base_t * base;
@@ -137,41 +289,94 @@ void timer_cancel(struct timer_t * timer)
 
 	if(timer)
 	{
-		base = timer->base;
-		spin_lock_irqsave(&base->lock, flags);
-		if(del_timer(base, timer))
+		base = lock_timer_base(timer, &flags);
+		del_timer(base, timer);
+		while((base->running == timer) && (base->running_cpu != smp_processor_id()))
 		{
-			struct timer_t * next = next_timer(base);
-			if(next)
-				clockevent_set_event_next(base->ce, ktime_get(), next->expires);
+			spin_unlock_irqrestore(&base->lock, flags);
+			smp_mb();
+			base = lock_timer_base(timer, &flags);
 		}
 		spin_unlock_irqrestore(&base->lock, flags);
 	}
 }
 
-static void timer_event_handler(struct clockevent_t * ce, void * data)
+static void run_timer(struct timer_base_t * base, struct timer_t * timer, irq_flags_t * flags)
 {
-	struct timer_base_t * base = (struct timer_base_t *)(data);
-	struct timer_t * timer;
-	ktime_t now = ktime_get();
-	irq_flags_t flags;
 	int restart;
 
-	spin_lock_irqsave(&base->lock, flags);
-	while((timer = next_timer(base)))
+	del_timer(base, timer);
+	timer->state = TIMER_STATE_CALLBACK;
+	base->running = timer;
+	base->running_cpu = smp_processor_id();
+	spin_unlock_irqrestore(&base->lock, *flags);
+	trace_event(TRACE_TYPE_TIMER_ENTER, (const void *)timer->function, 0);
+	restart = timer->function(timer, timer->data);
+	trace_event(TRACE_TYPE_TIMER_EXIT, (const void *)timer->function, 0);
+	spin_lock_irqsave(&base->lock, *flags);
+	base->running = NULL;
+	if(timer->state == TIMER_STATE_CALLBACK)
 	{
-		if(now.tv64 < timer->expires.tv64)
-			break;
-		del_timer(base, timer);
-		timer->state = TIMER_STATE_CALLBACK;
-		restart = timer->function(timer, timer->data);
 		timer->state = TIMER_STATE_INACTIVE;
-		if(restart)
+		if(restart && (timer->base == base))
 			add_timer(base, timer);
 	}
-	if((timer = next_timer(base)))
-		clockevent_set_event_next(ce, now, timer->expires);
+}
+
+static void timer_base_expire(struct timer_base_t * base)
+{
+	struct hlist_head * head;
+	struct hlist_node * n;
+	struct timer_t * timer;
+	irq_flags_t flags;
+	ktime_t now = ktime_get();
+	uint64_t tick = wheel_tick(now);
+	uint64_t gran, slot;
+	int lvl, k, i;
+
+	spin_lock_irqsave(&base->lock, flags);
+	for(lvl = 0; lvl < TIMER_WHEEL_LEVELS; lvl++)
+	{
+		if(!base->pending[lvl])
+			continue;
+		gran = wheel_granularity(lvl);
+		slot = (base->clk + gran - 1) >> (lvl * TIMER_WHEEL_SHIFT);
+		for(k = 0; (k < TIMER_WHEEL_SIZE) && (((slot + k) << (lvl * TIMER_WHEEL_SHIFT)) <= tick); k++)
+		{
+			i = (slot + k) & (TIMER_WHEEL_SIZE - 1);
+			head = &base->wheel[lvl][i];
+			while((n = head->first))
+			{
+				timer = hlist_entry(n, struct timer_t, entry);
+				hlist_del(n);
+				hlist_add_head(n, &base->expired);
+				timer->index = TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE;
+			}
+			base->pending[lvl] &= ~(1ULL << i);
+		}
+	}
+	if(base->clk <= tick)
+		base->clk = tick + 1;
+
+	while((n = base->expired.first))
+		run_timer(base, hlist_entry(n, struct timer_t, entry), &flags);
+	while((timer = base->next) && (timer->expires.tv64 <= now.tv64))
+		run_timer(base, timer, &flags);
+	now = base_next_expires(base);
 	spin_unlock_irqrestore(&base->lock, flags);
+	timer_program(now);
+}
+
+static void timer_event_handler(struct clockevent_t * ce, void * data)
+{
+	irq_flags_t flags;
+	int i;
+
+	spin_lock_irqsave(&__timer_ce_lock, flags);
+	__timer_ce_next.tv64 = KTIME_MAX;
+	spin_unlock_irqrestore(&__timer_ce_lock, flags);
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+		timer_base_expire(&__timer_base[i]);
 }
 
 void timer_bind_clockevent(struct clockevent_t * ce)
@@ -180,11 +385,10 @@ void timer_bind_clockevent(struct clockevent_t * ce)
 
 	if(ce)
 	{
-		spin_lock_irqsave(&__timer_base.lock, flags);
-		__timer_base.head = RB_ROOT;
-		__timer_base.next = NULL;
-		__timer_base.ce = ce;
-		clockevent_set_event_handler(__timer_base.ce, timer_event_handler, &__timer_base);
-		spin_unlock_irqrestore(&__timer_base.lock, flags);
+		spin_lock_irqsave(&__timer_ce_lock, flags);
+		__timer_ce = ce;
+		__timer_ce_next.tv64 = KTIME_MAX;
+		clockevent_set_event_handler(__timer_ce, timer_event_handler, NULL);
+		spin_unlock_irqrestore(&__timer_ce_lock, flags);
 	}
 }
@@ -107,18 +107,26 @@ static int sys_readdir(struct vfs_node_t * dn, s64_t off, struct vfs_dirent_t *
 {
 	struct kobj_t * kobj, * obj;
 	struct list_head * pos;
+	irq_flags_t flags;
 	int i;
 
 	kobj = dn->v_data;
+	read_lock_irqsave(&kobj->lock, flags);
 	if(list_empty(&kobj->children))
+	{
+		read_unlock_irqrestore(&kobj->lock, flags);
 		return -1;
+	}
 
 	pos = (&kobj->children)->next;
 	for(i = 0; i != off; i++)
 	{
 		pos = pos->next;
 		if(pos == (&kobj->children))
+		{
+			read_unlock_irqrestore(&kobj->lock, flags);
 			return -1;
+		}
 	}
 
 	obj = list_entry(pos, struct kobj_t, entry);
@@ -127,6 +135,7 @@ static int sys_readdir(struct vfs_node_t * dn, s64_t off, struct vfs_dirent_t *
 	else
 		d->d_type = VDT_REG;
 	strlcpy(d->d_name, obj->name, sizeof(d->d_name));
+	read_unlock_irqrestore(&kobj->lock, flags);
 	d->d_off = off;
 	d->d_reclen = 1;
 
@@ -43,7 +43,7 @@ void vision_erode(struct vision_t * v, int times)
 		void * datas;
 		int m, n;
 
-		datas = malloc(ndata);
+		datas = frame_alloc(ndata);
 		if(datas)
 		{
 			while(times-- > 0)
@@ -89,7 +89,7 @@ void vision_erode(struct vision_t * v, int times)
 					}
 				}
 			}
-			free(datas);
+			frame_free(datas);
 		}
 	}
 }
@@ -1216,6 +1216,7 @@ struct xui_context_t * xui_context_alloc(const char * fb, const char * input, vo
 	ctx->f = font_context_alloc();
 	ctx->lang = NULL;
 	ctx->surface = NULL;
+	ctx->uncached = NULL;
 	region_init(&ctx->screen, 0, 0, window_get_width(ctx->w), window_get_height(ctx->w));
 	ctx->cpshift = 7;
 	ctx->cpsize = 1 << ctx->cpshift;
@@ -1253,7 +1254,9 @@ void xui_context_free(struct xui_context_t * ctx)
 		if(ctx->lang)
 			hmap_free(ctx->lang);
 		if(ctx->surface)
-			lru_free(ctx->surface);
+			lrucache_free(ctx->surface);
+		if(ctx->uncached)
+			hmap_free(ctx->uncached);
 		if(ctx->cells[0])
 			free(ctx->cells[0]);
 		if(ctx->cells[1])
@@ -1323,11 +1326,16 @@ static void style_widget_color(struct json_value_t * v, struct xui_widget_color_
 void xui_load_style(struct xui_context_t * ctx, const char * json, int len)
 {
 	struct json_value_t * v, * o;
+	char * buf;
 	int i;
 
 	if(json && (len > 0))
 	{
-		v = json_parse(json, len, NULL);
+		buf = malloc(len);
+		if(!buf)
+			return;
+		memcpy(buf, json, len);
+		v = json_parse_insitu(buf, len, NULL);
 		if(v && (v->type == JSON_OBJECT))
 		{
 			for(i = 0; i < v->u.object.length; i++)
@@ -1597,6 +1605,7 @@ void xui_load_style(struct xui_context_t * ctx, const char * json, int len)
 			}
 		}
 		json_free(v);
+		free(buf);
 	}
 }
 
@@ -1609,7 +1618,7 @@ static void hmap_entry_callback(struct hmap_t * m, struct hmap_entry_t * e)
 void xui_load_lang(struct xui_context_t * ctx, const char * json, int len)
 {
 	struct json_value_t * v;
-	char * key, * value;
+	char * key, * value, * buf;
 	int i;
 
 	if(json && (len > 0))
@@ -1619,7 +1628,11 @@ void xui_load_lang(struct xui_context_t * ctx, const char * json, int len)
 		if(ctx->lang)
 		{
 			hmap_clear(ctx->lang);
-			v = json_parse(json, len, NULL);
+			buf = malloc(len);
+			if(!buf)
+				return;
+			memcpy(buf, json, len);
+			v = json_parse_insitu(buf, len, NULL);
 			if(v && (v->type == JSON_OBJECT))
 			{
 				for(i = 0; i < v->u.object.length; i++)
@@ -1638,19 +1651,20 @@ void xui_load_lang(struct xui_context_t * ctx, const char * json, int len)
 				}
 			}
 			json_free(v);
+			free(buf);
 		}
 	}
 }
 
-static void lru_callback(struct lru_t * l, const char * key, int nkey, void * buf, int nbuf)
+static void surface_cache_callback(struct lrucache_t * c, const char * key, int nkey, void * value, size_t size)
 {
-	struct surface_t * s;
+	surface_free((struct surface_t *)value);
+}
 
-	if(nbuf == sizeof(struct surface_t *))
-	{
-		memcpy(&s, buf, nbuf);
-		surface_free(s);
-	}
+static void surface_uncached_callback(struct hmap_t * m, struct hmap_entry_t * e)
+{
+	if(e && e->value)
+		surface_free((struct surface_t *)e->value);
 }
 
 struct surface_t * xui_load_surface(struct xui_context_t * ctx, const char * path)
@@ -1658,16 +1672,33 @@ struct surface_t * xui_load_surface(struct xui_context_t * ctx, const char * pat
 	struct surface_t * s = NULL;
 
 	if(!ctx->surface)
-		ctx->surface = lru_alloc(0, 0, lru_callback);
-	if(lru_get(ctx->surface, path, strlen(path), &s, sizeof(struct surface_t *)) != sizeof(struct surface_t *))
+		ctx->surface = lrucache_alloc(CONFIG_XUI_SURFACE_CACHE_SIZE, 1, LRUCACHE_POLICY_2Q, surface_cache_callback);
+	s = lrucache_get(ctx->surface, path, strlen(path));
+	if(!s && ctx->uncached)
+		s = hmap_search(ctx->uncached, path);
+	if(!s)
 	{
 		struct xfs_context_t * xfs;
 		xfs = xfs_alloc("/private/framework", 0);
 		if(xfs)
 		{
 			s = surface_alloc_from_xfs(xfs, path);
-			if(s)
-				lru_set(ctx->surface, path, strlen(path), &s, sizeof(struct surface_t *));
+			/*
+			 * A surface the cache refuses, larger than a shard or out of memory, is kept aside
+			 * until the context goes away instead of being leaked
+			 */
+			if(s && !lrucache_set(ctx->surface, path, strlen(path), s, sizeof(struct surface_t) + s->pixlen))
+			{
+				if(!ctx->uncached)
+					ctx->uncached = hmap_alloc(0, surface_uncached_callback);
+				if(ctx->uncached)
+					hmap_add(ctx->uncached, path, s);
+				else
+				{
+					surface_free(s);
+					s = NULL;
+				}
+			}
 			xfs_free(xfs);
 		}
 	}
@@ -2414,6 +2445,7 @@ void xui_loop(struct xui_context_t * ctx, void (*func)(struct xui_context_t *))
 			func(ctx);
 		if(window_is_active(ctx->w))
 			window_present(ctx->w, ctx, xui_draw);
+		frame_reset();
 		task_yield();
 	}
 }
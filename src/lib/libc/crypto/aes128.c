@@ -7,6 +7,8 @@
 #include <string.h>
 #include <aes128.h>
 
+#define AES_BATCH	(8)
+
 static const uint8_t sbox[256] = {
 	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
 	0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
@@ -512,7 +514,7 @@ void aes128_set_key(struct aes128_ctx_t * ctx, uint8_t * key)
 	}
 }
 
-void aes128_ecb_encrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
+void aes128_ecb_encrypt_generic(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
 {
 	int i;
 
@@ -524,7 +526,7 @@ void aes128_ecb_encrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out,
 	}
 }
 
-void aes128_ecb_decrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
+void aes128_ecb_decrypt_generic(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out, int blks)
 {
 	int i;
 
@@ -536,39 +538,49 @@ void aes128_ecb_decrypt(struct aes128_ctx_t * ctx, uint8_t * in, uint8_t * out,
 	}
 }
 
+/*
+ * Architectures with aes instructions provide strong ecb routines, the other modes are built on top of them
+ */
+extern __typeof(aes128_ecb_encrypt_generic) aes128_ecb_encrypt __attribute__((weak, alias("aes128_ecb_encrypt_generic")));
+extern __typeof(aes128_ecb_decrypt_generic) aes128_ecb_decrypt __attribute__((weak, alias("aes128_ecb_decrypt_generic")));
+
 void aes128_cbc_encrypt(struct aes128_ctx_t * ctx, uint8_t * iv, uint8_t * in, uint8_t * out, int blks)
 {
 	uint8_t chain[16];
-	uint8_t tmp[16];
 	int i;
 
 	memcpy(chain, iv, 16);
 	for(i = 0; i < blks; i++)
 	{
-		xor_block(tmp, chain, in, 16);
-		aes128_encrypt(ctx, tmp, out);
-		memcpy(chain, out, 16);
+		xor_block(chain, chain, in, 16);
+		aes128_ecb_encrypt(ctx, chain, chain, 1);
+		memcpy(out, chain, 16);
 		in += 16;
 		out += 16;
 	}
 }
 
+/*
+ * Decrypt a batch of blocks at once, the ciphertext is saved first so that in and out may overlap
+ */
 void aes128_cbc_decrypt(struct aes128_ctx_t * ctx, uint8_t * iv, uint8_t * in, uint8_t * out, int blks)
 {
 	uint8_t chain[16];
-	uint8_t block[16];
-	uint8_t tmp[16];
-	int i;
+	uint8_t block[AES_BATCH * 16];
+	int n;
 
 	memcpy(chain, iv, 16);
-	for(i = 0; i < blks; i++)
+	while(blks > 0)
 	{
-		memcpy(block, in, 16);
-		aes128_decrypt(ctx, in, tmp);
-		xor_block(out, chain, tmp, 16);
-		memcpy(chain, block, 16);
-		in += 16;
-		out += 16;
+		n = blks > AES_BATCH ? AES_BATCH : blks;
+		memcpy(block, in, n * 16);
+		aes128_ecb_decrypt(ctx, block, out, n);
+		xor_block(out, out, chain, 16);
+		xor_block(out + 16, out + 16, block, (n - 1) * 16);
+		memcpy(chain, &block[(n - 1) * 16], 16);
+		in += n * 16;
+		out += n * 16;
+		blks -= n;
 	}
 }
 
@@ -587,10 +599,10 @@ static inline void add_counter(uint8_t * counter)
 void aes128_ctr_encrypt(struct aes128_ctx_t * ctx, uint64_t offset, uint8_t * in, uint8_t * out, int bytes)
 {
 	uint8_t counter[16];
-	uint8_t tmp[16];
+	uint8_t stream[AES_BATCH * 16];
 	uint64_t o = offset >> 4;
 	int pos, len;
-	int i;
+	int i, n;
 
 	for(i = 0; i < 8; i++)
 		counter[i] = 0;
@@ -601,26 +613,25 @@ void aes128_ctr_encrypt(struct aes128_ctx_t * ctx, uint64_t offset, uint8_t * in
 	}
 
 	pos = (offset & 0x0f);
-	if(pos)
+	while(bytes > 0)
 	{
-		len = 16 - pos;
-		bytes -= len;
-		aes128_encrypt(ctx, counter, tmp);
-		xor_block(out, in, &tmp[pos], len);
+		n = (pos + bytes + 15) >> 4;
+		if(n > AES_BATCH)
+			n = AES_BATCH;
+		for(i = 0; i < n; i++)
+		{
+			memcpy(&stream[i << 4], counter, 16);
+			add_counter(counter);
+		}
+		aes128_ecb_encrypt(ctx, stream, stream, n);
+		len = (n << 4) - pos;
+		if(len > bytes)
+			len = bytes;
+		xor_block(out, in, &stream[pos], len);
 		in += len;
 		out += len;
-		add_counter(counter);
-	}
-
-	while(bytes)
-	{
-		len = bytes > 16 ? 16 : bytes;
 		bytes -= len;
-		aes128_encrypt(ctx, counter, tmp);
-		xor_block(out, in, tmp, len);
-		in += len;
-		out += len;
-		add_counter(counter);
+		pos = 0;
 	}
 }
 
@@ -26,6 +26,79 @@ static uint64_t curve_b[ECDSA256_NUM_DIGITS] = { 0x3bce3c3e27d2604bull, 0x651d06
 static uint64_t curve_n[ECDSA256_NUM_DIGITS] = { 0xf3b9cac2fc632551ull, 0xbce6faada7179e84ull, 0xffffffffffffffffull, 0xffffffff00000000ull };
 static struct ecdsa256_point_t curve_g = { { 0xf4a13945d898c296ull, 0x77037d812deb33a0ull, 0xf8bce6e563a440f2ull, 0x6b17d1f2e12c4247ull }, { 0xcbb6406837bf51f5ull, 0x2bce33576b315eceull, 0x8ee7eb4a7c0f9e16ull, 0x4fe342e2fe1a7f9bull } };
 
+/*
+ * Odd multiples G, 3G, ... 63G in affine form for the width 7 naf of the base point scalar
+ */
+#define CURVE_G_WNAF		(7)
+#define CURVE_Q_WNAF		(5)
+
+static const struct ecdsa256_point_t curve_g_table[1 << (CURVE_G_WNAF - 2)] = {
+	{ { 0xf4a13945d898c296ull, 0x77037d812deb33a0ull, 0xf8bce6e563a440f2ull, 0x6b17d1f2e12c4247ull },
+	  { 0xcbb6406837bf51f5ull, 0x2bce33576b315eceull, 0x8ee7eb4a7c0f9e16ull, 0x4fe342e2fe1a7f9bull } },
+	{ { 0xfb41661bc6e7fd6cull, 0xe6c6b721efada985ull, 0xc8f7ef951d4bf165ull, 0x5ecbe4d1a6330a44ull },
+	  { 0x9a79b127a27d5032ull, 0xd82ab036384fb83dull, 0x374b06ce1a64a2ecull, 0x8734640c4998ff7eull } },
+	{ { 0x21554a0dc3d033edull, 0xef8c82fd1f5be524ull, 0xd784c85608668fdfull, 0x51590b7a515140d2ull },
+	  { 0xd1d0bb44fda16da4ull, 0x0d012f00d4d80888ull, 0x8ae1bf36bf8a7926ull, 0xe0c17da8904a727dull } },
+	{ { 0x300628703187b2a3ull, 0x7ef9f8b8a80fef5bull, 0x25bb30667c01fb60ull, 0x8e533b6fa0bf7b46ull },
+	  { 0xc55e1a86c1f400b4ull, 0x53c73633cb041b21ull, 0x6d069f83a6f59000ull, 0x73eb1dbde0331836ull } },
+	{ { 0xd79e8a4b90949ee0ull, 0x9e0acb8c2c6df8b3ull, 0x878938d51d71f872ull, 0xea68d7b6fedf0b71ull },
+	  { 0xe85a224a4dd048faull, 0x4d714feaa4de823full, 0x87014a964a8ea0c8ull, 0x2a2744c972c9fce7ull } },
+	{ { 0x433391d374bc21d1ull, 0x16742ed0255048bfull, 0x0638379db0c21cdaull, 0x3ed113b7883b4c59ull },
+	  { 0xe2f8eefce82a3740ull, 0x090d04da5e9889daull, 0x24c843afa4f4c68aull, 0x9099209accc4c8a2ull } },
+	{ { 0x98e15d9d46072c01ull, 0x792e284b65ead58aull, 0x61805df2d85ee2fcull, 0x177c837ae0ac495aull },
+	  { 0x9c43bbe2efc7bfd8ull, 0x26ee14c3a1fb4df3ull, 0xa24091adb40f4e72ull, 0x63bb58cd4ebea558ull } },
+	{ { 0x63668c63e59b9d5full, 0xae03af92de3a0ef1ull, 0xadfb378999888265ull, 0xf0454dc6971abae7ull },
+	  { 0x47e59cde0d034f36ull, 0x2a3b21ce75b5fa3full, 0x4e6594e51f9643e6ull, 0xb5b93ee3592e2d1full } },
+	{ { 0xba1abce34738a73eull, 0x5fa68678f0d64af8ull, 0x9c0984b66f75301aull, 0x47776904c0f1cc3aull },
+	  { 0x32f787ff71f1fcdcull, 0x81b2804428d5733full, 0x6231856577648e83ull, 0xaa005ee6b5b95728ull } },
+	{ { 0xc1fc7b74ab03ed83ull, 0x782c452257884895ull, 0xce39b7c17108c507ull, 0xcb6d2861102c0c25ull },
+	  { 0xe39150752bcecdaaull, 0xa496716e30fa3e03ull, 0x5c35e7100d6d6ce4ull, 0x58d7614b24d9ef51ull } },
+	{ { 0xfd76364e67399e83ull, 0x3a582139f42b1523ull, 0x2e4ac86eb473bca5ull, 0x3250fcf686637c7bull },
+	  { 0x15de24a071d48c09ull, 0x897cd3c33b566a82ull, 0x97b3090d1d7eb88cull, 0x42e7c342667d3593ull } },
+	{ { 0x672e573045ca7896ull, 0x3c0bc0a5df64a4feull, 0xd28a3e39d4583fa6ull, 0x0e91c7239c2640d7ull },
+	  { 0x138046543140ad55ull, 0x7e68833575e7a5aeull, 0x1a22733bb8e0bd6dull, 0x5df65c3b550dba22ull } },
+	{ { 0x84a4dc45f200d687ull, 0x41652fc5b76f1b24ull, 0x85f4f52d8c07fa84ull, 0x3a67e2554b0c0bb6ull },
+	  { 0xa9ed16b302f79324ull, 0x8c188af735a7618aull, 0x26daf267163afb0dull, 0x27d0f1872f1fcf43ull } },
+	{ { 0xf2e201173b0883d1ull, 0x576355bd683e54abull, 0xdeba2fac4611f378ull, 0x184ffa5819d80d51ull },
+	  { 0x20d242c260906e6full, 0x45bdeccc63f04916ull, 0xa4c6d90826cb9995ull, 0xc0a66e276688f359ull } },
+	{ { 0xdedd693d1c784defull, 0xfd8cd1c688b58a41ull, 0xa7c36da090853b8cull, 0xd6d33adefa195b07ull },
+	  { 0x550c124593d1bca6ull, 0x09a166ab4b95ededull, 0x3f78245f558a5dcbull, 0x84aaba16ee195d7eull } },
+	{ { 0x3e3f9aa0a1b45b8bull, 0xfac9db7d52a95b3eull, 0xa85da026a7ae9aa0ull, 0x301d9e502dc7e05dull },
+	  { 0xd58db6aea17ee267ull, 0x298d9ae46887ca61ull, 0xe0d23c026b017d72ull, 0x6551b6f6b3061223ull } },
+	{ { 0x65c100f3cb2cd793ull, 0xa03b0a533aa872fdull, 0xfa9aa25b89d9d34eull, 0x9807d699fcd81356ull },
+	  { 0x2f6bf92479634af4ull, 0xffe630b96c587853ull, 0x86a01a4d1d091b2full, 0xc2a59cdccab11bf2ull } },
+	{ { 0xa12d389033bb291aull, 0x94e8e1fe92af9700ull, 0x8ffa3ad7326c48caull, 0xd58d4a589ed27d16ull },
+	  { 0xa5b0c9c6f586b9d5ull, 0x67271c163b034979ull, 0x76ea92632dc7fef6ull, 0xd45514d102726b85ull } },
+	{ { 0x73a92894502b3348ull, 0xe0d21379246bfd44ull, 0xd6b0978611a826aaull, 0x419a6a646ddb817dull },
+	  { 0xdb1d6c81b09214b2ull, 0x13c6d072f3dee1e2ull, 0x545c9fb1954c2fd5ull, 0x332544cf1102f584ull } },
+	{ { 0xa0c199ddfb2776c4ull, 0x547b942dd2d138d4ull, 0x42014976a179046eull, 0x22a682f7c3996d4dull },
+	  { 0x5347f649cbaa285dull, 0x979dcc310265b068ull, 0xb918c9835a54356cull, 0x4f4606b0102223eeull } },
+	{ { 0x3a7de694995d2fa2ull, 0x6067c5c3d4175a59ull, 0x1cf258d2e6cfe8aaull, 0x67a6bec240dee065ull },
+	  { 0x49c24ce1441feed5ull, 0x1542c7ee209aca6cull, 0x6c249b49464d4499ull, 0xde692b7022d13158ull } },
+	{ { 0x7544dc129b82d28dull, 0x8f4bc4c6d009b30full, 0xd04230861d8f4b49ull, 0x986ae2506f1ff104ull },
+	  { 0x25110c441bb07e97ull, 0xd86fc6289c189f25ull, 0xe328a4d97d3c7b61ull, 0x003cccc0a6460e0aull } },
+	{ { 0x79c78080fae0ba03ull, 0x0f5f609edd29d6d9ull, 0x3ecd0f5ddff0672eull, 0xa891d06670bde99bull },
+	  { 0xefc3edc8166934aeull, 0x1c6b38f0feb0f2ccull, 0x419a88c4033c1ce7ull, 0xb596cd922cbfa1c1ull } },
+	{ { 0x51d689227b1c0d7cull, 0xdd5b31583e19066dull, 0x595361ea83071bbcull, 0x42c315cc48958708ull },
+	  { 0xd6c4a72bb2f9b1b9ull, 0x74f1a1e1eb87f164ull, 0x2914d1dfbb7a7990ull, 0x649a61ce571b9585ull } },
+	{ { 0x7d228ce6a5674455ull, 0x28fb7ea9758fd4fdull, 0xbb22b146866e6c05ull, 0xf785b0e098068875ull },
+	  { 0xe7bc490c10d62408ull, 0x4b04b6fd5f3aa60aull, 0xe15c767f0d9f5b41ull, 0x73fdb0bf6080da6eull } },
+	{ { 0x044360f0018e22b1ull, 0x95f7eb56e81008ffull, 0xaadee6863c1d68bcull, 0x672c4a514d9de43eull },
+	  { 0x9935399191f37104ull, 0x136246589704d941ull, 0x611de5a4ace203f7ull, 0x548c7e9196a25bfeull } },
+	{ { 0xf126ec9f7449d036ull, 0x982b1ca78de9b983ull, 0x5a47802254b88039ull, 0x6f01bd49c9d95245ull },
+	  { 0x360233dd989e17dbull, 0xa78551bfc3749b08ull, 0x11a0f21a608776ceull, 0x1562080ff1d5deabull } },
+	{ { 0xdec1dff7df6e60a0ull, 0xc2a595b762c1eadaull, 0x7571a109fe7fea2cull, 0x079dba7ba068c926ull },
+	  { 0xfb0da5aeb4824deaull, 0x83eb2df35751a397ull, 0x1d223f9d2a9588abull, 0xdc1e19b743d4d181ull } },
+	{ { 0x8abd97b1d0f56077ull, 0x289d406e2d6c6bd8ull, 0x126d45a8ea907f86ull, 0xc116e30ebb4d2865ull },
+	  { 0x313fd7fda410c206ull, 0x7d5bd5e89e59c8c5ull, 0xb8b16d9bb13b8765ull, 0xe9478823c35b30c2ull } },
+	{ { 0xa2b6ea0e0faa4b45ull, 0xe50941119e8dc8ecull, 0x765b2784fca9bdf7ull, 0x665f1a6ffe0c6437ull },
+	  { 0x6e25a6602b7f4ccfull, 0x7dede5bf81e215bcull, 0x6e8cca29f7eac37full, 0x490e2ca49ffd18c2ull } },
+	{ { 0x5939ac380d32af0eull, 0x3e7910a08b724fd5ull, 0x2d3a6b3d8d990001ull, 0x059ccb19edd3da9aull },
+	  { 0x928e1e3c97fe91d1ull, 0x1621f7a33956cecdull, 0xda65281b9345638eull, 0xbb6ad7eccad49159ull } },
+	{ { 0x32a290825d8bdac1ull, 0xdf53c8af01a7cd38ull, 0x2a1f28a08acc7d8full, 0x6a9501d85bf5dc80ull },
+	  { 0x30aff53d5f1ef1a3ull, 0xf8461b5c697a6f35ull, 0x81c6c6e44a3c56a3ull, 0xca640ad193473743ull } },
+};
+
 static int get_random_number(uint64_t * vli)
 {
 	uint64_t v;
@@ -146,9 +219,10 @@ static uint64_t vli_add(uint64_t * result, uint64_t * left, uint64_t * right)
 
 	for(i = 0; i < ECDSA256_NUM_DIGITS; i++)
 	{
-		uint64_t sum = left[i] + right[i] + carry;
-		if(sum != left[i])
-			carry = (sum < left[i]);
+		uint64_t sum = left[i] + right[i];
+		uint64_t c = (sum < left[i]);
+		sum += carry;
+		carry = c | (sum < carry);
 		result[i] = sum;
 	}
 	return carry;
@@ -161,14 +235,72 @@ static uint64_t vli_sub(uint64_t * result, uint64_t * left, uint64_t * right)
 
 	for(i = 0; i < ECDSA256_NUM_DIGITS; i++)
 	{
-		uint64_t diff = left[i] - right[i] - borrow;
-		if(diff != left[i])
-			borrow = (diff > left[i]);
+		uint64_t diff = left[i] - right[i];
+		uint64_t b = (diff > left[i]);
+		b |= (diff < borrow);
+		diff -= borrow;
+		borrow = b;
 		result[i] = diff;
 	}
 	return borrow;
 }
 
+#if defined(__SIZEOF_INT128__)
+static void vli_mult(uint64_t * result, uint64_t * left, uint64_t * right)
+{
+	unsigned __int128 t;
+	uint64_t carry;
+	int i, j;
+
+	vli_clear(result);
+	for(i = 0; i < ECDSA256_NUM_DIGITS; i++)
+	{
+		carry = 0;
+		for(j = 0; j < ECDSA256_NUM_DIGITS; j++)
+		{
+			t = (unsigned __int128)left[i] * right[j] + result[i + j] + carry;
+			result[i + j] = (uint64_t)t;
+			carry = (uint64_t)(t >> 64);
+		}
+		result[i + ECDSA256_NUM_DIGITS] = carry;
+	}
+}
+
+static void vli_square(uint64_t * result, uint64_t * left)
+{
+	unsigned __int128 t;
+	uint64_t carry;
+	int i, j;
+
+	/*
+	 * Cross products once, doubled, then the diagonal
+	 */
+	vli_clear(result);
+	for(i = 0; i < ECDSA256_NUM_DIGITS; i++)
+	{
+		carry = 0;
+		for(j = i + 1; j < ECDSA256_NUM_DIGITS; j++)
+		{
+			t = (unsigned __int128)left[i] * left[j] + result[i + j] + carry;
+			result[i + j] = (uint64_t)t;
+			carry = (uint64_t)(t >> 64);
+		}
+		result[i + ECDSA256_NUM_DIGITS] = carry;
+	}
+	for(i = ECDSA256_NUM_DIGITS * 2 - 1; i > 0; i--)
+		result[i] = (result[i] << 1) | (result[i - 1] >> 63);
+	result[0] <<= 1;
+	carry = 0;
+	for(i = 0; i < ECDSA256_NUM_DIGITS; i++)
+	{
+		t = (unsigned __int128)left[i] * left[i] + result[2 * i] + carry;
+		result[2 * i] = (uint64_t)t;
+		t = (t >> 64) + result[2 * i + 1];
+		result[2 * i + 1] = (uint64_t)t;
+		carry = (uint64_t)(t >> 64);
+	}
+}
+#else
 static struct ecdsa256_uint128_t mul_64_64(uint64_t left, uint64_t right)
 {
 	struct ecdsa256_uint128_t result;
@@ -251,12 +383,15 @@ static void vli_square(uint64_t *result, uint64_t *left)
 	}
 	result[ECDSA256_NUM_DIGITS * 2 - 1] = r01.m_low;
 }
+#endif
 
 static void vli_modadd(uint64_t * result, uint64_t * left, uint64_t * right, uint64_t * mod)
 {
+	uint64_t tmp[ECDSA256_NUM_DIGITS];
 	uint64_t carry = vli_add(result, left, right);
-	if(carry || vli_cmp(result, mod) >= 0)
-		vli_sub(result, result, mod);
+
+	if(!vli_sub(tmp, result, mod) || carry)
+		vli_set(result, tmp);
 }
 
 static void vli_modsub(uint64_t * result, uint64_t * left, uint64_t * right, uint64_t * mod)
@@ -266,76 +401,64 @@ static void vli_modsub(uint64_t * result, uint64_t * left, uint64_t * right, uin
 		vli_add(result, result, mod);
 }
 
+/*
+ * Solinas reduction on 32 bits words, the nine terms are summed per word and carried once
+ */
 static void vli_mmod_fast(uint64_t * result, uint64_t * product)
 {
+	uint32_t c[ECDSA256_NUM_DIGITS * 4];
+	int64_t w[ECDSA256_NUM_DIGITS * 2];
 	uint64_t tmp[ECDSA256_NUM_DIGITS];
+	int64_t acc = 0;
 	int carry;
+	int i;
 
-	vli_set(result, product);
-
-	tmp[0] = 0;
-	tmp[1] = product[5] & 0xffffffff00000000ull;
-	tmp[2] = product[6];
-	tmp[3] = product[7];
-	carry = vli_lshift(tmp, tmp, 1);
-	carry += vli_add(result, result, tmp);
-
-	tmp[1] = product[6] << 32;
-	tmp[2] = (product[6] >> 32) | (product[7] << 32);
-	tmp[3] = product[7] >> 32;
-	carry += vli_lshift(tmp, tmp, 1);
-	carry += vli_add(result, result, tmp);
-
-	tmp[0] = product[4];
-	tmp[1] = product[5] & 0xffffffff;
-	tmp[2] = 0;
-	tmp[3] = product[7];
-	carry += vli_add(result, result, tmp);
-
-	tmp[0] = (product[4] >> 32) | (product[5] << 32);
-	tmp[1] = (product[5] >> 32) | (product[6] & 0xffffffff00000000ull);
-	tmp[2] = product[7];
-	tmp[3] = (product[6] >> 32) | (product[4] << 32);
-	carry += vli_add(result, result, tmp);
-
-	tmp[0] = (product[5] >> 32) | (product[6] << 32);
-	tmp[1] = (product[6] >> 32);
-	tmp[2] = 0;
-	tmp[3] = (product[4] & 0xffffffff) | (product[5] << 32);
-	carry -= vli_sub(result, result, tmp);
-
-	tmp[0] = product[6];
-	tmp[1] = product[7];
-	tmp[2] = 0;
-	tmp[3] = (product[4] >> 32) | (product[5] & 0xffffffff00000000ull);
-	carry -= vli_sub(result, result, tmp);
-
-	tmp[0] = (product[6] >> 32) | (product[7] << 32);
-	tmp[1] = (product[7] >> 32) | (product[4] << 32);
-	tmp[2] = (product[4] >> 32) | (product[5] << 32);
-	tmp[3] = (product[6] << 32);
-	carry -= vli_sub(result, result, tmp);
-
-	tmp[0] = product[7];
-	tmp[1] = product[4] & 0xffffffff00000000ull;
-	tmp[2] = product[5];
-	tmp[3] = product[6] & 0xffffffff00000000ull;
-	carry -= vli_sub(result, result, tmp);
-
-	if(carry < 0)
-	{
-		do
-		{
-			carry += vli_add(result, result, curve_p);
-		} while(carry < 0);
+	for(i = 0; i < ECDSA256_NUM_DIGITS * 2; i++)
+	{
+		c[2 * i] = (uint32_t)product[i];
+		c[2 * i + 1] = (uint32_t)(product[i] >> 32);
 	}
-	else
+	w[0] = (int64_t)c[0] + c[8] + c[9] - c[11] - c[12] - c[13] - c[14];
+	w[1] = (int64_t)c[1] + c[9] + c[10] - c[12] - c[13] - c[14] - c[15];
+	w[2] = (int64_t)c[2] + c[10] + c[11] - c[13] - c[14] - c[15];
+	w[3] = (int64_t)c[3] + 2 * (int64_t)c[11] + 2 * (int64_t)c[12] + c[13] - c[15] - c[8] - c[9];
+	w[4] = (int64_t)c[4] + 2 * (int64_t)c[12] + 2 * (int64_t)c[13] + c[14] - c[9] - c[10];
+	w[5] = (int64_t)c[5] + 2 * (int64_t)c[13] + 2 * (int64_t)c[14] + c[15] - c[10] - c[11];
+	w[6] = (int64_t)c[6] + 3 * (int64_t)c[14] + 2 * (int64_t)c[15] + c[13] - c[8] - c[9];
+	w[7] = (int64_t)c[7] + 3 * (int64_t)c[15] + c[8] - c[10] - c[11] - c[12] - c[13];
+	for(i = 0; i < ECDSA256_NUM_DIGITS * 2; i++)
 	{
-		while(carry || vli_cmp(curve_p, result) != 1)
-		{
-			carry -= vli_sub(result, result, curve_p);
-		}
+		acc += w[i];
+		c[i] = (uint32_t)acc;
+		acc >>= 32;
 	}
+
+	/*
+	 * Fold the small carry back with 2^256 = 2^224 - 2^192 - 2^96 + 1 (mod p)
+	 */
+	carry = (int)acc;
+	acc = (int64_t)c[0] + carry;
+	for(i = 0; i < ECDSA256_NUM_DIGITS * 2; i++)
+	{
+		if(i > 0)
+			acc += c[i];
+		if(i == 3 || i == 6)
+			acc -= carry;
+		else if(i == 7)
+			acc += carry;
+		c[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+	for(i = 0; i < ECDSA256_NUM_DIGITS; i++)
+		result[i] = ((uint64_t)c[2 * i + 1] << 32) | c[2 * i];
+
+	/*
+	 * Now within (-p, 2p), a single correction is enough
+	 */
+	if(acc < 0)
+		vli_add(result, result, curve_p);
+	else if(!vli_sub(tmp, result, curve_p) || acc)
+		vli_set(result, tmp);
 }
 
 static void vli_modMult_fast(uint64_t * result, uint64_t * left, uint64_t * right)
@@ -567,6 +690,161 @@ static void eccpoint_mult(struct ecdsa256_point_t * result, struct ecdsa256_poin
 	vli_set(result->y, Ry[0]);
 }
 
+/*
+ * Jacobian doubling with a = -3, the point at infinity is z = 0
+ */
+static void eccpoint_double_jacobian_a3(uint64_t * x1, uint64_t * y1, uint64_t * z1)
+{
+	uint64_t delta[ECDSA256_NUM_DIGITS];
+	uint64_t gamma[ECDSA256_NUM_DIGITS];
+	uint64_t beta[ECDSA256_NUM_DIGITS];
+	uint64_t alpha[ECDSA256_NUM_DIGITS];
+	uint64_t t[ECDSA256_NUM_DIGITS];
+
+	if(vli_iszero(z1))
+		return;
+	vli_modSquare_fast(delta, z1);
+	vli_modSquare_fast(gamma, y1);
+	vli_modMult_fast(beta, x1, gamma);
+	vli_modsub(t, x1, delta, curve_p);
+	vli_modadd(alpha, x1, delta, curve_p);
+	vli_modMult_fast(alpha, alpha, t);
+	vli_modadd(t, alpha, alpha, curve_p);
+	vli_modadd(alpha, alpha, t, curve_p);
+	vli_modadd(z1, z1, y1, curve_p);
+	vli_modSquare_fast(z1, z1);
+	vli_modsub(z1, z1, gamma, curve_p);
+	vli_modsub(z1, z1, delta, curve_p);
+	vli_modadd(beta, beta, beta, curve_p);
+	vli_modadd(beta, beta, beta, curve_p);
+	vli_modSquare_fast(x1, alpha);
+	vli_modsub(x1, x1, beta, curve_p);
+	vli_modsub(x1, x1, beta, curve_p);
+	vli_modsub(beta, beta, x1, curve_p);
+	vli_modMult_fast(y1, alpha, beta);
+	vli_modSquare_fast(gamma, gamma);
+	vli_modadd(gamma, gamma, gamma, curve_p);
+	vli_modadd(gamma, gamma, gamma, curve_p);
+	vli_modadd(gamma, gamma, gamma, curve_p);
+	vli_modsub(y1, y1, gamma, curve_p);
+}
+
+/*
+ * Adds or subtracts the second point into the first, a null z2 means the second point is affine
+ */
+static void eccpoint_add_jacobian(uint64_t * x1, uint64_t * y1, uint64_t * z1, uint64_t * x2, uint64_t * y2, uint64_t * z2, int neg)
+{
+	uint64_t u1[ECDSA256_NUM_DIGITS], s1[ECDSA256_NUM_DIGITS];
+	uint64_t u2[ECDSA256_NUM_DIGITS], s2[ECDSA256_NUM_DIGITS];
+	uint64_t h[ECDSA256_NUM_DIGITS], r[ECDSA256_NUM_DIGITS];
+	uint64_t t[ECDSA256_NUM_DIGITS];
+
+	if(vli_iszero(z1))
+	{
+		vli_set(x1, x2);
+		if(neg)
+			vli_modsub(y1, curve_p, y2, curve_p);
+		else
+			vli_set(y1, y2);
+		vli_clear(z1);
+		z1[0] = 1;
+		if(z2)
+			vli_set(z1, z2);
+		return;
+	}
+	if(z2)
+	{
+		vli_modSquare_fast(t, z2);
+		vli_modMult_fast(u1, x1, t);
+		vli_modMult_fast(t, t, z2);
+		vli_modMult_fast(s1, y1, t);
+	}
+	else
+	{
+		vli_set(u1, x1);
+		vli_set(s1, y1);
+	}
+	vli_modSquare_fast(t, z1);
+	vli_modMult_fast(u2, x2, t);
+	vli_modMult_fast(t, t, z1);
+	vli_modMult_fast(s2, y2, t);
+	if(neg)
+		vli_modsub(s2, curve_p, s2, curve_p);
+	vli_modsub(h, u2, u1, curve_p);
+	vli_modsub(r, s2, s1, curve_p);
+	if(vli_iszero(h))
+	{
+		if(vli_iszero(r))
+		{
+			eccpoint_double_jacobian_a3(x1, y1, z1);
+		}
+		else
+		{
+			vli_clear(x1);
+			vli_clear(y1);
+			vli_clear(z1);
+		}
+		return;
+	}
+	vli_modMult_fast(z1, z1, h);
+	if(z2)
+		vli_modMult_fast(z1, z1, z2);
+	vli_modSquare_fast(t, h);
+	vli_modMult_fast(u1, u1, t);
+	vli_modMult_fast(h, h, t);
+	vli_modMult_fast(s1, s1, h);
+	vli_modSquare_fast(x1, r);
+	vli_modsub(x1, x1, h, curve_p);
+	vli_modsub(x1, x1, u1, curve_p);
+	vli_modsub(x1, x1, u1, curve_p);
+	vli_modsub(u1, u1, x1, curve_p);
+	vli_modMult_fast(y1, r, u1);
+	vli_modsub(y1, y1, s1, curve_p);
+}
+
+/*
+ * Width w non adjacent form, digits are odd and below 2^(w-1) in magnitude
+ */
+static int vli_wnaf(int8_t * naf, uint64_t * scalar, int w)
+{
+	uint64_t k[ECDSA256_NUM_DIGITS + 1];
+	uint64_t c;
+	int len = 0;
+	int d, i;
+
+	vli_set(k, scalar);
+	k[ECDSA256_NUM_DIGITS] = 0;
+	while(!vli_iszero(k) || k[ECDSA256_NUM_DIGITS])
+	{
+		d = 0;
+		if(k[0] & 1)
+		{
+			d = k[0] & ((1 << w) - 1);
+			if(d >= (1 << (w - 1)))
+				d -= (1 << w);
+			if(d > 0)
+			{
+				c = (k[0] < (uint64_t)d);
+				k[0] -= d;
+				for(i = 1; c && (i <= ECDSA256_NUM_DIGITS); i++)
+					c = (k[i]-- == 0);
+			}
+			else
+			{
+				k[0] += -d;
+				c = (k[0] < (uint64_t)-d);
+				for(i = 1; c && (i <= ECDSA256_NUM_DIGITS); i++)
+					c = (++k[i] == 0);
+			}
+		}
+		naf[len++] = d;
+		for(i = 0; i < ECDSA256_NUM_DIGITS; i++)
+			k[i] = (k[i] >> 1) | (k[i + 1] << 63);
+		k[ECDSA256_NUM_DIGITS] >>= 1;
+	}
+	return len;
+}
+
 static void ecc_bytes2native(uint64_t * native, const uint8_t * bytes)
 {
 	int i;
@@ -674,11 +952,6 @@ static void vli_modmult(uint64_t * result, uint64_t * left, uint64_t * right, ui
 	vli_set(result, product);
 }
 
-static unsigned int umax(unsigned int a, unsigned int b)
-{
-	return (a > b ? a : b);
-}
-
 int ecdh256_keygen(const uint8_t * public, const uint8_t * private, uint8_t * shared)
 {
 	struct ecdsa256_point_t lpublic;
@@ -752,16 +1025,17 @@ int ecdsa256_sign(const uint8_t * private, const uint8_t * sha256, uint8_t * sig
 
 int ecdsa256_verify(const uint8_t * public, const uint8_t * sha256, const uint8_t * signature)
 {
+	uint64_t qx[1 << (CURVE_Q_WNAF - 2)][ECDSA256_NUM_DIGITS];
+	uint64_t qy[1 << (CURVE_Q_WNAF - 2)][ECDSA256_NUM_DIGITS];
+	uint64_t qz[1 << (CURVE_Q_WNAF - 2)][ECDSA256_NUM_DIGITS];
+	uint64_t dx[ECDSA256_NUM_DIGITS], dy[ECDSA256_NUM_DIGITS], dz[ECDSA256_NUM_DIGITS];
+	uint64_t rx[ECDSA256_NUM_DIGITS], ry[ECDSA256_NUM_DIGITS], rz[ECDSA256_NUM_DIGITS];
 	uint64_t u1[ECDSA256_NUM_DIGITS], u2[ECDSA256_NUM_DIGITS];
-	uint64_t z[ECDSA256_NUM_DIGITS];
-	struct ecdsa256_point_t lpublic, sum;
-	uint64_t rx[ECDSA256_NUM_DIGITS];
-	uint64_t ry[ECDSA256_NUM_DIGITS];
-	uint64_t tx[ECDSA256_NUM_DIGITS];
-	uint64_t ty[ECDSA256_NUM_DIGITS];
-	uint64_t tz[ECDSA256_NUM_DIGITS];
 	uint64_t r[ECDSA256_NUM_DIGITS], s[ECDSA256_NUM_DIGITS];
-	int i;
+	uint64_t z[ECDSA256_NUM_DIGITS], t[ECDSA256_NUM_DIGITS];
+	int8_t naf1[ECDSA256_BYTES * 8 + 1], naf2[ECDSA256_BYTES * 8 + 1];
+	struct ecdsa256_point_t lpublic;
+	int len1, len2, i, d;
 
 	ecc_point_decompress(&lpublic, public);
 	ecc_bytes2native(r, signature);
@@ -774,39 +1048,66 @@ int ecdsa256_verify(const uint8_t * public, const uint8_t * sha256, const uint8_
 	ecc_bytes2native(u1, sha256);
 	vli_modmult(u1, u1, z, curve_n);
 	vli_modmult(u2, r, z, curve_n);
-	vli_set(sum.x, lpublic.x);
-	vli_set(sum.y, lpublic.y);
-	vli_set(tx, curve_g.x);
-	vli_set(ty, curve_g.y);
-	vli_modsub(z, sum.x, tx, curve_p);
-	xycz_add(tx, ty, sum.x, sum.y);
-	vli_modinv(z, z, curve_p);
-	apply_z(sum.x, sum.y, z);
-	struct ecdsa256_point_t * points[4] = { NULL, &curve_g, &lpublic, &sum };
-	unsigned int numbits = umax(vli_numbits(u1), vli_numbits(u2));
-	struct ecdsa256_point_t * point = points[(!!vli_testbit(u1, numbits - 1)) | ((!!vli_testbit(u2, numbits - 1)) << 1)];
-	vli_set(rx, point->x);
-	vli_set(ry, point->y);
-	vli_clear(z);
-	z[0] = 1;
-	for(i = numbits - 2; i >= 0; --i)
+
+	/*
+	 * Odd multiples of the public key, kept in jacobian form to save the inversion
+	 */
+	vli_set(qx[0], lpublic.x);
+	vli_set(qy[0], lpublic.y);
+	vli_clear(qz[0]);
+	qz[0][0] = 1;
+	vli_set(dx, lpublic.x);
+	vli_set(dy, lpublic.y);
+	vli_set(dz, qz[0]);
+	eccpoint_double_jacobian_a3(dx, dy, dz);
+	for(i = 1; i < (1 << (CURVE_Q_WNAF - 2)); i++)
 	{
-		eccpoint_double_jacobian(rx, ry, z);
-		int index = (!!vli_testbit(u1, i)) | ((!!vli_testbit(u2, i)) << 1);
-		struct ecdsa256_point_t * point = points[index];
-		if(point)
+		vli_set(qx[i], qx[i - 1]);
+		vli_set(qy[i], qy[i - 1]);
+		vli_set(qz[i], qz[i - 1]);
+		eccpoint_add_jacobian(qx[i], qy[i], qz[i], dx, dy, dz, 0);
+	}
+
+	/*
+	 * Shamir's trick over both naf, one shared doubling chain
+	 */
+	len1 = vli_wnaf(naf1, u1, CURVE_G_WNAF);
+	len2 = vli_wnaf(naf2, u2, CURVE_Q_WNAF);
+	vli_clear(rx);
+	vli_clear(ry);
+	vli_clear(rz);
+	for(i = (len1 > len2 ? len1 : len2) - 1; i >= 0; i--)
+	{
+		eccpoint_double_jacobian_a3(rx, ry, rz);
+		d = (i < len1) ? naf1[i] : 0;
+		if(d)
+		{
+			vli_set(t, (uint64_t *)curve_g_table[(d < 0 ? -d : d) >> 1].y);
+			if(d < 0)
+				vli_sub(t, curve_p, t);
+			eccpoint_add_jacobian(rx, ry, rz, (uint64_t *)curve_g_table[(d < 0 ? -d : d) >> 1].x, t, NULL, 0);
+		}
+		d = (i < len2) ? naf2[i] : 0;
+		if(d)
 		{
-			vli_set(tx, point->x);
-			vli_set(ty, point->y);
-			apply_z(tx, ty, z);
-			vli_modsub(tz, rx, tx, curve_p);
-			xycz_add(tx, ty, rx, ry);
-			vli_modMult_fast(z, z, tz);
+			eccpoint_add_jacobian(rx, ry, rz, qx[(d < 0 ? -d : d) >> 1], qy[(d < 0 ? -d : d) >> 1], qz[(d < 0 ? -d : d) >> 1], d < 0);
 		}
 	}
-	vli_modinv(z, z, curve_p);
-	apply_z(rx, ry, z);
-	if(vli_cmp(curve_n, rx) != 1)
-		vli_sub(rx, rx, curve_n);
-	return (vli_cmp(rx, r) == 0);
+	if(vli_iszero(rz))
+		return 0;
+
+	/*
+	 * Compare in projective form, x / z^2 == r (mod n) without inverting z
+	 */
+	vli_modSquare_fast(z, rz);
+	vli_modMult_fast(t, r, z);
+	if(vli_cmp(t, rx) == 0)
+		return 1;
+	if(!vli_add(r, r, curve_n) && (vli_cmp(r, curve_p) < 0))
+	{
+		vli_modMult_fast(t, r, z);
+		if(vli_cmp(t, rx) == 0)
+			return 1;
+	}
+	return 0;
 }
@@ -5,9 +5,11 @@
 #include <xconfigs.h>
 #include <assert.h>
 #include <spinlock.h>
+#include <smp.h>
 #include <string.h>
 #include <stdio.h>
 #include <malloc.h>
+#include <mprof.h>
 #include <xboot/kobj.h>
 #include <xboot/module.h>
 
@@ -819,19 +821,195 @@ void mm_info(void * mm, size_t * mused, size_t * mfree)
 static void * __heap_pool = NULL;
 static spinlock_t __heap_lock = SPIN_LOCK_INIT();
 
-static void * __malloc(size_t size)
+/*
+ * Per-cpu magazines of small blocks, refilled from and drained to tlsf in batches
+ */
+static const size_t __magazine_class[] = {
+	32, 48, 64, 96, 128, 192, 256, 384, 512,
+};
+#define MAGAZINE_CLASS_COUNT	(sizeof(__magazine_class) / sizeof(__magazine_class[0]))
+#define MAGAZINE_CLASS_MAX		(512)
+#define MAGAZINE_BATCH			(CONFIG_MALLOC_MAGAZINE_SIZE / 2)
+
+struct magazine_t {
+	void * obj[CONFIG_MALLOC_MAGAZINE_SIZE];
+	int count;
+};
+
+struct magazine_cpu_t {
+	struct magazine_t mag[MAGAZINE_CLASS_COUNT];
+	unsigned long hit;
+	unsigned long miss;
+	spinlock_t lock;
+};
+
+static struct magazine_cpu_t __magazine[CONFIG_MAX_SMP_CPUS];
+
+static inline int magazine_class_index(size_t size)
+{
+	int i;
+
+	for(i = 0; i < MAGAZINE_CLASS_COUNT; i++)
+	{
+		if(size <= __magazine_class[i])
+			return i;
+	}
+	return -1;
+}
+
+static inline int magazine_block_index(void * ptr)
+{
+	size_t size = block_get_size(block_from_ptr(ptr));
+	int i;
+
+	if(size <= MAGAZINE_CLASS_MAX)
+	{
+		i = magazine_class_index(size);
+		if((i >= 0) && (__magazine_class[i] == size))
+			return i;
+	}
+	return -1;
+}
+
+static void * magazine_alloc(size_t size)
+{
+	struct magazine_cpu_t * mc;
+	struct magazine_t * mag;
+	irq_flags_t flags;
+	void * m = NULL;
+	int i, idx;
+
+	idx = magazine_class_index(size);
+	local_irq_save(flags);
+	mc = &__magazine[smp_processor_id()];
+	spin_lock(&mc->lock);
+	mag = &mc->mag[idx];
+	if(mag->count > 0)
+	{
+		m = mag->obj[--mag->count];
+		mc->hit++;
+	}
+	else
+	{
+		mc->miss++;
+		spin_lock(&__heap_lock);
+		m = tlsf_malloc(__heap_pool, __magazine_class[idx]);
+		for(i = 0; m && (i < MAGAZINE_BATCH); i++)
+		{
+			void * o = tlsf_malloc(__heap_pool, __magazine_class[idx]);
+			if(!o)
+				break;
+			mag->obj[mag->count++] = o;
+		}
+		spin_unlock(&__heap_lock);
+	}
+	spin_unlock(&mc->lock);
+	local_irq_restore(flags);
+	return m;
+}
+
+static int magazine_free(void * ptr)
+{
+	struct magazine_cpu_t * mc;
+	struct magazine_t * mag;
+	irq_flags_t flags;
+	int idx;
+
+	idx = magazine_block_index(ptr);
+	if(idx < 0)
+		return 0;
+	local_irq_save(flags);
+	mc = &__magazine[smp_processor_id()];
+	spin_lock(&mc->lock);
+	mag = &mc->mag[idx];
+	if(mag->count >= CONFIG_MALLOC_MAGAZINE_SIZE)
+	{
+		spin_lock(&__heap_lock);
+		while(mag->count > CONFIG_MALLOC_MAGAZINE_SIZE - MAGAZINE_BATCH)
+			tlsf_free(__heap_pool, mag->obj[--mag->count]);
+		spin_unlock(&__heap_lock);
+	}
+	mag->obj[mag->count++] = ptr;
+	spin_unlock(&mc->lock);
+	local_irq_restore(flags);
+	return 1;
+}
+
+/*
+ * Gives the blocks cached by every cpu back to tlsf when it runs out, returns how many
+ * there were. The lock of a magazine is always taken before the heap lock.
+ */
+static int magazine_drain(void)
+{
+	struct magazine_cpu_t * mc;
+	struct magazine_t * mag;
+	irq_flags_t flags;
+	int i, j, n = 0;
+
+	for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+	{
+		mc = &__magazine[i];
+		spin_lock_irqsave(&mc->lock, flags);
+		spin_lock(&__heap_lock);
+		for(j = 0; j < MAGAZINE_CLASS_COUNT; j++)
+		{
+			mag = &mc->mag[j];
+			n += mag->count;
+			while(mag->count > 0)
+				tlsf_free(__heap_pool, mag->obj[--mag->count]);
+		}
+		spin_unlock(&__heap_lock);
+		spin_unlock_irqrestore(&mc->lock, flags);
+	}
+	return n;
+}
+
+static void * heap_malloc(size_t size)
 {
 	void * m;
 
 	if(__heap_pool)
 	{
+		if(size <= MAGAZINE_CLASS_MAX)
+		{
+			m = magazine_alloc(size);
+			if(!m && magazine_drain())
+				m = magazine_alloc(size);
+			return m;
+		}
 		spin_lock(&__heap_lock);
 		m = tlsf_malloc(__heap_pool, size);
 		spin_unlock(&__heap_lock);
+		if(!m && magazine_drain())
+		{
+			spin_lock(&__heap_lock);
+			m = tlsf_malloc(__heap_pool, size);
+			spin_unlock(&__heap_lock);
+		}
 		return m;
 	}
 	return NULL;
 }
+
+static void heap_free(void * ptr)
+{
+	if(__heap_pool && ptr)
+	{
+		if(magazine_free(ptr))
+			return;
+		spin_lock(&__heap_lock);
+		tlsf_free(__heap_pool, ptr);
+		spin_unlock(&__heap_lock);
+	}
+}
+
+static void * __malloc(size_t size)
+{
+	void * m = heap_malloc(size);
+
+	mprof_alloc(m, size, __builtin_return_address(0));
+	return m;
+}
 extern __typeof(__malloc) malloc __attribute__((weak, alias("__malloc")));
 
 static void * __memalign(size_t align, size_t size)
@@ -843,18 +1021,37 @@ static void * __memalign(size_t align, size_t size)
 		spin_lock(&__heap_lock);
 		m = tlsf_memalign(__heap_pool, align, size);
 		spin_unlock(&__heap_lock);
+		mprof_alloc(m, size, __builtin_return_address(0));
 		return m;
 	}
 	return NULL;
 }
 extern __typeof(__memalign) memalign __attribute__((weak, alias("__memalign")));
 
-static void * __realloc(void * ptr, size_t size)
+static void * heap_realloc(void * ptr, size_t size)
 {
 	void * m;
 
 	if(__heap_pool)
 	{
+		if(!ptr)
+			return heap_malloc(size);
+		if(size == 0)
+		{
+			heap_free(ptr);
+			return NULL;
+		}
+		if((size <= MAGAZINE_CLASS_MAX) && (magazine_block_index(ptr) >= 0))
+		{
+			if(block_get_size(block_from_ptr(ptr)) >= size)
+				return ptr;
+			if((m = heap_malloc(size)))
+			{
+				memcpy(m, ptr, block_get_size(block_from_ptr(ptr)));
+				heap_free(ptr);
+			}
+			return m;
+		}
 		spin_lock(&__heap_lock);
 		m = tlsf_realloc(__heap_pool, ptr, size);
 		spin_unlock(&__heap_lock);
@@ -862,26 +1059,33 @@ static void * __realloc(void * ptr, size_t size)
 	}
 	return NULL;
 }
+
+static void * __realloc(void * ptr, size_t size)
+{
+	void * m = heap_realloc(ptr, size);
+
+	if(m || (size == 0))
+		mprof_free(ptr);
+	mprof_alloc(m, size, __builtin_return_address(0));
+	return m;
+}
 extern __typeof(__realloc) realloc __attribute__((weak, alias("__realloc")));
 
 static void * __calloc(size_t nmemb, size_t size)
 {
 	void * m;
 
-	if((m = malloc(nmemb * size)))
+	if((m = heap_malloc(nmemb * size)))
 		memset(m, 0, nmemb * size);
+	mprof_alloc(m, nmemb * size, __builtin_return_address(0));
 	return m;
 }
 extern __typeof(__calloc) calloc __attribute__((weak, alias("__calloc")));
 
 static void __free(void * ptr)
 {
-	if(__heap_pool)
-	{
-		spin_lock(&__heap_lock);
-		tlsf_free(__heap_pool, ptr);
-		spin_unlock(&__heap_lock);
-	}
+	mprof_free(ptr);
+	heap_free(ptr);
 }
 extern __typeof(__free) free __attribute__((weak, alias("__free")));
 
@@ -895,6 +1099,31 @@ static void __meminfo(size_t * mused, size_t * mfree)
 }
 extern __typeof(__meminfo) meminfo __attribute__((weak, alias("__meminfo")));
 
+/*
+ * Only the tlsf heap has a block map, a build on a host allocator like the sandbox
+ * has no heap pool and reports that with a zero return
+ */
+static int __memwalk(void (*cb)(void * ptr, size_t size, int used, void * data), void * data)
+{
+	block_header_t * block;
+
+	if(!__heap_pool)
+		return 0;
+	if(cb)
+	{
+		spin_lock(&__heap_lock);
+		block = offset_to_block(mm_get(__heap_pool), -(int)block_header_overhead);
+		while(block && !block_is_last(block))
+		{
+			cb(block_to_ptr(block), block_get_size(block), block_is_free(block) ? 0 : 1, data);
+			block = block_next(block);
+		}
+		spin_unlock(&__heap_lock);
+	}
+	return 1;
+}
+extern __typeof(__memwalk) memwalk __attribute__((weak, alias("__memwalk")));
+
 static struct kobj_t * search_class_memory_kobj(void)
 {
 	struct kobj_t * kclass = kobj_search_directory_with_create(kobj_get_root(), "class");
@@ -905,12 +1134,23 @@ static ssize_t memory_read_meminfo(struct kobj_t * kobj, void * buf, size_t size
 {
 	size_t mused = 0;
 	size_t mfree = 0;
+	size_t cached;
 	char * p = buf;
 	int len = 0;
+	int i, j;
 
 	meminfo(&mused, &mfree);
 	len += sprintf((char *)(p + len), " memory used: %ld\r\n", mused);
 	len += sprintf((char *)(p + len), " memory free: %ld\r\n", mfree);
+	if(__heap_pool)
+	{
+		for(i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+		{
+			for(j = 0, cached = 0; j < MAGAZINE_CLASS_COUNT; j++)
+				cached += __magazine[i].mag[j].count * __magazine_class[j];
+			len += sprintf((char *)(p + len), " cpu%d magazine hit: %lu, miss: %lu, cached: %ld\r\n", i, __magazine[i].hit, __magazine[i].miss, (long)cached);
+		}
+	}
 	return len;
 }
 
@@ -920,6 +1160,8 @@ void do_init_mem(void)
 	extern unsigned char __heap_start[];
 	extern unsigned char __heap_end[];
 	spin_lock_init(&__heap_lock);
+	for(int i = 0; i < CONFIG_MAX_SMP_CPUS; i++)
+		spin_lock_init(&__magazine[i].lock);
 	__heap_pool = mm_create((void *)__heap_start, (size_t)(__heap_end - __heap_start));
 #endif
 	kobj_add_regular(search_class_memory_kobj(), "meminfo", memory_read_meminfo, NULL, NULL);
@@ -0,0 +1,332 @@
+/*
+ * lib/libc/malloc/mprof.c
+ */
+
+#include <xconfigs.h>
+#include <spinlock.h>
+#include <string.h>
+#include <malloc.h>
+#include <mprof.h>
+#include <xboot/module.h>
+
+/*
+ * Blocks are sharded by address and callsites by caller, each shard under its own lock.
+ * An allocation takes its block shard and then its callsite shard, always in that order
+ */
+#define MPROF_SHARDS		(16)
+#define MPROF_SHARD_BLOCKS	(CONFIG_MPROF_BLOCKS / MPROF_SHARDS)
+#define MPROF_SHARD_HASH	(MPROF_SHARD_BLOCKS / 4)
+#define MPROF_SHARD_SITES	(CONFIG_MPROF_SITES / MPROF_SHARDS)
+
+struct mprof_block_t {
+	void * ptr;
+	size_t size;
+	int site;
+	int next;
+};
+
+struct mprof_bshard_t {
+	spinlock_t lock;
+	struct mprof_block_t block[MPROF_SHARD_BLOCKS];
+	int hash[MPROF_SHARD_HASH];
+	int free;
+	unsigned long nblock;
+	size_t bytes;
+	unsigned long dropped;
+};
+
+struct mprof_sshard_t {
+	spinlock_t lock;
+	struct mprof_site_t site[MPROF_SHARD_SITES];
+};
+
+struct mprof_table_t {
+	struct mprof_bshard_t bshard[MPROF_SHARDS];
+	struct mprof_sshard_t sshard[MPROF_SHARDS];
+};
+
+volatile int __mprof_enabled = 0;
+EXPORT_SYMBOL(__mprof_enabled);
+static struct mprof_table_t * __mprof = NULL;
+static spinlock_t __mprof_lock = SPIN_LOCK_INIT();
+
+static inline unsigned int mprof_hash_ptr(void * ptr)
+{
+	unsigned long v = (unsigned long)ptr >> 3;
+
+	v ^= v >> 16;
+	v *= 0x45d9f3b;
+	v ^= v >> 16;
+	return (unsigned int)v;
+}
+
+static inline struct mprof_bshard_t * mprof_bshard(struct mprof_table_t * t, unsigned int h)
+{
+	return &t->bshard[h & (MPROF_SHARDS - 1)];
+}
+
+static inline struct mprof_site_t * mprof_site(struct mprof_table_t * t, int site)
+{
+	return &t->sshard[site / MPROF_SHARD_SITES].site[site % MPROF_SHARD_SITES];
+}
+
+static inline int mprof_site_index(struct mprof_sshard_t * ss, int shard, unsigned int h, void * caller)
+{
+	unsigned int i = (h / MPROF_SHARDS) & (MPROF_SHARD_SITES - 1);
+	int n;
+
+	for(n = 0; n < MPROF_SHARD_SITES; n++, i = (i + 1) & (MPROF_SHARD_SITES - 1))
+	{
+		if(ss->site[i].caller == caller)
+			return shard * MPROF_SHARD_SITES + i;
+		if(!ss->site[i].caller)
+		{
+			ss->site[i].caller = caller;
+			return shard * MPROF_SHARD_SITES + i;
+		}
+	}
+	return -1;
+}
+
+static void mprof_reset(struct mprof_table_t * t)
+{
+	struct mprof_bshard_t * bs;
+	int i, j;
+
+	for(i = 0; i < MPROF_SHARDS; i++)
+	{
+		bs = &t->bshard[i];
+		for(j = 0; j < MPROF_SHARD_HASH; j++)
+			bs->hash[j] = -1;
+		for(j = 0; j < MPROF_SHARD_BLOCKS; j++)
+			bs->block[j].next = j + 1;
+		bs->block[MPROF_SHARD_BLOCKS - 1].next = -1;
+		bs->free = 0;
+		bs->nblock = 0;
+		bs->bytes = 0;
+		bs->dropped = 0;
+		memset(t->sshard[i].site, 0, sizeof(t->sshard[i].site));
+	}
+}
+
+static void mprof_lock_all(struct mprof_table_t * t)
+{
+	int i;
+
+	for(i = 0; i < MPROF_SHARDS; i++)
+		spin_lock(&t->bshard[i].lock);
+	for(i = 0; i < MPROF_SHARDS; i++)
+		spin_lock(&t->sshard[i].lock);
+}
+
+static void mprof_unlock_all(struct mprof_table_t * t)
+{
+	int i;
+
+	for(i = MPROF_SHARDS - 1; i >= 0; i--)
+		spin_unlock(&t->sshard[i].lock);
+	for(i = MPROF_SHARDS - 1; i >= 0; i--)
+		spin_unlock(&t->bshard[i].lock);
+}
+
+static void mprof_remove(struct mprof_table_t * t, struct mprof_bshard_t * bs, unsigned int h, void * ptr)
+{
+	struct mprof_sshard_t * ss;
+	struct mprof_block_t * b;
+	struct mprof_site_t * s;
+	int * link;
+
+	for(link = &bs->hash[(h / MPROF_SHARDS) & (MPROF_SHARD_HASH - 1)]; *link >= 0; link = &b->next)
+	{
+		b = &bs->block[*link];
+		if(b->ptr == ptr)
+		{
+			ss = &t->sshard[b->site / MPROF_SHARD_SITES];
+			spin_lock(&ss->lock);
+			s = mprof_site(t, b->site);
+			s->count--;
+			s->bytes -= b->size;
+			spin_unlock(&ss->lock);
+			bs->nblock--;
+			bs->bytes -= b->size;
+			b->ptr = NULL;
+			*link = b->next;
+			b->next = bs->free;
+			bs->free = b - bs->block;
+			break;
+		}
+	}
+}
+
+void __mprof_alloc(void * ptr, size_t size, void * caller)
+{
+	struct mprof_table_t * t = __mprof;
+	struct mprof_bshard_t * bs;
+	struct mprof_sshard_t * ss;
+	struct mprof_block_t * b;
+	struct mprof_site_t * s;
+	irq_flags_t flags;
+	unsigned int h, hc;
+	int i, idx;
+
+	if(!t)
+		return;
+	h = mprof_hash_ptr(ptr);
+	hc = mprof_hash_ptr(caller);
+	bs = mprof_bshard(t, h);
+	ss = &t->sshard[hc & (MPROF_SHARDS - 1)];
+	spin_lock_irqsave(&bs->lock, flags);
+	/* Drop a stale record of a block freed while profiling was stopped */
+	mprof_remove(t, bs, h, ptr);
+	spin_lock(&ss->lock);
+	idx = mprof_site_index(ss, ss - t->sshard, hc, caller);
+	if((idx < 0) || (bs->free < 0))
+	{
+		bs->dropped++;
+	}
+	else
+	{
+		i = bs->free;
+		b = &bs->block[i];
+		bs->free = b->next;
+		b->ptr = ptr;
+		b->size = size;
+		b->site = idx;
+		b->next = bs->hash[(h / MPROF_SHARDS) & (MPROF_SHARD_HASH - 1)];
+		bs->hash[(h / MPROF_SHARDS) & (MPROF_SHARD_HASH - 1)] = i;
+		bs->nblock++;
+		bs->bytes += size;
+		s = mprof_site(t, idx);
+		s->count++;
+		s->total++;
+		s->bytes += size;
+		if(s->bytes > s->peak)
+			s->peak = s->bytes;
+	}
+	spin_unlock(&ss->lock);
+	spin_unlock_irqrestore(&bs->lock, flags);
+}
+EXPORT_SYMBOL(__mprof_alloc);
+
+void __mprof_free(void * ptr)
+{
+	struct mprof_table_t * t = __mprof;
+	struct mprof_bshard_t * bs;
+	irq_flags_t flags;
+	unsigned int h;
+
+	if(!t)
+		return;
+	h = mprof_hash_ptr(ptr);
+	bs = mprof_bshard(t, h);
+	spin_lock_irqsave(&bs->lock, flags);
+	mprof_remove(t, bs, h, ptr);
+	spin_unlock_irqrestore(&bs->lock, flags);
+}
+EXPORT_SYMBOL(__mprof_free);
+
+int mprof_start(void)
+{
+	struct mprof_table_t * t;
+	irq_flags_t flags;
+	int i;
+
+	if(__mprof_enabled)
+		return 1;
+	if(!__mprof)
+	{
+		t = malloc(sizeof(struct mprof_table_t));
+		if(!t)
+			return 0;
+		for(i = 0; i < MPROF_SHARDS; i++)
+		{
+			spin_lock_init(&t->bshard[i].lock);
+			spin_lock_init(&t->sshard[i].lock);
+		}
+		mprof_reset(t);
+		spin_lock_irqsave(&__mprof_lock, flags);
+		if(!__mprof)
+		{
+			__mprof = t;
+			t = NULL;
+		}
+		spin_unlock_irqrestore(&__mprof_lock, flags);
+		free(t);
+	}
+	smp_wmb();
+	__mprof_enabled = 1;
+	return 1;
+}
+EXPORT_SYMBOL(mprof_start);
+
+void mprof_stop(void)
+{
+	__mprof_enabled = 0;
+	smp_mb();
+}
+EXPORT_SYMBOL(mprof_stop);
+
+void mprof_clear(void)
+{
+	struct mprof_table_t * t = __mprof;
+	irq_flags_t flags;
+
+	if(t)
+	{
+		local_irq_save(flags);
+		mprof_lock_all(t);
+		mprof_reset(t);
+		mprof_unlock_all(t);
+		local_irq_restore(flags);
+	}
+}
+EXPORT_SYMBOL(mprof_clear);
+
+int mprof_snapshot(struct mprof_site_t * site, int n)
+{
+	struct mprof_table_t * t = __mprof;
+	struct mprof_sshard_t * ss;
+	irq_flags_t flags;
+	int i, j, len = 0;
+
+	for(i = 0; t && (i < MPROF_SHARDS) && (len < n); i++)
+	{
+		ss = &t->sshard[i];
+		spin_lock_irqsave(&ss->lock, flags);
+		for(j = 0; (j < MPROF_SHARD_SITES) && (len < n); j++)
+		{
+			if(ss->site[j].caller)
+				memcpy(&site[len++], &ss->site[j], sizeof(struct mprof_site_t));
+		}
+		spin_unlock_irqrestore(&ss->lock, flags);
+	}
+	return len;
+}
+EXPORT_SYMBOL(mprof_snapshot);
+
+void mprof_summary(unsigned long * blocks, size_t * bytes, unsigned long * dropped)
+{
+	struct mprof_table_t * t = __mprof;
+	struct mprof_bshard_t * bs;
+	unsigned long nblock = 0, ndropped = 0;
+	size_t nbytes = 0;
+	irq_flags_t flags;
+	int i;
+
+	for(i = 0; t && (i < MPROF_SHARDS); i++)
+	{
+		bs = &t->bshard[i];
+		spin_lock_irqsave(&bs->lock, flags);
+		nblock += bs->nblock;
+		nbytes += bs->bytes;
+		ndropped += bs->dropped;
+		spin_unlock_irqrestore(&bs->lock, flags);
+	}
+	if(blocks)
+		*blocks = nblock;
+	if(bytes)
+		*bytes = nbytes;
+	if(dropped)
+		*dropped = ndropped;
+}
+EXPORT_SYMBOL(mprof_summary);
@@ -4,6 +4,7 @@
 
 #include <math.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <xboot/module.h>
 
@@ -36,24 +37,87 @@ enum ranks {
 #define PTRDIFF_T_RANK	rank_long
 
 #define EMIT(x)			({ if(o<n) {*q++ = (x);} o++; })
+#define EMITS(s, l)		({ size_t __l = (l), __c = (o < n) ? ((n - o < __l) ? n - o : __l) : 0; if(__c) {memcpy(q, (s), __c); q += __c;} o += __l; })
+
+static const char digits_lc[] = "0123456789abcdef";
+static const char digits_uc[] = "0123456789ABCDEF";
+static const char digits_100[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/*
+ * Write the digits of val backwards ending at end, decimal goes two digits per step
+ * and only falls back to 64 bits division above 32 bits
+ */
+static int format_digits(char * end, uintmax_t val, int base, int upper)
+{
+	const char * digits = upper ? digits_uc : digits_lc;
+	char * p = end;
+	uint32_t v, r;
+	int i;
+
+	switch (base)
+	{
+	case 10:
+		while (val > 0xffffffff)
+		{
+			v = val % 1000000000;
+			val /= 1000000000;
+			for (i = 0; i < 9; i++, v /= 10)
+				*--p = '0' + v % 10;
+		}
+		v = (uint32_t)val;
+		while (v >= 100)
+		{
+			r = v % 100;
+			v /= 100;
+			p -= 2;
+			p[0] = digits_100[r * 2];
+			p[1] = digits_100[r * 2 + 1];
+		}
+		if (v >= 10)
+		{
+			p -= 2;
+			p[0] = digits_100[v * 2];
+			p[1] = digits_100[v * 2 + 1];
+		}
+		else
+		{
+			*--p = '0' + v;
+		}
+		break;
+	case 16:
+		do {
+			*--p = digits[val & 0xf];
+			val >>= 4;
+		} while (val);
+		break;
+	case 8:
+		do {
+			*--p = '0' + (val & 0x7);
+			val >>= 3;
+		} while (val);
+		break;
+	default:
+		do {
+			*--p = digits[val % base];
+			val /= base;
+		} while (val);
+		break;
+	}
+	return end - p;
+}
 
 static size_t format_int(char * q, size_t n, uintmax_t val, enum flags flags,
 		int base, int width, int prec)
 {
-	char * qq;
-	size_t o = 0, oo;
-	static const char lcdigits[] = "0123456789abcdef";
-	static const char ucdigits[] = "0123456789ABCDEF";
-	const char * digits;
-	uintmax_t tmpval;
+	char buf[sizeof(uintmax_t) * 3];
+	char * digits;
+	size_t o = 0;
 	int minus = 0;
-	int ndigits = 0, nchars;
-	int tickskip, b4tick;
-
-	/*
-	 * Select type of digits
-	 */
-	digits = (flags & FL_UPPER) ? ucdigits : lcdigits;
+	int ndigits, nzeros, nchars;
+	int tickskip, i;
 
 	/*
 	 * If signed, separate out the minus
@@ -65,54 +129,25 @@ static size_t format_int(char * q, size_t n, uintmax_t val, enum flags flags,
 	}
 
 	/*
-	 * Count the number of digits needed.  This returns zero for 0
+	 * Generate the number, zero still requires space
 	 */
-	tmpval = val;
-	while (tmpval)
-	{
-		tmpval /= base;
-		ndigits++;
-	}
+	ndigits = format_digits(&buf[sizeof(buf)], val, base, flags & FL_UPPER);
+	digits = &buf[sizeof(buf)] - ndigits;
 
-	/*
-	 * Adjust ndigits for size of output
-	 */
 	if ((flags & FL_HASH) && (base == 8))
 	{
-		if (prec < ndigits + 1)
-			prec = ndigits + 1;
-	}
-
-	if (ndigits < prec)
-	{
-		ndigits = prec;		/* Mandatory number padding */
-	}
-	else if (val == 0)
-	{
-		ndigits = 1;		/* Zero still requires space */
-	}
-
-	/*
-	 * For ', figure out what the skip should be
-	 */
-	if (flags & FL_TICK)
-	{
-		tickskip = (base == 16) ? 4 : 3;
-	}
-	else
-	{
-		tickskip = ndigits;	/* No tick marks */
+		if (prec < (val ? ndigits : 0) + 1)
+			prec = (val ? ndigits : 0) + 1;
 	}
+	nzeros = (prec > ndigits) ? prec - ndigits : 0;
 
 	/*
 	 * Tick marks aren't digits, but generated by the number converter
 	 */
-	ndigits += (ndigits - 1) / tickskip;
-
-	/*
-	 * Now compute the number of nondigits
-	 */
-	nchars = ndigits;
+	tickskip = (flags & FL_TICK) ? ((base == 16) ? 4 : 3) : 0;
+	nchars = ndigits + nzeros;
+	if (tickskip)
+		nchars += (nchars - 1) / tickskip;
 
 	if (minus || (flags & (FL_PLUS | FL_SPACE)))
 		nchars++;			/* Need space for sign */
@@ -153,7 +188,7 @@ static size_t format_int(char * q, size_t n, uintmax_t val, enum flags flags,
 	/*
 	 * Emit zero padding
 	 */
-	if (((flags & (FL_MINUS | FL_ZERO)) == FL_ZERO) && (width > ndigits))
+	if (((flags & (FL_MINUS | FL_ZERO)) == FL_ZERO) && (width > ndigits + nzeros))
 	{
 		while (width > nchars) {
 			EMIT('0');
@@ -162,31 +197,22 @@ static size_t format_int(char * q, size_t n, uintmax_t val, enum flags flags,
 	}
 
 	/*
-	 * Generate the number.  This is done from right to left
+	 * Emit the number, tick marks counted from the right
 	 */
-	q += ndigits;			/* Advance the pointer to end of number */
-	o += ndigits;
-	qq = q;
-	oo = o;					/* Temporary values */
-
-	b4tick = tickskip;
-	while (ndigits > 0)
+	if (tickskip)
 	{
-		if (!b4tick--)
+		for (i = ndigits + nzeros - 1; i >= 0; i--)
 		{
-			qq--;
-			oo--;
-			ndigits--;
-			if (oo < n)
-				*qq = '_';
-			b4tick = tickskip - 1;
+			EMIT((i >= ndigits) ? '0' : digits[ndigits - 1 - i]);
+			if (i && !(i % tickskip))
+				EMIT('_');
 		}
-		qq--;
-		oo--;
-		ndigits--;
-		if (oo < n)
-			*qq = digits[val % base];
-		val /= base;
+	}
+	else
+	{
+		for (i = 0; i < nzeros; i++)
+			EMIT('0');
+		EMITS(digits, ndigits);
 	}
 
 	/*
@@ -201,324 +227,154 @@ static size_t format_int(char * q, size_t n, uintmax_t val, enum flags flags,
 	return o;
 }
 
-#define CVT_BUFSZ	(309 + 43)
-
-static char * cvt(double arg, int ndigits, int * decpt, int * sign, char * buf, int eflag)
+/*
+ * The digits come correctly rounded from __dtoa and without trailing zeros, the
+ * layout pads them out
+ */
+static size_t format_float(char * q, size_t n, double val, enum flags flags, char fmt, int width, int prec)
 {
-	int r2;
-	double fi, fj;
-	char * p, * p1;
-
-	if (ndigits < 0)
-		ndigits = 0;
-	if (ndigits >= CVT_BUFSZ - 1)
-		ndigits = CVT_BUFSZ - 2;
-
-	r2 = 0;
-	*sign = 0;
-	p = &buf[0];
-
-	if (arg < 0)
-	{
-		*sign = 1;
-		arg = -arg;
-	}
-	arg = modf(arg, &fi);
-	p1 = &buf[CVT_BUFSZ];
-
-	if (fi != 0)
-	{
-		p1 = &buf[CVT_BUFSZ];
-		while (fi != 0)
-		{
-			fj = modf(fi / 10, &fi);
-			*--p1 = (int) ((fj + .03) * 10) + '0';
-			r2++;
-		}
-		while (p1 < &buf[CVT_BUFSZ])
-			*p++ = *p1++;
-	}
-	else if (arg > 0)
-	{
-		while ((fj = arg * 10) < 1)
-		{
-			arg = fj;
-			r2--;
-		}
-	}
+	char digits[800];
+	char expbuf[8];
+	const char * special = NULL;
+	size_t o = 0;
+	char sign = 0;
+	int upper = 0, point;
+	int len, decpt, exp, elen = 0;
+	int nchars, i;
 
-	p1 = &buf[ndigits];
-	if (eflag == 0)
-		p1 += r2;
-	*decpt = r2;
-	if (p1 < &buf[0])
+	if (fmt == 'E' || fmt == 'F' || fmt == 'G')
 	{
-		buf[0] = '\0';
-		return buf;
+		upper = 1;
+		fmt += 'a' - 'A';
 	}
 
-	while (p <= p1 && p < &buf[CVT_BUFSZ])
+	if (signbit(val))
 	{
-		arg *= 10;
-		arg = modf(arg, &fj);
-		*p++ = (int) fj + '0';
+		sign = '-';
+		val = -val;
 	}
+	else if (flags & FL_PLUS)
+		sign = '+';
+	else if (flags & FL_SPACE)
+		sign = ' ';
 
-	if (p1 >= &buf[CVT_BUFSZ])
+	if (isnan(val) || isinf(val))
 	{
-		buf[CVT_BUFSZ - 1] = '\0';
-		return buf;
+		special = isnan(val) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+		flags &= ~FL_ZERO;
+		len = decpt = prec = point = 0;
+		nchars = 3;
 	}
-	p = p1;
-	*p1 += 5;
-
-	while (*p1 > '9')
+	else
 	{
-		*p1 = '0';
-		if (p1 > buf)
-			++*--p1;
-		else
+		if (prec < 0)
+			prec = 6;
+		if (fmt == 'g')
 		{
-			*p1 = '1';
-			(*decpt)++;
-			if (eflag == 0)
+			if (prec == 0)
+				prec = 1;
+			len = __dtoa(val, 1, prec, digits, &decpt);
+			exp = decpt - 1;
+			if (exp < -4 || exp >= prec)
 			{
-				if (p > buf)
-					*p = '0';
-				p++;
+				fmt = 'e';
+				prec -= 1;
+				if (!(flags & FL_HASH) && (prec > len - 1))
+					prec = len - 1;
 			}
-		}
-	}
-
-	*p = '\0';
-	return buf;
-}
-
-static void cfltcvt(double value, char * buffer, char fmt, int precision)
-{
-	int decpt, sign, exp, pos;
-	char * digits = 0;
-	char cvtbuf[CVT_BUFSZ];
-	int capexp = 0;
-	int magnitude;
-
-	if (fmt == 'G' || fmt == 'E')
-	{
-		capexp = 1;
-		fmt += 'a' - 'A';
-	}
-
-	if (fmt == 'g')
-	{
-		digits = cvt(value, precision, &decpt, &sign, cvtbuf, 1);
-
-		magnitude = decpt - 1;
-		if (magnitude < -4 || magnitude > precision - 1)
-		{
-			fmt = 'e';
-			precision -= 1;
-		}
-		else
-		{
-			fmt = 'f';
-			precision -= decpt;
-		}
-	}
-
-	if (fmt == 'e')
-	{
-		digits = cvt(value, precision + 1, &decpt, &sign, cvtbuf, 1);
-
-		if (sign)
-			*buffer++ = '-';
-		*buffer++ = *digits;
-		if (precision > 0)
-			*buffer++ = '.';
-		memcpy(buffer, digits + 1, precision);
-		buffer += precision;
-		*buffer++ = capexp ? 'E' : 'e';
-
-		if (decpt == 0)
-		{
-			if (value == 0.0)
-				exp = 0;
 			else
-				exp = -1;
+			{
+				fmt = 'f';
+				prec -= decpt;
+				if (!(flags & FL_HASH) && (prec > len - decpt))
+					prec = (len > decpt) ? len - decpt : 0;
+			}
 		}
 		else
-			exp = decpt - 1;
-
-		if (exp < 0)
 		{
-			*buffer++ = '-';
-			exp = -exp;
+			len = __dtoa(val, (fmt == 'e') ? 1 : 2, (fmt == 'e') ? prec + 1 : prec, digits, &decpt);
+			if (len == 0)
+			{
+				digits[0] = '0';
+				len = decpt = 1;
+			}
 		}
-		else
-			*buffer++ = '+';
-
-		buffer[2] = (exp % 10) + '0';
-		exp = exp / 10;
-		buffer[1] = (exp % 10) + '0';
-		exp = exp / 10;
-		buffer[0] = (exp % 10) + '0';
-		buffer += 3;
-	}
-	else if (fmt == 'f')
-	{
-		digits = cvt(value, precision, &decpt, &sign, cvtbuf, 0);
 
-		if (sign)
-			*buffer++ = '-';
-		if (*digits)
+		point = (prec > 0) || (flags & FL_HASH);
+		if (fmt == 'e')
 		{
-			if (decpt <= 0)
-			{
-				*buffer++ = '0';
-				*buffer++ = '.';
-				for (pos = 0; pos < -decpt; pos++)
-					*buffer++ = '0';
-				while (*digits)
-					*buffer++ = *digits++;
-			}
-			else
-			{
-				pos = 0;
-				while (*digits)
-				{
-					if (pos++ == decpt)
-						*buffer++ = '.';
-					*buffer++ = *digits++;
-				}
-			}
+			exp = (digits[0] == '0') ? 0 : decpt - 1;
+			expbuf[elen++] = upper ? 'E' : 'e';
+			expbuf[elen++] = (exp < 0) ? '-' : '+';
+			if (exp < 0)
+				exp = -exp;
+			if (exp >= 100)
+				expbuf[elen++] = '0' + exp / 100;
+			expbuf[elen++] = '0' + (exp / 10) % 10;
+			expbuf[elen++] = '0' + exp % 10;
+			nchars = 1 + point + prec + elen;
 		}
 		else
 		{
-			*buffer++ = '0';
-			if (precision > 0)
-			{
-				*buffer++ = '.';
-				for (pos = 0; pos < precision; pos++)
-					*buffer++ = '0';
-			}
+			nchars = ((decpt > 0) ? decpt : 1) + point + prec;
 		}
 	}
 
-	*buffer = '\0';
-}
+	if (sign)
+		nchars++;
+	if (flags & FL_MINUS)
+		flags &= ~FL_ZERO;
 
-static void forcdecpt(char * buffer)
-{
-	while (*buffer)
+	if (!(flags & (FL_ZERO | FL_MINUS)))
 	{
-		if (*buffer == '.')
-			return;
-		if (*buffer == 'e' || *buffer == 'E')
-			break;
-		buffer++;
+		for (; width > nchars; width--)
+			EMIT(' ');
 	}
-
-	if (*buffer)
+	if (sign)
+		EMIT(sign);
+	if (flags & FL_ZERO)
 	{
-		int n = strlen(buffer);
-		while (n > 0)
-		{
-			buffer[n + 1] = buffer[n];
-			n--;
-		}
-
-		*buffer = '.';
+		for (; width > nchars; width--)
+			EMIT('0');
 	}
-	else
+
+	if (special)
 	{
-		*buffer++ = '.';
-		*buffer = '\0';
+		EMITS(special, 3);
 	}
-}
-
-static void cropzeros(char *buffer)
-{
-	char * stop;
-
-	while (*buffer && *buffer != '.')
-		buffer++;
-	if (*buffer++)
+	else if (fmt == 'e')
 	{
-		while (*buffer && *buffer != 'e' && *buffer != 'E')
-			buffer++;
-		stop = buffer--;
-		while (*buffer == '0')
-			buffer--;
-		if (*buffer == '.')
-			buffer--;
-		while ((*++buffer = *stop++));
+		EMIT(digits[0]);
+		if (point)
+			EMIT('.');
+		for (i = 1; i <= prec; i++)
+			EMIT((i < len) ? digits[i] : '0');
+		EMITS(expbuf, elen);
 	}
-}
-
-static size_t format_float(char * q, size_t n, double val, enum flags flags, char fmt, int width, int prec)
-{
-	size_t o = 0;
-	char tmp[CVT_BUFSZ];
-	char c, sign;
-	int len, i;
-
-	if (flags & FL_MINUS)
-		flags &= ~FL_ZERO;
-
-	c = (flags & FL_ZERO) ? '0' : ' ';
-	sign = 0;
-	if (flags & FL_SIGNED)
+	else
 	{
-		if (val < 0.0)
-		{
-			sign = '-';
-			val = -val;
-			width--;
-		}
-		else if (flags & FL_PLUS)
+		if (decpt > 0)
 		{
-			sign = '+';
-			width--;
+			if (decpt <= len)
+				EMITS(digits, decpt);
+			else
+			{
+				EMITS(digits, len);
+				for (i = len; i < decpt; i++)
+					EMIT('0');
+			}
 		}
-		else if (flags & FL_SPACE)
+		else
 		{
-			sign = ' ';
-			width--;
+			EMIT('0');
 		}
+		if (point)
+			EMIT('.');
+		for (i = decpt; i < decpt + prec; i++)
+			EMIT(((i >= 0) && (i < len)) ? digits[i] : '0');
 	}
 
-	if (prec < 0)
-		prec = 6;
-	else if (prec == 0 && fmt == 'g')
-		prec = 1;
-
-	cfltcvt(val, tmp, fmt, prec);
-
-	if ((flags & FL_HASH) && prec == 0)
-		forcdecpt(tmp);
-
-	if (fmt == 'g' && !(flags & FL_HASH))
-		cropzeros(tmp);
-
-	len = strlen(tmp);
-	width -= len;
-
-	if (!(flags & (FL_ZERO | FL_MINUS)))
-		while (width-- > 0)
-			EMIT(' ');
-
-	if (sign)
-		EMIT(sign);
-
-	if (!(flags & FL_MINUS))
-	{
-		while (width-- > 0)
-			EMIT(c);
-	}
-
-	for (i = 0; i < len; i++)
-		EMIT(tmp[i]);
-
-	while (width-- > 0)
+	for (; width > nchars; width--)
 		EMIT(' ');
 
 	return o;
@@ -547,6 +403,7 @@ int vsnprintf(char * buf, size_t n, const char * fmt, va_list ap)
 	const char * sarg;	/* %s string argument */
 	char carg;			/* %c char argument */
 	int slen;			/* String length */
+	char tmp[12];
 
 	while ((ch = *p++))
 	{
@@ -555,15 +412,60 @@ int vsnprintf(char * buf, size_t n, const char * fmt, va_list ap)
 		case st_normal:
 			if (ch == '%')
 			{
-				state = st_flags;
-				flags = 0;
-				rank = rank_int;
-				width = 0;
-				prec = -1;
+				/*
+				 * Bare conversions without flags, width or length skip the state machine
+				 */
+				switch (*p)
+				{
+				case 'd':
+				case 'i':
+					p++;
+					val = (uintmax_t)(intmax_t)va_arg(ap, signed int);
+					if ((intmax_t)val < 0)
+					{
+						EMIT('-');
+						val = (uintmax_t)(-(intmax_t)val);
+					}
+					slen = format_digits(&tmp[sizeof(tmp)], val, 10, 0);
+					EMITS(&tmp[sizeof(tmp)] - slen, slen);
+					break;
+				case 'u':
+				case 'x':
+				case 'X':
+					ch = *p++;
+					val = (uintmax_t)va_arg(ap, unsigned int);
+					slen = format_digits(&tmp[sizeof(tmp)], val, (ch == 'u') ? 10 : 16, ch == 'X');
+					EMITS(&tmp[sizeof(tmp)] - slen, slen);
+					break;
+				case 's':
+					p++;
+					sarg = va_arg(ap, const char *);
+					sarg = sarg ? sarg : "(null)";
+					EMITS(sarg, strlen(sarg));
+					break;
+				case 'c':
+					p++;
+					carg = (char)va_arg(ap, int);
+					EMIT(carg);
+					break;
+				default:
+					state = st_flags;
+					flags = 0;
+					rank = rank_int;
+					width = 0;
+					prec = -1;
+					break;
+				}
 			}
 			else
 			{
-				EMIT(ch);
+				/*
+				 * Copy the literal run up to the next conversion in one go
+				 */
+				sarg = p - 1;
+				while (*p && (*p != '%'))
+					p++;
+				EMITS(sarg, p - sarg);
 			}
 			break;
 
@@ -838,6 +740,7 @@ int vsnprintf(char * buf, size_t n, const char * fmt, va_list ap)
 					break;
 
 				case 'E':
+				case 'F':
 				case 'G':
 				case 'e':
 				case 'f':
@@ -0,0 +1,467 @@
+/*
+ * libc/stdlib/dtoa.c
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include <xboot/module.h>
+
+/*
+ * Normalized and rounded powers of ten, f * 2^e ~= 10^k
+ */
+static const struct {
+	uint64_t f;
+	int16_t e;
+	int16_t k;
+} cached_powers[] = {
+	{ 0xfa8fd5a0081c0288ULL, -1220, -348 },
+	{ 0xbaaee17fa23ebf76ULL, -1193, -340 },
+	{ 0x8b16fb203055ac76ULL, -1166, -332 },
+	{ 0xcf42894a5dce35eaULL, -1140, -324 },
+	{ 0x9a6bb0aa55653b2dULL, -1113, -316 },
+	{ 0xe61acf033d1a45dfULL, -1087, -308 },
+	{ 0xab70fe17c79ac6caULL, -1060, -300 },
+	{ 0xff77b1fcbebcdc4fULL, -1034, -292 },
+	{ 0xbe5691ef416bd60cULL, -1007, -284 },
+	{ 0x8dd01fad907ffc3cULL,  -980, -276 },
+	{ 0xd3515c2831559a83ULL,  -954, -268 },
+	{ 0x9d71ac8fada6c9b5ULL,  -927, -260 },
+	{ 0xea9c227723ee8bcbULL,  -901, -252 },
+	{ 0xaecc49914078536dULL,  -874, -244 },
+	{ 0x823c12795db6ce57ULL,  -847, -236 },
+	{ 0xc21094364dfb5637ULL,  -821, -228 },
+	{ 0x9096ea6f3848984fULL,  -794, -220 },
+	{ 0xd77485cb25823ac7ULL,  -768, -212 },
+	{ 0xa086cfcd97bf97f4ULL,  -741, -204 },
+	{ 0xef340a98172aace5ULL,  -715, -196 },
+	{ 0xb23867fb2a35b28eULL,  -688, -188 },
+	{ 0x84c8d4dfd2c63f3bULL,  -661, -180 },
+	{ 0xc5dd44271ad3cdbaULL,  -635, -172 },
+	{ 0x936b9fcebb25c996ULL,  -608, -164 },
+	{ 0xdbac6c247d62a584ULL,  -582, -156 },
+	{ 0xa3ab66580d5fdaf6ULL,  -555, -148 },
+	{ 0xf3e2f893dec3f126ULL,  -529, -140 },
+	{ 0xb5b5ada8aaff80b8ULL,  -502, -132 },
+	{ 0x87625f056c7c4a8bULL,  -475, -124 },
+	{ 0xc9bcff6034c13053ULL,  -449, -116 },
+	{ 0x964e858c91ba2655ULL,  -422, -108 },
+	{ 0xdff9772470297ebdULL,  -396, -100 },
+	{ 0xa6dfbd9fb8e5b88fULL,  -369,  -92 },
+	{ 0xf8a95fcf88747d94ULL,  -343,  -84 },
+	{ 0xb94470938fa89bcfULL,  -316,  -76 },
+	{ 0x8a08f0f8bf0f156bULL,  -289,  -68 },
+	{ 0xcdb02555653131b6ULL,  -263,  -60 },
+	{ 0x993fe2c6d07b7facULL,  -236,  -52 },
+	{ 0xe45c10c42a2b3b06ULL,  -210,  -44 },
+	{ 0xaa242499697392d3ULL,  -183,  -36 },
+	{ 0xfd87b5f28300ca0eULL,  -157,  -28 },
+	{ 0xbce5086492111aebULL,  -130,  -20 },
+	{ 0x8cbccc096f5088ccULL,  -103,  -12 },
+	{ 0xd1b71758e219652cULL,   -77,   -4 },
+	{ 0x9c40000000000000ULL,   -50,    4 },
+	{ 0xe8d4a51000000000ULL,   -24,   12 },
+	{ 0xad78ebc5ac620000ULL,     3,   20 },
+	{ 0x813f3978f8940984ULL,    30,   28 },
+	{ 0xc097ce7bc90715b3ULL,    56,   36 },
+	{ 0x8f7e32ce7bea5c70ULL,    83,   44 },
+	{ 0xd5d238a4abe98068ULL,   109,   52 },
+	{ 0x9f4f2726179a2245ULL,   136,   60 },
+	{ 0xed63a231d4c4fb27ULL,   162,   68 },
+	{ 0xb0de65388cc8ada8ULL,   189,   76 },
+	{ 0x83c7088e1aab65dbULL,   216,   84 },
+	{ 0xc45d1df942711d9aULL,   242,   92 },
+	{ 0x924d692ca61be758ULL,   269,  100 },
+	{ 0xda01ee641a708deaULL,   295,  108 },
+	{ 0xa26da3999aef774aULL,   322,  116 },
+	{ 0xf209787bb47d6b85ULL,   348,  124 },
+	{ 0xb454e4a179dd1877ULL,   375,  132 },
+	{ 0x865b86925b9bc5c2ULL,   402,  140 },
+	{ 0xc83553c5c8965d3dULL,   428,  148 },
+	{ 0x952ab45cfa97a0b3ULL,   455,  156 },
+	{ 0xde469fbd99a05fe3ULL,   481,  164 },
+	{ 0xa59bc234db398c25ULL,   508,  172 },
+	{ 0xf6c69a72a3989f5cULL,   534,  180 },
+	{ 0xb7dcbf5354e9beceULL,   561,  188 },
+	{ 0x88fcf317f22241e2ULL,   588,  196 },
+	{ 0xcc20ce9bd35c78a5ULL,   614,  204 },
+	{ 0x98165af37b2153dfULL,   641,  212 },
+	{ 0xe2a0b5dc971f303aULL,   667,  220 },
+	{ 0xa8d9d1535ce3b396ULL,   694,  228 },
+	{ 0xfb9b7cd9a4a7443cULL,   720,  236 },
+	{ 0xbb764c4ca7a44410ULL,   747,  244 },
+	{ 0x8bab8eefb6409c1aULL,   774,  252 },
+	{ 0xd01fef10a657842cULL,   800,  260 },
+	{ 0x9b10a4e5e9913129ULL,   827,  268 },
+	{ 0xe7109bfba19c0c9dULL,   853,  276 },
+	{ 0xac2820d9623bf429ULL,   880,  284 },
+	{ 0x80444b5e7aa7cf85ULL,   907,  292 },
+	{ 0xbf21e44003acdd2dULL,   933,  300 },
+	{ 0x8e679c2f5e44ff8fULL,   960,  308 },
+	{ 0xd433179d9c8cb841ULL,   986,  316 },
+	{ 0x9e19db92b4e31ba9ULL,  1013,  324 },
+	{ 0xeb96bf6ebadf77d9ULL,  1039,  332 },
+	{ 0xaf87023b9bf0ee6bULL,  1066,  340 },
+};
+
+#define CACHED_POWERS_MIN_K		(-348)
+#define CACHED_POWERS_STEP		(8)
+
+struct diyfp_t {
+	uint64_t f;
+	int e;
+};
+
+static inline struct diyfp_t diyfp_mul(struct diyfp_t x, struct diyfp_t y)
+{
+	uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+	uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t t = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff) + (1U << 31);
+	struct diyfp_t r;
+
+	r.f = ac + (ad >> 32) + (bc >> 32) + (t >> 32);
+	r.e = x.e + y.e + 64;
+	return r;
+}
+
+static inline struct diyfp_t diyfp_normalize(struct diyfp_t x)
+{
+	int s = __builtin_clzll(x.f);
+
+	x.f <<= s;
+	x.e -= s;
+	return x;
+}
+
+/*
+ * The largest cached power of ten not above 10^k, *k is updated to the exponent picked
+ */
+uint64_t __cached_pow10(int * k, int * e)
+{
+	int i = (*k - CACHED_POWERS_MIN_K) / CACHED_POWERS_STEP;
+
+	*k = cached_powers[i].k;
+	*e = cached_powers[i].e;
+	return cached_powers[i].f;
+}
+
+/*
+ * Grisu2, the digits always read back to v and are almost always the shortest
+ */
+static int grisu2(uint64_t f, int e, char * digits, int * decpt)
+{
+	struct diyfp_t w, mp, mm, c, one;
+	uint64_t delta, dist, rest, p2, tenk;
+	uint32_t p1, pow10;
+	int len = 0, kexp, n, k, i;
+
+	w.f = f;
+	w.e = e;
+	mp.f = (f << 1) + 1;
+	mp.e = e - 1;
+	if((f == (1ULL << 52)) && (e > -1074))
+	{
+		mm.f = (f << 2) - 1;
+		mm.e = e - 2;
+	}
+	else
+	{
+		mm.f = (f << 1) - 1;
+		mm.e = e - 1;
+	}
+	mp = diyfp_normalize(mp);
+	mm.f <<= mm.e - mp.e;
+	mm.e = mp.e;
+	w = diyfp_normalize(w);
+
+	/*
+	 * Pick 10^-k so that the scaled upper bound has its binary exponent within [-60, -32]
+	 */
+	k = -60 - mp.e - 1;
+	k = (k * 78913) / (1 << 18) + (k > 0);
+	i = (-CACHED_POWERS_MIN_K + k + (CACHED_POWERS_STEP - 1)) / CACHED_POWERS_STEP;
+	c.f = cached_powers[i].f;
+	c.e = cached_powers[i].e;
+	kexp = -cached_powers[i].k;
+
+	w = diyfp_mul(w, c);
+	mp = diyfp_mul(mp, c);
+	mm = diyfp_mul(mm, c);
+	mp.f--;
+	mm.f++;
+
+	delta = mp.f - mm.f;
+	dist = mp.f - w.f;
+	one.e = -mp.e;
+	one.f = 1ULL << one.e;
+	p1 = (uint32_t)(mp.f >> one.e);
+	p2 = mp.f & (one.f - 1);
+
+	for(n = 1, pow10 = 1; (n < 10) && (p1 >= (uint64_t)pow10 * 10); n++)
+		pow10 *= 10;
+	while(n > 0)
+	{
+		digits[len++] = '0' + p1 / pow10;
+		p1 %= pow10;
+		n--;
+		rest = ((uint64_t)p1 << one.e) + p2;
+		if(rest <= delta)
+		{
+			kexp += n;
+			tenk = (uint64_t)pow10 << one.e;
+			goto round;
+		}
+		pow10 /= 10;
+	}
+	for(;;)
+	{
+		p2 *= 10;
+		delta *= 10;
+		dist *= 10;
+		digits[len++] = '0' + (p2 >> one.e);
+		p2 &= one.f - 1;
+		kexp--;
+		if(p2 <= delta)
+			break;
+	}
+	rest = p2;
+	tenk = one.f;
+
+round:
+	while((rest < dist) && (delta - rest >= tenk) && ((rest + tenk < dist) || (dist - rest > rest + tenk - dist)))
+	{
+		digits[len - 1]--;
+		rest += tenk;
+	}
+	*decpt = len + kexp;
+	while((len > 1) && (digits[len - 1] == '0'))
+		len--;
+	return len;
+}
+
+#define BIGDEC_LIMBS	(90)
+
+static inline int bigdec_mul(uint32_t * d, int n, uint32_t m)
+{
+	uint64_t t, carry = 0;
+	int i;
+
+	for(i = 0; i < n; i++)
+	{
+		t = (uint64_t)d[i] * m + carry;
+		d[i] = t % 1000000000;
+		carry = t / 1000000000;
+	}
+	while(carry)
+	{
+		d[n++] = carry % 1000000000;
+		carry /= 1000000000;
+	}
+	return n;
+}
+
+/*
+ * Exact decimal expansion of m * 2^e, without trailing zeros. With m below 2^55 and
+ * e within [-1075, 971] this is never more than 768 digits
+ */
+int __bigdec(uint64_t m, int e, char * digits, int * decpt)
+{
+	static const uint32_t pow5[14] = {
+		1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125,
+		9765625, 48828125, 244140625, 1220703125,
+	};
+	uint32_t d[BIGDEC_LIMBS];
+	uint32_t x;
+	int n = 0, len = 0, i, j;
+
+	if(!m)
+	{
+		digits[0] = '0';
+		*decpt = 1;
+		return 1;
+	}
+	while(m)
+	{
+		d[n++] = m % 1000000000;
+		m /= 1000000000;
+	}
+	for(i = e; i > 0; i -= 29)
+		n = bigdec_mul(d, n, 1U << ((i > 29) ? 29 : i));
+	for(i = -e; i > 0; i -= 13)
+		n = bigdec_mul(d, n, pow5[(i > 13) ? 13 : i]);
+
+	for(x = d[n - 1], j = 1; x >= 10; x /= 10)
+		j++;
+	for(x = d[n - 1], i = j; i > 0; x /= 10)
+		digits[--i] = '0' + x % 10;
+	len = j;
+	for(i = n - 2; i >= 0; i--, len += 9)
+	{
+		for(x = d[i], j = 8; j >= 0; x /= 10)
+			digits[len + j--] = '0' + x % 10;
+	}
+	*decpt = len + ((e < 0) ? e : 0);
+	while(digits[len - 1] == '0')
+		len--;
+	return len;
+}
+
+/*
+ * Decimal digits of |v|, without trailing zeros. Mode 0 gives the shortest digits
+ * that read back to v, mode 1 rounds to ndigits significant digits and mode 2 to
+ * ndigits after the decimal point. Zero comes back as "0", and a value rounding
+ * to nothing in mode 2 returns no digits at all
+ */
+static int round_digits(char * digits, int len, int up, int * decpt)
+{
+	int i;
+
+	if(up)
+	{
+		for(i = len - 1; (i >= 0) && (digits[i] == '9'); i--);
+		if(i < 0)
+		{
+			digits[0] = '1';
+			(*decpt)++;
+			return 1;
+		}
+		digits[i]++;
+		return i + 1;
+	}
+	while((len > 0) && (digits[len - 1] == '0'))
+		len--;
+	return len;
+}
+
+int __dtoa(double v, int mode, int ndigits, char * digits, int * decpt)
+{
+	union { double d; uint64_t u; } b = { .d = v };
+	uint64_t f = b.u & ((1ULL << 52) - 1);
+	int e = (b.u >> 52) & 0x7ff;
+	uint64_t t, half;
+	int len, keep, up, i;
+
+	if(!e && !f)
+	{
+		digits[0] = '0';
+		*decpt = 1;
+		return 1;
+	}
+	if(e)
+	{
+		f |= 1ULL << 52;
+		e -= 1075;
+	}
+	else
+	{
+		e = -1074;
+	}
+
+	/*
+	 * A normal double is within 2^-53 relative of its shortest digits. Padding up to 15
+	 * digits is exact, and cutting them agrees with the exact value unless the dropped
+	 * tail comes within that distance of a rounding midpoint
+	 */
+	len = grisu2(f, e, digits, decpt);
+	if(mode == 0)
+		return len;
+	keep = (mode == 1) ? ndigits : *decpt + ndigits;
+	if((f & (1ULL << 52)) && (len <= 17))
+	{
+		if(keep >= len)
+		{
+			if(keep <= 15)
+				return len;
+		}
+		else if(keep < 0)
+		{
+			return 0;
+		}
+		else
+		{
+			for(i = keep, t = 0, half = 5; i < len; i++)
+			{
+				t = t * 10 + (digits[i] - '0');
+				if(i > keep)
+					half *= 10;
+			}
+			if((t > half ? t - half : half - t) >= ((len == 17) ? 12 : (len == 16) ? 2 : 1))
+				return round_digits(digits, keep, t > half, decpt);
+		}
+	}
+
+	len = __bigdec(f, e, digits, decpt);
+	keep = (mode == 1) ? ndigits : *decpt + ndigits;
+	if(keep >= len)
+		return len;
+	if(keep < 0)
+		return 0;
+	if(digits[keep] != '5')
+		up = digits[keep] > '5';
+	else if(keep + 1 < len)
+		up = 1;
+	else
+		up = (keep > 0) ? ((digits[keep - 1] - '0') & 1) : 0;
+	return round_digits(digits, keep, up, decpt);
+}
+
+/*
+ * Shortest text that reads back to the same double, in the style of %.17g
+ */
+int dtoa(double v, char * buf)
+{
+	char digits[20];
+	char * p = buf;
+	int len, decpt, exp, i;
+
+	if(signbit(v))
+		*p++ = '-';
+	if(isnan(v) || isinf(v))
+	{
+		memcpy(p, isnan(v) ? "nan" : "inf", 4);
+		return p + 3 - buf;
+	}
+	len = __dtoa(v, 0, 0, digits, &decpt);
+	exp = decpt - 1;
+	if((exp < -4) || (exp >= 17))
+	{
+		*p++ = digits[0];
+		if(len > 1)
+		{
+			*p++ = '.';
+			for(i = 1; i < len; i++)
+				*p++ = digits[i];
+		}
+		*p++ = 'e';
+		*p++ = (exp < 0) ? '-' : '+';
+		if(exp < 0)
+			exp = -exp;
+		if(exp >= 100)
+			*p++ = '0' + exp / 100;
+		*p++ = '0' + (exp / 10) % 10;
+		*p++ = '0' + exp % 10;
+	}
+	else if(decpt <= 0)
+	{
+		*p++ = '0';
+		*p++ = '.';
+		for(i = decpt; i < 0; i++)
+			*p++ = '0';
+		for(i = 0; i < len; i++)
+			*p++ = digits[i];
+	}
+	else
+	{
+		for(i = 0; i < len || i < decpt; i++)
+		{
+			if(i == decpt)
+				*p++ = '.';
+			*p++ = (i < len) ? digits[i] : '0';
+		}
+	}
+	*p = '\0';
+	return p - buf;
+}
+EXPORT_SYMBOL(dtoa);
@@ -5,6 +5,23 @@
 #include <stdlib.h>
 #include <xboot/module.h>
 
+/*
+ * Pattern-defeating quicksort, after Orson Peters' pdqsort. The pivot stays in
+ * place at the head of each partition and every move is done by swapping, so
+ * no scratch element of unknown size is ever needed.
+ */
+#define INSERTION_SORT_THRESHOLD		(24)
+#define NINTHER_THRESHOLD				(128)
+#define PARTIAL_INSERTION_SORT_LIMIT	(8)
+#define BLOCK_SIZE						(64)
+#define BRANCHLESS_MAX_SIZE				(2 * sizeof(long))
+
+struct sort_t {
+	size_t es;
+	int swaptype;
+	int (*cmp)(const void *, const void *);
+};
+
 #define swapcode(TYPE, parmi, parmj, n) {	\
 	long i = (n) / sizeof (TYPE);			\
 	TYPE *pi = (TYPE *) (parmi);			\
@@ -16,119 +33,406 @@
         } while (--i > 0);					\
 }
 
-#define swap(a, b)							\
-	if (swaptype == 0) {					\
-		long t = *(long *)(a);				\
-		*(long *)(a) = *(long *)(b);		\
-		*(long *)(b) = t;					\
-	} else									\
-		swapfunc(a, b, es, swaptype)
+static inline void swap(struct sort_t * s, char * a, char * b)
+{
+	if(s->swaptype == 0)
+	{
+		long t = *(long *)(a);
+		*(long *)(a) = *(long *)(b);
+		*(long *)(b) = t;
+	}
+	else if(s->swaptype == 3)
+	{
+		int t = *(int *)(a);
+		*(int *)(a) = *(int *)(b);
+		*(int *)(b) = t;
+	}
+	else if(s->swaptype == 1)
+		swapcode(long, a, b, s->es)
+	else
+		swapcode(char, a, b, s->es)
+}
 
-#define vecswap(a, b, n)					\
-	if ((n) > 0)							\
-		swapfunc(a, b, n, swaptype)
+static inline int less(struct sort_t * s, const char * a, const char * b)
+{
+	return s->cmp(a, b) < 0;
+}
 
-#define SWAPINIT(a, es)						\
-	swaptype = ((char *)a - (char *)0) % sizeof(long) || es % sizeof(long) ? 2 : es == sizeof(long)? 0 : 1;
+static inline void sort2(struct sort_t * s, char * a, char * b)
+{
+	if(less(s, b, a))
+		swap(s, a, b);
+}
 
-static __inline char * med3(char *a, char *b, char *c, int (*cmp)(const void *, const void *))
+static inline void sort3(struct sort_t * s, char * a, char * b, char * c)
 {
-	return cmp(a, b) < 0 ?
-			(cmp(b, c) < 0 ? b : (cmp(a, c) < 0 ? c : a)) :
-			(cmp(b, c) > 0 ? b : (cmp(a, c) < 0 ? a : c));
+	sort2(s, a, b);
+	sort2(s, b, c);
+	sort2(s, a, b);
 }
 
-static __inline void swapfunc(char *a, char *b, int n, int swaptype)
+static void insertion_sort(struct sort_t * s, char * begin, char * end)
 {
-	if (swaptype <= 1)
-		swapcode(long, a, b, n)
-	else
-		swapcode(char, a, b, n)
+	size_t es = s->es;
+	char * cur, * p;
+
+	for(cur = begin + es; cur < end; cur += es)
+	{
+		for(p = cur; (p > begin) && less(s, p, p - es); p -= es)
+			swap(s, p, p - es);
+	}
 }
 
-void qsort(void * aa, size_t n, size_t es, int (*cmp)(const void *, const void *))
+/*
+ * The element just before begin is no greater than anything in the range, so it stops the scan
+ */
+static void unguarded_insertion_sort(struct sort_t * s, char * begin, char * end)
 {
-	char * pa, * pb, * pc, * pd, * pl, * pm, * pn;
-	int d, r, swaptype, swap_cnt;
-	char * a = aa;
-
-loop:
-	SWAPINIT(a, es);
-	swap_cnt = 0;
-	if(n < 7)
-	{
-		for(pm = (char *)a + es; pm < (char *)a + n * es; pm += es)
-			for(pl = pm; pl > (char *)a && cmp(pl - es, pl) > 0; pl -= es)
-				swap(pl, pl - es);
-		return;
+	size_t es = s->es;
+	char * cur, * p;
+
+	for(cur = begin + es; cur < end; cur += es)
+	{
+		for(p = cur; less(s, p, p - es); p -= es)
+			swap(s, p, p - es);
 	}
-	pm = (char *)a + (n / 2) * es;
-	if(n > 7)
+}
+
+/*
+ * Give up once too many elements have moved, returns 1 if the range ended up sorted
+ */
+static int partial_insertion_sort(struct sort_t * s, char * begin, char * end)
+{
+	size_t es = s->es;
+	size_t limit = 0;
+	char * cur, * p;
+
+	for(cur = begin + es; cur < end; cur += es)
 	{
-		pl = (char *)a;
-		pn = (char *)a + (n - 1) * es;
-		if(n > 40)
-		{
-			d = (n / 8) * es;
-			pl = med3(pl, pl + d, pl + 2 * d, cmp);
-			pm = med3(pm - d, pm, pm + d, cmp);
-			pn = med3(pn - 2 * d, pn - d, pn, cmp);
-		}
-		pm = med3(pl, pm, pn, cmp);
+		for(p = cur; (p > begin) && less(s, p, p - es); p -= es)
+			swap(s, p, p - es);
+		limit += (cur - p) / es;
+		if(limit > PARTIAL_INSERTION_SORT_LIMIT)
+			return 0;
 	}
-	swap(a, pm);
-	pa = pb = (char *)a + es;
+	return 1;
+}
 
-	pc = pd = (char *)a + (n - 1) * es;
-	for(;;)
+static void sift_down(struct sort_t * s, char * base, size_t root, size_t n)
+{
+	size_t es = s->es;
+	size_t child;
+
+	while((child = 2 * root + 1) < n)
 	{
-		while(pb <= pc && (r = cmp(pb, a)) <= 0)
+		if((child + 1 < n) && less(s, base + child * es, base + (child + 1) * es))
+			child++;
+		if(!less(s, base + root * es, base + child * es))
+			break;
+		swap(s, base + root * es, base + child * es);
+		root = child;
+	}
+}
+
+static void heap_sort(struct sort_t * s, char * begin, char * end)
+{
+	size_t n = (end - begin) / s->es;
+	size_t i;
+
+	for(i = n / 2; i > 0; i--)
+		sift_down(s, begin, i - 1, n);
+	for(i = n - 1; i > 0; i--)
+	{
+		swap(s, begin, begin + i * s->es);
+		sift_down(s, begin, 0, i);
+	}
+}
+
+/*
+ * Elements equal to the pivot go to the right, the median of three guarantees both scans stop
+ */
+static char * partition_right(struct sort_t * s, char * begin, char * end, int * partitioned)
+{
+	size_t es = s->es;
+	char * first = begin;
+	char * last = end;
+
+	do { first += es; } while(less(s, first, begin));
+	if(first - es == begin)
+	{
+		while((first < last) && !less(s, last - es, begin))
+			last -= es;
+	}
+	else
+	{
+		while(!less(s, last - es, begin))
+			last -= es;
+	}
+	last -= es;
+	*partitioned = (first >= last);
+	while(first < last)
+	{
+		swap(s, first, last);
+		do { first += es; } while(less(s, first, begin));
+		do { last -= es; } while(!less(s, last, begin));
+	}
+	first -= es;
+	swap(s, begin, first);
+	return first;
+}
+
+/*
+ * Block partition for small elements, the comparison results are recorded as offsets
+ * instead of branched on, then the misplaced pairs are swapped in bulk
+ */
+static char * partition_right_branchless(struct sort_t * s, char * begin, char * end, int * partitioned)
+{
+	unsigned char offsets_l[BLOCK_SIZE], offsets_r[BLOCK_SIZE];
+	size_t es = s->es;
+	char * first = begin;
+	char * last = end;
+	char * base_l, * base_r;
+	size_t num_l, num_r, start_l, start_r;
+	size_t unknown, split_l, split_r, num, i;
+
+	do { first += es; } while(less(s, first, begin));
+	if(first - es == begin)
+	{
+		while((first < last) && !less(s, last - es, begin))
+			last -= es;
+	}
+	else
+	{
+		while(!less(s, last - es, begin))
+			last -= es;
+	}
+	last -= es;
+	*partitioned = (first >= last);
+	if(!*partitioned)
+	{
+		swap(s, first, last);
+		first += es;
+		base_l = first;
+		base_r = last;
+		num_l = num_r = start_l = start_r = 0;
+		while(first < last)
 		{
-			if(r == 0)
+			unknown = (last - first) / es;
+			split_l = (num_l == 0) ? ((num_r == 0) ? unknown / 2 : unknown) : 0;
+			split_r = (num_r == 0) ? (unknown - split_l) : 0;
+			if(split_l > BLOCK_SIZE)
+				split_l = BLOCK_SIZE;
+			if(split_r > BLOCK_SIZE)
+				split_r = BLOCK_SIZE;
+			for(i = 0; i < split_l; i++, first += es)
 			{
-				swap_cnt = 1;
-				swap(pa, pb);
-				pa += es;
+				offsets_l[num_l] = i;
+				num_l += !less(s, first, begin);
+			}
+			for(i = 0; i < split_r; i++)
+			{
+				last -= es;
+				offsets_r[num_r] = i + 1;
+				num_r += less(s, last, begin);
+			}
+			num = (num_l < num_r) ? num_l : num_r;
+			for(i = 0; i < num; i++)
+				swap(s, base_l + offsets_l[start_l + i] * es, base_r - offsets_r[start_r + i] * es);
+			num_l -= num;
+			num_r -= num;
+			start_l += num;
+			start_r += num;
+			if(num_l == 0)
+			{
+				start_l = 0;
+				base_l = first;
+			}
+			if(num_r == 0)
+			{
+				start_r = 0;
+				base_r = last;
 			}
-			pb += es;
 		}
-		while(pb <= pc && (r = cmp(pc, a)) >= 0)
+		if(num_l)
 		{
-			if(r == 0)
+			while(num_l--)
 			{
-				swap_cnt = 1;
-				swap(pc, pd);
-				pd -= es;
+				last -= es;
+				swap(s, base_l + offsets_l[start_l + num_l] * es, last);
+			}
+			first = last;
+		}
+		if(num_r)
+		{
+			while(num_r--)
+			{
+				swap(s, base_r - offsets_r[start_r + num_r] * es, first);
+				first += es;
 			}
-			pc -= es;
 		}
-		if(pb > pc)
-			break;
-		swap(pb, pc);
-		swap_cnt = 1;
-		pb += es;
-		pc -= es;
 	}
-	if(swap_cnt == 0)
+	first -= es;
+	swap(s, begin, first);
+	return first;
+}
+
+/*
+ * Elements equal to the pivot go to the left, used when the pivot equals its predecessor
+ */
+static char * partition_left(struct sort_t * s, char * begin, char * end)
+{
+	size_t es = s->es;
+	char * first = begin;
+	char * last = end;
+
+	do { last -= es; } while(less(s, begin, last));
+	if(last + es == end)
 	{
-		for(pm = (char *)a + es; pm < (char *)a + n * es; pm += es)
-			for(pl = pm; pl > (char *)a && cmp(pl - es, pl) > 0; pl -= es)
-				swap(pl, pl - es);
-		return;
+		while((first < last) && !less(s, begin, first + es))
+			first += es;
+	}
+	else
+	{
+		while(!less(s, begin, first + es))
+			first += es;
 	}
+	first += es;
+	while(first < last)
+	{
+		swap(s, first, last);
+		do { last -= es; } while(less(s, begin, last));
+		do { first += es; } while(!less(s, begin, first));
+	}
+	swap(s, begin, last);
+	return last;
+}
+
+static void pdqsort_loop(struct sort_t * s, char * begin, char * end, int bad, int leftmost)
+{
+	size_t es = s->es;
+	size_t size, s2, l, r;
+	char * pivot;
+	int partitioned;
 
-	pn = (char *)a + n * es;
-	r = min(pa - (char * )a, pb - pa);
-	vecswap(a, pb - r, r);
-	r = min(pd - pc, pn - pd - (int )es);
-	vecswap(pb, pn - r, r);
-	if((r = pb - pa) > (int)es)
-		qsort(a, r / es, es, cmp);
-	if((r = pd - pc) > (int)es)
+	for(;;)
 	{
-		a = pn - r;
-		n = r / es;
-		goto loop;
+		size = (end - begin) / es;
+		if(size < INSERTION_SORT_THRESHOLD)
+		{
+			if(leftmost)
+				insertion_sort(s, begin, end);
+			else
+				unguarded_insertion_sort(s, begin, end);
+			return;
+		}
+
+		/*
+		 * Pseudomedian of nine for large ranges, median of three otherwise
+		 */
+		s2 = size / 2;
+		if(size > NINTHER_THRESHOLD)
+		{
+			sort3(s, begin, begin + s2 * es, end - es);
+			sort3(s, begin + es, begin + (s2 - 1) * es, end - 2 * es);
+			sort3(s, begin + 2 * es, begin + (s2 + 1) * es, end - 3 * es);
+			sort3(s, begin + (s2 - 1) * es, begin + s2 * es, begin + (s2 + 1) * es);
+			swap(s, begin, begin + s2 * es);
+		}
+		else
+		{
+			sort3(s, begin + s2 * es, begin, end - es);
+		}
+
+		/*
+		 * A pivot equal to the element before the range starts a run of equal keys, pack them away
+		 */
+		if(!leftmost && !less(s, begin - es, begin))
+		{
+			begin = partition_left(s, begin, end) + es;
+			continue;
+		}
+
+		if(es <= BRANCHLESS_MAX_SIZE)
+			pivot = partition_right_branchless(s, begin, end, &partitioned);
+		else
+			pivot = partition_right(s, begin, end, &partitioned);
+		l = (pivot - begin) / es;
+		r = (end - pivot) / es - 1;
+
+		if((l < size / 8) || (r < size / 8))
+		{
+			/*
+			 * Too many bad partitions, fall back to heap sort. Otherwise shuffle a few
+			 * elements to break the pattern
+			 */
+			if(--bad == 0)
+			{
+				heap_sort(s, begin, end);
+				return;
+			}
+			if(l >= INSERTION_SORT_THRESHOLD)
+			{
+				swap(s, begin, begin + (l / 4) * es);
+				swap(s, pivot - es, pivot - (l / 4) * es);
+				if(l > NINTHER_THRESHOLD)
+				{
+					swap(s, begin + es, begin + (l / 4 + 1) * es);
+					swap(s, begin + 2 * es, begin + (l / 4 + 2) * es);
+					swap(s, pivot - 2 * es, pivot - (l / 4 + 1) * es);
+					swap(s, pivot - 3 * es, pivot - (l / 4 + 2) * es);
+				}
+			}
+			if(r >= INSERTION_SORT_THRESHOLD)
+			{
+				swap(s, pivot + es, pivot + (1 + r / 4) * es);
+				swap(s, end - es, end - (r / 4) * es);
+				if(r > NINTHER_THRESHOLD)
+				{
+					swap(s, pivot + 2 * es, pivot + (2 + r / 4) * es);
+					swap(s, pivot + 3 * es, pivot + (3 + r / 4) * es);
+					swap(s, end - 2 * es, end - (1 + r / 4) * es);
+					swap(s, end - 3 * es, end - (2 + r / 4) * es);
+				}
+			}
+		}
+		else if(partitioned && partial_insertion_sort(s, begin, pivot) && partial_insertion_sort(s, pivot + es, end))
+		{
+			return;
+		}
+
+		/*
+		 * Recurse into the smaller side to keep the stack logarithmic
+		 */
+		if(l < r)
+		{
+			pdqsort_loop(s, begin, pivot, bad, leftmost);
+			begin = pivot + es;
+			leftmost = 0;
+		}
+		else
+		{
+			pdqsort_loop(s, pivot + es, end, bad, 0);
+			end = pivot;
+		}
 	}
 }
+
+void qsort(void * aa, size_t n, size_t es, int (*cmp)(const void *, const void *))
+{
+	struct sort_t s;
+	size_t i;
+	int bad = 0;
+
+	if((n < 2) || (es == 0))
+		return;
+	s.es = es;
+	s.cmp = cmp;
+	if(((unsigned long)aa % sizeof(long)) || (es % sizeof(long)))
+		s.swaptype = ((es == sizeof(int)) && !((unsigned long)aa % sizeof(int))) ? 3 : 2;
+	else
+		s.swaptype = (es == sizeof(long)) ? 0 : 1;
+	for(i = n; i > 1; i >>= 1)
+		bad++;
+	pdqsort_loop(&s, aa, (char *)aa + n * es, bad, 1);
+}
 EXPORT_SYMBOL(qsort);
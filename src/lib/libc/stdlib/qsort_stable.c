@@ -0,0 +1,216 @@
+/*
+ * libc/stdlib/qsort_stable.c
+ */
+
+#include <string.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <xboot/module.h>
+
+/*
+ * Bottom up merge sort over insertion sorted runs. Merging ping-pongs between the
+ * array and a scratch copy, without memory it falls back to rotation based merges
+ */
+#define STABLE_RUN		(16)
+
+/*
+ * Element moves with the common word sizes spelled out as fixed size builtins, so they
+ * become plain loads and stores even in a freestanding build
+ */
+static inline void copy_elem(char * d, const char * s, size_t es)
+{
+	if(es == 4)
+		__builtin_memcpy(d, s, 4);
+	else if(es == 8)
+		__builtin_memcpy(d, s, 8);
+	else
+		memcpy(d, s, es);
+}
+
+static inline void swap_bytes(char * a, char * b, size_t es)
+{
+	char t[16];
+	size_t n;
+
+	while(es > 0)
+	{
+		n = (es < sizeof(t)) ? es : sizeof(t);
+		if(n == 4)
+		{
+			__builtin_memcpy(t, a, 4);
+			__builtin_memcpy(a, b, 4);
+			__builtin_memcpy(b, t, 4);
+		}
+		else if(n == 8)
+		{
+			__builtin_memcpy(t, a, 8);
+			__builtin_memcpy(a, b, 8);
+			__builtin_memcpy(b, t, 8);
+		}
+		else
+		{
+			memcpy(t, a, n);
+			memcpy(a, b, n);
+			memcpy(b, t, n);
+		}
+		a += n;
+		b += n;
+		es -= n;
+	}
+}
+
+static void reverse(char * a, size_t n, size_t es)
+{
+	char * b = a + (n - 1) * es;
+
+	while(a < b)
+	{
+		swap_bytes(a, b, es);
+		a += es;
+		b -= es;
+	}
+}
+
+static void insertion_sort(char * a, size_t n, size_t es, int (*cmp)(const void *, const void *))
+{
+	char * cur, * p;
+
+	for(cur = a + es; cur < a + n * es; cur += es)
+	{
+		for(p = cur; (p > a) && (cmp(p - es, p) > 0); p -= es)
+			swap_bytes(p, p - es, es);
+	}
+}
+
+static void merge(char * dst, const char * a, size_t n1, const char * b, size_t n2, size_t es, int (*cmp)(const void *, const void *))
+{
+	const char * ea = a + n1 * es;
+	const char * eb = b + n2 * es;
+
+	if(cmp(ea - es, b) <= 0)
+	{
+		memcpy(dst, a, n1 * es);
+		memcpy(dst + n1 * es, b, n2 * es);
+		return;
+	}
+	while((a < ea) && (b < eb))
+	{
+		if(cmp(b, a) < 0)
+		{
+			copy_elem(dst, b, es);
+			b += es;
+		}
+		else
+		{
+			copy_elem(dst, a, es);
+			a += es;
+		}
+		dst += es;
+	}
+	if(a < ea)
+		memcpy(dst, a, ea - a);
+	if(b < eb)
+		memcpy(dst, b, eb - b);
+}
+
+static void merge_inplace(char * a, size_t n1, size_t n2, size_t es, int (*cmp)(const void *, const void *))
+{
+	char * b, * key;
+	size_t m1, m2, lo, hi, mid;
+
+	while((n1 > 0) && (n2 > 0))
+	{
+		b = a + n1 * es;
+		if(n1 + n2 == 2)
+		{
+			if(cmp(b, a) < 0)
+				swap_bytes(a, b, es);
+			return;
+		}
+		if(n1 >= n2)
+		{
+			m1 = n1 / 2;
+			key = a + m1 * es;
+			for(lo = 0, hi = n2; lo < hi;)
+			{
+				mid = (lo + hi) / 2;
+				if(cmp(b + mid * es, key) < 0)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			m2 = lo;
+		}
+		else
+		{
+			m2 = n2 / 2;
+			key = b + m2 * es;
+			for(lo = 0, hi = n1; lo < hi;)
+			{
+				mid = (lo + hi) / 2;
+				if(cmp(key, a + mid * es) < 0)
+					hi = mid;
+				else
+					lo = mid + 1;
+			}
+			m1 = lo;
+		}
+		if((n1 - m1 > 0) && (m2 > 0))
+		{
+			reverse(a + m1 * es, n1 - m1, es);
+			reverse(b, m2, es);
+			reverse(a + m1 * es, n1 - m1 + m2, es);
+		}
+		merge_inplace(a, m1, m2, es, cmp);
+		a += (m1 + m2) * es;
+		n1 -= m1;
+		n2 -= m2;
+	}
+}
+
+void qsort_stable(void * base, size_t n, size_t es, int (*cmp)(const void *, const void *))
+{
+	char * a = base;
+	char * buf, * src, * dst, * t;
+	size_t i, w, m;
+
+	if((n < 2) || (es == 0))
+		return;
+	for(i = 0; i < n; i += STABLE_RUN)
+		insertion_sort(a + i * es, (n - i < STABLE_RUN) ? n - i : STABLE_RUN, es, cmp);
+	if(n <= STABLE_RUN)
+		return;
+
+	buf = malloc(n * es);
+	if(!buf)
+	{
+		for(w = STABLE_RUN; w < n; w <<= 1)
+		{
+			for(i = 0; i + w < n; i += 2 * w)
+				merge_inplace(a + i * es, w, (n - i - w < w) ? n - i - w : w, es, cmp);
+		}
+		return;
+	}
+	src = a;
+	dst = buf;
+	for(w = STABLE_RUN; w < n; w <<= 1)
+	{
+		for(i = 0; i < n; i += 2 * w)
+		{
+			if(i + w < n)
+			{
+				m = (n - i - w < w) ? n - i - w : w;
+				merge(dst + i * es, src + i * es, w, src + (i + w) * es, m, es, cmp);
+			}
+			else
+				memcpy(dst + i * es, src + i * es, (n - i) * es);
+		}
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if(src != a)
+		memcpy(a, src, n * es);
+	free(buf);
+}
+EXPORT_SYMBOL(qsort_stable);
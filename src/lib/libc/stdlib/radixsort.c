@@ -0,0 +1,224 @@
+/*
+ * libc/stdlib/radixsort.c
+ */
+
+#include <types.h>
+#include <string.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <xboot/module.h>
+
+/*
+ * Least significant digit radix sort on bytes. All histograms come from one read
+ * pass and a byte that is the same in every key costs no pass at all. Signed and
+ * floating keys are mapped onto unsigned order in place and mapped back afterwards.
+ */
+#define RADIX_SMALL		(64)
+
+typedef u32_t __attribute__((__may_alias__)) u32_alias_t;
+typedef u64_t __attribute__((__may_alias__)) u64_alias_t;
+
+static int radix_compare32(const void * a, const void * b)
+{
+	u32_t x = *(const u32_alias_t *)a;
+	u32_t y = *(const u32_alias_t *)b;
+	return (x > y) - (x < y);
+}
+
+static int radix_compare64(const void * a, const void * b)
+{
+	u64_t x = *(const u64_alias_t *)a;
+	u64_t y = *(const u64_alias_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void radix_sort32(u32_alias_t * a, size_t n)
+{
+	u32_t count[4][256];
+	u32_alias_t * src, * dst, * t;
+	u32_t sum, c, v;
+	size_t i, j;
+	int b;
+
+	if(n < RADIX_SMALL)
+	{
+		for(i = 1; i < n; i++)
+		{
+			for(v = a[i], j = i; (j > 0) && (a[j - 1] > v); j--)
+				a[j] = a[j - 1];
+			a[j] = v;
+		}
+		return;
+	}
+	dst = malloc(n * sizeof(u32_t));
+	if(!dst)
+	{
+		qsort((void *)a, n, sizeof(u32_t), radix_compare32);
+		return;
+	}
+	memset(count, 0, sizeof(count));
+	for(i = 0; i < n; i++)
+	{
+		v = a[i];
+		count[0][v & 0xff]++;
+		count[1][(v >> 8) & 0xff]++;
+		count[2][(v >> 16) & 0xff]++;
+		count[3][v >> 24]++;
+	}
+	src = a;
+	for(b = 0; b < 4; b++)
+	{
+		if(count[b][(a[0] >> (b * 8)) & 0xff] == n)
+			continue;
+		for(i = 0, sum = 0; i < 256; i++)
+		{
+			c = count[b][i];
+			count[b][i] = sum;
+			sum += c;
+		}
+		for(i = 0; i < n; i++)
+		{
+			v = src[i];
+			dst[count[b][(v >> (b * 8)) & 0xff]++] = v;
+		}
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if(src != a)
+	{
+		memcpy((void *)a, (void *)src, n * sizeof(u32_t));
+		free((void *)src);
+	}
+	else
+		free((void *)dst);
+}
+
+static void radix_sort64(u64_alias_t * a, size_t n)
+{
+	u32_t count[8][256];
+	u64_alias_t * src, * dst, * t;
+	u64_t v;
+	u32_t sum, c;
+	size_t i, j;
+	int b;
+
+	if(n < RADIX_SMALL)
+	{
+		for(i = 1; i < n; i++)
+		{
+			for(v = a[i], j = i; (j > 0) && (a[j - 1] > v); j--)
+				a[j] = a[j - 1];
+			a[j] = v;
+		}
+		return;
+	}
+	dst = malloc(n * sizeof(u64_t));
+	if(!dst)
+	{
+		qsort((void *)a, n, sizeof(u64_t), radix_compare64);
+		return;
+	}
+	memset(count, 0, sizeof(count));
+	for(i = 0; i < n; i++)
+	{
+		v = a[i];
+		for(b = 0; b < 8; b++)
+			count[b][(v >> (b * 8)) & 0xff]++;
+	}
+	src = a;
+	for(b = 0; b < 8; b++)
+	{
+		if(count[b][(a[0] >> (b * 8)) & 0xff] == n)
+			continue;
+		for(i = 0, sum = 0; i < 256; i++)
+		{
+			c = count[b][i];
+			count[b][i] = sum;
+			sum += c;
+		}
+		for(i = 0; i < n; i++)
+		{
+			v = src[i];
+			dst[count[b][(v >> (b * 8)) & 0xff]++] = v;
+		}
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if(src != a)
+	{
+		memcpy((void *)a, (void *)src, n * sizeof(u64_t));
+		free((void *)src);
+	}
+	else
+		free((void *)dst);
+}
+
+void radixsort_u32(u32_t * a, size_t n)
+{
+	radix_sort32((u32_alias_t *)a, n);
+}
+EXPORT_SYMBOL(radixsort_u32);
+
+void radixsort_s32(s32_t * a, size_t n)
+{
+	u32_alias_t * k = (u32_alias_t *)a;
+	size_t i;
+
+	for(i = 0; i < n; i++)
+		k[i] ^= 0x80000000;
+	radix_sort32(k, n);
+	for(i = 0; i < n; i++)
+		k[i] ^= 0x80000000;
+}
+EXPORT_SYMBOL(radixsort_s32);
+
+void radixsort_u64(u64_t * a, size_t n)
+{
+	radix_sort64((u64_alias_t *)a, n);
+}
+EXPORT_SYMBOL(radixsort_u64);
+
+void radixsort_s64(s64_t * a, size_t n)
+{
+	u64_alias_t * k = (u64_alias_t *)a;
+	size_t i;
+
+	for(i = 0; i < n; i++)
+		k[i] ^= 0x8000000000000000ULL;
+	radix_sort64(k, n);
+	for(i = 0; i < n; i++)
+		k[i] ^= 0x8000000000000000ULL;
+}
+EXPORT_SYMBOL(radixsort_s64);
+
+/*
+ * Negative floats have all bits flipped and positive ones only the sign, -0.0 sorts
+ * before +0.0 and nans go to the end matching their sign
+ */
+void radixsort_float(float * a, size_t n)
+{
+	u32_alias_t * k = (u32_alias_t *)a;
+	size_t i;
+
+	for(i = 0; i < n; i++)
+		k[i] ^= (k[i] & 0x80000000) ? 0xffffffff : 0x80000000;
+	radix_sort32(k, n);
+	for(i = 0; i < n; i++)
+		k[i] ^= (k[i] & 0x80000000) ? 0x80000000 : 0xffffffff;
+}
+EXPORT_SYMBOL(radixsort_float);
+
+void radixsort_double(double * a, size_t n)
+{
+	u64_alias_t * k = (u64_alias_t *)a;
+	size_t i;
+
+	for(i = 0; i < n; i++)
+		k[i] ^= (k[i] & 0x8000000000000000ULL) ? 0xffffffffffffffffULL : 0x8000000000000000ULL;
+	radix_sort64(k, n);
+	for(i = 0; i < n; i++)
+		k[i] ^= (k[i] & 0x8000000000000000ULL) ? 0x8000000000000000ULL : 0xffffffffffffffffULL;
+}
+EXPORT_SYMBOL(radixsort_double);
@@ -5,136 +5,429 @@
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
 #include <stdlib.h>
 #include <xboot/module.h>
 
+union double_bits_t {
+	double d;
+	uint64_t u;
+};
+
+static const double pow10_exact[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline uint64_t mul64(uint64_t x, uint64_t y)
+{
+	uint64_t a = x >> 32, b = x & 0xffffffff;
+	uint64_t c = y >> 32, d = y & 0xffffffff;
+	uint64_t t = ((b * d) >> 32) + ((a * d) & 0xffffffff) + ((b * c) & 0xffffffff) + (1U << 31);
+
+	return a * c + ((a * d) >> 32) + ((b * c) >> 32) + (t >> 32);
+}
+
+static inline int hexval(int c)
+{
+	if((unsigned)(c - '0') < 10)
+		return c - '0';
+	c |= 0x20;
+	if((unsigned)(c - 'a') < 6)
+		return c - 'a' + 10;
+	return -1;
+}
+
+static int match(const char * s, const char * word)
+{
+	int i;
+
+	for(i = 0; word[i]; i++)
+	{
+		if((s[i] | 0x20) != word[i])
+			return 0;
+	}
+	return i;
+}
+
+static const char * read_exponent(const char * p, char mark, int * exp)
+{
+	const char * q = p + 1;
+	int neg = 0, x = 0;
+
+	if((*p | 0x20) != mark)
+		return p;
+	if((*q == '+') || (*q == '-'))
+		neg = (*q++ == '-');
+	if((unsigned)(*q - '0') >= 10)
+		return p;
+	for(; (unsigned)(*q - '0') < 10; q++)
+	{
+		if(x < 100000)
+			x = x * 10 + (*q - '0');
+	}
+	*exp += neg ? -x : x;
+	return q;
+}
+
 /*
- * Convert string to double
+ * Round m * 2^e to nearest even, sticky tells that something nonzero lies below m
  */
-double strtod(const char * nptr, char ** endptr)
+static double round_binary(uint64_t m, int e, int sticky)
 {
-	double number;
-	int exponent;
-	int negative;
-	char * p = (char *)nptr;
-	double p10;
-	int n;
-	int num_digits;
-	int num_decimals;
-
-	/* Skip leading whitespace */
-	while(isspace(*p))
-		p++;
+	union double_bits_t b;
+	uint64_t mant, rem, half = 1ULL << 63;
+	int s, be, shift;
 
-	/* Handle optional sign */
-	negative = 0;
-	switch(*p)
+	s = __builtin_clzll(m);
+	m <<= s;
+	e -= s;
+	be = e + 63 + 1023;
+	if(be >= 2047)
 	{
-	case '-':
-		negative = 1;
-		p++;
-		break;
-	case '+':
-		p++;
-		break;
+		errno = ERANGE;
+		return HUGE_VAL;
+	}
+	shift = 11;
+	if(be <= 0)
+	{
+		shift += 1 - be;
+		be = 0;
+	}
+	if(shift < 64)
+	{
+		mant = m >> shift;
+		rem = m << (64 - shift);
+	}
+	else
+	{
+		mant = 0;
+		rem = (shift == 64) ? m : 0;
+		sticky |= (shift > 64);
 	}
+	if((rem > half) || ((rem == half) && (sticky || (mant & 1))))
+		mant++;
+	b.u = be ? ((uint64_t)(be - 1) << 52) + mant : mant;
+	if((b.u >= 0x7ff0000000000000ULL) || (b.u == 0))
+		errno = ERANGE;
+	return b.d;
+}
 
-	number = 0.;
-	exponent = 0;
-	num_digits = 0;
-	num_decimals = 0;
+/*
+ * Scale w * 10^e with 64 bits products, tracking the error in eighths of an ulp. Returns
+ * zero when the result is too close to a halfway case, then it may be one below
+ */
+static int diyfp_strtod(uint64_t w, int e, int nd, int trunc, double * result)
+{
+	static const uint64_t adjust[] = {
+		0, 0xa000000000000000ULL, 0xc800000000000000ULL, 0xfa00000000000000ULL,
+		0x9c40000000000000ULL, 0xc350000000000000ULL, 0xf424000000000000ULL, 0x9896800000000000ULL,
+	};
+	static const int adjust_e[] = { 0, -60, -57, -54, -50, -47, -44, -40 };
+	union double_bits_t b;
+	uint64_t f, cf, error, bits, half, mask;
+	int fe, ce, k, s, order, prec, shift;
 
-	/* Process string of digits */
-	while(isdigit(*p))
+	error = trunc ? 4 : 0;
+	s = __builtin_clzll(w);
+	f = w << s;
+	fe = -s;
+	error <<= s;
+
+	k = e;
+	cf = __cached_pow10(&k, &ce);
+	if(k != e)
 	{
-		number = number * 10. + (*p - '0');
-		p++;
-		num_digits++;
+		f = mul64(f, adjust[e - k]);
+		fe += adjust_e[e - k] + 64;
+		if(19 - nd < e - k)
+			error += 4;
 	}
+	f = mul64(f, cf);
+	fe += ce + 64;
+	error += 4 + (error ? 1 : 0) + 4;
+	s = __builtin_clzll(f);
+	f <<= s;
+	fe -= s;
+	error <<= s;
 
-	/* Process decimal part */
-	if(*p == '.')
+	order = 64 + fe;
+	if(order >= -1074 + 53)
+		prec = 64 - 53;
+	else if(order <= -1074)
+		prec = 64;
+	else
+		prec = 64 - (order + 1074);
+	if(prec + 3 >= 64)
 	{
-		p++;
+		shift = prec + 3 - 64 + 1;
+		f >>= shift;
+		fe += shift;
+		error = (error >> shift) + 1 + 8;
+		prec -= shift;
+	}
+	mask = (1ULL << prec) - 1;
+	bits = (f & mask) * 8;
+	half = (1ULL << (prec - 1)) * 8;
+	f >>= prec;
+	fe += prec;
+	if(bits >= half + error)
+		f++;
 
-		while(isdigit(*p))
+	while(f > (1ULL << 53) - 1)
+	{
+		f >>= 1;
+		fe++;
+	}
+	if(fe >= 972)
+	{
+		b.u = 0x7ff0000000000000ULL;
+	}
+	else if(fe < -1074)
+	{
+		b.u = 0;
+	}
+	else
+	{
+		while((fe > -1074) && !(f & (1ULL << 52)))
 		{
-			number = number * 10. + (*p - '0');
-			p++;
-			num_digits++;
-			num_decimals++;
+			f <<= 1;
+			fe--;
 		}
-
-		exponent -= num_decimals;
+		if((fe == -1074) && !(f & (1ULL << 52)))
+			b.u = f;
+		else
+			b.u = (f & ((1ULL << 52) - 1)) | ((uint64_t)(fe + 1075) << 52);
 	}
+	*result = b.d;
+	return !((half - error < bits) && (bits < half + error));
+}
 
-	if(num_digits == 0)
+/*
+ * Settle between guess and the next double up by comparing the input digits with
+ * the exact halfway point between the two
+ */
+static double bigcomp(double guess, const char * s, int nd, int decpt)
+{
+	char digits[800];
+	union double_bits_t b = { .d = guess };
+	uint64_t f = b.u & ((1ULL << 52) - 1);
+	int e = (b.u >> 52) & 0x7ff;
+	int len, hdecpt, cmp, i;
+
+	if(e)
 	{
-		errno = ERANGE;
-		return 0.0;
+		f |= 1ULL << 52;
+		e -= 1075;
+	}
+	else
+	{
+		e = -1074;
+	}
+	len = __bigdec((f << 1) + 1, e - 1, digits, &hdecpt);
+	if(decpt != hdecpt)
+	{
+		cmp = (decpt > hdecpt) ? 1 : -1;
 	}
+	else
+	{
+		cmp = (len > nd) ? -1 : 0;
+		for(i = 0; i < nd; i++, s++)
+		{
+			if(*s == '.')
+				s++;
+			if(*s != ((i < len) ? digits[i] : '0'))
+			{
+				cmp = (*s > ((i < len) ? digits[i] : '0')) ? 1 : -1;
+				break;
+			}
+		}
+	}
+	if((cmp < 0) || ((cmp == 0) && !(f & 1)))
+		return guess;
+	b.u++;
+	return b.d;
+}
 
-	/* Correct for sign */
-	if(negative)
-		number = -number;
+/*
+ * Convert string to double, correctly rounded. Short inputs are done with one exact
+ * floating point operation, the rest with 64 bits arithmetic and a big number check
+ * only when the result is too close to a halfway case
+ */
+double strtod(const char * nptr, char ** endptr)
+{
+	union double_bits_t b;
+	const char * p = nptr;
+	const char * first, * q;
+	uint64_t w = 0;
+	double r;
+	int neg = 0, any = 0, trunc = 0, rnd = 0;
+	int nd = 0, e = 0, k, we, d, n;
 
-	/* Process an exponent string */
-	if(*p == 'e' || *p == 'E')
+	while((*p == ' ') || ((unsigned)(*p - '\t') < 5))
+		p++;
+	if((*p == '-') || (*p == '+'))
+		neg = (*p++ == '-');
+
+	if(((*p | 0x20) == 'i') && (n = match(p, "inf")))
+	{
+		p += n;
+		if((n = match(p, "inity")))
+			p += n;
+		r = INFINITY;
+		goto done;
+	}
+	if(((*p | 0x20) == 'n') && (n = match(p, "nan")))
 	{
-		/* Handle optional sign */
-		negative = 0;
-		switch(*++p)
+		p += n;
+		if(*p == '(')
 		{
-		case '-':
-			negative = 1;
-			p++;
-			break;
-		case '+':
-			p++;
-			break;
+			for(n = 1; isalnum(p[n]) || (p[n] == '_'); n++);
+			if(p[n] == ')')
+				p += n + 1;
 		}
+		r = NAN;
+		goto done;
+	}
+
+	if((p[0] == '0') && ((p[1] | 0x20) == 'x'))
+	{
+		int dot = 0;
 
-		/* Process string of digits */
-		n = 0;
-		while(isdigit(*p))
+		for(q = p + 2;; q++)
+		{
+			if((*q == '.') && !dot)
+			{
+				dot = 1;
+				continue;
+			}
+			if((d = hexval(*q)) < 0)
+				break;
+			any = 1;
+			if((w >> 60) == 0)
+			{
+				w = (w << 4) | d;
+				if(dot)
+					e -= 4;
+			}
+			else
+			{
+				trunc |= d;
+				if(!dot)
+					e += 4;
+			}
+		}
+		if(!any)
 		{
-			n = n * 10 + (*p - '0');
 			p++;
+			r = 0.0;
+			goto done;
 		}
+		p = read_exponent(q, 'p', &e);
+		r = w ? round_binary(w, e, trunc) : 0.0;
+		goto done;
+	}
 
-		if(negative)
-			exponent -= n;
+	/*
+	 * The value is the nd significant digits times 10^e, only the first 19 are kept in w
+	 */
+	q = p;
+	while(*p == '0')
+		p++;
+	first = p;
+	for(; (unsigned)(d = *p - '0') < 10; p++, nd++)
+	{
+		if(nd < 19)
+			w = w * 10 + d;
 		else
-			exponent += n;
+		{
+			rnd |= (nd == 19) && (d >= 5);
+			trunc |= d;
+		}
 	}
-
-	if(exponent < -307 || exponent > 308)
+	any = p > q;
+	if(*p == '.')
 	{
-		errno = ERANGE;
+		q = ++p;
+		if(!nd)
+		{
+			while(*p == '0')
+				p++;
+			e -= p - q;
+			first = p;
+		}
+		for(; (unsigned)(d = *p - '0') < 10; p++, nd++, e--)
+		{
+			if(nd < 19)
+				w = w * 10 + d;
+			else
+			{
+				rnd |= (nd == 19) && (d >= 5);
+				trunc |= d;
+			}
+		}
+		any |= p > q;
+	}
+	if(!any)
+	{
+		if(endptr)
+			*endptr = (char *)nptr;
 		return 0.0;
 	}
+	p = read_exponent(p, 'e', &e);
+	if(nd == 0)
+	{
+		r = 0.0;
+		goto done;
+	}
+	if(nd + e > 309)
+	{
+		errno = ERANGE;
+		r = HUGE_VAL;
+		goto done;
+	}
+	if(nd + e <= -324)
+	{
+		errno = ERANGE;
+		r = 0.0;
+		goto done;
+	}
 
-	/* Scale the result */
-	p10 = 10.;
-	n = exponent;
-	if(n < 0)
-		n = -n;
-	while(n)
+	k = (nd < 19) ? nd : 19;
+	we = e + nd - k;
+	if(!trunc && (w < (1ULL << 53)))
 	{
-		if(n & 1)
+		if((we >= 0) && (we <= 22))
 		{
-			if (exponent < 0)
-				number /= p10;
-			else
-				number *= p10;
+			r = (double)w * pow10_exact[we];
+			goto done;
+		}
+		if((we < 0) && (we >= -22))
+		{
+			r = (double)w / pow10_exact[-we];
+			goto done;
+		}
+		if((we > 22) && (we <= 22 + 15) && (w < (1ULL << 53) / (uint64_t)pow10_exact[we - 22]))
+		{
+			r = (double)(w * (uint64_t)pow10_exact[we - 22]) * 1e22;
+			goto done;
 		}
-		n >>= 1;
-		p10 *= p10;
 	}
+	if(trunc)
+		w += rnd;
+	if(!diyfp_strtod(w, we, nd, trunc, &r))
+	{
+		b.d = r;
+		if(b.u != 0x7ff0000000000000ULL)
+			r = bigcomp(r, first, nd, nd + e);
+	}
+	b.d = r;
+	if((b.u == 0x7ff0000000000000ULL) || (b.u == 0))
+		errno = ERANGE;
 
+done:
 	if(endptr)
-		*endptr = p;
-
-	return number;
+		*endptr = (char *)p;
+	return neg ? -r : r;
 }
 EXPORT_SYMBOL(strtod);
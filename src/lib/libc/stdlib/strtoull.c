@@ -2,7 +2,6 @@
  * libc/stdlib/strtoull.c
  */
 
-#include <ctype.h>
 #include <errno.h>
 #include <limits.h>
 #include <stdlib.h>
@@ -24,7 +23,7 @@ unsigned long long strtoull(const char * nptr, char ** endptr, int base)
 	s = nptr;
 	do {
 		c = (unsigned char) *s++;
-	} while (isspace(c));
+	} while (c == ' ' || (unsigned) (c - '\t') < 5);
 
 	if (c == '-')
 	{
@@ -78,10 +77,10 @@ unsigned long long strtoull(const char * nptr, char ** endptr, int base)
 
 	for (acc = 0, any = 0;; c = (unsigned char) *s++)
 	{
-		if (isdigit(c))
+		if ((unsigned) (c - '0') < 10)
 			c -= '0';
-		else if (isalpha(c))
-			c -= isupper(c) ? 'A' - 10 : 'a' - 10;
+		else if ((unsigned) ((c | 0x20) - 'a') < 26)
+			c = (c | 0x20) - ('a' - 10);
 		else
 			break;
 
@@ -7,21 +7,42 @@
 #include <string.h>
 #include <xboot/module.h>
 
-/*
- * Finds the first occurrence of a byte in a buffer
- */
-void * memchr(const void * s, int c, size_t n)
+typedef unsigned long __attribute__((__may_alias__)) word_t;
+
+#define WSIZE		(sizeof(word_t))
+#define WMASK		(WSIZE - 1)
+#define ONES		((word_t)-1 / 0xff)
+#define HIGHS		(ONES * 0x80)
+#define HASZERO(x)	(((x) - ONES) & ~(x) & HIGHS)
+
+static void * __memchr(const void * s, int c, size_t n)
 {
-	const unsigned char *p = s;
+	const unsigned char * p = s;
+	const word_t * w;
+	word_t k;
 
-	while (n-- != 0)
+	c = (unsigned char)c;
+	for(; ((unsigned long)p & WMASK) && n; p++, n--)
 	{
-        if ((unsigned char)c == *p++)
-        {
-			return (void *)(p - 1);
-		}
+		if(*p == c)
+			return (void *)p;
+	}
+	if(n >= WSIZE)
+	{
+		k = ONES * c;
+		for(w = (const word_t *)p; (n >= WSIZE) && !HASZERO(*w ^ k); w++, n -= WSIZE);
+		p = (const unsigned char *)w;
+	}
+	for(; n; p++, n--)
+	{
+		if(*p == c)
+			return (void *)p;
 	}
-
 	return NULL;
 }
+
+/*
+ * Finds the first occurrence of a byte in a buffer
+ */
+extern __typeof(__memchr) memchr __attribute__((weak, alias("__memchr")));
 EXPORT_SYMBOL(memchr);
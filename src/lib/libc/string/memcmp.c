@@ -6,15 +6,46 @@
 #include <string.h>
 #include <xboot/module.h>
 
+typedef unsigned long __attribute__((__may_alias__)) word_t;
+
+#define WSIZE		(sizeof(word_t))
+#define WMASK		(WSIZE - 1)
+
 static int __memcmp(const void * s1, const void * s2, size_t n)
 {
-	const unsigned char *su1, *su2;
-	int res = 0;
+	const unsigned char *su1 = s1, *su2 = s2;
+	const word_t * w1, * w2;
 
-	for (su1 = s1, su2 = s2; 0 < n; ++su1, ++su2, n--)
-		if ((res = *su1 - *su2) != 0)
-			break;
-	return res;
+	/*
+	 * Skip the equal words, the differing one is resolved bytewise
+	 */
+	if((n >= WSIZE * 2) && ((((unsigned long)su1 ^ (unsigned long)su2) & WMASK) == 0))
+	{
+		while((unsigned long)su1 & WMASK)
+		{
+			if(*su1 != *su2)
+				return *su1 - *su2;
+			su1++;
+			su2++;
+			n--;
+		}
+		w1 = (const word_t *)su1;
+		w2 = (const word_t *)su2;
+		while((n >= WSIZE) && (*w1 == *w2))
+		{
+			w1++;
+			w2++;
+			n -= WSIZE;
+		}
+		su1 = (const unsigned char *)w1;
+		su2 = (const unsigned char *)w2;
+	}
+	for(; n > 0; su1++, su2++, n--)
+	{
+		if(*su1 != *su2)
+			return *su1 - *su2;
+	}
+	return 0;
 }
 
 /*
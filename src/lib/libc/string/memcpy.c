@@ -3,16 +3,75 @@
  */
 
 #include <types.h>
+#include <endian.h>
 #include <string.h>
 #include <xboot/module.h>
 
+/*
+ * Word at a time copy, only aligned words are accessed so it is safe on strict alignment cores
+ */
+typedef unsigned long __attribute__((__may_alias__)) word_t;
+
+#define WSIZE		(sizeof(word_t))
+#define WMASK		(WSIZE - 1)
+
+#if (BYTE_ORDER == BIG_ENDIAN)
+#define MERGE(a, b, l, r)	(((a) << (l)) | ((b) >> (r)))
+#else
+#define MERGE(a, b, l, r)	(((a) >> (l)) | ((b) << (r)))
+#endif
+
 static void * __memcpy(void * dest, const void * src, size_t len)
 {
-	char * tmp = dest;
-	const char * s = src;
+	unsigned char * d = dest;
+	const unsigned char * s = src;
+	word_t * dw;
+	const word_t * sw;
+	word_t w0, w1;
+	unsigned int l, r;
 
-	while (len--)
-		*tmp++ = *s++;
+	if(len >= WSIZE * 2)
+	{
+		while((unsigned long)d & WMASK)
+		{
+			*d++ = *s++;
+			len--;
+		}
+		dw = (word_t *)d;
+		if(((unsigned long)s & WMASK) == 0)
+		{
+			sw = (const word_t *)s;
+			for(; len >= WSIZE * 4; len -= WSIZE * 4)
+			{
+				dw[0] = sw[0];
+				dw[1] = sw[1];
+				dw[2] = sw[2];
+				dw[3] = sw[3];
+				dw += 4;
+				sw += 4;
+			}
+			for(; len >= WSIZE; len -= WSIZE)
+				*dw++ = *sw++;
+			s = (const unsigned char *)sw;
+		}
+		else
+		{
+			l = ((unsigned long)s & WMASK) * 8;
+			r = WSIZE * 8 - l;
+			sw = (const word_t *)((unsigned long)s & ~WMASK);
+			w0 = *sw++;
+			for(; len >= WSIZE; len -= WSIZE)
+			{
+				w1 = *sw++;
+				*dw++ = MERGE(w0, w1, l, r);
+				w0 = w1;
+				s += WSIZE;
+			}
+		}
+		d = (unsigned char *)dw;
+	}
+	while(len--)
+		*d++ = *s++;
 	return dest;
 }
 
@@ -6,27 +6,80 @@
 #include <string.h>
 #include <xboot/module.h>
 
+typedef unsigned long __attribute__((__may_alias__)) word_t;
+
+#define WSIZE		(sizeof(word_t))
+#define WMASK		(WSIZE - 1)
+
 static void * __memmove(void * dest, const void * src, size_t n)
 {
-	char * tmp;
-	const char * s;
+	unsigned char * d = dest;
+	const unsigned char * s = src;
+	word_t * dw;
+	const word_t * sw;
 
-	if (dest <= src)
+	if(d == s)
+		return dest;
+
+	if(d < s)
 	{
-		tmp = dest;
-		s = src;
-		while (n--)
-			*tmp++ = *s++;
+		if((((unsigned long)d ^ (unsigned long)s) & WMASK) == 0)
+		{
+			while((unsigned long)d & WMASK)
+			{
+				if(n-- == 0)
+					return dest;
+				*d++ = *s++;
+			}
+			dw = (word_t *)d;
+			sw = (const word_t *)s;
+			for(; n >= WSIZE * 4; n -= WSIZE * 4)
+			{
+				dw[0] = sw[0];
+				dw[1] = sw[1];
+				dw[2] = sw[2];
+				dw[3] = sw[3];
+				dw += 4;
+				sw += 4;
+			}
+			for(; n >= WSIZE; n -= WSIZE)
+				*dw++ = *sw++;
+			d = (unsigned char *)dw;
+			s = (const unsigned char *)sw;
+		}
+		while(n--)
+			*d++ = *s++;
+		return dest;
 	}
-	else
+
+	d += n;
+	s += n;
+	if((((unsigned long)d ^ (unsigned long)s) & WMASK) == 0)
 	{
-		tmp = dest;
-		tmp += n;
-		s = src;
-		s += n;
-		while (n--)
-			*--tmp = *--s;
+		while((unsigned long)d & WMASK)
+		{
+			if(n-- == 0)
+				return dest;
+			*--d = *--s;
+		}
+		dw = (word_t *)d;
+		sw = (const word_t *)s;
+		for(; n >= WSIZE * 4; n -= WSIZE * 4)
+		{
+			dw -= 4;
+			sw -= 4;
+			dw[3] = sw[3];
+			dw[2] = sw[2];
+			dw[1] = sw[1];
+			dw[0] = sw[0];
+		}
+		for(; n >= WSIZE; n -= WSIZE)
+			*--dw = *--sw;
+		d = (unsigned char *)dw;
+		s = (const unsigned char *)sw;
 	}
+	while(n--)
+		*--d = *--s;
 	return dest;
 }
 
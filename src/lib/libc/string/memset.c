@@ -6,13 +6,44 @@
 #include <string.h>
 #include <xboot/module.h>
 
+typedef unsigned long __attribute__((__may_alias__)) word_t;
+
+#define WSIZE		(sizeof(word_t))
+#define WMASK		(WSIZE - 1)
+
 static void * __memset(void * s, int c, size_t n)
 {
-	char * xs = s;
+	unsigned char * xs = s;
+	word_t * ws;
+	word_t w;
 
-	while (n--)
+	if(n >= WSIZE * 2)
+	{
+		while((unsigned long)xs & WMASK)
+		{
+			*xs++ = c;
+			n--;
+		}
+		w = (unsigned char)c;
+		w |= w << 8;
+		w |= w << 16;
+		if(WSIZE > 4)
+			w |= (w << 16) << 16;
+		ws = (word_t *)xs;
+		for(; n >= WSIZE * 4; n -= WSIZE * 4)
+		{
+			ws[0] = w;
+			ws[1] = w;
+			ws[2] = w;
+			ws[3] = w;
+			ws += 4;
+		}
+		for(; n >= WSIZE; n -= WSIZE)
+			*ws++ = w;
+		xs = (unsigned char *)ws;
+	}
+	while(n--)
 		*xs++ = c;
-
 	return s;
 }
 
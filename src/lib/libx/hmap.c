@@ -5,6 +5,7 @@
 #include <types.h>
 #include <stddef.h>
 #include <string.h>
+#include <stdlib.h>
 #include <spinlock.h>
 #include <shash.h>
 #include <log2.h>
@@ -12,6 +13,9 @@
 #include <lsort.h>
 #include <malloc.h>
 #include <hmap.h>
+#include <xboot/slab.h>
+
+static struct kmem_cache_t __hmap_entry_cache = KMEM_CACHE_INIT("hmap_entry", sizeof(struct hmap_entry_t), 0, NULL);
 
 struct hmap_t * hmap_alloc(int size, void (*cb)(struct hmap_t *, struct hmap_entry_t *))
 {
@@ -71,7 +75,7 @@ void hmap_clear(struct hmap_t * m)
 			if(m->callback)
 				m->callback(m, pos);
 			free(pos->key);
-			free(pos);
+			kmem_cache_free(&__hmap_entry_cache, pos);
 		}
 	}
 }
@@ -137,7 +141,7 @@ void hmap_add(struct hmap_t * m, const char * key, void * value)
 	if(m->n > (m->size >> 1))
 		hmap_resize(m, m->size << 1);
 
-	pos = malloc(sizeof(struct hmap_entry_t));
+	pos = kmem_cache_alloc(&__hmap_entry_cache);
 	if(!pos)
 		return;
 
@@ -174,7 +178,7 @@ void hmap_remove(struct hmap_t * m, const char * key)
 			m->n--;
 			spin_unlock_irqrestore(&m->lock, flags);
 			free(pos->key);
-			free(pos);
+			kmem_cache_free(&__hmap_entry_cache, pos);
 			return;
 		}
 	}
@@ -187,15 +191,42 @@ static int hmap_compare(void * priv, struct list_head * a, struct list_head * b)
 	return strcmp(keya, keyb);
 }
 
+static int hmap_compare_entry(const void * a, const void * b)
+{
+	return strcmp((*(struct hmap_entry_t **)a)->key, (*(struct hmap_entry_t **)b)->key);
+}
+
+/*
+ * Sort an array of entry pointers and relink, the list merge sort is kept for when memory is short
+ */
 void hmap_sort(struct hmap_t * m)
 {
+	struct hmap_entry_t ** e, * pos;
 	irq_flags_t flags;
+	unsigned int n, i;
 
 	if(m)
 	{
+		n = m->n;
+		e = (n > 1) ? malloc(sizeof(struct hmap_entry_t *) * n) : NULL;
 		spin_lock_irqsave(&m->lock, flags);
-		lsort(NULL, &m->list, hmap_compare);
+		if(e && (m->n == n))
+		{
+			i = 0;
+			list_for_each_entry(pos, &m->list, head)
+				e[i++] = pos;
+			qsort(e, n, sizeof(struct hmap_entry_t *), hmap_compare_entry);
+			init_list_head(&m->list);
+			for(i = 0; i < n; i++)
+				list_add_tail(&e[i]->head, &m->list);
+		}
+		else
+		{
+			lsort(NULL, &m->list, hmap_compare);
+		}
 		spin_unlock_irqrestore(&m->lock, flags);
+		if(e)
+			free(e);
 	}
 }
 
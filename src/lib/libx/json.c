@@ -3,6 +3,7 @@
  */
 
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
@@ -840,6 +841,15 @@ void json_free(struct json_value_t * value)
 	if(!value)
 		return;
 
+	/*
+	 * An in-situ tree lives in a single block, marked by its root
+	 */
+	if(value->reserved.object_mem == (void *)value)
+	{
+		free(value);
+		return;
+	}
+
 	value->parent = 0;
 	while(value)
 	{
@@ -876,3 +886,836 @@ void json_free(struct json_value_t * value)
 		free(v);
 	}
 }
+
+enum {
+	READER_VALUE			= 0,
+	READER_OBJECT			= 1,
+	READER_ARRAY			= 2,
+	READER_COLON			= 3,
+	READER_NEXT				= 4,
+	READER_DONE				= 5,
+	READER_ERROR			= 6,
+};
+
+static inline enum json_token_type_t reader_error(struct json_reader_t * r, const char * error)
+{
+	r->error = error;
+	r->state = READER_ERROR;
+	return JSON_TOKEN_ERROR;
+}
+
+static inline void reader_value_done(struct json_reader_t * r)
+{
+	r->state = (r->depth > 0) ? READER_NEXT : READER_DONE;
+}
+
+static int reader_skip_space(struct json_reader_t * r)
+{
+	const char * p = r->ptr;
+	const char * end = r->end;
+
+	while(p < end)
+	{
+		switch(*p)
+		{
+		case ' ':
+		case '\t':
+		case '\r':
+			p++;
+			break;
+
+		case '\n':
+			r->line++;
+			r->bol = ++p;
+			break;
+
+		case '/':
+			if((p + 1 < end) && (p[1] == '/'))
+			{
+				p += 2;
+				while((p < end) && (*p != '\n'))
+					p++;
+			}
+			else if((p + 1 < end) && (p[1] == '*'))
+			{
+				p += 2;
+				for(;;)
+				{
+					if(p + 1 >= end)
+					{
+						r->ptr = end;
+						return 0;
+					}
+					if((p[0] == '*') && (p[1] == '/'))
+						break;
+					if(*p++ == '\n')
+					{
+						r->line++;
+						r->bol = p;
+					}
+				}
+				p += 2;
+			}
+			else
+			{
+				r->ptr = p;
+				return 1;
+			}
+			break;
+
+		default:
+			r->ptr = p;
+			return 1;
+		}
+	}
+	r->ptr = p;
+	return 1;
+}
+
+static enum json_token_type_t reader_string(struct json_reader_t * r, struct json_token_t * t)
+{
+	const char * p = r->ptr + 1;
+	const char * end = r->end;
+	int escaped = 0;
+
+	while(p < end)
+	{
+		switch(*p)
+		{
+		case '"':
+			t->ptr = r->ptr + 1;
+			t->length = p - t->ptr;
+			t->escaped = escaped;
+			r->ptr = p + 1;
+			return JSON_TOKEN_STRING;
+
+		case '\\':
+			escaped = 1;
+			p += 2;
+			break;
+
+		case '\n':
+			r->line++;
+			r->bol = ++p;
+			break;
+
+		default:
+			p++;
+			break;
+		}
+	}
+	r->ptr = end;
+	return reader_error(r, "Unexpected EOF in string");
+}
+
+static enum json_token_type_t reader_number(struct json_reader_t * r, struct json_token_t * t)
+{
+	const char * p = r->ptr;
+	const char * end = r->end;
+	uint64_t v = 0;
+	int negative = 0, isdbl = 0, digits;
+	char tmp[320];
+
+	if(*p == '-')
+	{
+		negative = 1;
+		p++;
+	}
+	for(digits = 0; (p < end) && isdigit(*p); p++, digits++)
+	{
+		if(v > (9223372036854775807ULL - (*p - '0')) / 10)
+			isdbl = 1;
+		else
+			v = v * 10 + (*p - '0');
+	}
+	if(digits == 0)
+		return reader_error(r, "Expected digit");
+	if((p < end) && (*p == '.'))
+	{
+		isdbl = 1;
+		for(p++, digits = 0; (p < end) && isdigit(*p); p++, digits++);
+		if(digits == 0)
+			return reader_error(r, "Expected digit after `.`");
+	}
+	if((p < end) && ((*p == 'e') || (*p == 'E')))
+	{
+		isdbl = 1;
+		p++;
+		if((p < end) && ((*p == '+') || (*p == '-')))
+			p++;
+		for(digits = 0; (p < end) && isdigit(*p); p++, digits++);
+		if(digits == 0)
+			return reader_error(r, "Expected digit after `e`");
+	}
+	if(isdbl)
+	{
+		if(p - r->ptr >= sizeof(tmp))
+			return reader_error(r, "Number too long");
+		memcpy(tmp, r->ptr, p - r->ptr);
+		tmp[p - r->ptr] = 0;
+		t->u.dbl = strtod(tmp, NULL);
+		r->ptr = p;
+		return JSON_TOKEN_DOUBLE;
+	}
+	t->u.integer = negative ? -(int64_t)v : (int64_t)v;
+	r->ptr = p;
+	return JSON_TOKEN_INTEGER;
+}
+
+static enum json_token_type_t reader_literal(struct json_reader_t * r, const char * s, int len)
+{
+	if((r->end - r->ptr < len) || (memcmp(r->ptr, s, len) != 0))
+		return reader_error(r, "Unknown value");
+	r->ptr += len;
+	return JSON_TOKEN_NULL;
+}
+
+void json_reader_init(struct json_reader_t * r, const char * json, size_t length)
+{
+	if((length >= 3) && ((unsigned char)json[0] == 0xef) && ((unsigned char)json[1] == 0xbb) && ((unsigned char)json[2] == 0xbf))
+	{
+		json += 3;
+		length -= 3;
+	}
+	r->ptr = json;
+	r->end = json + length;
+	r->bol = json;
+	r->error = NULL;
+	r->line = 1;
+	r->state = READER_VALUE;
+	r->depth = 0;
+}
+
+enum json_token_type_t json_reader_next(struct json_reader_t * r, struct json_token_t * t)
+{
+	enum json_token_type_t type;
+	char c;
+
+	for(;;)
+	{
+		if(r->state == READER_ERROR)
+			return (t->type = JSON_TOKEN_ERROR);
+		if(!reader_skip_space(r))
+			return (t->type = reader_error(r, "Unexpected EOF in block comment"));
+		if((r->ptr >= r->end) || (*r->ptr == 0))
+		{
+			if(r->state == READER_DONE)
+				return (t->type = JSON_TOKEN_EOF);
+			return (t->type = reader_error(r, "Unexpected EOF"));
+		}
+		c = *r->ptr;
+
+		switch(r->state)
+		{
+		case READER_DONE:
+			return (t->type = reader_error(r, "Trailing garbage"));
+
+		case READER_COLON:
+			if(c != ':')
+				return (t->type = reader_error(r, "Expected :"));
+			r->ptr++;
+			r->state = READER_VALUE;
+			continue;
+
+		case READER_NEXT:
+			if(c == ',')
+			{
+				r->ptr++;
+				r->state = (r->stack[r->depth - 1] == '{') ? READER_OBJECT : READER_ARRAY;
+				continue;
+			}
+			if((c != '}') && (c != ']'))
+				return (t->type = reader_error(r, "Expected ,"));
+			break;
+
+		case READER_OBJECT:
+			if(c == '"')
+			{
+				if(reader_string(r, t) != JSON_TOKEN_STRING)
+					return (t->type = JSON_TOKEN_ERROR);
+				r->state = READER_COLON;
+				return (t->type = JSON_TOKEN_KEY);
+			}
+			if(c != '}')
+				return (t->type = reader_error(r, "Expected key"));
+			break;
+
+		case READER_ARRAY:
+		case READER_VALUE:
+		default:
+			break;
+		}
+
+		switch(c)
+		{
+		case '}':
+		case ']':
+			if((r->depth == 0) || (r->stack[r->depth - 1] != ((c == '}') ? '{' : '[')) || (r->state == READER_VALUE))
+				return (t->type = reader_error(r, "Unexpected close bracket"));
+			r->depth--;
+			r->ptr++;
+			reader_value_done(r);
+			return (t->type = (c == '}') ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END);
+
+		case '{':
+		case '[':
+			if(r->depth >= JSON_READER_DEPTH)
+				return (t->type = reader_error(r, "Too deep"));
+			r->stack[r->depth++] = c;
+			r->ptr++;
+			r->state = (c == '{') ? READER_OBJECT : READER_ARRAY;
+			return (t->type = (c == '{') ? JSON_TOKEN_OBJECT_BEGIN : JSON_TOKEN_ARRAY_BEGIN);
+
+		case '"':
+			type = reader_string(r, t);
+			break;
+
+		case 't':
+			type = reader_literal(r, "true", 4);
+			if(type != JSON_TOKEN_ERROR)
+			{
+				t->u.boolean = 1;
+				type = JSON_TOKEN_BOOLEAN;
+			}
+			break;
+
+		case 'f':
+			type = reader_literal(r, "false", 5);
+			if(type != JSON_TOKEN_ERROR)
+			{
+				t->u.boolean = 0;
+				type = JSON_TOKEN_BOOLEAN;
+			}
+			break;
+
+		case 'n':
+			type = reader_literal(r, "null", 4);
+			break;
+
+		default:
+			if(isdigit(c) || (c == '-'))
+				type = reader_number(r, t);
+			else
+				type = reader_error(r, "Unexpected character when seeking value");
+			break;
+		}
+		if(type != JSON_TOKEN_ERROR)
+			reader_value_done(r);
+		return (t->type = type);
+	}
+}
+
+int json_reader_skip(struct json_reader_t * r)
+{
+	struct json_token_t t;
+	int depth = 0;
+
+	do {
+		switch(json_reader_next(r, &t))
+		{
+		case JSON_TOKEN_OBJECT_BEGIN:
+		case JSON_TOKEN_ARRAY_BEGIN:
+			depth++;
+			break;
+		case JSON_TOKEN_OBJECT_END:
+		case JSON_TOKEN_ARRAY_END:
+			if(--depth < 0)
+				return 0;
+			break;
+		case JSON_TOKEN_ERROR:
+		case JSON_TOKEN_EOF:
+			return 0;
+		default:
+			break;
+		}
+	} while(depth > 0);
+	return 1;
+}
+
+unsigned int json_string_unescape(char * dst, const char * src, unsigned int length)
+{
+	const char * end = src + length;
+	unsigned char b1, b2, b3, b4;
+	unsigned int uchar, uchar2;
+	char * d = dst;
+	char c;
+
+	while(src < end)
+	{
+		c = *src++;
+		if((c != '\\') || (src >= end))
+		{
+			*d++ = c;
+			continue;
+		}
+		switch(c = *src++)
+		{
+		case 'b':
+			*d++ = '\b';
+			break;
+		case 'f':
+			*d++ = '\f';
+			break;
+		case 'n':
+			*d++ = '\n';
+			break;
+		case 'r':
+			*d++ = '\r';
+			break;
+		case 't':
+			*d++ = '\t';
+			break;
+		case 'u':
+			if((end - src < 4)
+					|| (b1 = hex_value(src[0])) == 0xff
+					|| (b2 = hex_value(src[1])) == 0xff
+					|| (b3 = hex_value(src[2])) == 0xff
+					|| (b4 = hex_value(src[3])) == 0xff)
+			{
+				*d++ = c;
+				break;
+			}
+			src += 4;
+			uchar = (b1 << 12) | (b2 << 8) | (b3 << 4) | b4;
+			if(((uchar & 0xfc00) == 0xd800) && (end - src >= 6) && (src[0] == '\\') && (src[1] == 'u')
+					&& (b1 = hex_value(src[2])) != 0xff
+					&& (b2 = hex_value(src[3])) != 0xff
+					&& (b3 = hex_value(src[4])) != 0xff
+					&& (b4 = hex_value(src[5])) != 0xff)
+			{
+				uchar2 = (b1 << 12) | (b2 << 8) | (b3 << 4) | b4;
+				if((uchar2 & 0xfc00) == 0xdc00)
+				{
+					src += 6;
+					uchar = 0x010000 + (((uchar & 0x3ff) << 10) | (uchar2 & 0x3ff));
+				}
+			}
+			if(uchar <= 0x7f)
+			{
+				*d++ = uchar;
+			}
+			else if(uchar <= 0x7ff)
+			{
+				*d++ = 0xc0 | (uchar >> 6);
+				*d++ = 0x80 | (uchar & 0x3f);
+			}
+			else if(uchar <= 0xffff)
+			{
+				*d++ = 0xe0 | (uchar >> 12);
+				*d++ = 0x80 | ((uchar >> 6) & 0x3f);
+				*d++ = 0x80 | (uchar & 0x3f);
+			}
+			else
+			{
+				*d++ = 0xf0 | (uchar >> 18);
+				*d++ = 0x80 | ((uchar >> 12) & 0x3f);
+				*d++ = 0x80 | ((uchar >> 6) & 0x3f);
+				*d++ = 0x80 | (uchar & 0x3f);
+			}
+			break;
+		default:
+			*d++ = c;
+			break;
+		}
+	}
+	return d - dst;
+}
+
+static void insitu_error(struct json_reader_t * r, char * errbuf)
+{
+	if(errbuf)
+		sprintf(errbuf, "%d:%d: %s", r->line, (int)(r->ptr - r->bol + 1), r->error ? r->error : "Unknown error");
+}
+
+static char * insitu_string(struct json_token_t * t, unsigned int * length)
+{
+	char * s = (char *)t->ptr;
+
+	*length = t->escaped ? json_string_unescape(s, s, t->length) : t->length;
+	s[*length] = 0;
+	return s;
+}
+
+/*
+ * Two passes over the tokenizer, the first one only counts. Nodes, object entries and
+ * array slots then come from one block, and strings are unescaped into the source buffer
+ */
+struct json_value_t * json_parse_insitu(char * json, size_t length, char * errbuf)
+{
+	struct json_reader_t r;
+	struct json_token_t t;
+	struct json_value_t * values, * root = NULL, * cur = NULL, * v;
+	struct json_object_entry_t * entries, * estack, * e;
+	struct json_value_t ** slots, ** sstack;
+	unsigned int nvalue = 0, nentry = 0, nslot = 0;
+	unsigned int iv = 0, esp = 0, ssp = 0, n;
+	int depth;
+	char * name = NULL;
+	unsigned int name_length = 0;
+	void * block, * scratch;
+
+	json_reader_init(&r, json, length);
+	for(;;)
+	{
+		json_reader_next(&r, &t);
+		if(t.type == JSON_TOKEN_EOF)
+			break;
+		if(t.type == JSON_TOKEN_ERROR)
+		{
+			insitu_error(&r, errbuf);
+			return NULL;
+		}
+		if(t.type == JSON_TOKEN_KEY)
+			nentry++;
+		else if((t.type != JSON_TOKEN_OBJECT_END) && (t.type != JSON_TOKEN_ARRAY_END))
+		{
+			nvalue++;
+			depth = ((t.type == JSON_TOKEN_OBJECT_BEGIN) || (t.type == JSON_TOKEN_ARRAY_BEGIN)) ? r.depth - 1 : r.depth;
+			if((depth > 0) && (r.stack[depth - 1] == '['))
+				nslot++;
+		}
+	}
+
+	block = malloc(sizeof(struct json_value_t) * nvalue + sizeof(struct json_object_entry_t) * nentry + sizeof(struct json_value_t *) * nslot);
+	if(!block)
+	{
+		if(errbuf)
+			strcpy(errbuf, "Memory allocation failure");
+		return NULL;
+	}
+	scratch = malloc(sizeof(struct json_object_entry_t) * nentry + sizeof(struct json_value_t *) * nslot + 1);
+	if(!scratch)
+	{
+		free(block);
+		if(errbuf)
+			strcpy(errbuf, "Memory allocation failure");
+		return NULL;
+	}
+	values = (struct json_value_t *)block;
+	entries = (struct json_object_entry_t *)(values + nvalue);
+	slots = (struct json_value_t **)(entries + nentry);
+	estack = (struct json_object_entry_t *)scratch;
+	sstack = (struct json_value_t **)(estack + nentry);
+
+	json_reader_init(&r, json, length);
+	while(json_reader_next(&r, &t) > JSON_TOKEN_EOF)
+	{
+		switch(t.type)
+		{
+		case JSON_TOKEN_KEY:
+			name = insitu_string(&t, &name_length);
+			continue;
+
+		case JSON_TOKEN_OBJECT_END:
+			n = cur->u.object.length;
+			esp -= n;
+			memcpy(entries, &estack[esp], sizeof(struct json_object_entry_t) * n);
+			cur->u.object.values = n ? entries : NULL;
+			entries += n;
+			cur = cur->parent;
+			continue;
+
+		case JSON_TOKEN_ARRAY_END:
+			n = cur->u.array.length;
+			ssp -= n;
+			memcpy(slots, &sstack[ssp], sizeof(struct json_value_t *) * n);
+			cur->u.array.values = n ? slots : NULL;
+			slots += n;
+			cur = cur->parent;
+			continue;
+
+		default:
+			break;
+		}
+
+		v = &values[iv++];
+		v->parent = cur;
+		v->reserved.object_mem = NULL;
+		switch(t.type)
+		{
+		case JSON_TOKEN_OBJECT_BEGIN:
+			v->type = JSON_OBJECT;
+			v->u.object.length = 0;
+			v->u.object.values = NULL;
+			break;
+		case JSON_TOKEN_ARRAY_BEGIN:
+			v->type = JSON_ARRAY;
+			v->u.array.length = 0;
+			v->u.array.values = NULL;
+			break;
+		case JSON_TOKEN_STRING:
+			v->type = JSON_STRING;
+			v->u.string.ptr = insitu_string(&t, &v->u.string.length);
+			break;
+		case JSON_TOKEN_INTEGER:
+			v->type = JSON_INTEGER;
+			v->u.integer = t.u.integer;
+			break;
+		case JSON_TOKEN_DOUBLE:
+			v->type = JSON_DOUBLE;
+			v->u.dbl = t.u.dbl;
+			break;
+		case JSON_TOKEN_BOOLEAN:
+			v->type = JSON_BOOLEAN;
+			v->u.boolean = t.u.boolean;
+			break;
+		default:
+			v->type = JSON_NULL;
+			break;
+		}
+
+		if(!cur)
+		{
+			root = v;
+		}
+		else if(cur->type == JSON_OBJECT)
+		{
+			e = &estack[esp++];
+			e->name = name;
+			e->name_length = name_length;
+			e->value = v;
+			cur->u.object.length++;
+		}
+		else
+		{
+			sstack[ssp++] = v;
+			cur->u.array.length++;
+		}
+		if((v->type == JSON_OBJECT) || (v->type == JSON_ARRAY))
+			cur = v;
+	}
+	free(scratch);
+
+	if(!root)
+	{
+		free(block);
+		return NULL;
+	}
+	root->reserved.object_mem = root;
+	return root;
+}
+
+static void json_writer_put(struct json_writer_t * w, const char * s, size_t len)
+{
+	if(w->len + len > w->size)
+	{
+		json_writer_flush(w);
+		if(len > w->size)
+		{
+			if(w->flush)
+				w->flush(w, s, len);
+			else
+				w->overflow = 1;
+			return;
+		}
+		if(w->len + len > w->size)
+		{
+			w->overflow = 1;
+			return;
+		}
+	}
+	memcpy(w->buf + w->len, s, len);
+	w->len += len;
+}
+
+static inline void json_writer_putc(struct json_writer_t * w, char c)
+{
+	if(w->len >= w->size)
+	{
+		json_writer_flush(w);
+		if(w->len >= w->size)
+		{
+			w->overflow = 1;
+			return;
+		}
+	}
+	w->buf[w->len++] = c;
+}
+
+static void json_writer_prefix(struct json_writer_t * w)
+{
+	uint64_t bit = 1ULL << (w->depth & 63);
+
+	if(w->key)
+	{
+		w->key = 0;
+		return;
+	}
+	if(w->comma & bit)
+		json_writer_putc(w, ',');
+	w->comma |= bit;
+}
+
+static void json_writer_escape(struct json_writer_t * w, const char * s)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char * p = s;
+	char esc[6];
+	unsigned char c;
+
+	json_writer_putc(w, '"');
+	while((c = *p) != 0)
+	{
+		if((c >= 0x20) && (c != '"') && (c != '\\'))
+		{
+			p++;
+			continue;
+		}
+		if(p > s)
+			json_writer_put(w, s, p - s);
+		esc[0] = '\\';
+		switch(c)
+		{
+		case '"':
+		case '\\':
+			esc[1] = c;
+			json_writer_put(w, esc, 2);
+			break;
+		case '\n':
+			json_writer_put(w, "\\n", 2);
+			break;
+		case '\r':
+			json_writer_put(w, "\\r", 2);
+			break;
+		case '\t':
+			json_writer_put(w, "\\t", 2);
+			break;
+		default:
+			esc[1] = 'u';
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xf];
+			json_writer_put(w, esc, 6);
+			break;
+		}
+		s = ++p;
+	}
+	if(p > s)
+		json_writer_put(w, s, p - s);
+	json_writer_putc(w, '"');
+}
+
+void json_writer_init(struct json_writer_t * w, char * buf, size_t size, void (*flush)(struct json_writer_t *, const char *, size_t), void * priv)
+{
+	w->buf = buf;
+	w->size = size;
+	w->len = 0;
+	w->flush = flush;
+	w->priv = priv;
+	w->depth = 0;
+	w->overflow = 0;
+	w->comma = 0;
+	w->key = 0;
+}
+
+void json_writer_flush(struct json_writer_t * w)
+{
+	if(w->flush && (w->len > 0))
+	{
+		w->flush(w, w->buf, w->len);
+		w->len = 0;
+	}
+}
+
+void json_writer_object_begin(struct json_writer_t * w)
+{
+	json_writer_prefix(w);
+	json_writer_putc(w, '{');
+	w->depth++;
+	w->comma &= ~(1ULL << (w->depth & 63));
+}
+
+void json_writer_object_end(struct json_writer_t * w)
+{
+	w->depth--;
+	json_writer_putc(w, '}');
+}
+
+void json_writer_array_begin(struct json_writer_t * w)
+{
+	json_writer_prefix(w);
+	json_writer_putc(w, '[');
+	w->depth++;
+	w->comma &= ~(1ULL << (w->depth & 63));
+}
+
+void json_writer_array_end(struct json_writer_t * w)
+{
+	w->depth--;
+	json_writer_putc(w, ']');
+}
+
+void json_writer_key(struct json_writer_t * w, const char * key)
+{
+	json_writer_prefix(w);
+	json_writer_escape(w, key ? key : "");
+	json_writer_putc(w, ':');
+	w->key = 1;
+}
+
+void json_writer_string(struct json_writer_t * w, const char * s)
+{
+	json_writer_prefix(w);
+	if(s)
+		json_writer_escape(w, s);
+	else
+		json_writer_put(w, "null", 4);
+}
+
+void json_writer_integer(struct json_writer_t * w, int64_t v)
+{
+	char tmp[24];
+	char * p = &tmp[sizeof(tmp)];
+	uint64_t u = (v < 0) ? -(uint64_t)v : (uint64_t)v;
+
+	json_writer_prefix(w);
+	do {
+		*--p = '0' + (u % 10);
+		u /= 10;
+	} while(u);
+	if(v < 0)
+		*--p = '-';
+	json_writer_put(w, p, &tmp[sizeof(tmp)] - p);
+}
+
+void json_writer_double(struct json_writer_t * w, double v)
+{
+	char tmp[32];
+	int len;
+
+	json_writer_prefix(w);
+	if(isnan(v) || isinf(v))
+	{
+		json_writer_put(w, "null", 4);
+		return;
+	}
+	len = dtoa(v, tmp);
+	if(!strpbrk(tmp, ".e"))
+	{
+		tmp[len++] = '.';
+		tmp[len++] = '0';
+	}
+	json_writer_put(w, tmp, len);
+}
+
+void json_writer_boolean(struct json_writer_t * w, int v)
+{
+	json_writer_prefix(w);
+	if(v)
+		json_writer_put(w, "true", 4);
+	else
+		json_writer_put(w, "false", 5);
+}
+
+void json_writer_null(struct json_writer_t * w)
+{
+	json_writer_prefix(w);
+	json_writer_put(w, "null", 4);
+}
+
+void json_writer_raw(struct json_writer_t * w, const char * s, size_t len)
+{
+	json_writer_prefix(w);
+	json_writer_put(w, s, len);
+}
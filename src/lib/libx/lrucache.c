@@ -0,0 +1,391 @@
+/*
+ * libx/lrucache.c
+ */
+
+#include <types.h>
+#include <stddef.h>
+#include <string.h>
+#include <spinlock.h>
+#include <log2.h>
+#include <malloc.h>
+#include <lrucache.h>
+#include <xboot/slab.h>
+#include <xboot/module.h>
+
+static struct kmem_cache_t __lrucache_node_cache = KMEM_CACHE_INIT("lrucache_node", sizeof(struct lrucache_node_t), 0, NULL);
+
+static inline uint32_t lrucache_hash(const char * key, int nkey)
+{
+	uint32_t h = 5381;
+	int i;
+
+	for(i = 0; i < nkey; i++)
+		h = (h << 5) + h + key[i];
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	return h;
+}
+
+static inline struct lrucache_shard_t * lrucache_shard(struct lrucache_t * c, uint32_t hash)
+{
+	return &c->shard[(hash >> 24) & (c->nshard - 1)];
+}
+
+static struct lrucache_node_t * lrucache_node_alloc(const char * key, int nkey)
+{
+	struct lrucache_node_t * n;
+
+	n = kmem_cache_alloc(&__lrucache_node_cache);
+	if(!n)
+		return NULL;
+	if(nkey <= LRUCACHE_INLINE_KEY)
+	{
+		n->key = n->ikey;
+	}
+	else
+	{
+		n->key = malloc(nkey);
+		if(!n->key)
+		{
+			kmem_cache_free(&__lrucache_node_cache, n);
+			return NULL;
+		}
+	}
+	memcpy(n->key, key, nkey);
+	n->nkey = nkey;
+	return n;
+}
+
+static void lrucache_node_release(struct lrucache_t * c, struct list_head * head)
+{
+	struct lrucache_node_t * pos, * n;
+
+	list_for_each_entry_safe(pos, n, head, entry)
+	{
+		list_del(&pos->entry);
+		if(c->callback)
+			c->callback(c, pos->key, pos->nkey, pos->value, pos->size);
+		if(pos->key != pos->ikey)
+			free(pos->key);
+		kmem_cache_free(&__lrucache_node_cache, pos);
+	}
+}
+
+static struct lrucache_node_t * lrucache_find(struct lrucache_shard_t * s, const char * key, int nkey, uint32_t hash)
+{
+	struct lrucache_node_t * n;
+
+	for(n = s->table[hash & s->mask]; n; n = n->hnext)
+	{
+		if((n->hash == hash) && (n->nkey == nkey) && (memcmp(n->key, key, nkey) == 0))
+			return n;
+	}
+	return NULL;
+}
+
+static void lrucache_unlink(struct lrucache_shard_t * s, struct lrucache_node_t * n)
+{
+	struct lrucache_node_t ** pos;
+
+	for(pos = &s->table[n->hash & s->mask]; *pos; pos = &(*pos)->hnext)
+	{
+		if(*pos == n)
+		{
+			*pos = n->hnext;
+			break;
+		}
+	}
+	list_del(&n->entry);
+	s->bytes -= n->size;
+	if(!n->hot)
+		s->cbytes -= n->size;
+	s->count--;
+}
+
+static void lrucache_rehash(struct lrucache_shard_t * s)
+{
+	struct lrucache_node_t ** table;
+	struct lrucache_node_t * n, * next;
+	unsigned int size = (s->mask + 1) << 1;
+	unsigned int i;
+
+	table = malloc(sizeof(struct lrucache_node_t *) * size);
+	if(!table)
+		return;
+	memset(table, 0, sizeof(struct lrucache_node_t *) * size);
+	for(i = 0; i <= s->mask; i++)
+	{
+		for(n = s->table[i]; n; n = next)
+		{
+			next = n->hnext;
+			n->hnext = table[n->hash & (size - 1)];
+			table[n->hash & (size - 1)] = n;
+		}
+	}
+	free(s->table);
+	s->table = table;
+	s->mask = size - 1;
+}
+
+static void lrucache_evict(struct lrucache_t * c, struct lrucache_shard_t * s, size_t need, struct list_head * out)
+{
+	struct lrucache_node_t * n;
+
+	while((s->bytes + need > s->budget) && (s->count > 0))
+	{
+		if(!list_empty(&s->cold) && (list_empty(&s->hot) || (s->cbytes > (s->budget >> 2))))
+			n = list_last_entry(&s->cold, struct lrucache_node_t, entry);
+		else
+			n = list_last_entry(&s->hot, struct lrucache_node_t, entry);
+		lrucache_unlink(s, n);
+		list_add_tail(&n->entry, out);
+		s->evict++;
+	}
+}
+
+struct lrucache_t * lrucache_alloc(size_t budget, int nshard, int policy, void (*cb)(struct lrucache_t *, const char *, int, void *, size_t))
+{
+	struct lrucache_t * c;
+	struct lrucache_shard_t * s;
+	int i;
+
+	if(nshard < 1)
+		nshard = 1;
+	if(nshard & (nshard - 1))
+		nshard = roundup_pow_of_two(nshard);
+
+	c = malloc(sizeof(struct lrucache_t));
+	if(!c)
+		return NULL;
+	c->shard = malloc(sizeof(struct lrucache_shard_t) * nshard);
+	if(!c->shard)
+	{
+		free(c);
+		return NULL;
+	}
+	c->nshard = nshard;
+	c->policy = policy;
+	c->callback = cb;
+	for(i = 0; i < nshard; i++)
+	{
+		s = &c->shard[i];
+		spin_lock_init(&s->lock);
+		s->mask = 15;
+		s->table = malloc(sizeof(struct lrucache_node_t *) * (s->mask + 1));
+		if(!s->table)
+		{
+			while(--i >= 0)
+				free(c->shard[i].table);
+			free(c->shard);
+			free(c);
+			return NULL;
+		}
+		memset(s->table, 0, sizeof(struct lrucache_node_t *) * (s->mask + 1));
+		s->count = 0;
+		init_list_head(&s->cold);
+		init_list_head(&s->hot);
+		s->budget = budget / nshard;
+		s->bytes = 0;
+		s->cbytes = 0;
+		s->hit = 0;
+		s->miss = 0;
+		s->insert = 0;
+		s->evict = 0;
+	}
+	return c;
+}
+EXPORT_SYMBOL(lrucache_alloc);
+
+void lrucache_free(struct lrucache_t * c)
+{
+	int i;
+
+	if(c)
+	{
+		lrucache_clear(c);
+		for(i = 0; i < c->nshard; i++)
+			free(c->shard[i].table);
+		free(c->shard);
+		free(c);
+	}
+}
+EXPORT_SYMBOL(lrucache_free);
+
+void lrucache_clear(struct lrucache_t * c)
+{
+	struct lrucache_shard_t * s;
+	struct lrucache_node_t * n;
+	struct list_head out;
+	irq_flags_t flags;
+	int i;
+
+	if(!c)
+		return;
+	init_list_head(&out);
+	for(i = 0; i < c->nshard; i++)
+	{
+		s = &c->shard[i];
+		spin_lock_irqsave(&s->lock, flags);
+		while(s->count > 0)
+		{
+			n = list_empty(&s->cold) ? list_first_entry(&s->hot, struct lrucache_node_t, entry) : list_first_entry(&s->cold, struct lrucache_node_t, entry);
+			lrucache_unlink(s, n);
+			list_add_tail(&n->entry, &out);
+		}
+		spin_unlock_irqrestore(&s->lock, flags);
+	}
+	lrucache_node_release(c, &out);
+}
+EXPORT_SYMBOL(lrucache_clear);
+
+void * lrucache_get(struct lrucache_t * c, const char * key, int nkey)
+{
+	struct lrucache_shard_t * s;
+	struct lrucache_node_t * n;
+	irq_flags_t flags;
+	uint32_t hash;
+	void * value = NULL;
+
+	if(!c || !key)
+		return NULL;
+
+	hash = lrucache_hash(key, nkey);
+	s = lrucache_shard(c, hash);
+	spin_lock_irqsave(&s->lock, flags);
+	n = lrucache_find(s, key, nkey, hash);
+	if(n)
+	{
+		if(!n->hot)
+		{
+			n->hot = 1;
+			s->cbytes -= n->size;
+		}
+		list_move(&n->entry, &s->hot);
+		value = n->value;
+		s->hit++;
+	}
+	else
+	{
+		s->miss++;
+	}
+	spin_unlock_irqrestore(&s->lock, flags);
+	return value;
+}
+EXPORT_SYMBOL(lrucache_get);
+
+int lrucache_set(struct lrucache_t * c, const char * key, int nkey, void * value, size_t size)
+{
+	struct lrucache_shard_t * s;
+	struct lrucache_node_t * n, * old;
+	struct list_head out;
+	irq_flags_t flags;
+	uint32_t hash;
+
+	if(!c || !key)
+		return 0;
+
+	hash = lrucache_hash(key, nkey);
+	s = lrucache_shard(c, hash);
+	if(size > s->budget)
+		return 0;
+	n = lrucache_node_alloc(key, nkey);
+	if(!n)
+		return 0;
+	n->hash = hash;
+	n->value = value;
+	n->size = size;
+	n->hot = (c->policy == LRUCACHE_POLICY_2Q) ? 0 : 1;
+
+	init_list_head(&out);
+	spin_lock_irqsave(&s->lock, flags);
+	old = lrucache_find(s, key, nkey, hash);
+	if(old)
+	{
+		lrucache_unlink(s, old);
+		n->hot = old->hot;
+		if(old->value == value)
+		{
+			if(old->key != old->ikey)
+				free(old->key);
+			kmem_cache_free(&__lrucache_node_cache, old);
+		}
+		else
+		{
+			list_add_tail(&old->entry, &out);
+		}
+	}
+	lrucache_evict(c, s, size, &out);
+	if(s->count > s->mask)
+		lrucache_rehash(s);
+	n->hnext = s->table[hash & s->mask];
+	s->table[hash & s->mask] = n;
+	if(n->hot)
+	{
+		list_add(&n->entry, &s->hot);
+	}
+	else
+	{
+		list_add(&n->entry, &s->cold);
+		s->cbytes += size;
+	}
+	s->bytes += size;
+	s->count++;
+	s->insert++;
+	spin_unlock_irqrestore(&s->lock, flags);
+	lrucache_node_release(c, &out);
+	return 1;
+}
+EXPORT_SYMBOL(lrucache_set);
+
+int lrucache_remove(struct lrucache_t * c, const char * key, int nkey)
+{
+	struct lrucache_shard_t * s;
+	struct lrucache_node_t * n;
+	struct list_head out;
+	irq_flags_t flags;
+	uint32_t hash;
+
+	if(!c || !key)
+		return 0;
+
+	hash = lrucache_hash(key, nkey);
+	s = lrucache_shard(c, hash);
+	init_list_head(&out);
+	spin_lock_irqsave(&s->lock, flags);
+	n = lrucache_find(s, key, nkey, hash);
+	if(n)
+	{
+		lrucache_unlink(s, n);
+		list_add_tail(&n->entry, &out);
+	}
+	spin_unlock_irqrestore(&s->lock, flags);
+	lrucache_node_release(c, &out);
+	return n ? 1 : 0;
+}
+EXPORT_SYMBOL(lrucache_remove);
+
+void lrucache_stat(struct lrucache_t * c, struct lrucache_stat_t * st)
+{
+	struct lrucache_shard_t * s;
+	irq_flags_t flags;
+	int i;
+
+	if(!c || !st)
+		return;
+	memset(st, 0, sizeof(struct lrucache_stat_t));
+	for(i = 0; i < c->nshard; i++)
+	{
+		s = &c->shard[i];
+		spin_lock_irqsave(&s->lock, flags);
+		st->budget += s->budget;
+		st->bytes += s->bytes;
+		st->count += s->count;
+		st->hit += s->hit;
+		st->miss += s->miss;
+		st->insert += s->insert;
+		st->evict += s->evict;
+		spin_unlock_irqrestore(&s->lock, flags);
+	}
+}
+EXPORT_SYMBOL(lrucache_stat);
@@ -0,0 +1,274 @@
+/*
+ * libx/rhmap.c
+ */
+
+#include <types.h>
+#include <stddef.h>
+#include <string.h>
+#include <shash.h>
+#include <log2.h>
+#include <malloc.h>
+#include <rhmap.h>
+#include <xboot/module.h>
+
+#define RHMAP_MIGRATE_STEP		(16)
+
+static inline uint32_t rhmap_hash(const char * key)
+{
+	uint32_t h = shash(key);
+
+	/*
+	 * Spread the djb2 hash, similar keys would otherwise land in adjacent slots
+	 */
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	return h;
+}
+
+static struct rhmap_slot_t * rhmap_find(struct rhmap_slot_t * slot, unsigned int size, const char * key, uint32_t hash)
+{
+	unsigned int mask = size - 1;
+	unsigned int i = hash & mask;
+	uint32_t d;
+
+	for(d = 1; slot[i].dist >= d; d++, i = (i + 1) & mask)
+	{
+		if((slot[i].hash == hash) && slot[i].key && (strcmp(slot[i].key, key) == 0))
+			return &slot[i];
+	}
+	return NULL;
+}
+
+static void rhmap_insert(struct rhmap_slot_t * slot, unsigned int size, const char * key, void * value, uint32_t hash)
+{
+	struct rhmap_slot_t e, t;
+	unsigned int mask = size - 1;
+	unsigned int i = hash & mask;
+
+	e.key = key;
+	e.value = value;
+	e.hash = hash;
+	e.dist = 1;
+	while(slot[i].dist)
+	{
+		if(slot[i].dist < e.dist)
+		{
+			t = slot[i];
+			slot[i] = e;
+			e = t;
+		}
+		e.dist++;
+		i = (i + 1) & mask;
+	}
+	slot[i] = e;
+}
+
+static void rhmap_erase(struct rhmap_slot_t * slot, unsigned int size, struct rhmap_slot_t * s)
+{
+	unsigned int mask = size - 1;
+	unsigned int i = s - slot;
+	unsigned int j = (i + 1) & mask;
+
+	while(slot[j].dist > 1)
+	{
+		slot[i] = slot[j];
+		slot[i].dist--;
+		i = j;
+		j = (j + 1) & mask;
+	}
+	slot[i].key = NULL;
+	slot[i].value = NULL;
+	slot[i].dist = 0;
+}
+
+static void rhmap_migrate(struct rhmap_t * m, unsigned int step)
+{
+	struct rhmap_slot_t * s;
+
+	while(m->old && (step-- > 0))
+	{
+		s = &m->old[m->ocursor++];
+		if(s->dist && s->key)
+		{
+			rhmap_insert(m->slot, m->size, s->key, s->value, s->hash);
+			s->key = NULL;
+		}
+		if(m->ocursor >= m->osize)
+		{
+			free(m->old);
+			m->old = NULL;
+			m->osize = 0;
+			m->ocursor = 0;
+		}
+	}
+}
+
+static int rhmap_grow(struct rhmap_t * m)
+{
+	struct rhmap_slot_t * slot;
+
+	rhmap_migrate(m, m->osize);
+	slot = malloc(sizeof(struct rhmap_slot_t) * (m->size << 1));
+	if(!slot)
+		return 0;
+	memset(slot, 0, sizeof(struct rhmap_slot_t) * (m->size << 1));
+	m->old = m->slot;
+	m->osize = m->size;
+	m->ocursor = 0;
+	m->slot = slot;
+	m->size = m->size << 1;
+	return 1;
+}
+
+struct rhmap_t * rhmap_alloc(int size)
+{
+	struct rhmap_t * m;
+
+	if(size < 16)
+		size = 16;
+	if(size & (size - 1))
+		size = roundup_pow_of_two(size);
+
+	m = malloc(sizeof(struct rhmap_t));
+	if(!m)
+		return NULL;
+
+	m->slot = malloc(sizeof(struct rhmap_slot_t) * size);
+	if(!m->slot)
+	{
+		free(m);
+		return NULL;
+	}
+	memset(m->slot, 0, sizeof(struct rhmap_slot_t) * size);
+	m->size = size;
+	m->n = 0;
+	m->old = NULL;
+	m->osize = 0;
+	m->ocursor = 0;
+
+	return m;
+}
+EXPORT_SYMBOL(rhmap_alloc);
+
+void rhmap_free(struct rhmap_t * m)
+{
+	if(m)
+	{
+		if(m->old)
+			free(m->old);
+		free(m->slot);
+		free(m);
+	}
+}
+EXPORT_SYMBOL(rhmap_free);
+
+void rhmap_clear(struct rhmap_t * m)
+{
+	if(m)
+	{
+		if(m->old)
+		{
+			free(m->old);
+			m->old = NULL;
+			m->osize = 0;
+			m->ocursor = 0;
+		}
+		memset(m->slot, 0, sizeof(struct rhmap_slot_t) * m->size);
+		m->n = 0;
+	}
+}
+EXPORT_SYMBOL(rhmap_clear);
+
+int rhmap_add(struct rhmap_t * m, const char * key, void * value)
+{
+	struct rhmap_slot_t * s;
+	uint32_t hash;
+
+	if(!m || !key)
+		return 0;
+
+	hash = rhmap_hash(key);
+	rhmap_migrate(m, RHMAP_MIGRATE_STEP);
+	if((m->old && (s = rhmap_find(m->old, m->osize, key, hash))) || (s = rhmap_find(m->slot, m->size, key, hash)))
+	{
+		s->value = value;
+		return 1;
+	}
+	if(((m->n + 1) << 2) > m->size * 3)
+	{
+		if(!rhmap_grow(m) && (m->n + 1 >= m->size))
+			return 0;
+	}
+	rhmap_insert(m->slot, m->size, key, value, hash);
+	m->n++;
+	return 1;
+}
+EXPORT_SYMBOL(rhmap_add);
+
+void rhmap_remove(struct rhmap_t * m, const char * key)
+{
+	struct rhmap_slot_t * s;
+	uint32_t hash;
+
+	if(!m || !key)
+		return;
+
+	hash = rhmap_hash(key);
+	rhmap_migrate(m, RHMAP_MIGRATE_STEP);
+	if(m->old && (s = rhmap_find(m->old, m->osize, key, hash)))
+	{
+		/*
+		 * Leave a tombstone, shifting would move entries behind the migrate cursor
+		 */
+		s->key = NULL;
+		s->value = NULL;
+		m->n--;
+	}
+	else if((s = rhmap_find(m->slot, m->size, key, hash)))
+	{
+		rhmap_erase(m->slot, m->size, s);
+		m->n--;
+	}
+}
+EXPORT_SYMBOL(rhmap_remove);
+
+void * rhmap_search(struct rhmap_t * m, const char * key)
+{
+	struct rhmap_slot_t * s;
+	uint32_t hash;
+
+	if(!m || !key)
+		return NULL;
+
+	hash = rhmap_hash(key);
+	if((s = rhmap_find(m->slot, m->size, key, hash)))
+		return s->value;
+	if(m->old && (s = rhmap_find(m->old, m->osize, key, hash)))
+		return s->value;
+	return NULL;
+}
+EXPORT_SYMBOL(rhmap_search);
+
+void rhmap_walk(struct rhmap_t * m, void (*cb)(const char * key, void * value, void * data), void * data)
+{
+	unsigned int i;
+
+	if(!m || !cb)
+		return;
+
+	for(i = 0; i < m->size; i++)
+	{
+		if(m->slot[i].dist)
+			cb(m->slot[i].key, m->slot[i].value, data);
+	}
+	if(m->old)
+	{
+		for(i = m->ocursor; i < m->osize; i++)
+		{
+			if(m->old[i].dist && m->old[i].key)
+				cb(m->old[i].key, m->old[i].value, data);
+		}
+	}
+}
+EXPORT_SYMBOL(rhmap_walk);
@@ -0,0 +1,377 @@
+/*
+ * libx/ring.c
+ */
+
+#include <stddef.h>
+#include <barrier.h>
+#include <atomic.h>
+#include <irqflags.h>
+#include <log2.h>
+#include <string.h>
+#include <malloc.h>
+#include <ring.h>
+#include <xboot/module.h>
+
+#define RING_READ(x)		(*(volatile unsigned int *)&(x))
+#define RING_WRITE(x, v)	(*(volatile unsigned int *)&(x) = (v))
+
+struct ring_t * ring_alloc(unsigned int esize, unsigned int count)
+{
+	struct ring_t * r;
+
+	if(esize == 0)
+		return NULL;
+	if(count < 2)
+		count = 2;
+	if(count & (count - 1))
+		count = roundup_pow_of_two(count);
+
+	r = memalign(RING_CACHE_LINE, sizeof(struct ring_t));
+	if(!r)
+		return NULL;
+	r->buffer = malloc(esize * count);
+	if(!r->buffer)
+	{
+		free(r);
+		return NULL;
+	}
+	r->mask = count - 1;
+	r->esize = esize;
+	ring_reset(r);
+
+	return r;
+}
+EXPORT_SYMBOL(ring_alloc);
+
+void ring_free(struct ring_t * r)
+{
+	if(r)
+	{
+		free(r->buffer);
+		free(r);
+	}
+}
+EXPORT_SYMBOL(ring_free);
+
+void ring_reset(struct ring_t * r)
+{
+	r->head = r->ctail = 0;
+	r->tail = r->chead = 0;
+	smp_mb();
+}
+EXPORT_SYMBOL(ring_reset);
+
+unsigned int ring_count(struct ring_t * r)
+{
+	return RING_READ(r->head) - RING_READ(r->tail);
+}
+EXPORT_SYMBOL(ring_count);
+
+/*
+ * Producer side, *n is the number of slots wanted and is cut down to what is free
+ * and contiguous. Fill them in place and publish with ring_commit()
+ */
+void * ring_reserve(struct ring_t * r, unsigned int * n)
+{
+	unsigned int want = n ? *n : 1;
+	unsigned int head = r->head;
+	unsigned int size = r->mask + 1;
+	unsigned int idx, avail;
+
+	avail = size - (head - r->ctail);
+	if(avail < want)
+	{
+		r->ctail = RING_READ(r->tail);
+		smp_mb();
+		avail = size - (head - r->ctail);
+		if(avail == 0)
+			return NULL;
+	}
+	idx = head & r->mask;
+	avail = min(min(want, avail), size - idx);
+	if(n)
+		*n = avail;
+	return r->buffer + idx * r->esize;
+}
+EXPORT_SYMBOL(ring_reserve);
+
+void ring_commit(struct ring_t * r, unsigned int n)
+{
+	smp_wmb();
+	RING_WRITE(r->head, r->head + n);
+}
+EXPORT_SYMBOL(ring_commit);
+
+/*
+ * Consumer side, the mirror of ring_reserve(). Hand the slots back with ring_release()
+ */
+void * ring_peek(struct ring_t * r, unsigned int * n)
+{
+	unsigned int want = n ? *n : 1;
+	unsigned int tail = r->tail;
+	unsigned int size = r->mask + 1;
+	unsigned int idx, avail;
+
+	avail = r->chead - tail;
+	if(avail < want)
+	{
+		r->chead = RING_READ(r->head);
+		smp_rmb();
+		avail = r->chead - tail;
+		if(avail == 0)
+			return NULL;
+	}
+	idx = tail & r->mask;
+	avail = min(min(want, avail), size - idx);
+	if(n)
+		*n = avail;
+	return r->buffer + idx * r->esize;
+}
+EXPORT_SYMBOL(ring_peek);
+
+void ring_release(struct ring_t * r, unsigned int n)
+{
+	smp_mb();
+	RING_WRITE(r->tail, r->tail + n);
+}
+EXPORT_SYMBOL(ring_release);
+
+int ring_enqueue(struct ring_t * r, const void * e)
+{
+	void * p = ring_reserve(r, NULL);
+
+	if(!p)
+		return 0;
+	memcpy(p, e, r->esize);
+	ring_commit(r, 1);
+	return 1;
+}
+EXPORT_SYMBOL(ring_enqueue);
+
+unsigned int ring_dequeue(struct ring_t * r, void * buf, unsigned int n)
+{
+	unsigned int total = 0;
+	unsigned int k;
+	void * p;
+
+	while(total < n)
+	{
+		k = n - total;
+		p = ring_peek(r, &k);
+		if(!p)
+			break;
+		memcpy((unsigned char *)buf + total * r->esize, p, k * r->esize);
+		ring_release(r, k);
+		total += k;
+	}
+	return total;
+}
+EXPORT_SYMBOL(ring_dequeue);
+
+/*
+ * Without exclusive loads and stores the compare and swap of atomic.h is a plain read modify
+ * write, those parts are single core so masking interrupts keeps irq producers out of it
+ */
+static inline unsigned int mpmc_cmpxchg(atomic_t * a, unsigned int o, unsigned int n)
+{
+#if (defined(__ARM32_ARCH__) && (__ARM32_ARCH__ < 6)) || defined(__csky__) || (defined(__riscv) && !defined(__riscv_atomic))
+	irq_flags_t flags;
+	unsigned int v;
+
+	local_irq_save(flags);
+	v = atomic_cmpxchg(a, o, n);
+	local_irq_restore(flags);
+	return v;
+#else
+	return atomic_cmpxchg(a, o, n);
+#endif
+}
+
+static inline struct mpmc_cell_t * mpmc_cell(struct mpmc_ring_t * r, unsigned int pos)
+{
+	return (struct mpmc_cell_t *)(r->buffer + (pos & r->mask) * r->stride);
+}
+
+struct mpmc_ring_t * mpmc_ring_alloc(unsigned int esize, unsigned int count)
+{
+	struct mpmc_ring_t * r;
+	unsigned int i;
+
+	if(esize == 0)
+		return NULL;
+	if(count < 2)
+		count = 2;
+	if(count & (count - 1))
+		count = roundup_pow_of_two(count);
+
+	r = memalign(RING_CACHE_LINE, sizeof(struct mpmc_ring_t));
+	if(!r)
+		return NULL;
+	r->mask = count - 1;
+	r->esize = esize;
+	r->stride = (sizeof(struct mpmc_cell_t) + esize + 7) & ~7;
+	r->buffer = malloc(r->stride * count);
+	if(!r->buffer)
+	{
+		free(r);
+		return NULL;
+	}
+	for(i = 0; i < count; i++)
+		atomic_set(&mpmc_cell(r, i)->seq, i);
+	atomic_set(&r->head, 0);
+	atomic_set(&r->tail, 0);
+
+	return r;
+}
+EXPORT_SYMBOL(mpmc_ring_alloc);
+
+void mpmc_ring_free(struct mpmc_ring_t * r)
+{
+	if(r)
+	{
+		free(r->buffer);
+		free(r);
+	}
+}
+EXPORT_SYMBOL(mpmc_ring_free);
+
+unsigned int mpmc_ring_count(struct mpmc_ring_t * r)
+{
+	return (unsigned int)atomic_get(&r->head) - (unsigned int)atomic_get(&r->tail);
+}
+EXPORT_SYMBOL(mpmc_ring_count);
+
+void * mpmc_ring_reserve(struct mpmc_ring_t * r)
+{
+	struct mpmc_cell_t * c;
+	unsigned int pos, old;
+	int dif;
+
+	pos = atomic_get(&r->head);
+	for(;;)
+	{
+		c = mpmc_cell(r, pos);
+		dif = (int)((unsigned int)atomic_get(&c->seq) - pos);
+		if(dif == 0)
+		{
+			old = mpmc_cmpxchg(&r->head, pos, pos + 1);
+			if(old == pos)
+			{
+				c->ticket = pos;
+				return c + 1;
+			}
+			pos = old;
+		}
+		else if(dif < 0)
+			return NULL;
+		else
+			pos = atomic_get(&r->head);
+	}
+}
+EXPORT_SYMBOL(mpmc_ring_reserve);
+
+void mpmc_ring_commit(struct mpmc_ring_t * r, void * e)
+{
+	struct mpmc_cell_t * c = (struct mpmc_cell_t *)e - 1;
+
+	smp_wmb();
+	atomic_set(&c->seq, c->ticket + 1);
+}
+EXPORT_SYMBOL(mpmc_ring_commit);
+
+void * mpmc_ring_peek(struct mpmc_ring_t * r)
+{
+	struct mpmc_cell_t * c;
+	unsigned int pos, old;
+	int dif;
+
+	pos = atomic_get(&r->tail);
+	for(;;)
+	{
+		c = mpmc_cell(r, pos);
+		dif = (int)((unsigned int)atomic_get(&c->seq) - (pos + 1));
+		if(dif == 0)
+		{
+			old = mpmc_cmpxchg(&r->tail, pos, pos + 1);
+			if(old == pos)
+			{
+				c->ticket = pos;
+				smp_rmb();
+				return c + 1;
+			}
+			pos = old;
+		}
+		else if(dif < 0)
+			return NULL;
+		else
+			pos = atomic_get(&r->tail);
+	}
+}
+EXPORT_SYMBOL(mpmc_ring_peek);
+
+void mpmc_ring_release(struct mpmc_ring_t * r, void * e)
+{
+	struct mpmc_cell_t * c = (struct mpmc_cell_t *)e - 1;
+
+	smp_mb();
+	atomic_set(&c->seq, c->ticket + r->mask + 1);
+}
+EXPORT_SYMBOL(mpmc_ring_release);
+
+int mpmc_ring_enqueue(struct mpmc_ring_t * r, const void * e)
+{
+	void * p = mpmc_ring_reserve(r);
+
+	if(!p)
+		return 0;
+	memcpy(p, e, r->esize);
+	mpmc_ring_commit(r, p);
+	return 1;
+}
+EXPORT_SYMBOL(mpmc_ring_enqueue);
+
+/*
+ * Claims a run of full cells with a single compare and swap on the tail
+ */
+unsigned int mpmc_ring_dequeue(struct mpmc_ring_t * r, void * buf, unsigned int n)
+{
+	struct mpmc_cell_t * c;
+	unsigned int pos, old, k, i;
+	int dif;
+
+	if(n == 0)
+		return 0;
+	pos = atomic_get(&r->tail);
+	for(;;)
+	{
+		for(k = 0; k < n; k++)
+		{
+			c = mpmc_cell(r, pos + k);
+			if((unsigned int)atomic_get(&c->seq) != pos + k + 1)
+				break;
+		}
+		if(k == 0)
+		{
+			dif = (int)((unsigned int)atomic_get(&mpmc_cell(r, pos)->seq) - (pos + 1));
+			if(dif < 0)
+				return 0;
+			pos = atomic_get(&r->tail);
+			continue;
+		}
+		old = mpmc_cmpxchg(&r->tail, pos, pos + k);
+		if(old == pos)
+			break;
+		pos = old;
+	}
+	smp_rmb();
+	for(i = 0; i < k; i++)
+	{
+		c = mpmc_cell(r, pos + i);
+		memcpy((unsigned char *)buf + i * r->esize, c + 1, r->esize);
+	}
+	smp_mb();
+	for(i = 0; i < k; i++)
+		atomic_set(&mpmc_cell(r, pos + i)->seq, pos + i + r->mask + 1);
+	return k;
+}
+EXPORT_SYMBOL(mpmc_ring_dequeue);
@@ -7,6 +7,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <list.h>
 #include <lsort.h>
 #include <malloc.h>
@@ -83,10 +84,40 @@ static int slist_compare(void * priv, struct list_head * a, struct list_head * b
 	return strcmp(keya, keyb);
 }
 
+static int slist_compare_entry(const void * a, const void * b)
+{
+	return strcmp((*(struct slist_t **)a)->key, (*(struct slist_t **)b)->key);
+}
+
+/*
+ * Equal keys keep their order, so the array path uses the stable sort as lsort did
+ */
 void slist_sort(struct slist_t * sl)
 {
+	struct slist_t ** e, * pos;
+	int n = 0, i;
+
 	if(sl)
-		lsort(NULL, &sl->list, slist_compare);
+	{
+		list_for_each_entry(pos, &sl->list, list)
+			n++;
+		e = (n > 1) ? malloc(sizeof(struct slist_t *) * n) : NULL;
+		if(e)
+		{
+			i = 0;
+			list_for_each_entry(pos, &sl->list, list)
+				e[i++] = pos;
+			qsort_stable(e, n, sizeof(struct slist_t *), slist_compare_entry);
+			init_list_head(&sl->list);
+			for(i = 0; i < n; i++)
+				list_add_tail(&e[i]->list, &sl->list);
+			free(e);
+		}
+		else
+		{
+			lsort(NULL, &sl->list, slist_compare);
+		}
+	}
 }
 
 int slist_empty(struct slist_t * sl)
@@ -0,0 +1,149 @@
+/*
+ * wboxtest/benchmark-crypto/aes128.c
+ */
+
+#include <aes128.h>
+#include <wboxtest.h>
+
+struct wbt_aes128_pdata_t
+{
+	struct aes128_ctx_t ctx;
+	uint8_t iv[AES128_BLOCK_SIZE];
+	uint8_t * in;
+	uint8_t * out;
+	uint8_t * ref;
+	int size;
+};
+
+static void * aes128_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_aes128_pdata_t * pdat;
+	uint8_t key[AES128_KEY_SIZE];
+
+	pdat = malloc(sizeof(struct wbt_aes128_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	pdat->size = SZ_64K;
+	pdat->in = malloc(pdat->size);
+	pdat->out = malloc(pdat->size);
+	pdat->ref = malloc(pdat->size);
+	if(!pdat->in || !pdat->out || !pdat->ref)
+	{
+		free(pdat->in);
+		free(pdat->out);
+		free(pdat->ref);
+		free(pdat);
+		return NULL;
+	}
+	wboxtest_random_buffer((char *)key, sizeof(key));
+	wboxtest_random_buffer((char *)pdat->iv, sizeof(pdat->iv));
+	wboxtest_random_buffer((char *)pdat->in, pdat->size);
+	aes128_set_key(&pdat->ctx, key);
+
+	return pdat;
+}
+
+static void aes128_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_aes128_pdata_t * pdat = (struct wbt_aes128_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->in);
+		free(pdat->out);
+		free(pdat->ref);
+		free(pdat);
+	}
+}
+
+static void ecb_enc(struct wbt_aes128_pdata_t * pdat) { aes128_ecb_encrypt(&pdat->ctx, pdat->in, pdat->out, pdat->size / 16); }
+static void ecb_dec(struct wbt_aes128_pdata_t * pdat) { aes128_ecb_decrypt(&pdat->ctx, pdat->in, pdat->out, pdat->size / 16); }
+static void ecb_enc_generic(struct wbt_aes128_pdata_t * pdat) { aes128_ecb_encrypt_generic(&pdat->ctx, pdat->in, pdat->out, pdat->size / 16); }
+static void ecb_dec_generic(struct wbt_aes128_pdata_t * pdat) { aes128_ecb_decrypt_generic(&pdat->ctx, pdat->in, pdat->out, pdat->size / 16); }
+static void cbc_enc(struct wbt_aes128_pdata_t * pdat) { aes128_cbc_encrypt(&pdat->ctx, pdat->iv, pdat->in, pdat->out, pdat->size / 16); }
+static void cbc_dec(struct wbt_aes128_pdata_t * pdat) { aes128_cbc_decrypt(&pdat->ctx, pdat->iv, pdat->in, pdat->out, pdat->size / 16); }
+static void ctr_enc(struct wbt_aes128_pdata_t * pdat) { aes128_ctr_encrypt(&pdat->ctx, 0, pdat->in, pdat->out, pdat->size); }
+
+static const struct {
+	const char * name;
+	void (*crypt)(struct wbt_aes128_pdata_t *);
+} aes128_mode[] = {
+	{ "ecb-enc",			ecb_enc },
+	{ "ecb-enc generic",	ecb_enc_generic },
+	{ "ecb-dec",			ecb_dec },
+	{ "ecb-dec generic",	ecb_dec_generic },
+	{ "cbc-enc",			cbc_enc },
+	{ "cbc-dec",			cbc_dec },
+	{ "ctr",				ctr_enc },
+};
+
+static void aes128_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_aes128_pdata_t * pdat = (struct wbt_aes128_pdata_t *)data;
+	uint8_t chain[AES128_BLOCK_SIZE];
+	ktime_t t1, t2;
+	char buf[32];
+	int blks = pdat ? pdat->size / 16 : 0;
+	int calls;
+
+	if(pdat)
+	{
+		aes128_ecb_encrypt(&pdat->ctx, pdat->in, pdat->out, blks);
+		aes128_ecb_encrypt_generic(&pdat->ctx, pdat->in, pdat->ref, blks);
+		assert_memory_equal(pdat->out, pdat->ref, pdat->size);
+		aes128_ecb_decrypt(&pdat->ctx, pdat->in, pdat->out, blks);
+		aes128_ecb_decrypt_generic(&pdat->ctx, pdat->in, pdat->ref, blks);
+		assert_memory_equal(pdat->out, pdat->ref, pdat->size);
+
+		aes128_cbc_encrypt(&pdat->ctx, pdat->iv, pdat->in, pdat->out, blks);
+		memcpy(chain, pdat->iv, sizeof(chain));
+		for(int i = 0; i < blks; i++)
+		{
+			for(int j = 0; j < 16; j++)
+				chain[j] ^= pdat->in[i * 16 + j];
+			aes128_ecb_encrypt_generic(&pdat->ctx, chain, chain, 1);
+			memcpy(&pdat->ref[i * 16], chain, 16);
+		}
+		assert_memory_equal(pdat->out, pdat->ref, pdat->size);
+		aes128_cbc_decrypt(&pdat->ctx, pdat->iv, pdat->out, pdat->out, blks);
+		assert_memory_equal(pdat->out, pdat->in, pdat->size);
+
+		aes128_ctr_encrypt(&pdat->ctx, 7, pdat->in, pdat->out, pdat->size - 7);
+		aes128_ctr_decrypt(&pdat->ctx, 7, pdat->out, pdat->ref, pdat->size - 7);
+		assert_memory_equal(pdat->in, pdat->ref, pdat->size - 7);
+
+		for(int i = 0; i < ARRAY_SIZE(aes128_mode); i++)
+		{
+			calls = 0;
+			t2 = t1 = ktime_get();
+			do {
+				calls++;
+				aes128_mode[i].crypt(pdat);
+				t2 = ktime_get();
+			} while(ktime_before(t2, ktime_add_ms(t1, 400)));
+			wboxtest_print(" %-16s: %s/s\r\n", aes128_mode[i].name, ssize(buf, (double)calls * pdat->size * 1000.0 / ktime_ms_delta(t2, t1)));
+		}
+	}
+}
+
+static struct wboxtest_t wbt_aes128 = {
+	.group	= "benchmark-crypto",
+	.name	= "aes128",
+	.setup	= aes128_setup,
+	.clean	= aes128_clean,
+	.run	= aes128_run,
+};
+
+static __init void aes128_wbt_init(void)
+{
+	register_wboxtest(&wbt_aes128);
+}
+
+static __exit void aes128_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_aes128);
+}
+
+wboxtest_initcall(aes128_wbt_init);
+wboxtest_exitcall(aes128_wbt_exit);
@@ -0,0 +1,116 @@
+/*
+ * wboxtest/benchmark-crypto/crc32.c
+ */
+
+#include <crc32.h>
+#include <wboxtest.h>
+
+struct wbt_crc32_pdata_t
+{
+	uint8_t * buf;
+	int size;
+};
+
+static void * crc32_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_crc32_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_crc32_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	pdat->size = SZ_1M;
+	pdat->buf = malloc(pdat->size);
+	if(!pdat->buf)
+	{
+		free(pdat);
+		return NULL;
+	}
+	wboxtest_random_buffer((char *)pdat->buf, pdat->size);
+
+	return pdat;
+}
+
+static void crc32_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_crc32_pdata_t * pdat = (struct wbt_crc32_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->buf);
+		free(pdat);
+	}
+}
+
+static double crc32_speed(uint32_t (*sum)(uint32_t, const uint8_t *, int), const uint8_t * buf, int size)
+{
+	ktime_t t1, t2;
+	uint32_t crc = 0;
+	int batch = (size < SZ_64K) ? SZ_64K / size : 1;
+	int calls = 0;
+
+	t2 = t1 = ktime_get();
+	do {
+		for(int j = 0; j < batch; j++)
+		{
+			calls++;
+			crc = sum(crc, buf, size);
+		}
+		t2 = ktime_get();
+	} while(ktime_before(t2, ktime_add_ms(t1, 400)));
+	return (double)calls * size * 1000.0 / ktime_ms_delta(t2, t1);
+}
+
+static const int crc32_size[] = {
+	64, SZ_4K, SZ_64K, SZ_1M,
+};
+
+static void crc32_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_crc32_pdata_t * pdat = (struct wbt_crc32_pdata_t *)data;
+	char buf1[32], buf2[32];
+	uint32_t seed;
+	int off, len;
+	int miss = 0;
+
+	if(pdat)
+	{
+		for(int i = 0; i < 1024; i++)
+		{
+			off = wboxtest_random_int(0, 15);
+			len = (i < 512) ? i : wboxtest_random_int(0, SZ_64K);
+			seed = wboxtest_random_int(0, 0x7fffffff);
+			if(crc32_sum(seed, pdat->buf + off, len) != crc32_sum_generic(seed, pdat->buf + off, len))
+				miss++;
+		}
+		assert_equal(miss, 0);
+
+		for(int i = 0; i < ARRAY_SIZE(crc32_size); i++)
+		{
+			ssize(buf1, crc32_speed(crc32_sum, pdat->buf, crc32_size[i]));
+			ssize(buf2, crc32_speed(crc32_sum_generic, pdat->buf, crc32_size[i]));
+			wboxtest_print(" %8ld Bytes: %s/s, generic %s/s\r\n", (long)crc32_size[i], buf1, buf2);
+		}
+	}
+}
+
+static struct wboxtest_t wbt_crc32 = {
+	.group	= "benchmark-crypto",
+	.name	= "crc32",
+	.setup	= crc32_setup,
+	.clean	= crc32_clean,
+	.run	= crc32_run,
+};
+
+static __init void crc32_wbt_init(void)
+{
+	register_wboxtest(&wbt_crc32);
+}
+
+static __exit void crc32_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_crc32);
+}
+
+wboxtest_initcall(crc32_wbt_init);
+wboxtest_exitcall(crc32_wbt_exit);
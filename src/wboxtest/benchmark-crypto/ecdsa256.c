@@ -0,0 +1,125 @@
+/*
+ * wboxtest/benchmark-crypto/ecdsa256.c
+ */
+
+#include <ecdsa256.h>
+#include <wboxtest.h>
+
+struct wbt_ecdsa256_pdata_t
+{
+	uint8_t pub[ECDSA256_PUBLIC_KEY_SIZE];
+	uint8_t priv[ECDSA256_PRIVATE_KEY_SIZE];
+	uint8_t sign[ECDSA256_SIGNATURE_SIZE];
+	uint8_t msg[32];
+};
+
+static void * ecdsa256_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_ecdsa256_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_ecdsa256_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	wboxtest_random_buffer((char *)pdat->msg, sizeof(pdat->msg));
+	if(!ecdsa256_keygen(pdat->pub, pdat->priv) || !ecdsa256_sign(pdat->priv, pdat->msg, pdat->sign))
+	{
+		free(pdat);
+		return NULL;
+	}
+
+	return pdat;
+}
+
+static void ecdsa256_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_ecdsa256_pdata_t * pdat = (struct wbt_ecdsa256_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void ecdsa256_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_ecdsa256_pdata_t * pdat = (struct wbt_ecdsa256_pdata_t *)data;
+	const uint8_t pub[ECDSA256_PUBLIC_KEY_SIZE] = {
+		0x03, 0x60, 0xfe, 0xd4, 0xba, 0x25, 0x5a, 0x9d, 0x31, 0xc9, 0x61, 0xeb, 0x74, 0xc6, 0x35, 0x6d,
+		0x68, 0xc0, 0x49, 0xb8, 0x92, 0x3b, 0x61, 0xfa, 0x6c, 0xe6, 0x69, 0x62, 0x2e, 0x60, 0xf2, 0x9f,
+		0xb6,
+	};
+	const uint8_t msg[32] = {
+		0xaf, 0x2b, 0xdb, 0xe1, 0xaa, 0x9b, 0x6e, 0xc1, 0xe2, 0xad, 0xe1, 0xd6, 0x94, 0xf4, 0x1f, 0xc7,
+		0x1a, 0x83, 0x1d, 0x02, 0x68, 0xe9, 0x89, 0x15, 0x62, 0x11, 0x3d, 0x8a, 0x62, 0xad, 0xd1, 0xbf,
+	};
+	const uint8_t sign[ECDSA256_SIGNATURE_SIZE] = {
+		0xef, 0xd4, 0x8b, 0x2a, 0xac, 0xb6, 0xa8, 0xfd, 0x11, 0x40, 0xdd, 0x9c, 0xd4, 0x5e, 0x81, 0xd6,
+		0x9d, 0x2c, 0x87, 0x7b, 0x56, 0xaa, 0xf9, 0x91, 0xc3, 0x4d, 0x0e, 0xa8, 0x4e, 0xaf, 0x37, 0x16,
+		0xf7, 0xcb, 0x1c, 0x94, 0x2d, 0x65, 0x7c, 0x41, 0xd4, 0x36, 0xc7, 0xa1, 0xb6, 0xe2, 0x9f, 0x65,
+		0xf3, 0xe9, 0x00, 0xdb, 0xb9, 0xaf, 0xf4, 0x06, 0x4d, 0xc4, 0xab, 0x2f, 0x84, 0x3a, 0xcd, 0xa8,
+	};
+	uint8_t tpub[ECDSA256_PUBLIC_KEY_SIZE];
+	uint8_t tpriv[ECDSA256_PRIVATE_KEY_SIZE];
+	uint8_t tsign[ECDSA256_SIGNATURE_SIZE];
+	ktime_t t1, t2;
+	int calls, miss;
+
+	if(pdat)
+	{
+		assert_true(ecdsa256_verify(pub, msg, sign));
+		assert_true(ecdsa256_verify(pdat->pub, pdat->msg, pdat->sign));
+
+		t2 = t1 = ktime_get();
+		calls = miss = 0;
+		do {
+			calls++;
+			if(!ecdsa256_verify(pdat->pub, pdat->msg, pdat->sign))
+				miss++;
+			t2 = ktime_get();
+		} while(ktime_before(t2, ktime_add_ms(t1, 1000)));
+		assert_equal(miss, 0);
+		wboxtest_print(" verify: %d ops/s, %d us/op\r\n", (int)(calls * 1000LL / ktime_ms_delta(t2, t1)), (int)(ktime_us_delta(t2, t1) / calls));
+
+		t2 = t1 = ktime_get();
+		calls = miss = 0;
+		do {
+			calls++;
+			if(!ecdsa256_sign(pdat->priv, pdat->msg, tsign))
+				miss++;
+			t2 = ktime_get();
+		} while(ktime_before(t2, ktime_add_ms(t1, 1000)));
+		assert_equal(miss, 0);
+		wboxtest_print("   sign: %d ops/s, %d us/op\r\n", (int)(calls * 1000LL / ktime_ms_delta(t2, t1)), (int)(ktime_us_delta(t2, t1) / calls));
+
+		t2 = t1 = ktime_get();
+		calls = miss = 0;
+		do {
+			calls++;
+			if(!ecdsa256_keygen(tpub, tpriv))
+				miss++;
+			t2 = ktime_get();
+		} while(ktime_before(t2, ktime_add_ms(t1, 1000)));
+		assert_equal(miss, 0);
+		wboxtest_print(" keygen: %d ops/s, %d us/op\r\n", (int)(calls * 1000LL / ktime_ms_delta(t2, t1)), (int)(ktime_us_delta(t2, t1) / calls));
+	}
+}
+
+static struct wboxtest_t wbt_ecdsa256 = {
+	.group	= "benchmark-crypto",
+	.name	= "ecdsa256",
+	.setup	= ecdsa256_setup,
+	.clean	= ecdsa256_clean,
+	.run	= ecdsa256_run,
+};
+
+static __init void ecdsa256_wbt_init(void)
+{
+	register_wboxtest(&wbt_ecdsa256);
+}
+
+static __exit void ecdsa256_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_ecdsa256);
+}
+
+wboxtest_initcall(ecdsa256_wbt_init);
+wboxtest_exitcall(ecdsa256_wbt_exit);
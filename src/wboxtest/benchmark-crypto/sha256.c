@@ -0,0 +1,128 @@
+/*
+ * wboxtest/benchmark-crypto/sha256.c
+ */
+
+#include <sha256.h>
+#include <wboxtest.h>
+
+struct wbt_sha256_pdata_t
+{
+	uint8_t * buf;
+	int size;
+};
+
+static void * sha256_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_sha256_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_sha256_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	pdat->size = SZ_1M;
+	pdat->buf = malloc(pdat->size + 1);
+	if(!pdat->buf)
+	{
+		free(pdat);
+		return NULL;
+	}
+	wboxtest_random_buffer((char *)pdat->buf, pdat->size + 1);
+
+	return pdat;
+}
+
+static void sha256_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_sha256_pdata_t * pdat = (struct wbt_sha256_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->buf);
+		free(pdat);
+	}
+}
+
+static double sha256_speed(void (*blocks)(uint32_t *, const uint8_t *, int), const uint8_t * buf, int size)
+{
+	struct sha256_ctx_t ctx;
+	ktime_t t1, t2;
+	int batch = (size < SZ_64K) ? SZ_64K / size : 1;
+	int calls = 0;
+
+	sha256_init(&ctx);
+	t2 = t1 = ktime_get();
+	do {
+		for(int j = 0; j < batch; j++)
+		{
+			calls++;
+			blocks(ctx.state, buf, size / 64);
+		}
+		t2 = ktime_get();
+	} while(ktime_before(t2, ktime_add_ms(t1, 400)));
+	return (double)calls * size * 1000.0 / ktime_ms_delta(t2, t1);
+}
+
+static const int sha256_size[] = {
+	64, SZ_4K, SZ_64K, SZ_1M,
+};
+
+static void sha256_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_sha256_pdata_t * pdat = (struct wbt_sha256_pdata_t *)data;
+	const uint8_t abc[SHA256_DIGEST_SIZE] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+	};
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	struct sha256_ctx_t c1, c2;
+	char buf1[32], buf2[32];
+	int off, blks;
+	int miss = 0;
+
+	if(pdat)
+	{
+		sha256_hash("abc", 3, digest);
+		assert_memory_equal(digest, abc, SHA256_DIGEST_SIZE);
+
+		for(int i = 0; i < 256; i++)
+		{
+			off = wboxtest_random_int(0, 1);
+			blks = wboxtest_random_int(1, 64);
+			sha256_init(&c1);
+			sha256_init(&c2);
+			sha256_blocks(c1.state, pdat->buf + off, blks);
+			sha256_blocks_generic(c2.state, pdat->buf + off, blks);
+			if(memcmp(c1.state, c2.state, sizeof(c1.state)) != 0)
+				miss++;
+		}
+		assert_equal(miss, 0);
+
+		for(int i = 0; i < ARRAY_SIZE(sha256_size); i++)
+		{
+			ssize(buf1, sha256_speed(sha256_blocks, pdat->buf, sha256_size[i]));
+			ssize(buf2, sha256_speed(sha256_blocks_generic, pdat->buf, sha256_size[i]));
+			wboxtest_print(" %8ld Bytes: %s/s, generic %s/s\r\n", (long)sha256_size[i], buf1, buf2);
+		}
+	}
+}
+
+static struct wboxtest_t wbt_sha256 = {
+	.group	= "benchmark-crypto",
+	.name	= "sha256",
+	.setup	= sha256_setup,
+	.clean	= sha256_clean,
+	.run	= sha256_run,
+};
+
+static __init void sha256_wbt_init(void)
+{
+	register_wboxtest(&wbt_sha256);
+}
+
+static __exit void sha256_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_sha256);
+}
+
+wboxtest_initcall(sha256_wbt_init);
+wboxtest_exitcall(sha256_wbt_exit);
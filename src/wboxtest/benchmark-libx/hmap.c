@@ -0,0 +1,166 @@
+/*
+ * wboxtest/benchmark-libx/hmap.c
+ */
+
+#include <wboxtest.h>
+
+#define HMAP_BENCH_KEYS		(4096)
+#define HMAP_BENCH_ROUNDS	(32)
+
+struct wbt_hmap_pdata_t
+{
+	char (*key)[16];
+	int * order;
+	int count;
+};
+
+static void * hmap_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_hmap_pdata_t * pdat;
+	int i, j, t;
+
+	pdat = malloc(sizeof(struct wbt_hmap_pdata_t));
+	if(!pdat)
+		return NULL;
+	pdat->key = malloc(HMAP_BENCH_KEYS * sizeof(pdat->key[0]));
+	pdat->order = malloc(HMAP_BENCH_KEYS * sizeof(int));
+	if(!pdat->key || !pdat->order)
+	{
+		free(pdat->key);
+		free(pdat->order);
+		free(pdat);
+		return NULL;
+	}
+	for(i = 0; i < HMAP_BENCH_KEYS; i++)
+	{
+		snprintf(pdat->key[i], sizeof(pdat->key[0]), "key-%d", i);
+		pdat->order[i] = i;
+	}
+	/*
+	 * Search in random order, walking keys in sequence only measures prefetching
+	 */
+	for(i = HMAP_BENCH_KEYS - 1; i > 0; i--)
+	{
+		j = wboxtest_random_int(0, i);
+		t = pdat->order[i];
+		pdat->order[i] = pdat->order[j];
+		pdat->order[j] = t;
+	}
+	pdat->count = HMAP_BENCH_KEYS;
+
+	return pdat;
+}
+
+static void hmap_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_hmap_pdata_t * pdat = (struct wbt_hmap_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->order);
+		free(pdat->key);
+		free(pdat);
+	}
+}
+
+static void hmap_report(const char * name, int add, int search, int remove)
+{
+	wboxtest_print(" %-6s add: %8d us, search: %8d us, remove: %8d us\r\n", name, add, search, remove);
+}
+
+static void hmap_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_hmap_pdata_t * pdat = (struct wbt_hmap_pdata_t *)data;
+	struct hmap_t * hm;
+	struct rhmap_t * rm;
+	struct hmap_entry_t * e, * prev;
+	ktime_t t1, t2, t3, t4, t5;
+	int i, j, k, miss;
+
+	if(pdat)
+	{
+		hm = hmap_alloc(0, NULL);
+		assert_not_null(hm);
+		if(!hm)
+			return;
+		t1 = ktime_get();
+		for(i = 0; i < pdat->count; i++)
+			hmap_add(hm, pdat->key[i], (void *)(unsigned long)(i + 1));
+		t2 = ktime_get();
+		for(j = 0, miss = 0; j < HMAP_BENCH_ROUNDS; j++)
+		{
+			for(i = 0; i < pdat->count; i++)
+			{
+				k = pdat->order[i];
+				if(hmap_search(hm, pdat->key[k]) != (void *)(unsigned long)(k + 1))
+					miss++;
+			}
+		}
+		t3 = ktime_get();
+		hmap_sort(hm);
+		t5 = ktime_get();
+		prev = NULL;
+		hmap_for_each_entry(e, hm)
+		{
+			if(prev && (strcmp(prev->key, e->key) >= 0))
+				miss++;
+			prev = e;
+		}
+		wboxtest_print(" %-6s sort: %8d us\r\n", "hmap", (int)ktime_us_delta(t5, t3));
+		t5 = ktime_get();
+		for(i = 0; i < pdat->count; i++)
+			hmap_remove(hm, pdat->key[i]);
+		t4 = ktime_get();
+		assert_equal(miss, 0);
+		assert_equal(hm->n, 0);
+		hmap_free(hm);
+		hmap_report("hmap", ktime_us_delta(t2, t1), ktime_us_delta(t3, t2), ktime_us_delta(t4, t5));
+
+		rm = rhmap_alloc(0);
+		assert_not_null(rm);
+		if(!rm)
+			return;
+		t1 = ktime_get();
+		for(i = 0; i < pdat->count; i++)
+			rhmap_add(rm, pdat->key[i], (void *)(unsigned long)(i + 1));
+		t2 = ktime_get();
+		for(j = 0, miss = 0; j < HMAP_BENCH_ROUNDS; j++)
+		{
+			for(i = 0; i < pdat->count; i++)
+			{
+				k = pdat->order[i];
+				if(rhmap_search(rm, pdat->key[k]) != (void *)(unsigned long)(k + 1))
+					miss++;
+			}
+		}
+		t3 = ktime_get();
+		for(i = 0; i < pdat->count; i++)
+			rhmap_remove(rm, pdat->key[i]);
+		t4 = ktime_get();
+		assert_equal(miss, 0);
+		assert_equal(rm->n, 0);
+		rhmap_free(rm);
+		hmap_report("rhmap", ktime_us_delta(t2, t1), ktime_us_delta(t3, t2), ktime_us_delta(t4, t3));
+	}
+}
+
+static struct wboxtest_t wbt_hmap = {
+	.group	= "benchmark-libx",
+	.name	= "hmap",
+	.setup	= hmap_setup,
+	.clean	= hmap_clean,
+	.run	= hmap_run,
+};
+
+static __init void hmap_wbt_init(void)
+{
+	register_wboxtest(&wbt_hmap);
+}
+
+static __exit void hmap_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_hmap);
+}
+
+wboxtest_initcall(hmap_wbt_init);
+wboxtest_exitcall(hmap_wbt_exit);
@@ -0,0 +1,224 @@
+/*
+ * wboxtest/benchmark-libx/json.c
+ */
+
+#include <wboxtest.h>
+
+#define JSON_BENCH_NODES	(1024)
+#define JSON_BENCH_ROUNDS	(16)
+
+struct wbt_json_pdata_t
+{
+	char * json;
+	char * copy;
+	size_t len;
+	size_t size;
+};
+
+static void json_bench_write(struct json_writer_t * w)
+{
+	char name[32];
+	int i;
+
+	json_writer_object_begin(w);
+	for(i = 0; i < JSON_BENCH_NODES; i++)
+	{
+		snprintf(name, sizeof(name), "gpio-led@%d", i);
+		json_writer_key(w, name);
+		json_writer_object_begin(w);
+		json_writer_key(w, "name");
+		json_writer_string(w, "led \"status\"\n");
+		json_writer_key(w, "gpio");
+		json_writer_integer(w, i);
+		json_writer_key(w, "gpio-config");
+		json_writer_integer(w, -1);
+		json_writer_key(w, "active-low");
+		json_writer_boolean(w, i & 1);
+		json_writer_key(w, "brightness");
+		json_writer_double(w, i * 0.25);
+		json_writer_key(w, "default-trigger");
+		json_writer_null(w);
+		json_writer_key(w, "regs");
+		json_writer_array_begin(w);
+		json_writer_integer(w, 0x1c20800 + i * 4);
+		json_writer_integer(w, 4);
+		json_writer_array_end(w);
+		json_writer_object_end(w);
+	}
+	json_writer_object_end(w);
+}
+
+static void * json_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_json_pdata_t * pdat;
+	struct json_writer_t w;
+
+	pdat = malloc(sizeof(struct wbt_json_pdata_t));
+	if(!pdat)
+		return NULL;
+	pdat->size = JSON_BENCH_NODES * 256;
+	pdat->json = malloc(pdat->size);
+	pdat->copy = malloc(pdat->size);
+	if(!pdat->json || !pdat->copy)
+	{
+		free(pdat->json);
+		free(pdat->copy);
+		free(pdat);
+		return NULL;
+	}
+	json_writer_init(&w, pdat->json, pdat->size, NULL, NULL);
+	json_bench_write(&w);
+	pdat->len = w.overflow ? 0 : w.len;
+
+	return pdat;
+}
+
+static void json_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_json_pdata_t * pdat = (struct wbt_json_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->json);
+		free(pdat->copy);
+		free(pdat);
+	}
+}
+
+static int json_bench_equal(struct json_value_t * a, struct json_value_t * b)
+{
+	int i;
+
+	if(a->type != b->type)
+		return 0;
+	switch(a->type)
+	{
+	case JSON_OBJECT:
+		if(a->u.object.length != b->u.object.length)
+			return 0;
+		for(i = 0; i < a->u.object.length; i++)
+		{
+			if(strcmp(a->u.object.values[i].name, b->u.object.values[i].name) != 0)
+				return 0;
+			if(!json_bench_equal(a->u.object.values[i].value, b->u.object.values[i].value))
+				return 0;
+		}
+		return 1;
+	case JSON_ARRAY:
+		if(a->u.array.length != b->u.array.length)
+			return 0;
+		for(i = 0; i < a->u.array.length; i++)
+		{
+			if(!json_bench_equal(a->u.array.values[i], b->u.array.values[i]))
+				return 0;
+		}
+		return 1;
+	case JSON_STRING:
+		return (a->u.string.length == b->u.string.length) && (strcmp(a->u.string.ptr, b->u.string.ptr) == 0);
+	case JSON_INTEGER:
+		return a->u.integer == b->u.integer;
+	case JSON_DOUBLE:
+		return a->u.dbl == b->u.dbl;
+	case JSON_BOOLEAN:
+		return a->u.boolean == b->u.boolean;
+	default:
+		return 1;
+	}
+}
+
+static void json_report(const char * name, ktime_t t1, ktime_t t2, size_t len)
+{
+	int us = ktime_us_delta(t2, t1);
+
+	wboxtest_print(" %-10s %8d us, %8lu KB/s\r\n", name, us, us > 0 ? (unsigned long)((uint64_t)len * JSON_BENCH_ROUNDS * 1000000 / 1024 / us) : 0);
+}
+
+static void json_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_json_pdata_t * pdat = (struct wbt_json_pdata_t *)data;
+	struct json_reader_t r;
+	struct json_token_t t;
+	struct json_writer_t w;
+	struct json_value_t * a, * b;
+	ktime_t t1, t2;
+	int i, n;
+
+	if(pdat)
+	{
+		assert_not_equal(pdat->len, 0);
+		if(pdat->len == 0)
+			return;
+
+		a = json_parse(pdat->json, pdat->len, NULL);
+		memcpy(pdat->copy, pdat->json, pdat->len);
+		b = json_parse_insitu(pdat->copy, pdat->len, NULL);
+		assert_not_null(a);
+		assert_not_null(b);
+		if(a && b)
+		{
+			assert_equal(a->u.object.length, JSON_BENCH_NODES);
+			assert_true(json_bench_equal(a, b));
+		}
+		json_free(a);
+		json_free(b);
+
+		t1 = ktime_get();
+		for(i = 0; i < JSON_BENCH_ROUNDS; i++)
+			json_free(json_parse(pdat->json, pdat->len, NULL));
+		t2 = ktime_get();
+		json_report("parse", t1, t2, pdat->len);
+
+		t1 = ktime_get();
+		for(i = 0; i < JSON_BENCH_ROUNDS; i++)
+		{
+			memcpy(pdat->copy, pdat->json, pdat->len);
+			json_free(json_parse_insitu(pdat->copy, pdat->len, NULL));
+		}
+		t2 = ktime_get();
+		json_report("insitu", t1, t2, pdat->len);
+
+		t1 = ktime_get();
+		for(i = 0, n = 0; i < JSON_BENCH_ROUNDS; i++)
+		{
+			json_reader_init(&r, pdat->json, pdat->len);
+			while(json_reader_next(&r, &t) > JSON_TOKEN_EOF)
+				n++;
+		}
+		t2 = ktime_get();
+		assert_equal(t.type, JSON_TOKEN_EOF);
+		assert_equal(n, JSON_BENCH_NODES * 20 * JSON_BENCH_ROUNDS + 2 * JSON_BENCH_ROUNDS);
+		json_report("tokenize", t1, t2, pdat->len);
+
+		t1 = ktime_get();
+		for(i = 0; i < JSON_BENCH_ROUNDS; i++)
+		{
+			json_writer_init(&w, pdat->copy, pdat->size, NULL, NULL);
+			json_bench_write(&w);
+		}
+		t2 = ktime_get();
+		assert_equal(w.len, pdat->len);
+		assert_memory_equal(pdat->copy, pdat->json, pdat->len);
+		json_report("write", t1, t2, pdat->len);
+	}
+}
+
+static struct wboxtest_t wbt_json = {
+	.group	= "benchmark-libx",
+	.name	= "json",
+	.setup	= json_setup,
+	.clean	= json_clean,
+	.run	= json_run,
+};
+
+static __init void json_wbt_init(void)
+{
+	register_wboxtest(&wbt_json);
+}
+
+static __exit void json_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_json);
+}
+
+wboxtest_initcall(json_wbt_init);
+wboxtest_exitcall(json_wbt_exit);
@@ -0,0 +1,310 @@
+/*
+ * wboxtest/benchmark-libx/ring.c
+ */
+
+#include <wboxtest.h>
+
+#define RING_BENCH_ITEMS	(65536)
+#define RING_BENCH_SLOTS	(256)
+#define RING_BENCH_BATCH	(16)
+
+enum {
+	RING_BENCH_FIFO		= 0,
+	RING_BENCH_CHANNEL	= 1,
+	RING_BENCH_SPSC		= 2,
+	RING_BENCH_MPMC		= 3,
+};
+
+struct ring_bench_item_t {
+	uint32_t seq;
+	uint32_t data[3];
+};
+
+struct wbt_ring_pdata_t
+{
+	struct waiter_t w;
+	struct fifo_t * fifo;
+	struct channel_t * ch;
+	struct ring_t * spsc;
+	struct mpmc_ring_t * mpmc;
+	int kind;
+	int nproducer;
+	int order;
+	uint64_t sum;
+};
+
+static void * ring_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_ring_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_ring_pdata_t));
+	if(!pdat)
+		return NULL;
+	memset(pdat, 0, sizeof(struct wbt_ring_pdata_t));
+	waiter_init(&pdat->w);
+	pdat->fifo = fifo_alloc(sizeof(struct ring_bench_item_t) * RING_BENCH_SLOTS);
+	pdat->ch = channel_alloc(sizeof(struct ring_bench_item_t) * RING_BENCH_SLOTS);
+	pdat->spsc = ring_alloc(sizeof(struct ring_bench_item_t), RING_BENCH_SLOTS);
+	pdat->mpmc = mpmc_ring_alloc(sizeof(struct ring_bench_item_t), RING_BENCH_SLOTS);
+
+	return pdat;
+}
+
+static void ring_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_ring_pdata_t * pdat = (struct wbt_ring_pdata_t *)data;
+
+	if(pdat)
+	{
+		fifo_free(pdat->fifo);
+		channel_free(pdat->ch);
+		ring_free(pdat->spsc);
+		mpmc_ring_free(pdat->mpmc);
+		free(pdat);
+	}
+}
+
+static void ring_producer(struct task_t * task, void * data)
+{
+	struct wbt_ring_pdata_t * pdat = (struct wbt_ring_pdata_t *)data;
+	struct ring_bench_item_t * p;
+	unsigned int count = RING_BENCH_ITEMS / pdat->nproducer;
+	unsigned int i, n;
+
+	for(i = 1; i <= count; i++)
+	{
+		switch(pdat->kind)
+		{
+		case RING_BENCH_SPSC:
+			n = 1;
+			while(!(p = ring_reserve(pdat->spsc, &n)))
+				task_yield();
+			p->seq = i;
+			ring_commit(pdat->spsc, 1);
+			break;
+		case RING_BENCH_MPMC:
+			while(!(p = mpmc_ring_reserve(pdat->mpmc)))
+				task_yield();
+			p->seq = i;
+			mpmc_ring_commit(pdat->mpmc, p);
+			break;
+		default:
+			break;
+		}
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void ring_consumer(struct task_t * task, void * data)
+{
+	struct wbt_ring_pdata_t * pdat = (struct wbt_ring_pdata_t *)data;
+	struct ring_bench_item_t item[RING_BENCH_BATCH];
+	unsigned int total = 0, expect = 1, n, i;
+
+	while(total < RING_BENCH_ITEMS)
+	{
+		switch(pdat->kind)
+		{
+		case RING_BENCH_SPSC:
+			n = ring_dequeue(pdat->spsc, item, RING_BENCH_BATCH);
+			break;
+		case RING_BENCH_MPMC:
+			n = mpmc_ring_dequeue(pdat->mpmc, item, RING_BENCH_BATCH);
+			break;
+		default:
+			n = 0;
+			break;
+		}
+		if(n == 0)
+		{
+			task_yield();
+			continue;
+		}
+		for(i = 0; i < n; i++)
+		{
+			if((pdat->nproducer == 1) && (item[i].seq != expect))
+				pdat->order++;
+			expect = item[i].seq + 1;
+			pdat->sum += item[i].seq;
+		}
+		total += n;
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+/*
+ * Fill and drain the queue from one task, this is the cost of the queue itself
+ * without any scheduling in between
+ */
+static int ring_pump(struct wbt_ring_pdata_t * pdat, int kind)
+{
+	struct ring_bench_item_t item[RING_BENCH_BATCH], * p;
+	ktime_t t1, t2;
+	unsigned int seq = 0, expect = 1, i, j, k, n;
+
+	pdat->order = 0;
+	pdat->sum = 0;
+	memset(item, 0, sizeof(item));
+	t1 = ktime_get();
+	for(i = 0; i < RING_BENCH_ITEMS; i += RING_BENCH_SLOTS)
+	{
+		for(j = 0; j < RING_BENCH_SLOTS; j++)
+		{
+			item[0].seq = ++seq;
+			switch(kind)
+			{
+			case RING_BENCH_FIFO:
+				fifo_put(pdat->fifo, (unsigned char *)&item[0], sizeof(item[0]));
+				break;
+			case RING_BENCH_CHANNEL:
+				channel_send(pdat->ch, (unsigned char *)&item[0], sizeof(item[0]));
+				break;
+			case RING_BENCH_SPSC:
+				n = 1;
+				p = ring_reserve(pdat->spsc, &n);
+				p->seq = seq;
+				ring_commit(pdat->spsc, 1);
+				break;
+			case RING_BENCH_MPMC:
+				p = mpmc_ring_reserve(pdat->mpmc);
+				p->seq = seq;
+				mpmc_ring_commit(pdat->mpmc, p);
+				break;
+			default:
+				break;
+			}
+		}
+		for(j = 0; j < RING_BENCH_SLOTS; j += n)
+		{
+			switch(kind)
+			{
+			case RING_BENCH_FIFO:
+				n = fifo_get(pdat->fifo, (unsigned char *)item, sizeof(item)) / sizeof(item[0]);
+				break;
+			case RING_BENCH_CHANNEL:
+				channel_recv(pdat->ch, (unsigned char *)item, sizeof(item));
+				n = RING_BENCH_BATCH;
+				break;
+			case RING_BENCH_SPSC:
+				n = ring_dequeue(pdat->spsc, item, RING_BENCH_BATCH);
+				break;
+			case RING_BENCH_MPMC:
+				n = mpmc_ring_dequeue(pdat->mpmc, item, RING_BENCH_BATCH);
+				break;
+			default:
+				n = 0;
+				break;
+			}
+			if(n == 0)
+				return -1;
+			for(k = 0; k < n; k++)
+			{
+				if(item[k].seq != expect)
+					pdat->order++;
+				expect = item[k].seq + 1;
+				pdat->sum += item[k].seq;
+			}
+		}
+	}
+	t2 = ktime_get();
+	return ktime_us_delta(t2, t1);
+}
+
+static int ring_bench(struct wbt_ring_pdata_t * pdat, int kind, int nproducer)
+{
+	ktime_t t1, t2;
+	int i;
+
+	pdat->kind = kind;
+	pdat->nproducer = nproducer;
+	pdat->order = 0;
+	pdat->sum = 0;
+	t1 = ktime_get();
+	waiter_add(&pdat->w, 1);
+	if(!task_create(scheduler_self(), "wbt-ring-rx", NULL, NULL, ring_consumer, pdat, 0, 0))
+		waiter_sub(&pdat->w, 1);
+	for(i = 0; i < nproducer; i++)
+	{
+		waiter_add(&pdat->w, 1);
+		if(!task_create(scheduler_self(), "wbt-ring-tx", NULL, NULL, ring_producer, pdat, 0, 0))
+			waiter_sub(&pdat->w, 1);
+	}
+	waiter_wait(&pdat->w);
+	t2 = ktime_get();
+	return ktime_us_delta(t2, t1);
+}
+
+static void ring_report(const char * name, int us)
+{
+	wboxtest_print(" %-12s %8d us, %8lu items/ms\r\n", name, us, us > 0 ? (unsigned long)((uint64_t)RING_BENCH_ITEMS * 1000 / us) : 0);
+}
+
+static void ring_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_ring_pdata_t * pdat = (struct wbt_ring_pdata_t *)data;
+	uint64_t expect = (uint64_t)RING_BENCH_ITEMS * (RING_BENCH_ITEMS + 1) / 2;
+	uint64_t expect4 = (uint64_t)4 * (RING_BENCH_ITEMS / 4) * (RING_BENCH_ITEMS / 4 + 1) / 2;
+	int us;
+
+	if(pdat)
+	{
+		assert_not_null(pdat->fifo);
+		assert_not_null(pdat->ch);
+		assert_not_null(pdat->spsc);
+		assert_not_null(pdat->mpmc);
+		if(!pdat->fifo || !pdat->ch || !pdat->spsc || !pdat->mpmc)
+			return;
+
+		us = ring_pump(pdat, RING_BENCH_FIFO);
+		assert_equal(pdat->order, 0);
+		assert_true(pdat->sum == expect);
+		ring_report("fifo", us);
+
+		us = ring_pump(pdat, RING_BENCH_CHANNEL);
+		assert_equal(pdat->order, 0);
+		assert_true(pdat->sum == expect);
+		ring_report("channel", us);
+
+		us = ring_pump(pdat, RING_BENCH_SPSC);
+		assert_equal(pdat->order, 0);
+		assert_true(pdat->sum == expect);
+		ring_report("spsc", us);
+
+		us = ring_pump(pdat, RING_BENCH_MPMC);
+		assert_equal(pdat->order, 0);
+		assert_true(pdat->sum == expect);
+		ring_report("mpmc", us);
+
+		us = ring_bench(pdat, RING_BENCH_SPSC, 1);
+		assert_equal(pdat->order, 0);
+		assert_true(pdat->sum == expect);
+		assert_equal(ring_count(pdat->spsc), 0);
+		ring_report("spsc task", us);
+
+		us = ring_bench(pdat, RING_BENCH_MPMC, 4);
+		assert_true(pdat->sum == expect4);
+		assert_equal(mpmc_ring_count(pdat->mpmc), 0);
+		ring_report("mpmc 4:1", us);
+	}
+}
+
+static struct wboxtest_t wbt_ring = {
+	.group	= "benchmark-libx",
+	.name	= "ring",
+	.setup	= ring_setup,
+	.clean	= ring_clean,
+	.run	= ring_run,
+};
+
+static __init void ring_wbt_init(void)
+{
+	register_wboxtest(&wbt_ring);
+}
+
+static __exit void ring_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_ring);
+}
+
+wboxtest_initcall(ring_wbt_init);
+wboxtest_exitcall(ring_wbt_exit);
@@ -0,0 +1,104 @@
+/*
+ * wboxtest/benchmark-memory/memchr.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_memchr_pdata_t
+{
+	char * src;
+	size_t size;
+
+	ktime_t t1;
+	ktime_t t2;
+	int calls;
+};
+
+static void * memchr_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_memchr_pdata_t * pdat;
+	int i;
+
+	pdat = malloc(sizeof(struct wbt_memchr_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	pdat->size = SZ_1M;
+	pdat->src = malloc(pdat->size);
+	if(!pdat->src)
+	{
+		free(pdat->src);
+		free(pdat);
+		return NULL;
+	}
+	for(i = 0; i < pdat->size; i++)
+	{
+		pdat->src[i] = 0x55;
+	}
+
+	return pdat;
+}
+
+static void memchr_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_memchr_pdata_t * pdat = (struct wbt_memchr_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->src);
+		free(pdat);
+	}
+}
+
+static const size_t memchr_size[] = {
+	16, 64, 256, SZ_4K, SZ_64K, SZ_1M,
+};
+
+static void memchr_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_memchr_pdata_t * pdat = (struct wbt_memchr_pdata_t *)data;
+	char buf[32];
+	size_t size;
+	int batch;
+
+	if(pdat)
+	{
+		for(int i = 0; i < ARRAY_SIZE(memchr_size); i++)
+		{
+			size = memchr_size[i];
+			batch = (size < SZ_64K) ? SZ_64K / size : 1;
+			pdat->calls = 0;
+			pdat->t2 = pdat->t1 = ktime_get();
+			do {
+				for(int j = 0; j < batch; j++)
+				{
+					pdat->calls++;
+					memchr(pdat->src, 0xaa, size);
+				}
+				pdat->t2 = ktime_get();
+			} while(ktime_before(pdat->t2, ktime_add_ms(pdat->t1, 400)));
+			wboxtest_print(" %8ld Bytes: %s/s\r\n", (long)size, ssize(buf, (double)pdat->calls * size * 1000.0 / ktime_ms_delta(pdat->t2, pdat->t1)));
+		}
+	}
+}
+
+static struct wboxtest_t wbt_memchr = {
+	.group	= "benchmark-memory",
+	.name	= "memchr",
+	.setup	= memchr_setup,
+	.clean	= memchr_clean,
+	.run	= memchr_run,
+};
+
+static __init void memchr_wbt_init(void)
+{
+	register_wboxtest(&wbt_memchr);
+}
+
+static __exit void memchr_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_memchr);
+}
+
+wboxtest_initcall(memchr_wbt_init);
+wboxtest_exitcall(memchr_wbt_exit);
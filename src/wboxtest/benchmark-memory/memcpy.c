@@ -55,21 +55,35 @@ static void memcpy_clean(struct wboxtest_t * wbt, void * data)
 	}
 }
 
+static const size_t memcpy_size[] = {
+	16, 64, 256, SZ_4K, SZ_64K, SZ_1M,
+};
+
 static void memcpy_run(struct wboxtest_t * wbt, void * data)
 {
 	struct wbt_memcpy_pdata_t * pdat = (struct wbt_memcpy_pdata_t *)data;
 	char buf[32];
+	size_t size;
+	int batch;
 
 	if(pdat)
 	{
-		pdat->calls = 0;
-		pdat->t2 = pdat->t1 = ktime_get();
-		do {
-			pdat->calls++;
-			memcpy(pdat->dst, pdat->src, pdat->size);
-			pdat->t2 = ktime_get();
-		} while(ktime_before(pdat->t2, ktime_add_ms(pdat->t1, 2000)));
-		wboxtest_print(" Bandwidth: %s/s\r\n", ssize(buf, (double)(pdat->calls * pdat->size) * 1000.0 / ktime_ms_delta(pdat->t2, pdat->t1)));
+		for(int i = 0; i < ARRAY_SIZE(memcpy_size); i++)
+		{
+			size = memcpy_size[i];
+			batch = (size < SZ_64K) ? SZ_64K / size : 1;
+			pdat->calls = 0;
+			pdat->t2 = pdat->t1 = ktime_get();
+			do {
+				for(int j = 0; j < batch; j++)
+				{
+					pdat->calls++;
+					memcpy(pdat->dst, pdat->src, size);
+				}
+				pdat->t2 = ktime_get();
+			} while(ktime_before(pdat->t2, ktime_add_ms(pdat->t1, 400)));
+			wboxtest_print(" %8ld Bytes: %s/s\r\n", (long)size, ssize(buf, (double)pdat->calls * size * 1000.0 / ktime_ms_delta(pdat->t2, pdat->t1)));
+		}
 	}
 }
 
@@ -0,0 +1,106 @@
+/*
+ * wboxtest/benchmark-memory/strlen.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_strlen_pdata_t
+{
+	char * src;
+	size_t size;
+
+	ktime_t t1;
+	ktime_t t2;
+	int calls;
+};
+
+static void * strlen_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_strlen_pdata_t * pdat;
+	int i;
+
+	pdat = malloc(sizeof(struct wbt_strlen_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	pdat->size = SZ_1M;
+	pdat->src = malloc(pdat->size);
+	if(!pdat->src)
+	{
+		free(pdat->src);
+		free(pdat);
+		return NULL;
+	}
+	for(i = 0; i < pdat->size; i++)
+	{
+		pdat->src[i] = 0x55;
+	}
+
+	return pdat;
+}
+
+static void strlen_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_strlen_pdata_t * pdat = (struct wbt_strlen_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->src);
+		free(pdat);
+	}
+}
+
+static const size_t strlen_size[] = {
+	16, 64, 256, SZ_4K, SZ_64K, SZ_1M - 1,
+};
+
+static void strlen_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_strlen_pdata_t * pdat = (struct wbt_strlen_pdata_t *)data;
+	char buf[32];
+	size_t size;
+	int batch;
+
+	if(pdat)
+	{
+		for(int i = 0; i < ARRAY_SIZE(strlen_size); i++)
+		{
+			size = strlen_size[i];
+			batch = (size < SZ_64K) ? SZ_64K / size : 1;
+			pdat->src[size] = 0;
+			pdat->calls = 0;
+			pdat->t2 = pdat->t1 = ktime_get();
+			do {
+				for(int j = 0; j < batch; j++)
+				{
+					pdat->calls++;
+					strlen(pdat->src);
+				}
+				pdat->t2 = ktime_get();
+			} while(ktime_before(pdat->t2, ktime_add_ms(pdat->t1, 400)));
+			pdat->src[size] = 0x55;
+			wboxtest_print(" %8ld Bytes: %s/s\r\n", (long)size, ssize(buf, (double)pdat->calls * size * 1000.0 / ktime_ms_delta(pdat->t2, pdat->t1)));
+		}
+	}
+}
+
+static struct wboxtest_t wbt_strlen = {
+	.group	= "benchmark-memory",
+	.name	= "strlen",
+	.setup	= strlen_setup,
+	.clean	= strlen_clean,
+	.run	= strlen_run,
+};
+
+static __init void strlen_wbt_init(void)
+{
+	register_wboxtest(&wbt_strlen);
+}
+
+static __exit void strlen_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_strlen);
+}
+
+wboxtest_initcall(strlen_wbt_init);
+wboxtest_exitcall(strlen_wbt_exit);
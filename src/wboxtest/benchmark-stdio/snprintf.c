@@ -0,0 +1,114 @@
+/*
+ * wboxtest/benchmark-stdio/snprintf.c
+ */
+
+#include <wboxtest.h>
+
+#define SNPRINTF_VALUES		(256)
+
+struct wbt_snprintf_pdata_t
+{
+	int ival[SNPRINTF_VALUES];
+	double dval[SNPRINTF_VALUES];
+};
+
+static void * snprintf_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_snprintf_pdata_t * pdat;
+	int i;
+
+	pdat = malloc(sizeof(struct wbt_snprintf_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	for(i = 0; i < SNPRINTF_VALUES; i++)
+	{
+		pdat->ival[i] = wboxtest_random_int(-1000000000, 1000000000);
+		pdat->dval[i] = (double)wboxtest_random_int(-1000000000, 1000000000) / (double)wboxtest_random_int(1, 100000);
+	}
+
+	return pdat;
+}
+
+static void snprintf_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_snprintf_pdata_t * pdat = (struct wbt_snprintf_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static const struct {
+	const char * name;
+	const char * fmt;
+} snprintf_format[] = {
+	{ "int",			"%d" },
+	{ "int and string",	"id=%d name=%s" },
+	{ "hex",			"%08x" },
+	{ "fixed",			"%.2f" },
+	{ "general",		"%g" },
+	{ "general 14",		"%.14g" },
+	{ "general 17",		"%.17g" },
+};
+
+static void snprintf_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_snprintf_pdata_t * pdat = (struct wbt_snprintf_pdata_t *)data;
+	char buf[64];
+	const char * fmt;
+	ktime_t t1, t2;
+	int calls, kind, i, j;
+
+	if(pdat)
+	{
+		for(i = 0; i < ARRAY_SIZE(snprintf_format); i++)
+		{
+			fmt = snprintf_format[i].fmt;
+			kind = strchr(fmt, 's') ? 2 : strpbrk(fmt, "fg") ? 1 : 0;
+			t2 = t1 = ktime_get();
+			calls = 0;
+			do {
+				for(j = 0; j < SNPRINTF_VALUES; j++, calls++)
+				{
+					if(kind == 2)
+						snprintf(buf, sizeof(buf), fmt, pdat->ival[j], "xboot");
+					else if(kind == 1)
+						snprintf(buf, sizeof(buf), fmt, pdat->dval[j]);
+					else
+						snprintf(buf, sizeof(buf), fmt, pdat->ival[j]);
+				}
+				t2 = ktime_get();
+			} while(ktime_before(t2, ktime_add_ms(t1, 400)));
+			wboxtest_print(" %-16s: %d calls/s\r\n", snprintf_format[i].name, (int)(calls * 1000LL / ktime_ms_delta(t2, t1)));
+		}
+		t2 = t1 = ktime_get();
+		calls = 0;
+		do {
+			for(j = 0; j < SNPRINTF_VALUES; j++, calls++)
+				dtoa(pdat->dval[j], buf);
+			t2 = ktime_get();
+		} while(ktime_before(t2, ktime_add_ms(t1, 400)));
+		wboxtest_print(" %-16s: %d calls/s\r\n", "dtoa", (int)(calls * 1000LL / ktime_ms_delta(t2, t1)));
+	}
+}
+
+static struct wboxtest_t wbt_snprintf = {
+	.group	= "benchmark-stdio",
+	.name	= "snprintf",
+	.setup	= snprintf_setup,
+	.clean	= snprintf_clean,
+	.run	= snprintf_run,
+};
+
+static __init void snprintf_wbt_init(void)
+{
+	register_wboxtest(&wbt_snprintf);
+}
+
+static __exit void snprintf_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_snprintf);
+}
+
+wboxtest_initcall(snprintf_wbt_init);
+wboxtest_exitcall(snprintf_wbt_exit);
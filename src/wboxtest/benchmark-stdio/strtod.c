@@ -0,0 +1,91 @@
+/*
+ * wboxtest/benchmark-stdio/strtod.c
+ */
+
+#include <wboxtest.h>
+
+#define STRTOD_VALUES		(256)
+
+struct wbt_strtod_pdata_t
+{
+	char sval[STRTOD_VALUES][32];
+	char dval[STRTOD_VALUES][32];
+	char lval[STRTOD_VALUES][32];
+};
+
+static void * strtod_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_strtod_pdata_t * pdat;
+	int i;
+
+	pdat = malloc(sizeof(struct wbt_strtod_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	for(i = 0; i < STRTOD_VALUES; i++)
+	{
+		sprintf(pdat->sval[i], "%.3f", wboxtest_random_float(-1000.0, 1000.0));
+		dtoa(wboxtest_random_float(-1e6, 1e6) / (double)wboxtest_random_int(1, 100000), pdat->dval[i]);
+		sprintf(pdat->lval[i], "%d", wboxtest_random_int(-1000000000, 1000000000));
+	}
+
+	return pdat;
+}
+
+static void strtod_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_strtod_pdata_t * pdat = (struct wbt_strtod_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void strtod_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_strtod_pdata_t * pdat = (struct wbt_strtod_pdata_t *)data;
+	char (* str)[32];
+	ktime_t t1, t2;
+	int calls, i, j;
+
+	if(pdat)
+	{
+		for(i = 0; i < 3; i++)
+		{
+			str = (i == 0) ? pdat->sval : (i == 1) ? pdat->dval : pdat->lval;
+			t2 = t1 = ktime_get();
+			calls = 0;
+			do {
+				for(j = 0; j < STRTOD_VALUES; j++, calls++)
+				{
+					if(i < 2)
+						strtod(str[j], NULL);
+					else
+						strtol(str[j], NULL, 10);
+				}
+				t2 = ktime_get();
+			} while(ktime_before(t2, ktime_add_ms(t1, 400)));
+			wboxtest_print(" %-16s: %d calls/s\r\n", (i == 0) ? "strtod short" : (i == 1) ? "strtod shortest" : "strtol", (int)(calls * 1000LL / ktime_ms_delta(t2, t1)));
+		}
+	}
+}
+
+static struct wboxtest_t wbt_strtod = {
+	.group	= "benchmark-stdio",
+	.name	= "strtod",
+	.setup	= strtod_setup,
+	.clean	= strtod_clean,
+	.run	= strtod_run,
+};
+
+static __init void strtod_wbt_init(void)
+{
+	register_wboxtest(&wbt_strtod);
+}
+
+static __exit void strtod_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_strtod);
+}
+
+wboxtest_initcall(strtod_wbt_init);
+wboxtest_exitcall(strtod_wbt_exit);
@@ -0,0 +1,144 @@
+/*
+ * wboxtest/benchmark-stdlib/sort.c
+ */
+
+#include <wboxtest.h>
+
+#define SORT_BENCH_COUNT	(65536)
+
+struct wbt_sort_pdata_t
+{
+	int * src;
+	int * dst;
+};
+
+static void * sort_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_sort_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_sort_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	pdat->src = malloc(SORT_BENCH_COUNT * sizeof(int));
+	pdat->dst = malloc(SORT_BENCH_COUNT * sizeof(int));
+	if(!pdat->src || !pdat->dst)
+	{
+		free(pdat->src);
+		free(pdat->dst);
+		free(pdat);
+		return NULL;
+	}
+
+	return pdat;
+}
+
+static void sort_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_sort_pdata_t * pdat = (struct wbt_sort_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->src);
+		free(pdat->dst);
+		free(pdat);
+	}
+}
+
+static int sort_compare(const void * a, const void * b)
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+static const char * sort_pattern[] = {
+	"random", "sorted", "reversed", "organ", "few",
+};
+
+static void sort_fill(int * a, int n, int pattern)
+{
+	int i;
+
+	for(i = 0; i < n; i++)
+	{
+		switch(pattern)
+		{
+		case 0:
+			a[i] = wboxtest_random_int(-0x40000000, 0x40000000);
+			break;
+		case 1:
+			a[i] = i;
+			break;
+		case 2:
+			a[i] = n - i;
+			break;
+		case 3:
+			a[i] = (i < n / 2) ? i : n - i;
+			break;
+		default:
+			a[i] = wboxtest_random_int(0, 7);
+			break;
+		}
+	}
+}
+
+static void sort_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_sort_pdata_t * pdat = (struct wbt_sort_pdata_t *)data;
+	ktime_t t1, t2;
+	int us[3];
+	int i, k, p, miss;
+
+	if(pdat)
+	{
+		for(p = 0, miss = 0; p < ARRAY_SIZE(sort_pattern); p++)
+		{
+			sort_fill(pdat->src, SORT_BENCH_COUNT, p);
+			for(k = 0; k < 3; k++)
+			{
+				memcpy(pdat->dst, pdat->src, SORT_BENCH_COUNT * sizeof(int));
+				t1 = ktime_get();
+				if(k == 0)
+					qsort(pdat->dst, SORT_BENCH_COUNT, sizeof(int), sort_compare);
+				else if(k == 1)
+					qsort_stable(pdat->dst, SORT_BENCH_COUNT, sizeof(int), sort_compare);
+				else
+					radixsort_s32((s32_t *)pdat->dst, SORT_BENCH_COUNT);
+				t2 = ktime_get();
+				us[k] = ktime_us_delta(t2, t1);
+				for(i = 1; i < SORT_BENCH_COUNT; i++)
+				{
+					if(pdat->dst[i - 1] > pdat->dst[i])
+					{
+						miss++;
+						break;
+					}
+				}
+			}
+			wboxtest_print(" %-8s qsort: %6d us, stable: %6d us, radix: %6d us\r\n", sort_pattern[p], us[0], us[1], us[2]);
+		}
+		assert_equal(miss, 0);
+	}
+}
+
+static struct wboxtest_t wbt_sort = {
+	.group	= "benchmark-stdlib",
+	.name	= "sort",
+	.setup	= sort_setup,
+	.clean	= sort_clean,
+	.run	= sort_run,
+};
+
+static __init void sort_wbt_init(void)
+{
+	register_wboxtest(&wbt_sort);
+}
+
+static __exit void sort_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_sort);
+}
+
+wboxtest_initcall(sort_wbt_init);
+wboxtest_exitcall(sort_wbt_exit);
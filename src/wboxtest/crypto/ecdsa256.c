@@ -5,6 +5,57 @@
 #include <ecdsa256.h>
 #include <wboxtest.h>
 
+/*
+ * Known answer vectors from rfc6979 a.2.5, p-256 with sha-256
+ */
+static const uint8_t kat_private[ECDSA256_PRIVATE_KEY_SIZE] = {
+	0xc9, 0xaf, 0xa9, 0xd8, 0x45, 0xba, 0x75, 0x16, 0x6b, 0x5c, 0x21, 0x57, 0x67, 0xb1, 0xd6, 0x93,
+	0x4e, 0x50, 0xc3, 0xdb, 0x36, 0xe8, 0x9b, 0x12, 0x7b, 0x8a, 0x62, 0x2b, 0x12, 0x0f, 0x67, 0x21,
+};
+
+static const uint8_t kat_public[ECDSA256_PUBLIC_KEY_SIZE] = {
+	0x03, 0x60, 0xfe, 0xd4, 0xba, 0x25, 0x5a, 0x9d, 0x31, 0xc9, 0x61, 0xeb, 0x74, 0xc6, 0x35, 0x6d,
+	0x68, 0xc0, 0x49, 0xb8, 0x92, 0x3b, 0x61, 0xfa, 0x6c, 0xe6, 0x69, 0x62, 0x2e, 0x60, 0xf2, 0x9f,
+	0xb6,
+};
+
+static const struct {
+	uint8_t sha256[32];
+	uint8_t signature[ECDSA256_SIGNATURE_SIZE];
+} kat_vectors[] = {
+	{
+		/* "sample" */
+		{
+			0xaf, 0x2b, 0xdb, 0xe1, 0xaa, 0x9b, 0x6e, 0xc1, 0xe2, 0xad, 0xe1, 0xd6, 0x94, 0xf4, 0x1f, 0xc7,
+			0x1a, 0x83, 0x1d, 0x02, 0x68, 0xe9, 0x89, 0x15, 0x62, 0x11, 0x3d, 0x8a, 0x62, 0xad, 0xd1, 0xbf,
+		},
+		{
+			0xef, 0xd4, 0x8b, 0x2a, 0xac, 0xb6, 0xa8, 0xfd, 0x11, 0x40, 0xdd, 0x9c, 0xd4, 0x5e, 0x81, 0xd6,
+			0x9d, 0x2c, 0x87, 0x7b, 0x56, 0xaa, 0xf9, 0x91, 0xc3, 0x4d, 0x0e, 0xa8, 0x4e, 0xaf, 0x37, 0x16,
+			0xf7, 0xcb, 0x1c, 0x94, 0x2d, 0x65, 0x7c, 0x41, 0xd4, 0x36, 0xc7, 0xa1, 0xb6, 0xe2, 0x9f, 0x65,
+			0xf3, 0xe9, 0x00, 0xdb, 0xb9, 0xaf, 0xf4, 0x06, 0x4d, 0xc4, 0xab, 0x2f, 0x84, 0x3a, 0xcd, 0xa8,
+		},
+	},
+	{
+		/* "test" */
+		{
+			0x9f, 0x86, 0xd0, 0x81, 0x88, 0x4c, 0x7d, 0x65, 0x9a, 0x2f, 0xea, 0xa0, 0xc5, 0x5a, 0xd0, 0x15,
+			0xa3, 0xbf, 0x4f, 0x1b, 0x2b, 0x0b, 0x82, 0x2c, 0xd1, 0x5d, 0x6c, 0x15, 0xb0, 0xf0, 0x0a, 0x08,
+		},
+		{
+			0xf1, 0xab, 0xb0, 0x23, 0x51, 0x83, 0x51, 0xcd, 0x71, 0xd8, 0x81, 0x56, 0x7b, 0x1e, 0xa6, 0x63,
+			0xed, 0x3e, 0xfc, 0xf6, 0xc5, 0x13, 0x2b, 0x35, 0x4f, 0x28, 0xd3, 0xb0, 0xb7, 0xd3, 0x83, 0x67,
+			0x01, 0x9f, 0x41, 0x13, 0x74, 0x2a, 0x2b, 0x14, 0xbd, 0x25, 0x92, 0x6b, 0x49, 0xc6, 0x49, 0x15,
+			0x5f, 0x26, 0x7e, 0x60, 0xd3, 0x81, 0x4b, 0x4c, 0x0c, 0xc8, 0x42, 0x50, 0xe4, 0x6f, 0x00, 0x83,
+		},
+	},
+};
+
+static const uint8_t curve_n[32] = {
+	0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17, 0x9e, 0x84, 0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51,
+};
+
 static void * ecdsa256_setup(struct wboxtest_t * wbt)
 {
 	return NULL;
@@ -20,6 +71,32 @@ static void ecdsa256_run(struct wboxtest_t * wbt, void * data)
 	uint8_t priv[ECDSA256_PRIVATE_KEY_SIZE];
 	uint8_t sign[ECDSA256_SIGNATURE_SIZE];
 	uint8_t msg[32];
+	int i;
+
+	for(i = 0; i < ARRAY_SIZE(kat_vectors); i++)
+	{
+		assert_true(ecdsa256_verify(kat_public, kat_vectors[i].sha256, kat_vectors[i].signature));
+
+		memcpy(msg, kat_vectors[i].sha256, sizeof(msg));
+		msg[wboxtest_random_int(0, 31)] ^= 1 << wboxtest_random_int(0, 7);
+		assert_false(ecdsa256_verify(kat_public, msg, kat_vectors[i].signature));
+
+		memcpy(sign, kat_vectors[i].signature, sizeof(sign));
+		sign[wboxtest_random_int(0, 63)] ^= 1 << wboxtest_random_int(0, 7);
+		assert_false(ecdsa256_verify(kat_public, kat_vectors[i].sha256, sign));
+
+		memcpy(sign, kat_vectors[i].signature, sizeof(sign));
+		memset(&sign[0], 0, ECDSA256_BYTES);
+		assert_false(ecdsa256_verify(kat_public, kat_vectors[i].sha256, sign));
+
+		memcpy(sign, kat_vectors[i].signature, sizeof(sign));
+		memcpy(&sign[ECDSA256_BYTES], curve_n, ECDSA256_BYTES);
+		assert_false(ecdsa256_verify(kat_public, kat_vectors[i].sha256, sign));
+	}
+
+	wboxtest_random_buffer((char *)msg, sizeof(msg));
+	assert_true(ecdsa256_sign(kat_private, msg, sign));
+	assert_true(ecdsa256_verify(kat_public, msg, sign));
 
 	wboxtest_random_buffer((char *)msg, sizeof(msg));
 	assert_true(ecdsa256_keygen(pub, priv));
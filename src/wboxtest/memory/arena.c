@@ -0,0 +1,124 @@
+/*
+ * wboxtest/memory/arena.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_arena_pdata_t
+{
+	struct waiter_t w;
+	int misaligned;
+	int lifo;
+	int overflow;
+	int steady;
+	int grown;
+};
+
+static void * arena_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_arena_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_arena_pdata_t));
+	if(!pdat)
+		return NULL;
+	memset(pdat, 0, sizeof(struct wbt_arena_pdata_t));
+	waiter_init(&pdat->w);
+
+	return pdat;
+}
+
+static void arena_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_arena_pdata_t * pdat = (struct wbt_arena_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void arena_task(struct task_t * task, void * data)
+{
+	struct wbt_arena_pdata_t * pdat = (struct wbt_arena_pdata_t *)data;
+	struct frame_arena_t * a;
+	void * p[64];
+	void * q;
+	size_t size;
+	int i;
+
+	for(i = 0; i < ARRAY_SIZE(p); i++)
+	{
+		p[i] = frame_alloc(wboxtest_random_int(1, 100));
+		if(!p[i] || ((unsigned long)p[i] & 0xf))
+			pdat->misaligned++;
+	}
+	a = task->__arena;
+	q = frame_alloc(128);
+	frame_free(q);
+	if(frame_alloc(128) == q)
+		pdat->lifo = 1;
+	frame_reset();
+
+	size = a->size;
+	for(i = 0; i < ARRAY_SIZE(p); i++)
+		frame_free(frame_alloc(size / 2));
+	frame_reset();
+	if(a->size == size)
+		pdat->steady = 1;
+
+	for(i = 0; i < ARRAY_SIZE(p); i++)
+	{
+		p[i] = frame_alloc(size / 16);
+		memset(p[i], i, size / 16);
+	}
+	if(a->noverflow > 0)
+		pdat->overflow = 1;
+	for(i = 0; i < ARRAY_SIZE(p); i++)
+		frame_free(p[i]);
+	frame_reset();
+	if((a->size > size) && list_empty(&a->overflow))
+		pdat->grown = 1;
+	waiter_sub(&pdat->w, 1);
+}
+
+static void arena_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_arena_pdata_t * pdat = (struct wbt_arena_pdata_t *)data;
+	size_t before, after, mfree;
+
+	if(pdat)
+	{
+		meminfo(&before, &mfree);
+		waiter_add(&pdat->w, 1);
+		if(!task_create(scheduler_self(), "wbt-arena", NULL, NULL, arena_task, pdat, 0, 0))
+			waiter_sub(&pdat->w, 1);
+		waiter_wait(&pdat->w);
+		msleep(20);
+		meminfo(&after, &mfree);
+		assert_equal(pdat->misaligned, 0);
+		assert_true(pdat->lifo);
+		assert_true(pdat->overflow);
+		assert_true(pdat->steady);
+		assert_true(pdat->grown);
+		assert_true(after < before + 64 * 1024);
+	}
+}
+
+static struct wboxtest_t wbt_arena = {
+	.group	= "memory",
+	.name	= "arena",
+	.setup	= arena_setup,
+	.clean	= arena_clean,
+	.run	= arena_run,
+};
+
+static __init void arena_wbt_init(void)
+{
+	register_wboxtest(&wbt_arena);
+}
+
+static __exit void arena_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_arena);
+}
+
+wboxtest_initcall(arena_wbt_init);
+wboxtest_exitcall(arena_wbt_exit);
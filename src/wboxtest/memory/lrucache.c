@@ -0,0 +1,160 @@
+/*
+ * wboxtest/memory/lrucache.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_lrucache_pdata_t
+{
+	struct waiter_t w;
+	struct lrucache_t * c;
+	int mismatch;
+};
+
+static atomic_t __evicted;
+
+static void lrucache_callback(struct lrucache_t * c, const char * key, int nkey, void * value, size_t size)
+{
+	atomic_inc(&__evicted);
+}
+
+static void * lrucache_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_lrucache_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_lrucache_pdata_t));
+	if(!pdat)
+		return NULL;
+	memset(pdat, 0, sizeof(struct wbt_lrucache_pdata_t));
+	waiter_init(&pdat->w);
+	atomic_set(&__evicted, 0);
+
+	return pdat;
+}
+
+static void lrucache_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_lrucache_pdata_t * pdat = (struct wbt_lrucache_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void lrucache_task(struct task_t * task, void * data)
+{
+	struct wbt_lrucache_pdata_t * pdat = (struct wbt_lrucache_pdata_t *)data;
+	char key[32];
+	void * v;
+	int i, k;
+
+	for(i = 0; i < 4096; i++)
+	{
+		k = wboxtest_random_int(0, 255);
+		sprintf(key, "key-%d", k);
+		v = lrucache_get(pdat->c, key, strlen(key));
+		if(v && ((unsigned long)v != k + 1))
+			pdat->mismatch++;
+		else if(!v)
+			lrucache_set(pdat->c, key, strlen(key), (void *)(unsigned long)(k + 1), wboxtest_random_int(16, 256));
+		if((i & 0x3f) == 0)
+			lrucache_remove(pdat->c, key, strlen(key));
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void lrucache_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_lrucache_pdata_t * pdat = (struct wbt_lrucache_pdata_t *)data;
+	struct lrucache_t * c;
+	struct lrucache_stat_t st;
+	char key[80];
+	int hot, i;
+
+	if(pdat)
+	{
+		c = lrucache_alloc(1024, 1, LRUCACHE_POLICY_LRU, lrucache_callback);
+		assert_not_null(c);
+		for(i = 0; i < 16; i++)
+		{
+			sprintf(key, "%d", i);
+			lrucache_set(c, key, strlen(key), (void *)(unsigned long)(i + 1), 100);
+		}
+		lrucache_stat(c, &st);
+		assert_equal(st.insert, 16);
+		assert_true(st.bytes <= 1024);
+		assert_equal(st.count, 10);
+		assert_equal(st.evict, 6);
+		assert_null(lrucache_get(c, "0", 1));
+		assert_equal((unsigned long)lrucache_get(c, "15", 2), 16);
+		assert_false(lrucache_set(c, "big", 3, (void *)1, 2048));
+		memset(key, 'x', sizeof(key));
+		assert_true(lrucache_set(c, key, sizeof(key), (void *)2, 10));
+		assert_equal((unsigned long)lrucache_get(c, key, sizeof(key)), 2);
+		assert_true(lrucache_remove(c, key, sizeof(key)));
+		lrucache_stat(c, &st);
+		assert_equal(st.hit, 2);
+		assert_equal(st.miss, 1);
+		lrucache_free(c);
+		assert_equal(atomic_get(&__evicted), 17);
+
+		c = lrucache_alloc(64 * 100, 1, LRUCACHE_POLICY_2Q, lrucache_callback);
+		assert_not_null(c);
+		for(i = 0; i < 32; i++)
+		{
+			sprintf(key, "hot-%d", i);
+			lrucache_set(c, key, strlen(key), (void *)1, 100);
+			lrucache_get(c, key, strlen(key));
+		}
+		for(i = 0; i < 1024; i++)
+		{
+			sprintf(key, "scan-%d", i);
+			lrucache_set(c, key, strlen(key), (void *)1, 100);
+		}
+		for(i = 0, hot = 0; i < 32; i++)
+		{
+			sprintf(key, "hot-%d", i);
+			if(lrucache_get(c, key, strlen(key)))
+				hot++;
+		}
+		assert_equal(hot, 32);
+		lrucache_free(c);
+
+		atomic_set(&__evicted, 0);
+		pdat->c = lrucache_alloc(64 * 256, 4, LRUCACHE_POLICY_2Q, lrucache_callback);
+		assert_not_null(pdat->c);
+		for(i = 0; i < 4; i++)
+		{
+			waiter_add(&pdat->w, 1);
+			if(!task_create(scheduler_self(), "wbt-lrucache", NULL, NULL, lrucache_task, pdat, 0, 0))
+				waiter_sub(&pdat->w, 1);
+		}
+		waiter_wait(&pdat->w);
+		lrucache_stat(pdat->c, &st);
+		assert_equal(pdat->mismatch, 0);
+		assert_true(st.bytes <= st.budget);
+		assert_true(st.hit > 0);
+		lrucache_free(pdat->c);
+		assert_true(atomic_get(&__evicted) <= st.insert);
+	}
+}
+
+static struct wboxtest_t wbt_lrucache = {
+	.group	= "memory",
+	.name	= "lrucache",
+	.setup	= lrucache_setup,
+	.clean	= lrucache_clean,
+	.run	= lrucache_run,
+};
+
+static __init void lrucache_wbt_init(void)
+{
+	register_wboxtest(&wbt_lrucache);
+}
+
+static __exit void lrucache_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_lrucache);
+}
+
+wboxtest_initcall(lrucache_wbt_init);
+wboxtest_exitcall(lrucache_wbt_exit);
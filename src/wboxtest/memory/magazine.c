@@ -0,0 +1,108 @@
+/*
+ * wboxtest/memory/magazine.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_magazine_pdata_t
+{
+	int n4096[2];
+	int n256[2];
+	int nsmall;
+};
+
+static void * magazine_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_magazine_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_magazine_pdata_t));
+	if(!pdat)
+		return NULL;
+	memset(pdat, 0, sizeof(struct wbt_magazine_pdata_t));
+
+	return pdat;
+}
+
+static void magazine_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_magazine_pdata_t * pdat = (struct wbt_magazine_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void magazine_walk(void * ptr, size_t size, int used, void * data)
+{
+}
+
+/*
+ * Allocates blocks of one size until the heap is exhausted, then frees them all again
+ */
+static int magazine_exhaust(size_t size)
+{
+	void * head = NULL;
+	void * m;
+	int n = 0;
+
+	while((m = malloc(size)))
+	{
+		*((void **)m) = head;
+		head = m;
+		n++;
+	}
+	while(head)
+	{
+		m = head;
+		head = *((void **)m);
+		free(m);
+	}
+	return n;
+}
+
+static void magazine_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_magazine_pdata_t * pdat = (struct wbt_magazine_pdata_t *)data;
+	static const size_t size[] = { 32, 48, 64, 96, 128, 192, 384, 512 };
+	int i;
+
+	if(pdat)
+	{
+		if(!memwalk(magazine_walk, NULL))
+		{
+			wboxtest_print(" No heap pool, skipped\r\n");
+			return;
+		}
+		pdat->n4096[0] = magazine_exhaust(4096);
+		pdat->n256[0] = magazine_exhaust(256);
+		for(i = 0; i < ARRAY_SIZE(size); i++)
+			pdat->nsmall += magazine_exhaust(size[i]);
+		pdat->n256[1] = magazine_exhaust(256);
+		pdat->n4096[1] = magazine_exhaust(4096);
+		wboxtest_print(" 4096: %d, 256: %d, small: %d, 256: %d, 4096: %d\r\n", pdat->n4096[0], pdat->n256[0], pdat->nsmall, pdat->n256[1], pdat->n4096[1]);
+		assert_true(pdat->n4096[0] > 0);
+		assert_true(pdat->nsmall > 0);
+		assert_true(pdat->n256[1] + 16 >= pdat->n256[0]);
+		assert_true(pdat->n4096[1] + 1 >= pdat->n4096[0]);
+	}
+}
+
+static struct wboxtest_t wbt_magazine = {
+	.group	= "memory",
+	.name	= "magazine",
+	.setup	= magazine_setup,
+	.clean	= magazine_clean,
+	.run	= magazine_run,
+};
+
+static __init void magazine_wbt_init(void)
+{
+	register_wboxtest(&wbt_magazine);
+}
+
+static __exit void magazine_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_magazine);
+}
+
+wboxtest_initcall(magazine_wbt_init);
+wboxtest_exitcall(magazine_wbt_exit);
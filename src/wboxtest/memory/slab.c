@@ -0,0 +1,161 @@
+/*
+ * wboxtest/memory/slab.c
+ */
+
+#include <wboxtest.h>
+
+#define SLAB_OBJ_MAGIC		(0x5eed1234)
+#define SLAB_OBJ_COUNT		(512)
+
+struct wbt_slab_obj_t
+{
+	uint32_t magic;
+	uint32_t owner;
+	char payload[52];
+};
+
+struct wbt_slab_pdata_t
+{
+	struct kmem_cache_t * cache;
+	struct wbt_slab_obj_t * obj[SLAB_OBJ_COUNT];
+	struct waiter_t w;
+	atomic_t errors;
+};
+
+static void slab_obj_ctor(void * o)
+{
+	struct wbt_slab_obj_t * obj = (struct wbt_slab_obj_t *)o;
+
+	obj->magic = SLAB_OBJ_MAGIC;
+	obj->owner = 0;
+}
+
+static void * slab_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_slab_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_slab_pdata_t));
+	if(!pdat)
+		return NULL;
+	pdat->cache = kmem_cache_create("wbt-slab", sizeof(struct wbt_slab_obj_t), 16, slab_obj_ctor);
+	if(!pdat->cache)
+	{
+		free(pdat);
+		return NULL;
+	}
+	waiter_init(&pdat->w);
+	atomic_set(&pdat->errors, 0);
+
+	return pdat;
+}
+
+static void slab_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_slab_pdata_t * pdat = (struct wbt_slab_pdata_t *)data;
+
+	if(pdat)
+	{
+		kmem_cache_destroy(pdat->cache);
+		free(pdat);
+	}
+}
+
+static void slab_stress_task(struct task_t * task, void * data)
+{
+	struct wbt_slab_pdata_t * pdat = (struct wbt_slab_pdata_t *)data;
+	struct wbt_slab_obj_t * obj[32];
+	uint32_t owner = (uint32_t)((unsigned long)task);
+	int i, j;
+
+	for(j = 0; j < 200; j++)
+	{
+		for(i = 0; i < ARRAY_SIZE(obj); i++)
+		{
+			obj[i] = kmem_cache_alloc(pdat->cache);
+			if(!obj[i] || (obj[i]->magic != SLAB_OBJ_MAGIC) || (obj[i]->owner != 0))
+				atomic_inc(&pdat->errors);
+			else
+				obj[i]->owner = owner;
+		}
+		task_yield();
+		for(i = 0; i < ARRAY_SIZE(obj); i++)
+		{
+			if(obj[i])
+			{
+				if(obj[i]->owner != owner)
+					atomic_inc(&pdat->errors);
+				obj[i]->owner = 0;
+				kmem_cache_free(pdat->cache, obj[i]);
+			}
+		}
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void slab_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_slab_pdata_t * pdat = (struct wbt_slab_pdata_t *)data;
+	int i, j, dup = 0, misaligned = 0, broken = 0;
+
+	if(pdat)
+	{
+		for(i = 0; i < SLAB_OBJ_COUNT; i++)
+		{
+			pdat->obj[i] = kmem_cache_alloc(pdat->cache);
+			assert_not_null(pdat->obj[i]);
+			if(!pdat->obj[i])
+				return;
+			if((unsigned long)pdat->obj[i] & 0xf)
+				misaligned++;
+			if(pdat->obj[i]->magic != SLAB_OBJ_MAGIC)
+				broken++;
+			memset(pdat->obj[i]->payload, i & 0xff, sizeof(pdat->obj[i]->payload));
+		}
+		for(i = 0; i < SLAB_OBJ_COUNT; i++)
+		{
+			for(j = 0; j < sizeof(pdat->obj[i]->payload); j++)
+			{
+				if(pdat->obj[i]->payload[j] != (char)(i & 0xff))
+				{
+					dup++;
+					break;
+				}
+			}
+		}
+		assert_equal(misaligned, 0);
+		assert_equal(broken, 0);
+		assert_equal(dup, 0);
+		for(i = 0; i < SLAB_OBJ_COUNT; i++)
+			kmem_cache_free(pdat->cache, pdat->obj[i]);
+
+		for(i = 0; i < CONFIG_MAX_SMP_CPUS * 2; i++)
+		{
+			waiter_add(&pdat->w, 1);
+			if(!task_create(scheduler_self(), "wbt-slab", NULL, NULL, slab_stress_task, pdat, 0, 0))
+				waiter_sub(&pdat->w, 1);
+		}
+		waiter_wait(&pdat->w);
+		assert_equal(atomic_get(&pdat->errors), 0);
+	}
+}
+
+static struct wboxtest_t wbt_slab = {
+	.group	= "memory",
+	.name	= "slab",
+	.setup	= slab_setup,
+	.clean	= slab_clean,
+	.run	= slab_run,
+};
+
+static __init void slab_wbt_init(void)
+{
+	register_wboxtest(&wbt_slab);
+}
+
+static __exit void slab_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_slab);
+}
+
+wboxtest_initcall(slab_wbt_init);
+wboxtest_exitcall(slab_wbt_exit);
@@ -31,6 +31,36 @@ static void sprintf_run(struct wboxtest_t * wbt, void * data)
 
 	sprintf(buf, "%c%c%c%c%c", 'x', 'b', 'o', 'o', 't');
 	assert_string_equal(buf, "xboot");
+
+	sprintf(buf, "[%5d|%-5d|%05d|%+d]", 42, 42, -42, 7);
+	assert_string_equal(buf, "[   42|42   |-0042|+7]");
+
+	sprintf(buf, "%ld %lu %lld", LONG_MIN, ULONG_MAX, LLONG_MIN);
+	assert_true(strtol(buf, NULL, 10) == LONG_MIN);
+	assert_string_equal(buf + strlen(buf) - 20, "-9223372036854775808");
+
+	sprintf(buf, "%08lx %o %#o", 0x1234abcdUL, 8, 8);
+	assert_string_equal(buf, "1234abcd 10 010");
+
+	sprintf(buf, "%.2f %.3f %.0f %f", 3.14159, -0.0005, 2.5, 1.0 / 3.0);
+	assert_string_equal(buf, "3.14 -0.001 2 0.333333");
+
+	sprintf(buf, "%e %.2E %g %g %g", 12345.678, 0.000123, 100000.0, 1000000.0, 0.0001);
+	assert_string_equal(buf, "1.234568e+04 1.23E-04 100000 1e+06 0.0001");
+
+	sprintf(buf, "%.17g %.14g %#g %G", 0.1, 0.1, 1.0, 1e-10);
+	assert_string_equal(buf, "0.10000000000000001 0.1 1.00000 1E-10");
+
+	sprintf(buf, "[%10.3f|%-10.1e|%+.1f|% .1f]", -1.5, 1234.0, 1.25, 1.0);
+	assert_string_equal(buf, "[    -1.500|1.2e+03   |+1.2| 1.0]");
+
+	sprintf(buf, "%f %F %g", INFINITY, -INFINITY, NAN);
+	assert_string_equal(buf, "inf -INF nan");
+
+	assert_equal(snprintf(buf, 4, "%d", 123456), 6);
+	assert_string_equal(buf, "123");
+	assert_equal(snprintf(buf, 6, "%.3f", 3.14159), 5);
+	assert_string_equal(buf, "3.142");
 }
 
 static struct wboxtest_t wbt_sprintf = {
@@ -0,0 +1,104 @@
+/*
+ * wboxtest/stdio/strtod.c
+ */
+
+#include <wboxtest.h>
+
+static double double_from_bits(uint64_t u)
+{
+	union { double d; uint64_t u; } b = { .u = u };
+	return b.d;
+}
+
+static void * strtod_setup(struct wboxtest_t * wbt)
+{
+	return NULL;
+}
+
+static void strtod_clean(struct wboxtest_t * wbt, void * data)
+{
+}
+
+static void strtod_run(struct wboxtest_t * wbt, void * data)
+{
+	char buf[64];
+	char * end;
+	double v, r;
+	uint64_t u;
+	int i, bad;
+
+	assert_true(strtod("0.1", NULL) == 0.1);
+	assert_true(strtod("1e23", NULL) == 1e23);
+	assert_true(strtod("  -12.5e-1xyz", &end) == -1.25);
+	assert_string_equal(end, "xyz");
+	assert_true(strtod("9007199254740993", NULL) == 9007199254740992.0);
+	assert_true(strtod("9007199254740993.0000000001", NULL) == 9007199254740994.0);
+	assert_true(strtod("2.2250738585072011e-308", NULL) == double_from_bits(0x000fffffffffffffULL));
+	assert_true(strtod("4.9e-324", NULL) == double_from_bits(1));
+	assert_true(strtod("0x1.8p1", NULL) == 3.0);
+	assert_true(isinf(strtod("-Infinity", NULL)));
+	assert_true(isnan(strtod("nan(123)", NULL)));
+	errno = 0;
+	assert_true(strtod("1e400", NULL) == HUGE_VAL);
+	assert_equal(errno, ERANGE);
+	errno = 0;
+	assert_true(strtod("1e-400", NULL) == 0.0);
+	assert_equal(errno, ERANGE);
+	assert_true(strtod(".e5", &end) == 0.0);
+	assert_string_equal(end, ".e5");
+
+	assert_equal(strtol(" -0x7fffffff", NULL, 0), -0x7fffffffL);
+	assert_equal(strtol("z", NULL, 36), 35);
+	assert_true(strtoull("18446744073709551615", NULL, 10) == ULLONG_MAX);
+	assert_equal(strtoul("0755", &end, 0), 0755);
+	assert_string_equal(end, "");
+
+	dtoa(0.3, buf);
+	assert_string_equal(buf, "0.3");
+	dtoa(1e21, buf);
+	assert_string_equal(buf, "1e+21");
+	dtoa(-5e-324, buf);
+	assert_string_equal(buf, "-5e-324");
+	dtoa(123456.0, buf);
+	assert_string_equal(buf, "123456");
+
+	/*
+	 * Random bit patterns must survive both the shortest and the %.17g text
+	 */
+	for(i = 0, bad = 0; i < 20000; i++)
+	{
+		u = ((uint64_t)rand() << 62) ^ ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+		v = double_from_bits(u);
+		if(isnan(v) || isinf(v))
+			continue;
+		dtoa(v, buf);
+		r = strtod(buf, &end);
+		if((r != v) || (signbit(r) != signbit(v)) || (*end != '\0'))
+			bad++;
+		sprintf(buf, "%.17g", v);
+		if(strtod(buf, NULL) != v)
+			bad++;
+	}
+	assert_equal(bad, 0);
+}
+
+static struct wboxtest_t wbt_strtod = {
+	.group	= "stdio",
+	.name	= "strtod",
+	.setup	= strtod_setup,
+	.clean	= strtod_clean,
+	.run	= strtod_run,
+};
+
+static __init void strtod_wbt_init(void)
+{
+	register_wboxtest(&wbt_strtod);
+}
+
+static __exit void strtod_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_strtod);
+}
+
+wboxtest_initcall(strtod_wbt_init);
+wboxtest_exitcall(strtod_wbt_exit);
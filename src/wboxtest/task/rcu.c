@@ -0,0 +1,175 @@
+/*
+ * wboxtest/task/rcu.c
+ */
+
+#include <wboxtest.h>
+
+#define RCU_NODE_MAGIC		(0x52435521)
+
+struct wbt_rcu_node_t
+{
+	struct list_head entry;
+	int magic;
+	int value;
+};
+
+struct wbt_rcu_pdata_t
+{
+	struct waiter_t w;
+	struct list_head list;
+	spinlock_t lock;
+	int held;
+	int released;
+	int error;
+};
+
+static void * rcu_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_rcu_pdata_t * pdat;
+	struct wbt_rcu_node_t * node;
+
+	pdat = malloc(sizeof(struct wbt_rcu_pdata_t));
+	if(!pdat)
+		return NULL;
+	waiter_init(&pdat->w);
+	init_list_head(&pdat->list);
+	spin_lock_init(&pdat->lock);
+	pdat->held = 0;
+	pdat->released = 0;
+	pdat->error = 0;
+	for(int i = 0; i < 16; i++)
+	{
+		node = malloc(sizeof(struct wbt_rcu_node_t));
+		if(node)
+		{
+			node->magic = RCU_NODE_MAGIC;
+			node->value = i;
+			list_add_tail_rcu(&node->entry, &pdat->list);
+		}
+	}
+
+	return pdat;
+}
+
+static void rcu_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_rcu_pdata_t * pdat = (struct wbt_rcu_pdata_t *)data;
+	struct wbt_rcu_node_t * pos, * n;
+
+	if(pdat)
+	{
+		list_for_each_entry_safe(pos, n, &pdat->list, entry)
+		{
+			list_del(&pos->entry);
+			free(pos);
+		}
+		free(pdat);
+	}
+}
+
+static void rcu_reader_task(struct task_t * task, void * data)
+{
+	struct wbt_rcu_pdata_t * pdat = (struct wbt_rcu_pdata_t *)data;
+	struct wbt_rcu_node_t * pos;
+	int cnt = 1000;
+	int idx;
+
+	while(cnt--)
+	{
+		idx = rcu_read_lock();
+		list_for_each_entry_rcu(pos, &pdat->list, entry)
+		{
+			if(pos->magic != RCU_NODE_MAGIC)
+				pdat->error++;
+		}
+		rcu_read_unlock(idx);
+		task_yield();
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rcu_writer_task(struct task_t * task, void * data)
+{
+	struct wbt_rcu_pdata_t * pdat = (struct wbt_rcu_pdata_t *)data;
+	struct wbt_rcu_node_t * node, * old;
+	irq_flags_t flags;
+	int cnt = 200;
+
+	while(cnt--)
+	{
+		node = malloc(sizeof(struct wbt_rcu_node_t));
+		if(!node)
+			break;
+		node->magic = RCU_NODE_MAGIC;
+		spin_lock_irqsave(&pdat->lock, flags);
+		old = list_first_entry(&pdat->list, struct wbt_rcu_node_t, entry);
+		node->value = old->value;
+		list_del_rcu(&old->entry);
+		list_add_tail_rcu(&node->entry, &pdat->list);
+		spin_unlock_irqrestore(&pdat->lock, flags);
+		synchronize_rcu();
+		old->magic = 0;
+		free(old);
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rcu_holder_task(struct task_t * task, void * data)
+{
+	struct wbt_rcu_pdata_t * pdat = (struct wbt_rcu_pdata_t *)data;
+	int idx;
+
+	idx = rcu_read_lock();
+	pdat->held = 1;
+	msleep(50);
+	pdat->released = 1;
+	rcu_read_unlock(idx);
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rcu_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_rcu_pdata_t * pdat = (struct wbt_rcu_pdata_t *)data;
+	char name[128];
+
+	if(pdat)
+	{
+		waiter_add(&pdat->w, 1);
+		task_create(scheduler_self(), "rcu-holder", NULL, NULL, rcu_holder_task, pdat, 0, 0);
+		while(!pdat->held)
+			task_yield();
+		synchronize_rcu();
+		assert_true(pdat->released == 1);
+		waiter_wait(&pdat->w);
+
+		for(int i = 0; i < 6; i++)
+		{
+			waiter_add(&pdat->w, 1);
+			sprintf(name, "rcu-%s-%02d", (i < 2) ? "writer" : "reader", i);
+			task_create(NULL, name, NULL, NULL, (i < 2) ? rcu_writer_task : rcu_reader_task, pdat, 0, 0);
+		}
+		waiter_wait(&pdat->w);
+		assert_true(pdat->error == 0);
+	}
+}
+
+static struct wboxtest_t wbt_rcu = {
+	.group	= "task",
+	.name	= "rcu",
+	.setup	= rcu_setup,
+	.clean	= rcu_clean,
+	.run	= rcu_run,
+};
+
+static __init void rcu_wbt_init(void)
+{
+	register_wboxtest(&wbt_rcu);
+}
+
+static __exit void rcu_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_rcu);
+}
+
+wboxtest_initcall(rcu_wbt_init);
+wboxtest_exitcall(rcu_wbt_exit);
@@ -0,0 +1,127 @@
+/*
+ * wboxtest/task/rt.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_rt_pdata_t
+{
+	struct waiter_t w;
+	atomic_t seq;
+	int order[3];
+	volatile int stop;
+	volatile int progress;
+};
+
+struct wbt_rt_arg_t
+{
+	struct wbt_rt_pdata_t * pdat;
+	int index;
+};
+
+static void * rt_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_rt_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_rt_pdata_t));
+	if(!pdat)
+		return NULL;
+	waiter_init(&pdat->w);
+	atomic_set(&pdat->seq, 0);
+
+	return pdat;
+}
+
+static void rt_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_rt_pdata_t * pdat = (struct wbt_rt_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void rt_order_task(struct task_t * task, void * data)
+{
+	struct wbt_rt_arg_t * arg = (struct wbt_rt_arg_t *)data;
+	struct wbt_rt_pdata_t * pdat = arg->pdat;
+
+	pdat->order[arg->index] = atomic_add_return(&pdat->seq, 1);
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rt_hog_task(struct task_t * task, void * data)
+{
+	struct wbt_rt_pdata_t * pdat = (struct wbt_rt_pdata_t *)data;
+	ktime_t timeout = ktime_add_ms(ktime_get(), 1200);
+
+	while(ktime_before(ktime_get(), timeout))
+		task_yield();
+	pdat->stop = 1;
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rt_normal_task(struct task_t * task, void * data)
+{
+	struct wbt_rt_pdata_t * pdat = (struct wbt_rt_pdata_t *)data;
+
+	while(!pdat->stop)
+	{
+		pdat->progress++;
+		task_yield();
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rt_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_rt_pdata_t * pdat = (struct wbt_rt_pdata_t *)data;
+	struct wbt_rt_arg_t arg[3];
+	int prio[3] = { 5, 20, 10 };
+	int i;
+
+	if(pdat)
+	{
+		atomic_set(&pdat->seq, 0);
+		for(i = 0; i < 3; i++)
+		{
+			arg[i].pdat = pdat;
+			arg[i].index = i;
+			waiter_add(&pdat->w, 1);
+			if(!task_create_with_policy(scheduler_self(), "rt-order", NULL, NULL, rt_order_task, &arg[i], 0, 0, TASK_POLICY_FIFO, prio[i]))
+				waiter_sub(&pdat->w, 1);
+		}
+		waiter_wait(&pdat->w);
+		assert_equal(pdat->order[1], 1);
+		assert_equal(pdat->order[2], 2);
+		assert_equal(pdat->order[0], 3);
+
+		pdat->stop = 0;
+		pdat->progress = 0;
+		waiter_add(&pdat->w, 2);
+		task_create(scheduler_self(), "rt-normal", NULL, NULL, rt_normal_task, pdat, 0, 0);
+		task_create_with_policy(scheduler_self(), "rt-hog", NULL, NULL, rt_hog_task, pdat, 0, 0, TASK_POLICY_RR, 0);
+		waiter_wait(&pdat->w);
+		assert_not_equal(pdat->progress, 0);
+	}
+}
+
+static struct wboxtest_t wbt_rt = {
+	.group	= "task",
+	.name	= "rt",
+	.setup	= rt_setup,
+	.clean	= rt_clean,
+	.run	= rt_run,
+};
+
+static __init void rt_wbt_init(void)
+{
+	register_wboxtest(&wbt_rt);
+}
+
+static __exit void rt_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_rt);
+}
+
+wboxtest_initcall(rt_wbt_init);
+wboxtest_exitcall(rt_wbt_exit);
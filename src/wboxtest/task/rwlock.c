@@ -0,0 +1,121 @@
+/*
+ * wboxtest/task/rwlock.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_rwlock_pdata_t
+{
+	struct waiter_t w;
+	rwlock_t lock;
+	int a, b;
+	int error;
+};
+
+static void * rwlock_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_rwlock_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_rwlock_pdata_t));
+	if(!pdat)
+		return NULL;
+	waiter_init(&pdat->w);
+	rwlock_init(&pdat->lock);
+	pdat->a = 0;
+	pdat->b = 0;
+	pdat->error = 0;
+
+	return pdat;
+}
+
+static void rwlock_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_rwlock_pdata_t * pdat = (struct wbt_rwlock_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void rwlock_reader_task(struct task_t * task, void * data)
+{
+	struct wbt_rwlock_pdata_t * pdat = (struct wbt_rwlock_pdata_t *)data;
+	irq_flags_t flags;
+	int cnt = 1000;
+
+	while(cnt--)
+	{
+		read_lock_irqsave(&pdat->lock, flags);
+		if(pdat->a != pdat->b)
+			pdat->error++;
+		read_unlock_irqrestore(&pdat->lock, flags);
+		task_yield();
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rwlock_writer_task(struct task_t * task, void * data)
+{
+	struct wbt_rwlock_pdata_t * pdat = (struct wbt_rwlock_pdata_t *)data;
+	irq_flags_t flags;
+	int cnt = 1000;
+
+	while(cnt--)
+	{
+		write_lock_irqsave(&pdat->lock, flags);
+		pdat->a++;
+		smp_mb();
+		pdat->b++;
+		write_unlock_irqrestore(&pdat->lock, flags);
+		task_yield();
+	}
+	waiter_sub(&pdat->w, 1);
+}
+
+static void rwlock_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_rwlock_pdata_t * pdat = (struct wbt_rwlock_pdata_t *)data;
+	char name[128];
+
+	if(pdat)
+	{
+		assert_true(read_trylock(&pdat->lock));
+		assert_true(read_trylock(&pdat->lock));
+		assert_true(!write_trylock(&pdat->lock));
+		read_unlock(&pdat->lock);
+		read_unlock(&pdat->lock);
+		assert_true(write_trylock(&pdat->lock));
+		assert_true(!read_trylock(&pdat->lock));
+		write_unlock(&pdat->lock);
+
+		for(int i = 0; i < 8; i++)
+		{
+			waiter_add(&pdat->w, 1);
+			sprintf(name, "rwlock-%s-%02d", (i < 2) ? "writer" : "reader", i);
+			task_create(NULL, name, NULL, NULL, (i < 2) ? rwlock_writer_task : rwlock_reader_task, pdat, 0, 0);
+		}
+		waiter_wait(&pdat->w);
+		assert_true(pdat->error == 0);
+		assert_true(pdat->a == 2000);
+	}
+}
+
+static struct wboxtest_t wbt_rwlock = {
+	.group	= "task",
+	.name	= "rwlock",
+	.setup	= rwlock_setup,
+	.clean	= rwlock_clean,
+	.run	= rwlock_run,
+};
+
+static __init void rwlock_wbt_init(void)
+{
+	register_wboxtest(&wbt_rwlock);
+}
+
+static __exit void rwlock_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_rwlock);
+}
+
+wboxtest_initcall(rwlock_wbt_init);
+wboxtest_exitcall(rwlock_wbt_exit);
@@ -0,0 +1,124 @@
+/*
+ * wboxtest/task/spawn.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_spawn_pdata_t
+{
+	struct waiter_t w;
+	struct waiter_t release[16];
+	void * stack;
+	size_t stksz;
+	atomic_t count;
+
+	ktime_t t1;
+	ktime_t t2;
+};
+
+static void * spawn_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_spawn_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_spawn_pdata_t));
+	if(!pdat)
+		return NULL;
+
+	pdat->stksz = SZ_16K;
+	pdat->stack = malloc(pdat->stksz * 16);
+	if(!pdat->stack)
+	{
+		free(pdat);
+		return NULL;
+	}
+	waiter_init(&pdat->w);
+	for(int i = 0; i < 16; i++)
+		waiter_init(&pdat->release[i]);
+	atomic_set(&pdat->count, 0);
+
+	return pdat;
+}
+
+static void spawn_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_spawn_pdata_t * pdat = (struct wbt_spawn_pdata_t *)data;
+
+	if(pdat)
+	{
+		free(pdat->stack);
+		free(pdat);
+	}
+}
+
+static void spawn_task(struct task_t * task, void * data)
+{
+	struct wbt_spawn_pdata_t * pdat = (struct wbt_spawn_pdata_t *)data;
+
+	atomic_inc(&pdat->count);
+	waiter_sub(&pdat->w, 1);
+}
+
+static void spawn_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_spawn_pdata_t * pdat = (struct wbt_spawn_pdata_t *)data;
+	int calls, slot, i;
+
+	if(pdat)
+	{
+		atomic_set(&pdat->count, 0);
+		calls = 0;
+		pdat->t2 = pdat->t1 = ktime_get();
+		do {
+			for(i = 0; i < 16; i++)
+			{
+				waiter_add(&pdat->w, 1);
+				if(!task_create(scheduler_self(), "spawn-task", NULL, NULL, spawn_task, pdat, SZ_16K, 0))
+					waiter_sub(&pdat->w, 1);
+			}
+			waiter_wait(&pdat->w);
+			calls += 16;
+			pdat->t2 = ktime_get();
+		} while(ktime_before(pdat->t2, ktime_add_ms(pdat->t1, 2000)));
+		assert_equal(atomic_get(&pdat->count), calls);
+		wboxtest_print(" Spawn and exit: %.3f us/task\r\n", (double)ktime_us_delta(pdat->t2, pdat->t1) / (double)calls);
+
+		atomic_set(&pdat->count, 0);
+		calls = 0;
+		pdat->t2 = pdat->t1 = ktime_get();
+		do {
+			slot = calls & 0xf;
+			waiter_wait(&pdat->release[slot]);
+			waiter_add(&pdat->w, 1);
+			if(!task_create_with_stack(scheduler_self(), "spawn-stack", NULL, NULL, spawn_task, pdat, pdat->stack + pdat->stksz * slot, pdat->stksz, 0, &pdat->release[slot]))
+				waiter_sub(&pdat->w, 1);
+			waiter_wait(&pdat->w);
+			calls++;
+			pdat->t2 = ktime_get();
+		} while(ktime_before(pdat->t2, ktime_add_ms(pdat->t1, 2000)));
+		for(i = 0; i < 16; i++)
+			waiter_wait(&pdat->release[i]);
+		assert_equal(atomic_get(&pdat->count), calls);
+		wboxtest_print(" Spawn and exit with stack: %.3f us/task\r\n", (double)ktime_us_delta(pdat->t2, pdat->t1) / (double)calls);
+	}
+}
+
+static struct wboxtest_t wbt_spawn = {
+	.group	= "task",
+	.name	= "spawn",
+	.setup	= spawn_setup,
+	.clean	= spawn_clean,
+	.run	= spawn_run,
+};
+
+static __init void spawn_wbt_init(void)
+{
+	register_wboxtest(&wbt_spawn);
+}
+
+static __exit void spawn_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_spawn);
+}
+
+wboxtest_initcall(spawn_wbt_init);
+wboxtest_exitcall(spawn_wbt_exit);
@@ -0,0 +1,104 @@
+/*
+ * wboxtest/task/stack.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_stack_pdata_t
+{
+	struct waiter_t w;
+	size_t idle;
+	size_t deep;
+	int check;
+};
+
+static void * stack_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_stack_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_stack_pdata_t));
+	if(!pdat)
+		return NULL;
+	waiter_init(&pdat->w);
+	pdat->idle = 0;
+	pdat->deep = 0;
+	pdat->check = 0;
+
+	return pdat;
+}
+
+static void stack_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_stack_pdata_t * pdat = (struct wbt_stack_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void stack_idle_task(struct task_t * task, void * data)
+{
+	struct wbt_stack_pdata_t * pdat = (struct wbt_stack_pdata_t *)data;
+
+	pdat->idle = task_stack_used(task);
+	waiter_sub(&pdat->w, 1);
+}
+
+static void stack_deep_task(struct task_t * task, void * data)
+{
+	struct wbt_stack_pdata_t * pdat = (struct wbt_stack_pdata_t *)data;
+	volatile char buf[16 * 1024];
+
+	for(int i = 0; i < sizeof(buf); i += 64)
+		buf[i] = i;
+	task_yield();
+	pdat->deep = task_stack_used(task);
+	pdat->check = task_stack_check(task);
+	waiter_sub(&pdat->w, 1);
+}
+
+static void stack_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_stack_pdata_t * pdat = (struct wbt_stack_pdata_t *)data;
+
+	if(pdat)
+	{
+		waiter_add(&pdat->w, 2);
+		task_create(NULL, "wbt-stack-idle", NULL, NULL, stack_idle_task, pdat, 64 * 1024, 0);
+		task_create(NULL, "wbt-stack-deep", NULL, NULL, stack_deep_task, pdat, 64 * 1024 + 3, 0);
+		waiter_wait(&pdat->w);
+		wboxtest_print(" idle: %ld bytes, deep: %ld bytes\r\n", (long)pdat->idle, (long)pdat->deep);
+		assert_true(pdat->idle < 16 * 1024);
+		assert_true(pdat->deep >= 16 * 1024);
+		assert_true(pdat->deep < 64 * 1024);
+		assert_true(pdat->check);
+		assert_true(task_stack_check(task_self()));
+
+		msleep(20);
+		waiter_add(&pdat->w, 1);
+		task_create(NULL, "wbt-stack-reuse", NULL, NULL, stack_idle_task, pdat, 64 * 1024 + 3, 0);
+		waiter_wait(&pdat->w);
+		wboxtest_print(" reused: %ld bytes\r\n", (long)pdat->idle);
+		assert_true(pdat->idle < 16 * 1024);
+	}
+}
+
+static struct wboxtest_t wbt_stack = {
+	.group	= "task",
+	.name	= "stack",
+	.setup	= stack_setup,
+	.clean	= stack_clean,
+	.run	= stack_run,
+};
+
+static __init void stack_wbt_init(void)
+{
+	register_wboxtest(&wbt_stack);
+}
+
+static __exit void stack_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_stack);
+}
+
+wboxtest_initcall(stack_wbt_init);
+wboxtest_exitcall(stack_wbt_exit);
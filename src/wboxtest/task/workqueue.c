@@ -0,0 +1,130 @@
+/*
+ * wboxtest/task/workqueue.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_workqueue_pdata_t
+{
+	struct work_t work[16];
+	int cpu[16];
+	struct work_t delayed;
+	struct work_t cancel;
+	atomic_t count;
+	ktime_t expires;
+	ktime_t fired;
+};
+
+static void * workqueue_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_workqueue_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_workqueue_pdata_t));
+	if(!pdat)
+		return NULL;
+	atomic_set(&pdat->count, 0);
+
+	return pdat;
+}
+
+static void workqueue_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_workqueue_pdata_t * pdat = (struct wbt_workqueue_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static void workqueue_count_work(struct work_t * work, void * data)
+{
+	struct wbt_workqueue_pdata_t * pdat = (struct wbt_workqueue_pdata_t *)data;
+
+	atomic_inc(&pdat->count);
+}
+
+static void workqueue_cpu_work(struct work_t * work, void * data)
+{
+	struct wbt_workqueue_pdata_t * pdat = (struct wbt_workqueue_pdata_t *)data;
+
+	pdat->cpu[work - &pdat->work[0]] = smp_processor_id();
+	atomic_inc(&pdat->count);
+}
+
+static void workqueue_delayed_work(struct work_t * work, void * data)
+{
+	struct wbt_workqueue_pdata_t * pdat = (struct wbt_workqueue_pdata_t *)data;
+
+	pdat->fired = ktime_get();
+}
+
+static void workqueue_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_workqueue_pdata_t * pdat = (struct wbt_workqueue_pdata_t *)data;
+	int i;
+
+	if(pdat)
+	{
+		for(i = 0; i < ARRAY_SIZE(pdat->work); i++)
+		{
+			work_init(&pdat->work[i], workqueue_cpu_work, pdat);
+			assert_true(work_queue_on(i % CONFIG_MAX_SMP_CPUS, &pdat->work[i]));
+		}
+		for(i = 0; i < ARRAY_SIZE(pdat->work); i++)
+			work_flush(&pdat->work[i]);
+		assert_equal(atomic_get(&pdat->count), ARRAY_SIZE(pdat->work));
+		for(i = 0; i < ARRAY_SIZE(pdat->work); i++)
+			assert_equal(pdat->cpu[i], i % CONFIG_MAX_SMP_CPUS);
+
+		work_init(&pdat->delayed, workqueue_delayed_work, pdat);
+		pdat->fired = ktime_set(0, 0);
+		pdat->expires = ktime_add_ms(ktime_get(), 50);
+		assert_true(work_queue_delayed(&pdat->delayed, ms_to_ktime(50)));
+		assert_false(work_queue_delayed(&pdat->delayed, ms_to_ktime(50)));
+		msleep(100);
+		assert_false(work_pending(&pdat->delayed));
+		assert_false(ktime_before(pdat->fired, pdat->expires));
+
+		pdat->fired = ktime_set(0, 0);
+		assert_true(work_queue_delayed(&pdat->delayed, ms_to_ktime(50)));
+		msleep(30);
+		pdat->expires = ktime_add_ms(ktime_get(), 50);
+		assert_true(work_mod_delayed(&pdat->delayed, ms_to_ktime(50)));
+		msleep(30);
+		assert_true(work_pending(&pdat->delayed));
+		msleep(70);
+		assert_false(work_pending(&pdat->delayed));
+		assert_false(ktime_before(pdat->fired, pdat->expires));
+
+		atomic_set(&pdat->count, 0);
+		work_init(&pdat->cancel, workqueue_count_work, pdat);
+		assert_true(work_queue_delayed(&pdat->cancel, ms_to_ktime(20)));
+		assert_true(work_cancel(&pdat->cancel));
+		msleep(50);
+		assert_equal(atomic_get(&pdat->count), 0);
+
+		assert_true(work_queue_delayed(&pdat->cancel, ms_to_ktime(5000)));
+		work_flush(&pdat->cancel);
+		assert_equal(atomic_get(&pdat->count), 1);
+	}
+}
+
+static struct wboxtest_t wbt_workqueue = {
+	.group	= "task",
+	.name	= "workqueue",
+	.setup	= workqueue_setup,
+	.clean	= workqueue_clean,
+	.run	= workqueue_run,
+};
+
+static __init void workqueue_wbt_init(void)
+{
+	register_wboxtest(&wbt_workqueue);
+}
+
+static __exit void workqueue_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_workqueue);
+}
+
+wboxtest_initcall(workqueue_wbt_init);
+wboxtest_exitcall(workqueue_wbt_exit);
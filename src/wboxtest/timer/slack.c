@@ -0,0 +1,106 @@
+/*
+ * wboxtest/timer/slack.c
+ */
+
+#include <wboxtest.h>
+
+struct wbt_slack_timer_t
+{
+	struct timer_t timer;
+	ktime_t expires;
+	ktime_t fired;
+	struct waiter_t * w;
+};
+
+struct wbt_slack_pdata_t
+{
+	struct wbt_slack_timer_t t[64];
+	struct waiter_t w;
+};
+
+static void * slack_setup(struct wboxtest_t * wbt)
+{
+	struct wbt_slack_pdata_t * pdat;
+
+	pdat = malloc(sizeof(struct wbt_slack_pdata_t));
+	if(!pdat)
+		return NULL;
+	waiter_init(&pdat->w);
+
+	return pdat;
+}
+
+static void slack_clean(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_slack_pdata_t * pdat = (struct wbt_slack_pdata_t *)data;
+
+	if(pdat)
+		free(pdat);
+}
+
+static int slack_timer_function(struct timer_t * timer, void * data)
+{
+	struct wbt_slack_timer_t * t = (struct wbt_slack_timer_t *)data;
+
+	t->fired = ktime_get();
+	waiter_sub(t->w, 1);
+	return 0;
+}
+
+static void slack_run(struct wboxtest_t * wbt, void * data)
+{
+	struct wbt_slack_pdata_t * pdat = (struct wbt_slack_pdata_t *)data;
+	struct wbt_slack_timer_t * t;
+	int64_t early = 0, late = 0;
+	int64_t slack, delta;
+	int i;
+
+	if(pdat)
+	{
+		for(i = 0; i < ARRAY_SIZE(pdat->t); i++)
+		{
+			t = &pdat->t[i];
+			t->w = &pdat->w;
+			timer_init(&t->timer, slack_timer_function, t);
+			timer_set_slack(&t->timer, ms_to_ktime((i & 0x3) * 25));
+			waiter_add(&pdat->w, 1);
+			delta = wboxtest_random_int(1, 1500);
+			t->expires = ktime_add_ms(ktime_get(), delta);
+			timer_start(&t->timer, ms_to_ktime(delta));
+		}
+		waiter_wait(&pdat->w);
+		for(i = 0; i < ARRAY_SIZE(pdat->t); i++)
+		{
+			t = &pdat->t[i];
+			slack = ktime_to_ns(t->timer.slack);
+			delta = ktime_to_ns(ktime_sub(t->fired, t->expires));
+			if(delta < 0)
+				early++;
+			else if(delta > slack + 20 * 1000000LL)
+				late++;
+		}
+		assert_equal(early, 0);
+		assert_equal(late, 0);
+	}
+}
+
+static struct wboxtest_t wbt_slack = {
+	.group	= "timer",
+	.name	= "slack",
+	.setup	= slack_setup,
+	.clean	= slack_clean,
+	.run	= slack_run,
+};
+
+static __init void slack_wbt_init(void)
+{
+	register_wboxtest(&wbt_slack);
+}
+
+static __exit void slack_wbt_exit(void)
+{
+	unregister_wboxtest(&wbt_slack);
+}
+
+wboxtest_initcall(slack_wbt_init);
+wboxtest_exitcall(slack_wbt_exit);